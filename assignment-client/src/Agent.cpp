@@ -13,7 +13,6 @@
 #include <QtCore/QEventLoop>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QTimer>
-#include <QtNetwork/QNetworkDiskCache>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
@@ -22,6 +21,7 @@
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <ResourceCache.h>
+#include <ResourceDiskCache.h>
 #include <SoundCache.h>
 #include <UUID.h>
 
@@ -146,6 +146,7 @@ void Agent::readPendingDatagrams() {
 }
 
 const QString AGENT_LOGGING_NAME = "agent";
+const qint64 MAXIMUM_AGENT_CACHE_SIZE = 1073741824; // 1GB
 
 void Agent::run() {
     ThreadedAssignment::commonInit(AGENT_LOGGING_NAME, NodeType::Agent);
@@ -168,14 +169,12 @@ void Agent::run() {
         scriptURL = QUrl(_payload);
     }
    
+    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+    ResourceDiskCache::setCacheDirectory(!cachePath.isEmpty() ? cachePath : "agentCache", MAXIMUM_AGENT_CACHE_SIZE);
+    
     QNetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
     QNetworkReply *reply = networkAccessManager.get(QNetworkRequest(scriptURL));
     
-    QNetworkDiskCache* cache = new QNetworkDiskCache();
-    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
-    cache->setCacheDirectory(!cachePath.isEmpty() ? cachePath : "agentCache");
-    networkAccessManager.setCache(cache);
-    
     qDebug() << "Downloading script at" << scriptURL.toString();
     
     QEventLoop loop;
@@ -66,6 +66,7 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
     const QString ASSIGNMENT_WALLET_DESTINATION_ID_OPTION = "wallet";
     const QString CUSTOM_ASSIGNMENT_SERVER_HOSTNAME_OPTION = "a";
     const QString CUSTOM_ASSIGNMENT_SERVER_PORT_OPTION = "p";
+    const QString DATAGRAM_CAPTURE_FILE_OPTION = "capture";
 
     Assignment::Type requestAssignmentType = Assignment::AllTypes;
 
@@ -109,6 +110,11 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
         argumentVariantMap.value(CUSTOM_ASSIGNMENT_SERVER_PORT_OPTION).toString().toUInt();
     }
     
+    // check for a file to capture inbound datagrams to, for later replay with the packet-replay tool
+    if (argumentVariantMap.contains(DATAGRAM_CAPTURE_FILE_OPTION)) {
+        nodeList->startDatagramCapture(argumentVariantMap.value(DATAGRAM_CAPTURE_FILE_OPTION).toString());
+    }
+    
     _assignmentServerSocket = HifiSockAddr(_assignmentServerHostname, assignmentServerPort, true);
     nodeList->setAssignmentServerSocket(_assignmentServerSocket);
 
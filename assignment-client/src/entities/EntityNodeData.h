@@ -18,17 +18,17 @@
 
 class EntityNodeData : public OctreeQueryNode {
 public:
-    EntityNodeData() :
+    EntityNodeData(int deletedEntitiesReader) :
         OctreeQueryNode(),
-        _lastDeletedEntitiesSentAt(0) { }
+        _deletedEntitiesReader(deletedEntitiesReader) { }
 
     virtual PacketType getMyPacketType() const { return PacketTypeEntityData; }
 
-    quint64 getLastDeletedEntitiesSentAt() const { return _lastDeletedEntitiesSentAt; }
-    void setLastDeletedEntitiesSentAt(quint64 sentAt) { _lastDeletedEntitiesSentAt = sentAt; }
+    /// Our reader of the tree's deleted entities, see EntityTree::addDeletedEntitiesReader()
+    int getDeletedEntitiesReader() const { return _deletedEntitiesReader; }
 
 private:
-    quint64 _lastDeletedEntitiesSentAt;
+    int _deletedEntitiesReader;
 };
 
 #endif // hifi_EntityNodeData_h
@@ -9,7 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
-#include <QTimer>
+#include <EntityEncodeCache.h>
 #include <EntityTree.h>
 #include <SimpleEntitySimulation.h>
 
@@ -32,7 +32,8 @@ EntityServer::~EntityServer() {
 }
 
 OctreeQueryNode* EntityServer::createOctreeQueryNode() {
-    return new EntityNodeData();
+    EntityTree* tree = static_cast<EntityTree*>(_tree);
+    return new EntityNodeData(tree->addDeletedEntitiesReader());
 }
 
 Octree* EntityServer::createTree() {
@@ -47,11 +48,48 @@ Octree* EntityServer::createTree() {
     return tree;
 }
 
-void EntityServer::beforeRun() {
-    QTimer* pruneDeletedEntitiesTimer = new QTimer(this);
-    connect(pruneDeletedEntitiesTimer, SIGNAL(timeout()), this, SLOT(pruneDeletedEntities()));
-    const int PRUNE_DELETED_MODELS_INTERVAL_MSECS = 1 * 1000; // once every second
-    pruneDeletedEntitiesTimer->start(PRUNE_DELETED_MODELS_INTERVAL_MSECS);
+QString EntityServer::serverSubclassStats() {
+    const float MEGABYTES = 1000000.0f;
+    const float AS_PERCENT = 100.0f;
+    quint64 hits = EntityEncodeCache::getHits();
+    quint64 lookups = hits + EntityEncodeCache::getMisses();
+    QString statsString;
+    statsString += QString().sprintf("Entity Encode Cache:             %8.2f MB of %.2f MB for %llu entities\r\n",
+                                     EntityEncodeCache::getCachedBytes() / MEGABYTES,
+                                     EntityEncodeCache::getMaximumBytes() / MEGABYTES,
+                                     (unsigned long long)EntityEncodeCache::getCachedEntities());
+    statsString += QString().sprintf("Entity Encodes Over Budget:      %8llu\r\n",
+                                     (unsigned long long)EntityEncodeCache::getOverBudget());
+    statsString += QString().sprintf("Entity Encode Cache Hit Rate:    %8.2f%% of %llu encodes\r\n",
+                                     lookups == 0 ? 0.0f : (float)hits / (float)lookups * AS_PERCENT,
+                                     (unsigned long long)lookups);
+    EntityTree* tree = static_cast<EntityTree*>(_tree);
+    quint64 oldestDeleteTime = tree->getOldestLoggedDeleteTime();
+    statsString += QString().sprintf("Deleted Entities Log:            %8d entities, oldest %.2f secs ago\r\n",
+                                     tree->getDeletedEntitiesLogSize(), oldestDeleteTime == 0 ? 0.0f :
+                                     (float)(usecTimestampNow() - oldestDeleteTime) / (float)USECS_PER_SECOND);
+    statsString += "\r\n";
+    return statsString;
+}
+
+void EntityServer::readAdditionalConfiguration(const QJsonObject& settingsSectionObject) {
+    // Unless the user turns it off, edits that leave entities in place don't wait for the threads sending to clients,
+    // which read the last published version of the entities instead
+    bool noVersionedReads;
+    readOptionBool(QString("NoVersionedReads"), settingsSectionObject, noVersionedReads);
+    qDebug("versionedReads=%s", debug::valueOf(!noVersionedReads));
+
+    EntityTree* tree = static_cast<EntityTree*>(_tree);
+    tree->setVersionedReads(!noVersionedReads);
+
+    // Check to see if the user wants a different budget for the encodings entities keep of themselves, 0 disables them
+    int entityEncodeCacheSizeMB = DEFAULT_ENTITY_ENCODE_CACHE_SIZE / BYTES_PER_MEGABYTE;
+    readOptionInt(QString("entityEncodeCacheSizeMB"), settingsSectionObject, entityEncodeCacheSizeMB);
+    if (entityEncodeCacheSizeMB < 0) {
+        entityEncodeCacheSizeMB = 0;
+    }
+    EntityEncodeCache::setMaximumBytes(entityEncodeCacheSizeMB * (qint64)BYTES_PER_MEGABYTE);
+    qDebug("entityEncodeCacheSizeMB=%d", entityEncodeCacheSizeMB);
 }
 
 void EntityServer::entityCreated(const EntityItem& newEntity, const SharedNodePointer& senderNode) {
@@ -84,13 +122,11 @@ void EntityServer::entityCreated(const EntityItem& newEntity, const SharedNodePo
 bool EntityServer::hasSpecialPacketToSend(const SharedNodePointer& node) {
     bool shouldSendDeletedEntities = false;
 
-    // check to see if any new entities have been added since we last sent to this node...
+    // check to see if any entities have been deleted since we last sent to this node...
     EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-
         EntityTree* tree = static_cast<EntityTree*>(_tree);
-        shouldSendDeletedEntities = tree->hasEntitiesDeletedSince(deletedEntitiesSentAt);
+        shouldSendDeletedEntities = tree->hasDeletedEntitiesToSend(nodeData->getDeletedEntitiesReader());
     }
 
     return shouldSendDeletedEntities;
@@ -102,47 +138,33 @@ int EntityServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNo
 
     EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-        quint64 deletePacketSentAt = usecTimestampNow();
-
         EntityTree* tree = static_cast<EntityTree*>(_tree);
         bool hasMoreToSend = true;
 
         // TODO: is it possible to send too many of these packets? what if you deleted 1,000,000 entities?
         packetsSent = 0;
         while (hasMoreToSend) {
-            hasMoreToSend = tree->encodeEntitiesDeletedSince(queryNode->getSequenceNumber(), deletedEntitiesSentAt,
-                                                outputBuffer, MAX_PACKET_SIZE, packetLength);
+            hasMoreToSend = tree->encodeDeletedEntities(queryNode->getSequenceNumber(),
+                                                        nodeData->getDeletedEntitiesReader(),
+                                                        outputBuffer, MAX_PACKET_SIZE, packetLength);
 
             NodeList::getInstance()->writeDatagram((char*) outputBuffer, packetLength, SharedNodePointer(node));
             queryNode->packetSent(outputBuffer, packetLength);
             packetsSent++;
         }
-
-        nodeData->setLastDeletedEntitiesSentAt(deletePacketSentAt);
     }
 
     // TODO: caller is expecting a packetLength, what if we send more than one packet??
     return packetLength;
 }
 
-void EntityServer::pruneDeletedEntities() {
-    EntityTree* tree = static_cast<EntityTree*>(_tree);
-    if (tree->hasAnyDeletedEntities()) {
-
-        quint64 earliestLastDeletedEntitiesSent = usecTimestampNow() + 1; // in the future
-        
-        NodeList::getInstance()->eachNode([&earliestLastDeletedEntitiesSent](const SharedNodePointer& node) {
-            if (node->getLinkedData()) {
-                EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
-                quint64 nodeLastDeletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-                if (nodeLastDeletedEntitiesSentAt < earliestLastDeletedEntitiesSent) {
-                    earliestLastDeletedEntitiesSent = nodeLastDeletedEntitiesSentAt;
-                }
-            }
-        });
-        
-        tree->forgetEntitiesDeletedBefore(earliestLastDeletedEntitiesSent);
+void EntityServer::nodeKilled(SharedNodePointer node) {
+    // the deletes this node hasn't had yet don't need to be kept for it anymore
+    EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
+    if (nodeData) {
+        EntityTree* tree = static_cast<EntityTree*>(_tree);
+        tree->removeDeletedEntitiesReader(nodeData->getDeletedEntitiesReader());
     }
+    OctreeServer::nodeKilled(node);
 }
 
@@ -36,17 +36,18 @@ public:
     virtual QString getMyDomainSettingsKey() const { return QString("entity_server_settings"); }
 
     // subclass may implement these method
-    virtual void beforeRun();
     virtual bool hasSpecialPacketToSend(const SharedNodePointer& node);
     virtual int sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNode* queryNode, int& packetsSent);
+    virtual QString serverSubclassStats();
 
     virtual void entityCreated(const EntityItem& newEntity, const SharedNodePointer& senderNode);
 
 public slots:
-    void pruneDeletedEntities();
+    virtual void nodeKilled(SharedNodePointer node);
 
 protected:
     virtual Octree* createTree();
+    virtual void readAdditionalConfiguration(const QJsonObject& settingsSectionObject);
 
 private:
     EntitySimulation* _entitySimulation;
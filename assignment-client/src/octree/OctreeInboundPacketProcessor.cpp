@@ -29,7 +29,9 @@ OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServe
     _totalElementsInPacket(0),
     _totalPackets(0),
     _lastNackTime(usecTimestampNow()),
-    _shuttingDown(false)
+    _shuttingDown(false),
+    _inEditBatch(false),
+    _editBatchStarted(0)
 {
 }
 
@@ -64,14 +66,42 @@ void OctreeInboundPacketProcessor::preProcess() {
 }
 
 void OctreeInboundPacketProcessor::midProcess() {
-    // check if it's time to send a nack. If yes, do so
+    // let readers and other writers in between batches, but keep going while packets are still queued
     quint64 now = usecTimestampNow();
+    if (_inEditBatch && (!hasPacketsToProcess() || now - _editBatchStarted >= MAX_EDIT_BATCH_USECS)) {
+        endEditBatch();
+    }
+
+    // check if it's time to send a nack. If yes, do so
     if (now - _lastNackTime >= TOO_LONG_SINCE_LAST_NACK) {
         _lastNackTime = now;
         sendNackPackets();
     }
 }
 
+void OctreeInboundPacketProcessor::postProcess() {
+    if (_inEditBatch) {
+        endEditBatch();
+    }
+}
+
+quint64 OctreeInboundPacketProcessor::beginEditBatch() {
+    quint64 startLock = usecTimestampNow();
+    _myServer->getOctree()->lockForEdit();
+    _editBatchStarted = usecTimestampNow();
+    _myServer->getOctree()->beginEditBatch();
+    _inEditBatch = true;
+    return _editBatchStarted - startLock;
+}
+
+void OctreeInboundPacketProcessor::endEditBatch() {
+    quint64 startEnd = usecTimestampNow();
+    _myServer->getOctree()->endEditBatch();
+    _myServer->getOctree()->unlockForEdit();
+    _inEditBatch = false;
+    _totalProcessTime += usecTimestampNow() - startEnd;
+}
+
 void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
     if (_shuttingDown) {
         qDebug() << "OctreeInboundPacketProcessor::processPacket() while shutting down... ignoring incoming packet";
@@ -139,6 +169,11 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
         }
         
 
+        // edits have to see the whole tree, so they wait for the part of it that's still loading
+        if (!_myServer->isFullyLoaded()) {
+            _myServer->finishLoading();
+        }
+
         unsigned char* editData = (unsigned char*)&packetData[atByte];
         while (atByte < packet.size()) {
         
@@ -152,8 +187,9 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
                         packetType, packetData, packet.size(), editData, atByte, maxSize);
             }
 
-            quint64 startLock = usecTimestampNow();
-            _myServer->getOctree()->lockForWrite();
+            if (!_inEditBatch) {
+                lockWaitTime += beginEditBatch();
+            }
             quint64 startProcess = usecTimestampNow();
             int editDataBytesRead = _myServer->getOctree()->processEditPacketData(packetType,
                                                                                   reinterpret_cast<const unsigned char*>(packet.data()),
@@ -165,14 +201,11 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
                                 << "editDataBytesRead=" << editDataBytesRead;
             }
 
-            _myServer->getOctree()->unlock();
             quint64 endProcess = usecTimestampNow();
 
             editsInPacket++;
             quint64 thisProcessTime = endProcess - startProcess;
-            quint64 thisLockWaitTime = startProcess - startLock;
             processTime += thisProcessTime;
-            lockWaitTime += thisLockWaitTime;
 
             // skip to next edit record in the packet
             editData += editDataBytesRead;
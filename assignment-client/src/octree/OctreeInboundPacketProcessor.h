@@ -83,10 +83,16 @@ protected:
     virtual unsigned long getMaxWait() const;
     virtual void preProcess();
     virtual void midProcess();
+    virtual void postProcess();
 
 private:
     int sendNackPackets();
 
+    /// Edits are applied in batches, under one edit lock for as many queued packets as fit in MAX_EDIT_BATCH_USECS.
+    /// Returns how long it waited for the lock.
+    quint64 beginEditBatch();
+    void endEditBatch();
+
 private:
     void trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime, 
             int elementsInPacket, quint64 processTime, quint64 lockWaitTime);
@@ -104,5 +110,8 @@ private:
 
     quint64 _lastNackTime;
     bool _shuttingDown;
+
+    bool _inEditBatch;
+    quint64 _editBatchStarted;
 };
 #endif // hifi_OctreeInboundPacketProcessor_h
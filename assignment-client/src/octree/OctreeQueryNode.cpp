@@ -14,6 +14,7 @@
 #include "OctreeQueryNode.h"
 #include <cstring>
 #include <cstdio>
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 
 OctreeQueryNode::OctreeQueryNode() :
@@ -34,12 +35,15 @@ OctreeQueryNode::OctreeQueryNode() :
     _currentPacketIsColor(true),
     _currentPacketIsCompressed(false),
     _octreeSendThread(NULL),
+    _octreeSendScheduler(),
     _lastClientBoundaryLevelAdjust(0),
     _lastClientOctreeSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
     _lodChanged(false),
     _lodInitialized(false),
     _sequenceNumber(0),
     _lastRootTimestamp(0),
+    _lastChangeSequenceSent(0),
+    _lastChangeSequenceTime(0),
     _myPacketType(PacketTypeUnknown),
     _isShuttingDown(false),
     _sentPacketHistory()
@@ -75,7 +79,9 @@ void OctreeQueryNode::forceNodeShutdown() {
         OctreeSendThread* sendThread = _octreeSendThread;
         _octreeSendThread = NULL;
         sendThread->setIsShuttingDown();
-        sendThread->terminate();
+        if (_octreeSendScheduler) {
+            _octreeSendScheduler->removeSendThread(sendThread);
+        }
         delete sendThread;
     }
 }
@@ -91,12 +97,17 @@ void OctreeQueryNode::sendThreadFinished() {
     }
 }
 
-void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node) {
+void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node,
+                                                 OctreeSendScheduler* sendScheduler) {
     _octreeSendThread = new OctreeSendThread(myAssignment, node);
+    _octreeSendScheduler = sendScheduler;
     
     // we want to be notified when the thread finishes
     connect(_octreeSendThread, &GenericThread::finished, this, &OctreeQueryNode::sendThreadFinished);
-    _octreeSendThread->initialize(true);
+
+    // we don't get a thread of our own, the scheduler's workers take turns running us
+    _octreeSendThread->initialize(false);
+    _octreeSendScheduler->addSendThread(_octreeSendThread);
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
@@ -369,7 +380,8 @@ void OctreeQueryNode::octreePacketSent() {
 }
 
 void OctreeQueryNode::packetSent(unsigned char* packet, int packetLength) {
-    packetSent(QByteArray((char*)packet, packetLength));
+    _sentPacketHistory.packetSent(_sequenceNumber, reinterpret_cast<const char*>(packet), packetLength);
+    _sequenceNumber++;
 }
 
 void OctreeQueryNode::packetSent(const QByteArray& packet) {
@@ -381,12 +393,12 @@ bool OctreeQueryNode::hasNextNackedPacket() const {
     return !_nackedSequenceNumbers.isEmpty();
 }
 
-const QByteArray* OctreeQueryNode::getNextNackedPacket() {
+QByteArray OctreeQueryNode::getNextNackedPacket() {
     if (!_nackedSequenceNumbers.isEmpty()) {
         // could return null if packet is not in the history
         return _sentPacketHistory.getPacket(_nackedSequenceNumbers.dequeue());
     }
-    return NULL;
+    return QByteArray();
 }
 
 void OctreeQueryNode::parseNackPacket(const QByteArray& packet) {
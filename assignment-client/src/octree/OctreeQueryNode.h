@@ -24,8 +24,10 @@
 #include <OctreeSceneStats.h>
 #include <ThreadedAssignment.h> // for SharedAssignmentPointer
 #include "SentPacketHistory.h"
+#include <qpointer.h>
 #include <qqueue.h>
 
+class OctreeSendScheduler;
 class OctreeSendThread;
 
 class OctreeQueryNode : public OctreeQuery {
@@ -89,13 +91,21 @@ public:
     
     OctreeSceneStats stats;
     
-    void initializeOctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node);
+    void initializeOctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node,
+                                    OctreeSendScheduler* sendScheduler);
     bool isOctreeSendThreadInitalized() { return _octreeSendThread; }
     
     void dumpOutOfView();
     
     quint64 getLastRootTimestamp() const { return _lastRootTimestamp; }
     void setLastRootTimestamp(quint64 timestamp) { _lastRootTimestamp = timestamp; }
+
+    /// The tree's change sequence when the scene we're sending started, and when we read it. 0 if we haven't started one
+    /// on a tree that logs its changes.
+    quint64 getLastChangeSequenceSent() const { return _lastChangeSequenceSent; }
+    quint64 getLastChangeSequenceTime() const { return _lastChangeSequenceTime; }
+    void setLastChangeSequenceSent(quint64 sequence, quint64 time)
+        { _lastChangeSequenceSent = sequence; _lastChangeSequenceTime = time; }
     unsigned int getlastOctreePacketLength() const { return _lastOctreePacketLength; }
     int getDuplicatePacketCount() const { return _duplicatePacketCount; }
     
@@ -111,7 +121,9 @@ public:
 
     void parseNackPacket(const QByteArray& packet);
     bool hasNextNackedPacket() const;
-    const QByteArray* getNextNackedPacket();
+    QByteArray getNextNackedPacket(); // only valid until the next packet is sent to this node
+
+    quint64 getSentPacketHistoryMemoryUsage() const { return _sentPacketHistory.getMemoryUsage(); }
 
 private slots:
     void sendThreadFinished();
@@ -142,6 +154,7 @@ private:
     bool _currentPacketIsCompressed;
 
     OctreeSendThread* _octreeSendThread;
+    QPointer<OctreeSendScheduler> _octreeSendScheduler;
 
     // watch for LOD changes
     int _lastClientBoundaryLevelAdjust;
@@ -152,6 +165,8 @@ private:
     OCTREE_PACKET_SEQUENCE _sequenceNumber;
 
     quint64 _lastRootTimestamp;
+    quint64 _lastChangeSequenceSent;
+    quint64 _lastChangeSequenceTime;
     
     PacketType _myPacketType;
     bool _isShuttingDown;
@@ -0,0 +1,176 @@
+//
+//  OctreeSendScheduler.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include <SharedUtil.h>
+
+#include "OctreeSendScheduler.h"
+#include "OctreeSendThread.h"
+#include "OctreeServerConsts.h"
+
+static bool isDueLater(const ScheduledSend& first, const ScheduledSend& second) {
+    return first.dueUsecs > second.dueUsecs;
+}
+
+OctreeSendWorker::OctreeSendWorker(OctreeSendScheduler* scheduler) :
+    _scheduler(scheduler)
+{
+}
+
+bool OctreeSendWorker::process() {
+    return _scheduler->runNextSend() && isStillRunning();
+}
+
+OctreeSendScheduler::OctreeSendScheduler(int workerCount) :
+    _workers(),
+    _mutex(),
+    _queueChanged(),
+    _sendFinished(),
+    _runQueue(),
+    _sendThreads(),
+    _runningSendThreads(),
+    _isStopping(false),
+    _averageQueueLatency(),
+    _maxQueueLatency(0),
+    _runs(0),
+    _missedIntervals(0)
+{
+    workerCount = std::max(1, workerCount);
+    qDebug() << "Starting" << workerCount << "octree send workers";
+    for (int i = 0; i < workerCount; i++) {
+        OctreeSendWorker* worker = new OctreeSendWorker(this);
+        worker->initialize(true);
+        _workers.append(worker);
+    }
+}
+
+OctreeSendScheduler::~OctreeSendScheduler() {
+    stop();
+}
+
+void OctreeSendScheduler::addSendThread(OctreeSendThread* sendThread) {
+    QMutexLocker locker(&_mutex);
+    if (_isStopping || _sendThreads.contains(sendThread)) {
+        return;
+    }
+    _sendThreads.insert(sendThread);
+    pushSend(ScheduledSend(sendThread, usecTimestampNow()));
+    _queueChanged.wakeOne();
+}
+
+void OctreeSendScheduler::removeSendThread(OctreeSendThread* sendThread) {
+    QMutexLocker locker(&_mutex);
+    _sendThreads.remove(sendThread);
+    for (int i = 0; i < _runQueue.size(); i++) {
+        if (_runQueue.at(i).sendThread == sendThread) {
+            _runQueue.remove(i);
+            std::make_heap(_runQueue.begin(), _runQueue.end(), isDueLater);
+            break;
+        }
+    }
+    while (_runningSendThreads.contains(sendThread)) {
+        _sendFinished.wait(&_mutex);
+    }
+}
+
+void OctreeSendScheduler::stop() {
+    {
+        QMutexLocker locker(&_mutex);
+        _isStopping = true;
+        _runQueue.clear();
+        _queueChanged.wakeAll();
+    }
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->terminate();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+int OctreeSendScheduler::getSendThreadCount() {
+    QMutexLocker locker(&_mutex);
+    return _sendThreads.size();
+}
+
+void OctreeSendScheduler::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _averageQueueLatency.reset();
+    _maxQueueLatency = 0;
+    _runs = 0;
+    _missedIntervals = 0;
+}
+
+bool OctreeSendScheduler::runNextSend() {
+    QMutexLocker locker(&_mutex);
+    ScheduledSend send;
+    quint64 now = 0;
+    while (true) {
+        if (_isStopping) {
+            return false;
+        }
+        if (_runQueue.isEmpty()) {
+            _queueChanged.wait(&_mutex);
+            continue;
+        }
+        now = usecTimestampNow();
+        quint64 dueUsecs = _runQueue.first().dueUsecs;
+        if (dueUsecs > now) {
+            unsigned long msecsToWait = (dueUsecs - now + USECS_PER_MSEC - 1) / USECS_PER_MSEC;
+            _queueChanged.wait(&_mutex, msecsToWait);
+            continue;
+        }
+        send = popSend();
+        break;
+    }
+
+    quint64 queueLatency = now - send.dueUsecs;
+    _averageQueueLatency.updateAverage(queueLatency);
+    _maxQueueLatency = std::max(_maxQueueLatency, queueLatency);
+    _runs++;
+    _runningSendThreads.insert(send.sendThread);
+    locker.unlock();
+
+    bool keepRunning = send.sendThread->process();
+
+    locker.relock();
+    _runningSendThreads.remove(send.sendThread);
+    if (keepRunning && !_isStopping && _sendThreads.contains(send.sendThread)) {
+        quint64 nextDueUsecs = send.dueUsecs + OCTREE_SEND_INTERVAL_USECS;
+        quint64 finished = usecTimestampNow();
+        if (nextDueUsecs < finished) {
+            // we ran late, so skip the intervals we missed instead of bursting to catch up
+            _missedIntervals += (finished - nextDueUsecs) / OCTREE_SEND_INTERVAL_USECS + 1;
+            nextDueUsecs = finished;
+        }
+        pushSend(ScheduledSend(send.sendThread, nextDueUsecs));
+        _queueChanged.wakeOne();
+    } else if (!keepRunning && _sendThreads.remove(send.sendThread)) {
+        // the client is going away, let its owner clean up the send thread
+        emit send.sendThread->finished();
+    }
+    _sendFinished.wakeAll();
+    return true;
+}
+
+void OctreeSendScheduler::pushSend(const ScheduledSend& send) {
+    _runQueue.append(send);
+    std::push_heap(_runQueue.begin(), _runQueue.end(), isDueLater);
+}
+
+ScheduledSend OctreeSendScheduler::popSend() {
+    std::pop_heap(_runQueue.begin(), _runQueue.end(), isDueLater);
+    ScheduledSend send = _runQueue.last();
+    _runQueue.removeLast();
+    return send;
+}
@@ -0,0 +1,104 @@
+//
+//  OctreeSendScheduler.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendScheduler_h
+#define hifi_OctreeSendScheduler_h
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <GenericThread.h>
+#include <SimpleMovingAverage.h>
+
+class OctreeSendScheduler;
+class OctreeSendThread;
+
+/// One send interval of one client, due at a given time
+class ScheduledSend {
+public:
+    ScheduledSend(OctreeSendThread* sendThread = NULL, quint64 dueUsecs = 0) :
+        sendThread(sendThread),
+        dueUsecs(dueUsecs) { }
+
+    OctreeSendThread* sendThread;
+    quint64 dueUsecs;
+};
+
+/// A worker of the send pool, runs whatever send is due next
+class OctreeSendWorker : public GenericThread {
+    Q_OBJECT
+public:
+    OctreeSendWorker(OctreeSendScheduler* scheduler);
+
+protected:
+    virtual bool process();
+
+private:
+    OctreeSendScheduler* _scheduler;
+};
+
+/// Runs the OctreeSendThreads of all connected clients on a fixed pool of worker threads. Every client is due once per
+/// send interval, and due sends wait in a run queue ordered by when they were due. A client whose send ran long is due
+/// again as soon as it finishes, behind everyone who came due in the meantime, and the intervals it missed are dropped
+/// rather than made up.
+class OctreeSendScheduler : public QObject {
+    Q_OBJECT
+public:
+    OctreeSendScheduler(int workerCount);
+    ~OctreeSendScheduler();
+
+    void addSendThread(OctreeSendThread* sendThread);
+
+    /// Takes the send thread out of the run queue, waiting for a worker that is running it right now to finish.
+    void removeSendThread(OctreeSendThread* sendThread);
+
+    /// Stops the workers, sends still queued are dropped.
+    void stop();
+
+    int getWorkerCount() const { return _workers.size(); }
+    int getSendThreadCount();
+
+    /// How long due sends waited in the run queue before a worker picked them up
+    float getAverageQueueLatency() const { return _averageQueueLatency.getAverage(); }
+    quint64 getMaxQueueLatency() const { return _maxQueueLatency; }
+    quint64 getRuns() const { return _runs; }
+    quint64 getMissedIntervals() const { return _missedIntervals; }
+    void resetStats();
+
+private:
+    friend class OctreeSendWorker;
+
+    /// Waits for the next send to come due, runs it and puts it back in the queue for its next interval. Returns false
+    /// once the scheduler is stopping.
+    bool runNextSend();
+
+    void pushSend(const ScheduledSend& send);
+    ScheduledSend popSend();
+
+    QVector<OctreeSendWorker*> _workers;
+
+    QMutex _mutex;
+    QWaitCondition _queueChanged;
+    QWaitCondition _sendFinished;
+    QVector<ScheduledSend> _runQueue; // min-heap on dueUsecs
+    QSet<OctreeSendThread*> _sendThreads;
+    QSet<OctreeSendThread*> _runningSendThreads;
+    bool _isStopping;
+
+    SimpleMovingAverage _averageQueueLatency;
+    quint64 _maxQueueLatency;
+    quint64 _runs;
+    quint64 _missedIntervals;
+};
+
+#endif // hifi_OctreeSendScheduler_h
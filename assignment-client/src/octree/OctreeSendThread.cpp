@@ -18,9 +18,6 @@
 #include "OctreeServer.h"
 #include "OctreeServerConsts.h"
 
-quint64 startSceneSleepTime = 0;
-quint64 endSceneSleepTime = 0;
-
 OctreeSendThread::OctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node) :
     _myAssignment(myAssignment),
     _myServer(static_cast<OctreeServer*>(myAssignment.data())),
@@ -73,8 +70,6 @@ bool OctreeSendThread::process() {
 
     OctreeServer::didProcess(this);
 
-    quint64  start = usecTimestampNow();
-
     // don't do any send processing until the initial load of the octree is complete...
     if (_myServer->isInitialLoadComplete()) {
         if (_node) {
@@ -84,36 +79,18 @@ bool OctreeSendThread::process() {
             // Sometimes the node data has not yet been linked, in which case we can't really do anything
             if (nodeData && !nodeData->isShuttingDown()) {
                 bool viewFrustumChanged = nodeData->updateCurrentViewFrustum();
+                if (!_myServer->isFullyLoaded()) {
+                    _myServer->hydrateView(nodeData->getCurrentViewFrustum()); // load what they see first
+                }
                 packetDistributor(nodeData, viewFrustumChanged);
             }
         }
     }
 
-    if (_isShuttingDown) {
-        return false; // exit early if we're shutting down
-    }
-
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning()) {
-        // dynamically sleep until we need to fire off the next set of octree elements
-        int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
-
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            const int MIN_USEC_TO_SLEEP = 1;
-            usleep(MIN_USEC_TO_SLEEP);
-        }
-    }
-
-    return isStillRunning();  // keep running till they terminate us
+    // the scheduler takes care of waiting until our next interval is due
+    return !_isShuttingDown;
 }
 
-quint64 OctreeSendThread::_usleepTime = 0;
-quint64 OctreeSendThread::_usleepCalls = 0;
-
 quint64 OctreeSendThread::_totalBytes = 0;
 quint64 OctreeSendThread::_totalWastedBytes = 0;
 quint64 OctreeSendThread::_totalPackets = 0;
@@ -279,6 +256,38 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
     return packetsSent;
 }
 
+// sends the server's special packets and any packets the client nacked, returning how many went out
+int OctreeSendThread::handleSpecialPacketSends(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent,
+                                               int packetsSentThisInterval, int maxPacketsPerInterval) {
+    int packetsSent = 0;
+
+    // Here's where we can/should allow the server to send other data...
+    // send the environment packet
+    // TODO: should we turn this into a while loop to better handle sending multiple special packets
+    if (_myServer->hasSpecialPacketToSend(_node) && !nodeData->isShuttingDown()) {
+        int specialPacketsSent;
+        trueBytesSent += _myServer->sendSpecialPacket(_node, nodeData, specialPacketsSent);
+        nodeData->resetOctreePacket();   // because nodeData's _sequenceNumber has changed
+        truePacketsSent += specialPacketsSent;
+        packetsSent += specialPacketsSent;
+    }
+
+    // Re-send packets that were nacked by the client
+    while (nodeData->hasNextNackedPacket() && packetsSentThisInterval + packetsSent < maxPacketsPerInterval) {
+        QByteArray packet = nodeData->getNextNackedPacket();
+        if (!packet.isNull()) {
+            NodeList::getInstance()->writeDatagram(packet, _node);
+            truePacketsSent++;
+            packetsSent++;
+
+            _totalBytes += packet.size();
+            _totalPackets++;
+            _totalWastedBytes += MAX_PACKET_SIZE - packet.size();
+        }
+    }
+    return packetsSent;
+}
+
 /// Version of octree element distributor that sends the deepest LOD level at once
 int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrustumChanged) {
         
@@ -328,10 +337,24 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
     const ViewFrustum* lastViewFrustum =  wantDelta ? &nodeData->getLastKnownViewFrustum() : NULL;
 
+    // A client that already has its whole view only needs what changed since, and a tree that logs its changes can say
+    // where those are without a walk from the root. If nothing changed, there's no scene to send at all.
+    Octree* octree = _myServer->getOctree();
+    quint64 changeSequence = octree->getChangeSequence();
+    bool sendChangesOnly = !viewFrustumChanged && !isFullScene && nodeData->getViewSent() &&
+        nodeData->elementBag.isEmpty() && nodeData->getLastChangeSequenceSent() > 0;
+    if (sendChangesOnly && changeSequence == nodeData->getLastChangeSequenceSent()) {
+        handleSpecialPacketSends(nodeData, trueBytesSent, truePacketsSent, packetsSentThisInterval, maxPacketsPerInterval);
+        return truePacketsSent;
+    }
+
     // If the current view frustum has changed OR we have nothing to send, then search against
     // the current view frustum for things to send.
     if (viewFrustumChanged || nodeData->elementBag.isEmpty()) {
 
+        // send what looks biggest from where the client is now first, including what's left from before it moved
+        nodeData->elementBag.setPriorityView(nodeData->getCurrentViewFrustum());
+
         // if our view has changed, we need to reset these things...
         if (viewFrustumChanged) {
             if (nodeData->moveShouldDump() || nodeData->hasLodChanged()) {
@@ -352,8 +375,6 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         _myServer->getOctree()->releaseSceneEncodeData(&nodeData->extraEncodeData);
 
         // TODO: add these to stats page
-        //::endSceneSleepTime = _usleepTime;
-        //unsigned long sleepTime = ::endSceneSleepTime - ::startSceneSleepTime;
         //unsigned long encodeTime = nodeData->stats.getTotalEncodeTime();
         //unsigned long elapsedTime = nodeData->stats.getElapsedTime();
 
@@ -365,9 +386,6 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             nodeData->elementBag.deleteAll();
         }
 
-        // TODO: add these to stats page
-        //::startSceneSleepTime = _usleepTime;
-        
         // start tracking our stats
         nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getOctree()->getRoot(), _myServer->getJurisdiction());
 
@@ -377,9 +395,23 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             if (nodeData->elementBag.isEmpty()) {
                 nodeData->elementBag.insert(_myServer->getOctree()->getRoot());
             }
+        } else if (sendChangesOnly) {
+            QSet<OctreeElement*> changedElements;
+            octree->lockForRead();
+            octree->findElementsChangedSince(nodeData->getLastChangeSequenceSent(), changedElements);
+            octree->unlock();
+            foreach (OctreeElement* element, changedElements) {
+                nodeData->elementBag.insert(element);
+            }
+
+            // the entities in those elements that changed before our last scene started were sent with it
+            nodeData->setLastTimeBagEmpty(nodeData->getLastChangeSequenceTime() - CHANGE_FUDGE);
         } else {
             nodeData->elementBag.insert(_myServer->getOctree()->getRoot());
         }
+        if (changeSequence > 0) {
+            nodeData->setLastChangeSequenceSent(changeSequence, usecTimestampNow());
+        }
     }
 
     // If we have something in our elementBag, then turn them into packets and send them out...
@@ -559,30 +591,8 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         }
 
 
-        // Here's where we can/should allow the server to send other data...
-        // send the environment packet
-        // TODO: should we turn this into a while loop to better handle sending multiple special packets
-        if (_myServer->hasSpecialPacketToSend(_node) && !nodeData->isShuttingDown()) {
-            int specialPacketsSent;
-            trueBytesSent += _myServer->sendSpecialPacket(_node, nodeData, specialPacketsSent);
-            nodeData->resetOctreePacket();   // because nodeData's _sequenceNumber has changed
-            truePacketsSent += specialPacketsSent;
-            packetsSentThisInterval += specialPacketsSent;
-        }
-
-        // Re-send packets that were nacked by the client
-        while (nodeData->hasNextNackedPacket() && packetsSentThisInterval < maxPacketsPerInterval) {
-            const QByteArray* packet = nodeData->getNextNackedPacket();
-            if (packet) {
-                NodeList::getInstance()->writeDatagram(*packet, _node);
-                truePacketsSent++;
-                packetsSentThisInterval++;
-
-                _totalBytes += packet->size();
-                _totalPackets++;
-                _totalWastedBytes += MAX_PACKET_SIZE - packet->size();
-            }
-        }
+        packetsSentThisInterval += handleSpecialPacketSends(nodeData, trueBytesSent, truePacketsSent,
+                                                            packetsSentThisInterval, maxPacketsPerInterval);
 
         quint64 end = usecTimestampNow();
         int elapsedmsec = (end - start)/USECS_PER_MSEC;
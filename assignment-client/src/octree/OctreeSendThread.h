@@ -22,7 +22,8 @@
 
 class OctreeServer;
 
-/// Threaded processor for sending octree packets to a single client
+/// Processor for sending octree packets to a single client. Runs non-threaded, the OctreeSendScheduler calls process()
+/// from one of its workers once every send interval.
 class OctreeSendThread : public GenericThread {
     Q_OBJECT
 public:
@@ -31,17 +32,13 @@ public:
     
     void setIsShuttingDown();
 
+    /// Does one send interval worth of work for our client. Returns false once we're shutting down.
+    virtual bool process();
+
     static quint64 _totalBytes;
     static quint64 _totalWastedBytes;
     static quint64 _totalPackets;
 
-    static quint64 _usleepTime;
-    static quint64 _usleepCalls;
-
-protected:
-    /// Implements generic processing behavior for this thread.
-    virtual bool process();
-
 private:
     SharedAssignmentPointer _myAssignment;
     OctreeServer* _myServer;
@@ -49,6 +46,8 @@ private:
     QUuid _nodeUUID;
 
     int handlePacketSend(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent);
+    int handleSpecialPacketSends(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent,
+                                 int packetsSentThisInterval, int maxPacketsPerInterval);
     int packetDistributor(OctreeQueryNode* nodeData, bool viewFrustumChanged);
 
     OctreePacketData _packetData;
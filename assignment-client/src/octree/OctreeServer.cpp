@@ -11,6 +11,7 @@
 
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QThread>
 #include <QTimer>
 #include <QUuid>
 
@@ -19,6 +20,9 @@
 #include <AccountManager.h>
 #include <HTTPConnection.h>
 #include <LogHandler.h>
+#include <OctreeEditLog.h>
+#include <OctreeElementPool.h>
+#include <OctreeEncodeCache.h>
 #include <UUID.h>
 
 #include "../AssignmentClient.h"
@@ -122,6 +126,10 @@ void OctreeServer::resetSendingStats() {
     _longProcessWait = 0;
     _shortProcessWait = 0;
     _noProcessWait = 0;
+
+    if (_sendScheduler) {
+        _sendScheduler->resetStats();
+    }
 }
 
 void OctreeServer::trackEncodeTime(float time) { 
@@ -236,6 +244,12 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _jurisdictionSender(NULL),
     _octreeInboundPacketProcessor(NULL),
     _persistThread(NULL),
+    _sendScheduler(NULL),
+    _sendThreads(std::max(1, QThread::idealThreadCount())),
+    _wantEditLog(false),
+    _editLogCommitInterval(OctreeEditLog::DEFAULT_COMMIT_INTERVAL),
+    _editLogCompactSizeMB(OctreeEditLog::DEFAULT_COMPACT_SIZE / BYTES_PER_MEGABYTE),
+    _wantIndexedPersist(false),
     _started(time(0)),
     _startedUSecs(usecTimestampNow())
 {
@@ -278,6 +292,11 @@ OctreeServer::~OctreeServer() {
         _persistThread->deleteLater();
     }
 
+    if (_sendScheduler) {
+        _sendScheduler->stop();
+        _sendScheduler->deleteLater();
+    }
+
     delete _jurisdiction;
     _jurisdiction = NULL;
     
@@ -372,6 +391,26 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             statsString += getFileLoadTime();
             statsString += "\r\n";
 
+            if (!isFullyLoaded()) {
+                statsString += "Still loading the rest of the octree file in the background...\r\n";
+            } else if (_persistThread && _persistThread->getHydrationElapsedTime() > 0) {
+                statsString += QString().sprintf("Loading the rest of the octree file in the background took %.3f seconds\r\n",
+                                                 (float)_persistThread->getHydrationElapsedTime() / (float)USECS_PER_SECOND);
+            }
+
+            OctreeEditLog* editLog = _persistThread ? _persistThread->getEditLog() : NULL;
+            if (editLog) {
+                statsString += QString().sprintf("Edit log: %llu edits replayed at load, %llu logged since\r\n",
+                                                 (unsigned long long)editLog->getRecordsReplayed(),
+                                                 (unsigned long long)editLog->getRecordsAppended());
+                statsString += QString().sprintf("Edit log: %llu commits, average %.2f edits and %.2f usecs per commit\r\n",
+                                                 (unsigned long long)editLog->getCommits(),
+                                                 editLog->getAverageRecordsPerCommit(), editLog->getAverageCommitTime());
+                statsString += QString().sprintf("Edit log: %lld bytes, %llu compactions\r\n",
+                                                 (long long)editLog->getSize(),
+                                                 (unsigned long long)editLog->getCompactions());
+            }
+
         } else {
             statsString += "Octree file not yet loaded...\r\n";
         }
@@ -423,6 +462,18 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("          Total Clients Connected: %1 clients\r\n")
             .arg(locale.toString((uint)getCurrentClientCount()).rightJustified(COLUMN_WIDTH, ' '));
 
+        if (_sendScheduler) {
+            statsString += QString("              Send Worker Threads: %1 threads\r\n")
+                .arg(locale.toString((uint)_sendScheduler->getWorkerCount()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("       Average Send Queue Latency: %1 usecs\r\n")
+                .arg(locale.toString((uint)_sendScheduler->getAverageQueueLatency()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("           Max Send Queue Latency: %1 usecs\r\n")
+                .arg(locale.toString((uint)_sendScheduler->getMaxQueueLatency()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("            Missed Send Intervals: %1 of %2 intervals run\r\n")
+                .arg(locale.toString((uint)_sendScheduler->getMissedIntervals()).rightJustified(COLUMN_WIDTH, ' '))
+                .arg(locale.toString((uint)_sendScheduler->getRuns()));
+        }
+
         quint64 oneSecondAgo = usecTimestampNow() - USECS_PER_SECOND;
         
         statsString += QString("            process() last second: %1 clients\r\n")
@@ -538,6 +589,32 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
                                          _averageExtraLongEncodeTime.getAverage(), 
                                          extraLongVsTotalEncode * AS_PERCENT, _extraLongEncode);
 
+        OctreeEncodeCache* encodeCache = _tree ? _tree->getEncodeCache() : NULL;
+        if (encodeCache) {
+            quint64 cacheLookups = encodeCache->getHits() + encodeCache->getMisses();
+            float hitRate = (cacheLookups > 0) ? ((float)encodeCache->getHits() / (float)cacheLookups) : 0.0f;
+            statsString += QString().sprintf("        Shared subtree encode hits:"
+                                             "                          (%6.2f%%) samples: %12llu \r\n",
+                                             hitRate * AS_PERCENT, (unsigned long long)encodeCache->getHits());
+            statsString += QString().sprintf("      Shared subtree encode misses:"
+                                             "                                    samples: %12llu \r\n",
+                                             (unsigned long long)encodeCache->getMisses());
+            statsString += QString().sprintf("   Shared subtree hits didn't fit:"
+                                             "                                    samples: %12llu \r\n",
+                                             (unsigned long long)encodeCache->getDidntFit());
+            statsString += QString().sprintf("      Shared subtree stores/evicts:  %12llu / %llu\r\n",
+                                             (unsigned long long)encodeCache->getStores(),
+                                             (unsigned long long)encodeCache->getEvictions());
+            statsString += QString().sprintf("     Shared subtree invalidations:  %12llu\r\n",
+                                             (unsigned long long)encodeCache->getInvalidations());
+            statsString += QString().sprintf("        Shared subtree bytes reused:  %12llu bytes\r\n",
+                                             (unsigned long long)encodeCache->getBytesReused());
+            statsString += QString().sprintf("          Shared subtree cache size:  %12d bytes in %d subtrees"
+                                             " (max %d bytes)\r\n\r\n",
+                                             encodeCache->getSize(), encodeCache->getEntryCount(),
+                                             encodeCache->getMaximumSize());
+        }
+
 
         float averageCompressAndWriteTime = getAverageCompressAndWriteTime();
         statsString += QString().sprintf("     Average compress and write time:    %9.2f usecs\r\n", 
@@ -722,6 +799,32 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
                                          OctreeElement::getTotalMemoryUsage() / memoryScale, memoryScaleLabel);
         statsString += "\r\n";
 
+        OctreeElementPool* elementPool = _tree->getElementPool();
+        if (elementPool) {
+            statsString += QString().sprintf("Element Pool Reserved:           %8.2f %s in %d slabs\r\n",
+                                             elementPool->getReservedBytes() / memoryScale, memoryScaleLabel,
+                                             elementPool->getSlabCount());
+            statsString += QString().sprintf("Element Pool In Use:             %llu elements, %llu child arrays\r\n",
+                                             (unsigned long long)elementPool->getElementsInUse(),
+                                             (unsigned long long)elementPool->getChildArraysInUse());
+            statsString += "\r\n";
+        }
+
+        statsString += serverSubclassStats();
+
+        // the sent packet histories are fixed size slabs, so this is bounded by clients * history capacity
+        quint64 sentPacketHistoryMemoryUsage = 0;
+        NodeList::getInstance()->eachNode([&sentPacketHistoryMemoryUsage](const SharedNodePointer& node) {
+            OctreeQueryNode* nodeData = static_cast<OctreeQueryNode*>(node->getLinkedData());
+            if (nodeData) {
+                sentPacketHistoryMemoryUsage += nodeData->getSentPacketHistoryMemoryUsage();
+            }
+        });
+        statsString += QString().sprintf("Sent Packet History Memory Usage:%8.2f %s (%d clients)\r\n",
+                                         sentPacketHistoryMemoryUsage / memoryScale, memoryScaleLabel,
+                                         getCurrentClientCount());
+        statsString += "\r\n";
+
         statsString += "OctreeElement Children Population Statistics...\r\n";
         checkSum = 0;
         for (int i=0; i <= NUMBER_OF_CHILDREN; i++) {
@@ -847,7 +950,7 @@ void OctreeServer::readPendingDatagram(const QByteArray& receivedPacket, const H
                     // solution is to get the shared pointer for the current assignment. We need to make sure this is the 
                     // same SharedAssignmentPointer that was ref counted by the assignment client.                    
                     SharedAssignmentPointer sharedAssignment = AssignmentClient::getCurrentAssignment();
-                    nodeData->initializeOctreeSendThread(sharedAssignment, matchingNode);
+                    nodeData->initializeOctreeSendThread(sharedAssignment, matchingNode, _sendScheduler);
                 }
             }
         } else if (packetType == PacketTypeOctreeDataNack) {
@@ -1056,6 +1159,22 @@ void OctreeServer::readConfiguration() {
             qDebug() << "maxBackupVersions=" << _maxBackupVersions;
         }
 
+        bool noEditLog;
+        readOptionBool(QString("NoEditLog"), settingsSectionObject, noEditLog);
+        _wantEditLog = !noEditLog;
+        qDebug() << "wantEditLog=" << _wantEditLog;
+
+        if (_wantEditLog) {
+            readOptionInt(QString("editLogCommitInterval"), settingsSectionObject, _editLogCommitInterval);
+            qDebug() << "editLogCommitInterval=" << _editLogCommitInterval;
+
+            readOptionInt(QString("editLogCompactSizeMB"), settingsSectionObject, _editLogCompactSizeMB);
+            qDebug() << "editLogCompactSizeMB=" << _editLogCompactSizeMB;
+        }
+
+        readOptionBool(QString("indexedPersist"), settingsSectionObject, _wantIndexedPersist);
+        qDebug() << "wantIndexedPersist=" << _wantIndexedPersist;
+
     } else {
         qDebug("persistFilename= DISABLED");
     }
@@ -1090,6 +1209,23 @@ void OctreeServer::readConfiguration() {
     }
     qDebug("packetsPerSecondTotalMax=%d _packetsTotalPerInterval=%d", 
                     packetsPerSecondTotalMax, _packetsTotalPerInterval);
+
+    // Check to see if the user wants a different size for the encoded subtrees shared between send threads, 0 disables
+    int encodeCacheSizeMB = DEFAULT_ENCODE_CACHE_SIZE / BYTES_PER_MEGABYTE;
+    readOptionInt(QString("encodeCacheSizeMB"), settingsSectionObject, encodeCacheSizeMB);
+    if (encodeCacheSizeMB > 0) {
+        _tree->setEncodeCache(new OctreeEncodeCache(encodeCacheSizeMB * BYTES_PER_MEGABYTE));
+    } else {
+        _tree->setEncodeCache(NULL);
+    }
+    qDebug("encodeCacheSizeMB=%d", encodeCacheSizeMB);
+
+    // Check to see if the user wants a different number of worker threads sending to clients
+    int sendThreads = 0;
+    if (readOptionInt(QString("sendThreads"), settingsSectionObject, sendThreads) && sendThreads > 0) {
+        _sendThreads = sendThreads;
+    }
+    qDebug("sendThreads=%d", _sendThreads);
                     
                     
     readAdditionalConfiguration(settingsSectionObject);
@@ -1143,6 +1279,10 @@ void OctreeServer::run() {
                                     _wantBackup, _backupInterval, _backupExtensionFormat, 
                                     _maxBackupVersions, _debugTimestampNow);
         if (_persistThread) {
+            if (_wantEditLog) {
+                _persistThread->enableEditLog(_editLogCommitInterval, _editLogCompactSizeMB * BYTES_PER_MEGABYTE);
+            }
+            _persistThread->setWantIndexedFile(_wantIndexedPersist);
             _persistThread->initialize(true);
         }
     }
@@ -1160,6 +1300,9 @@ void OctreeServer::run() {
     _octreeInboundPacketProcessor = new OctreeInboundPacketProcessor(this);
     _octreeInboundPacketProcessor->initialize(true);
 
+    // set up the worker threads that all of our clients' send threads run on
+    _sendScheduler = new OctreeSendScheduler(_sendThreads);
+
     // Convert now to tm struct for local timezone
     tm* localtm = localtime(&_started);
     const int MAX_TIME_LENGTH = 128;
@@ -1227,6 +1370,10 @@ void OctreeServer::aboutToFinish() {
         qDebug() << qPrintable(_safeServerName) << "server about to finish while node still connected node:" << *node;
         forceNodeShutdown(node);
     });
+
+    if (_sendScheduler) {
+        _sendScheduler->stop();
+    }
     
     if (_persistThread) {
         _persistThread->aboutToFinish();
@@ -22,6 +22,7 @@
 #include <EnvironmentData.h>
 
 #include "OctreePersistThread.h"
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 #include "OctreeServerConsts.h"
 #include "OctreeInboundPacketProcessor.h"
@@ -59,6 +60,9 @@ public:
     bool isInitialLoadComplete() const { return (_persistThread) ? _persistThread->isInitialLoadComplete() : true; }
     bool isPersistEnabled() const { return (_persistThread) ? true : false; }
     quint64 getLoadElapsedTime() const { return (_persistThread) ? _persistThread->getLoadElapsedTime() : 0; }
+    bool isFullyLoaded() const { return (_persistThread) ? _persistThread->isFullyLoaded() : true; }
+    void finishLoading() { if (_persistThread) { _persistThread->finishLoading(); } }
+    void hydrateView(const ViewFrustum& viewFrustum) { if (_persistThread) { _persistThread->hydrateView(viewFrustum); } }
 
     // Subclasses must implement these methods
     virtual OctreeQueryNode* createOctreeQueryNode() = 0;
@@ -74,6 +78,7 @@ public:
     virtual void beforeRun() { }
     virtual bool hasSpecialPacketToSend(const SharedNodePointer& node) { return false; }
     virtual int sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNode* queryNode, int& packetsSent) { return 0; }
+    virtual QString serverSubclassStats() { return QString(); } /// extra lines for the memory section of the stats page
 
     static void attachQueryNodeToNode(Node* newNode);
     
@@ -124,7 +129,7 @@ public slots:
     /// runs the octree server assignment
     void run();
     void nodeAdded(SharedNodePointer node);
-    void nodeKilled(SharedNodePointer node);
+    virtual void nodeKilled(SharedNodePointer node);
     void sendStatsPacket();
     
     void readPendingDatagrams() { }; // this will not be called since our datagram processing thread will handle
@@ -168,12 +173,18 @@ protected:
     JurisdictionSender* _jurisdictionSender;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
     OctreePersistThread* _persistThread;
+    OctreeSendScheduler* _sendScheduler;
+    int _sendThreads;
     
     int _persistInterval;
     bool _wantBackup;
     QString _backupExtensionFormat;
     int _backupInterval;
     int _maxBackupVersions;
+    bool _wantEditLog;
+    int _editLogCommitInterval;
+    int _editLogCompactSizeMB;
+    bool _wantIndexedPersist;
 
     static OctreeServer* _instance;
 
@@ -20,5 +20,7 @@ const int MAX_FILENAME_LENGTH = 1024;
 const int INTERVALS_PER_SECOND = 60;
 const int OCTREE_SEND_INTERVAL_USECS = (1000 * 1000)/INTERVALS_PER_SECOND;
 const int SENDING_TIME_TO_SPARE = 5 * 1000; // usec of sending interval to spare for sending octree elements
+const int BYTES_PER_MEGABYTE = 1024 * 1024;
+const quint64 MAX_EDIT_BATCH_USECS = 5 * USECS_PER_MSEC; // longest the inbound processor holds the edit lock for a batch
 
 #endif // hifi_OctreeServerConsts_h
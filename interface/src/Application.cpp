@@ -33,7 +33,6 @@
 #include <QMenuBar>
 #include <QMouseEvent>
 #include <QNetworkReply>
-#include <QNetworkDiskCache>
 #include <QOpenGLFramebufferObject>
 #include <QObject>
 #include <QWheelEvent>
@@ -73,6 +72,7 @@
 #include <PhysicsEngine.h>
 #include <ProgramObject.h>
 #include <ResourceCache.h>
+#include <ResourceDiskCache.h>
 #include <SoundCache.h>
 #include <TextRenderer.h>
 #include <UserActivityLogger.h>
@@ -340,13 +340,10 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
     billboardPacketTimer->start(AVATAR_BILLBOARD_PACKET_SEND_INTERVAL_MSECS);
 
     QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
-    QNetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
-    QNetworkDiskCache* cache = new QNetworkDiskCache();
-    cache->setMaximumCacheSize(MAXIMUM_CACHE_SIZE);
-    cache->setCacheDirectory(!cachePath.isEmpty() ? cachePath : "interfaceCache");
-    networkAccessManager.setCache(cache);
+    ResourceDiskCache::setCacheDirectory(!cachePath.isEmpty() ? cachePath : "interfaceCache", MAXIMUM_CACHE_SIZE);
 
-    ResourceCache::setRequestLimit(3);
+    // the number of downloads actually in flight adapts to the throughput, this is only the ceiling
+    ResourceCache::setRequestLimit(6);
 
     _window->setCentralWidget(glCanvas.data());
 
@@ -171,6 +171,7 @@ public:
     const OctreePacketProcessor& getOctreePacketProcessor() const { return _octreeProcessor; }
     MetavoxelSystem* getMetavoxels() { return &_metavoxels; }
     EntityTreeRenderer* getEntities() { return &_entities; }
+    EntityCollisionSystem* getEntityCollisionSystem() { return &_entityCollisionSystem; }
     Environment* getEnvironment() { return &_environment; }
     PrioVR* getPrioVR() { return &_prioVR; }
     QUndoStack* getUndoStack() { return &_undoStack; }
@@ -397,7 +397,7 @@ void Stats::display(
     MyAvatar* myAvatar = Application::getInstance()->getAvatar();
     glm::vec3 avatarPos = myAvatar->getPosition();
 
-    lines = _expanded ? 8 : 3;
+    lines = _expanded ? 9 : 3;
 
     if (columnOneWidth == _generalStatsWidth) {
         drawBackground(backgroundColor, horizontalOffset, 0, _geoStatsWidth, lines * STATS_PELS_PER_LINE + 10);
@@ -437,11 +437,24 @@ void Stats::display(
         foreach (Resource* resource, ResourceCache::getLoadingRequests()) {
             downloads << (int)(resource->getProgress() * 100.0f) << "% ";
         }
-        downloads << "(" << ResourceCache::getPendingRequestCount() << " pending)";
+        downloads << "(" << ResourceCache::getPendingRequestCount() << " pending, " << ResourceCache::getActiveRequestLimit()
+            << " slots, " << (int)(ResourceCache::getThroughput() / 1000.0f) << " kB/s)";
         
         verticalOffset += STATS_PELS_PER_LINE;
         drawText(horizontalOffset, verticalOffset, scale, rotation, font, downloads.str().c_str(), color);
         
+        GeometryCache::SharedPointer geometryCache = DependencyManager::get<GeometryCache>();
+        TextureCache::SharedPointer textureCache = DependencyManager::get<TextureCache>();
+        stringstream downloadQueues;
+        downloadQueues << "Geometry: " << geometryCache->getQueueDepth() << " queued, "
+            << (int)geometryCache->getAverageTimeToFirstByte() << " ms TTFB, "
+            << geometryCache->getCancelledRequestCount() << " cancelled  Textures: " << textureCache->getQueueDepth()
+            << " queued, " << (int)textureCache->getAverageTimeToFirstByte() << " ms TTFB, "
+            << textureCache->getCancelledRequestCount() << " cancelled";
+        
+        verticalOffset += STATS_PELS_PER_LINE;
+        drawText(horizontalOffset, verticalOffset, scale, rotation, font, downloadQueues.str().c_str(), color);
+        
         QMetaObject::invokeMethod(Application::getInstance()->getMetavoxels()->getUpdater(), "getStats",
             Q_ARG(QObject*, this), Q_ARG(const QByteArray&, "setMetavoxelStats"));
         
@@ -471,7 +484,7 @@ void Stats::display(
     verticalOffset = 0;
     horizontalOffset = _lastHorizontalOffset + _generalStatsWidth + _pingStatsWidth + _geoStatsWidth + 3;
 
-    lines = _expanded ? 14 : 3;
+    lines = _expanded ? 15 : 3;
 
     drawBackground(backgroundColor, horizontalOffset, 0, glCanvas->width() - horizontalOffset,
         lines * STATS_PELS_PER_LINE + 10);
@@ -506,6 +519,15 @@ void Stats::display(
                     << " / Translucent:" << entities->getTranslucentMeshPartsRendered();
         verticalOffset += STATS_PELS_PER_LINE;
         drawText(horizontalOffset, verticalOffset, scale, rotation, font, (char*)octreeStats.str().c_str(), color);
+
+        EntityCollisionSystem* collisions = Application::getInstance()->getEntityCollisionSystem();
+        octreeStats.str("");
+        octreeStats << "  Collision Pairs: " << collisions->getCandidatePairCount()
+                    << " / Colliding:" << collisions->getCollidingPairCount()
+                    << " / Broadphase:" << collisions->getBroadphaseUsecs() << "us"
+                    << " / Narrowphase:" << collisions->getNarrowphaseUsecs() << "us";
+        verticalOffset += STATS_PELS_PER_LINE;
+        drawText(horizontalOffset, verticalOffset, scale, rotation, font, (char*)octreeStats.str().c_str(), color);
     }
 
     // iterate all the current voxel stats, and list their sending modes, and total voxel counts
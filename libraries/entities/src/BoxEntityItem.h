@@ -21,6 +21,7 @@ public:
     BoxEntityItem(const EntityItemID& entityItemID, const EntityItemProperties& properties);
     
     ALLOW_INSTANTIATION // This class can be instantiated
+    virtual EntityItem* clone() const { return new BoxEntityItem(*this); }
     
     // methods for getting/setting all properties of an entity
     virtual EntityItemProperties getProperties() const;
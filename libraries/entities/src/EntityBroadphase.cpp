@@ -0,0 +1,289 @@
+//
+//  EntityBroadphase.cpp
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <float.h>
+
+#include <QtCore/QtAlgorithms>
+
+#include "EntityBroadphase.h"
+#include "EntityItem.h"
+
+// past this many entities added or removed in one update, sorting everything again beats inserting them one at a time
+const int MAX_INCREMENTAL_CHANGES = 16;
+
+EntityBroadphase::EntityBroadphase() :
+    _proxies(),
+    _freeProxies(),
+    _proxyIDs(),
+    _overlaps(),
+    _entitiesToUpdate(),
+    _removedProxies()
+{
+}
+
+quint64 EntityBroadphase::overlapKey(int proxyA, int proxyB) {
+    return (proxyA < proxyB) ? (((quint64)proxyA << 32) | (quint32)proxyB) : (((quint64)proxyB << 32) | (quint32)proxyA);
+}
+
+bool EntityBroadphase::overlaps(int proxyA, int proxyB) const {
+    const Proxy& a = _proxies.at(proxyA);
+    const Proxy& b = _proxies.at(proxyB);
+    if (!a.entity || !b.entity) {
+        return false;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (a.min[axis] > b.max[axis] || b.min[axis] > a.max[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EntityBroadphase::updateEntity(EntityItem* entity) {
+    _entitiesToUpdate.insert(entity);
+}
+
+void EntityBroadphase::removeEntity(EntityItem* entity) {
+    _entitiesToUpdate.remove(entity);
+    QHash<EntityItem*, int>::iterator proxyItr = _proxyIDs.find(entity);
+    if (proxyItr != _proxyIDs.end()) {
+        int proxy = proxyItr.value();
+        _proxyIDs.erase(proxyItr);
+
+        // its ends stay sorted where they are until the next update, but nothing will read the entity again
+        _proxies[proxy].entity = NULL;
+        _removedProxies << proxy;
+    }
+}
+
+void EntityBroadphase::clear() {
+    _proxies.clear();
+    _freeProxies.clear();
+    _proxyIDs.clear();
+    for (int axis = 0; axis < 3; axis++) {
+        _endpoints[axis].clear();
+    }
+    _overlaps.clear();
+    _entitiesToUpdate.clear();
+    _removedProxies.clear();
+}
+
+void EntityBroadphase::update() {
+    QVector<int> addedProxies;
+    QVector<int> movedProxies;
+    foreach (EntityItem* entity, _entitiesToUpdate) {
+        if (entity->getIgnoreForCollisions()) {
+            removeEntity(entity);
+            continue;
+        }
+        QHash<EntityItem*, int>::const_iterator proxyItr = _proxyIDs.constFind(entity);
+        if (proxyItr != _proxyIDs.constEnd()) {
+            movedProxies << proxyItr.value();
+        } else {
+            addedProxies << addProxy(entity);
+        }
+    }
+    _entitiesToUpdate.clear();
+
+    if (addedProxies.size() + _removedProxies.size() > MAX_INCREMENTAL_CHANGES) {
+        foreach (int proxy, movedProxies) {
+            readBounds(proxy);
+        }
+        rebuild();
+        return;
+    }
+
+    foreach (int proxy, _removedProxies) {
+        removeProxy(proxy);
+    }
+    _removedProxies.clear();
+
+    foreach (int proxy, addedProxies) {
+        // the new ends start past everything else, so sorting them into place crosses exactly the cubes it overlaps
+        Proxy& added = _proxies[proxy];
+        for (int axis = 0; axis < 3; axis++) {
+            QVector<Endpoint>& endpoints = _endpoints[axis];
+            Endpoint minEnd = { FLT_MAX, proxy, false };
+            Endpoint maxEnd = { FLT_MAX, proxy, true };
+            added.endpoints[axis][0] = endpoints.size();
+            endpoints << minEnd;
+            added.endpoints[axis][1] = endpoints.size();
+            endpoints << maxEnd;
+        }
+        readBounds(proxy);
+        sortProxy(proxy);
+    }
+
+    foreach (int proxy, movedProxies) {
+        readBounds(proxy);
+        sortProxy(proxy);
+    }
+}
+
+void EntityBroadphase::findPairs(const QSet<EntityItem*>& entities, QVector<EntityPair>& pairs) const {
+    foreach (quint64 key, _overlaps) {
+        EntityItem* entityA = _proxies.at((int)(key >> 32)).entity;
+        EntityItem* entityB = _proxies.at((int)(quint32)key).entity;
+        if (entityA && entityB && (entities.contains(entityA) || entities.contains(entityB))) {
+            pairs << EntityPair(entityA, entityB);
+        }
+    }
+}
+
+int EntityBroadphase::addProxy(EntityItem* entity) {
+    int proxy;
+    if (_freeProxies.isEmpty()) {
+        proxy = _proxies.size();
+        _proxies.resize(proxy + 1);
+    } else {
+        proxy = _freeProxies.last();
+        _freeProxies.pop_back();
+    }
+    Proxy& added = _proxies[proxy];
+    added.entity = entity;
+    for (int axis = 0; axis < 3; axis++) {
+        added.endpoints[axis][0] = added.endpoints[axis][1] = -1;
+    }
+    _proxyIDs.insert(entity, proxy);
+    return proxy;
+}
+
+void EntityBroadphase::removeProxy(int proxy) {
+    // with its entity gone the proxy overlaps nothing, so sorting its ends past everything else only takes overlaps away
+    Proxy& removed = _proxies[proxy];
+    for (int axis = 0; axis < 3; axis++) {
+        removed.min[axis] = removed.max[axis] = FLT_MAX;
+        _endpoints[axis][removed.endpoints[axis][0]].value = FLT_MAX;
+        _endpoints[axis][removed.endpoints[axis][1]].value = FLT_MAX;
+    }
+    sortProxy(proxy);
+    for (int axis = 0; axis < 3; axis++) {
+        _endpoints[axis].resize(_endpoints[axis].size() - 2);
+        removed.endpoints[axis][0] = removed.endpoints[axis][1] = -1;
+    }
+    _freeProxies << proxy;
+}
+
+void EntityBroadphase::readBounds(int proxy) {
+    Proxy& bounded = _proxies[proxy];
+    AACube cube = bounded.entity->getMaximumAACube();
+    glm::vec3 corner = cube.getCorner();
+    float scale = cube.getScale();
+    for (int axis = 0; axis < 3; axis++) {
+        bounded.min[axis] = corner[axis];
+        bounded.max[axis] = corner[axis] + scale;
+        if (bounded.endpoints[axis][0] >= 0) {
+            _endpoints[axis][bounded.endpoints[axis][0]].value = bounded.min[axis];
+            _endpoints[axis][bounded.endpoints[axis][1]].value = bounded.max[axis];
+        }
+    }
+}
+
+void EntityBroadphase::sortProxy(int proxy) {
+    const Proxy& sorted = _proxies.at(proxy);
+    for (int axis = 0; axis < 3; axis++) {
+        // an end can't pass the other end of its own cube, so the one on the side the cube is moving toward goes first
+        const QVector<Endpoint>& endpoints = _endpoints[axis];
+        int maxIndex = sorted.endpoints[axis][1];
+        if (maxIndex + 1 < endpoints.size() && endpoints.at(maxIndex + 1).value < endpoints.at(maxIndex).value) {
+            sortEndpoint(axis, maxIndex);
+            sortEndpoint(axis, sorted.endpoints[axis][0]);
+        } else {
+            sortEndpoint(axis, sorted.endpoints[axis][0]);
+            sortEndpoint(axis, sorted.endpoints[axis][1]);
+        }
+    }
+}
+
+// moves the end at the index to where its value sorts, starting or stopping overlaps with every end of another cube it
+// crosses on the way
+void EntityBroadphase::sortEndpoint(int axis, int index) {
+    QVector<Endpoint>& endpoints = _endpoints[axis];
+    Endpoint* ends = endpoints.data();
+    Endpoint end = ends[index];
+
+    while (index > 0 && ends[index - 1].value > end.value) {
+        const Endpoint& other = ends[index - 1];
+        if (other.proxy != end.proxy && other.isMax != end.isMax) {
+            if (end.isMax) {
+                // our max went below their min
+                _overlaps.remove(overlapKey(end.proxy, other.proxy));
+            } else if (overlaps(end.proxy, other.proxy)) {
+                // our min went below their max
+                _overlaps.insert(overlapKey(end.proxy, other.proxy));
+            }
+        }
+        ends[index] = other;
+        _proxies[other.proxy].endpoints[axis][other.isMax] = index;
+        index--;
+    }
+
+    int last = endpoints.size() - 1;
+    while (index < last && ends[index + 1].value < end.value) {
+        const Endpoint& other = ends[index + 1];
+        if (other.proxy != end.proxy && other.isMax != end.isMax) {
+            if (!end.isMax) {
+                // our min went above their max
+                _overlaps.remove(overlapKey(end.proxy, other.proxy));
+            } else if (overlaps(end.proxy, other.proxy)) {
+                // our max went above their min
+                _overlaps.insert(overlapKey(end.proxy, other.proxy));
+            }
+        }
+        ends[index] = other;
+        _proxies[other.proxy].endpoints[axis][other.isMax] = index;
+        index++;
+    }
+
+    ends[index] = end;
+    _proxies[end.proxy].endpoints[axis][end.isMax] = index;
+}
+
+void EntityBroadphase::rebuild() {
+    _freeProxies << _removedProxies;
+    _removedProxies.clear();
+
+    for (int axis = 0; axis < 3; axis++) {
+        QVector<Endpoint>& endpoints = _endpoints[axis];
+        endpoints.clear();
+        endpoints.reserve(_proxyIDs.size() * 2);
+        foreach (int proxy, _proxyIDs) {
+            Proxy& sorted = _proxies[proxy];
+            if (sorted.endpoints[0][0] < 0) {
+                // added this update, so its cube hasn't been read yet
+                readBounds(proxy);
+            }
+            Endpoint minEnd = { sorted.min[axis], proxy, false };
+            Endpoint maxEnd = { sorted.max[axis], proxy, true };
+            endpoints << minEnd << maxEnd;
+        }
+        qSort(endpoints.begin(), endpoints.end());
+        for (int index = 0; index < endpoints.size(); index++) {
+            const Endpoint& end = endpoints.at(index);
+            _proxies[end.proxy].endpoints[axis][end.isMax] = index;
+        }
+    }
+
+    // one sweep along x finds every overlap, checking the other two axes for each cube still open
+    _overlaps.clear();
+    QVector<int> openProxies;
+    foreach (const Endpoint& end, _endpoints[0]) {
+        if (end.isMax) {
+            openProxies.remove(openProxies.indexOf(end.proxy));
+        } else {
+            foreach (int openProxy, openProxies) {
+                if (overlaps(end.proxy, openProxy)) {
+                    _overlaps.insert(overlapKey(end.proxy, openProxy));
+                }
+            }
+            openProxies << end.proxy;
+        }
+    }
+}
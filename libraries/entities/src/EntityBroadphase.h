@@ -0,0 +1,92 @@
+//
+//  EntityBroadphase.h
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityBroadphase_h
+#define hifi_EntityBroadphase_h
+
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+class EntityItem;
+
+typedef QPair<EntityItem*, EntityItem*> EntityPair;
+
+/// Incremental sweep and prune over the maximum AACubes of the entities that can collide. The min and max of every cube
+/// are kept sorted along each axis, and the set of overlapping cubes is kept up to date by the swaps that re-sort the
+/// ends of a cube that changed: ends only cross where an overlap starts or stops. Since entities move a little each
+/// tick, re-sorting is close to linear in the number that moved, and nothing is done for the ones that stayed put.
+///
+/// When many entities arrive or leave at once, like when a domain's entities load, it's cheaper to sort everything again
+/// and sweep once, so that's what happens.
+class EntityBroadphase {
+public:
+    EntityBroadphase();
+
+    /// Queues the entity to have its cube read again at the next update(), adding it if it's new. An entity that ignores
+    /// collisions is taken out instead.
+    void updateEntity(EntityItem* entity);
+
+    /// Takes the entity out now, the broadphase won't touch it again
+    void removeEntity(EntityItem* entity);
+    void clear();
+
+    /// Reads the cubes of the entities queued since the last update and brings the overlaps up to date
+    void update();
+
+    /// Appends the overlapping pairs that have at least one of the given entities in them
+    void findPairs(const QSet<EntityItem*>& entities, QVector<EntityPair>& pairs) const;
+
+    int getEntityCount() const { return _proxyIDs.size(); }
+    int getOverlapCount() const { return _overlaps.size(); }
+
+private:
+    class Proxy {
+    public:
+        EntityItem* entity; // NULL for a free proxy
+        float min[3];
+        float max[3];
+        int endpoints[3][2]; // the index of the min and max end along each axis
+    };
+
+    class Endpoint {
+    public:
+        float value;
+        int proxy;
+        bool isMax;
+
+        // ties sort min first, so cubes that only touch count as overlapping, the same as overlaps()
+        bool operator<(const Endpoint& other) const {
+            return value < other.value || (value == other.value && !isMax && other.isMax);
+        }
+    };
+
+    static quint64 overlapKey(int proxyA, int proxyB);
+    bool overlaps(int proxyA, int proxyB) const;
+
+    int addProxy(EntityItem* entity);
+    void removeProxy(int proxy);
+    void readBounds(int proxy);
+    void sortProxy(int proxy);
+    void sortEndpoint(int axis, int index);
+    void rebuild();
+
+    QVector<Proxy> _proxies;
+    QVector<int> _freeProxies;
+    QHash<EntityItem*, int> _proxyIDs;
+    QVector<Endpoint> _endpoints[3];
+    QSet<quint64> _overlaps; // the lower proxy in the high 32 bits
+
+    QSet<EntityItem*> _entitiesToUpdate;
+    QVector<int> _removedProxies; // taken out since the last update, their ends still need to go
+};
+
+#endif // hifi_EntityBroadphase_h
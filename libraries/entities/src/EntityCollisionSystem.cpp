@@ -16,6 +16,7 @@
 #include <HeadData.h>
 #include <HandData.h>
 #include <PerfStat.h>
+#include <ShapeCollider.h>
 #include <SphereShape.h>
 
 #include "EntityCollisionSystem.h"
@@ -30,7 +31,12 @@ EntityCollisionSystem::EntityCollisionSystem()
     :   SimpleEntitySimulation(), 
         _packetSender(NULL),
         _avatars(NULL),
-        _collisions(MAX_COLLISIONS_PER_Entity) {
+        _collisions(MAX_COLLISIONS_PER_Entity),
+        _broadphase(),
+        _candidatePairCount(0),
+        _collidingPairCount(0),
+        _broadphaseUsecs(0),
+        _narrowphaseUsecs(0) {
 }
 
 void EntityCollisionSystem::init(EntityEditPacketSender* packetSender,
@@ -49,17 +55,57 @@ void EntityCollisionSystem::updateCollisions() {
     assert(_entityTree);
     // update all Entities
     if (_entityTree->tryLockForWrite()) {
+        quint64 start = usecTimestampNow();
+
+        // the moving entities were simulated since the last update, so their cubes moved with them
+        foreach (EntityItem* entity, _movingEntities) {
+            _broadphase.updateEntity(entity);
+        }
+        _broadphase.update();
+        QVector<EntityPair> pairs;
+        _broadphase.findPairs(_movingEntities, pairs);
+        _candidatePairCount = pairs.size();
+        _collidingPairCount = 0;
+
+        quint64 broadphaseEnd = usecTimestampNow();
+        _broadphaseUsecs = broadphaseEnd - start;
+
+        // each moving entity collides with the other, the same as if it had searched the tree for what it touches
+        foreach (const EntityPair& pair, pairs) {
+            if (_movingEntities.contains(pair.first)) {
+                updateCollisionWithEntity(pair.first, pair.second);
+            }
+            if (_movingEntities.contains(pair.second)) {
+                updateCollisionWithEntity(pair.second, pair.first);
+            }
+        }
         foreach (EntityItem* entity, _movingEntities) {
-            checkEntity(entity);
+            updateCollisionWithAvatars(entity);
         }
+        _narrowphaseUsecs = usecTimestampNow() - broadphaseEnd;
         _entityTree->unlock();
     }
 }
 
+void EntityCollisionSystem::addEntityInternal(EntityItem* entity) {
+    SimpleEntitySimulation::addEntityInternal(entity);
+    _broadphase.updateEntity(entity);
+}
+
+void EntityCollisionSystem::removeEntityInternal(EntityItem* entity) {
+    SimpleEntitySimulation::removeEntityInternal(entity);
+    _broadphase.removeEntity(entity);
+}
+
+void EntityCollisionSystem::entityChangedInternal(EntityItem* entity) {
+    // a new position, size or collision setting all show up the next time the broadphase reads the entity
+    _broadphase.updateEntity(entity);
+    SimpleEntitySimulation::entityChangedInternal(entity);
+}
 
-void EntityCollisionSystem::checkEntity(EntityItem* entity) {
-    updateCollisionWithEntities(entity);
-    updateCollisionWithAvatars(entity);
+void EntityCollisionSystem::clearEntitiesInternal() {
+    SimpleEntitySimulation::clearEntitiesInternal();
+    _broadphase.clear();
 }
 
 void EntityCollisionSystem::emitGlobalEntityCollisionWithEntity(EntityItem* entityA, 
@@ -70,45 +116,30 @@ void EntityCollisionSystem::emitGlobalEntityCollisionWithEntity(EntityItem* enti
     emit entityCollisionWithEntity(idA, idB, collision);
 }
 
-void EntityCollisionSystem::updateCollisionWithEntities(EntityItem* entityA) {
+void EntityCollisionSystem::updateCollisionWithEntity(EntityItem* entityA, EntityItem* entityB) {
 
-    if (entityA->getIgnoreForCollisions()) {
-        return; // bail early if this entity is to be ignored...
+    if (entityA->getIgnoreForCollisions() || entityB->getIgnoreForCollisions()) {
+        return; // bail early if either entity is to be ignored...
     }
 
     // don't collide entities with unknown IDs,
-    if (!entityA->isKnownID()) {
+    if (!entityA->isKnownID() || !entityB->isKnownID()) {
         return;
     }
 
     glm::vec3 penetration;
-    EntityItem* entityB = NULL;
     
     const int MAX_COLLISIONS_PER_ENTITY = 32;
     CollisionList collisions(MAX_COLLISIONS_PER_ENTITY);
-    bool shapeCollisionsAccurate = false;
-    
-    bool shapeCollisions = _entityTree->findShapeCollisions(&entityA->getCollisionShapeInMeters(), 
-                                            collisions, Octree::NoLock, &shapeCollisionsAccurate);
 
-    if (shapeCollisions) {
+    // the broadphase only knows the cubes overlap, the shapes decide if the entities touch
+    if (ShapeCollider::collideShapes(&entityA->getCollisionShapeInMeters(), &entityB->getCollisionShapeInMeters(),
+                                     collisions)) {
+        _collidingPairCount++;
         for(int i = 0; i < collisions.size(); i++) {
 
             CollisionInfo* collision = collisions[i];
             penetration = collision->_penetration;
-            entityB = static_cast<EntityItem*>(collision->_extraData);
-            
-            // The collision _extraData should be a valid entity, but if for some reason
-            // it's NULL then continue with a warning.
-            if (!entityB) {
-                qDebug() << "UNEXPECTED - we have a collision with missing _extraData. Something went wrong down below!";
-                continue; // skip this loop pass if the entity is NULL
-            }
-            
-            // don't collide entities with unknown IDs,
-            if (!entityB->isKnownID()) {
-                continue; // skip this loop pass if the entity has an unknown ID
-            }
             
             // NOTE: 'penetration' is the depth that 'entityA' overlaps 'entityB'.  It points from A into B.
             glm::vec3 penetrationInTreeUnits = penetration / (float)(TREE_SCALE);
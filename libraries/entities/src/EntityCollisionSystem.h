@@ -23,6 +23,7 @@
 #include <OctreePacketData.h>
 #include <SharedUtil.h>
 
+#include "EntityBroadphase.h"
 #include "EntityItem.h"
 #include "SimpleEntitySimulation.h"
 
@@ -42,14 +43,25 @@ public:
 
     void updateCollisions();
 
-    void checkEntity(EntityItem* Entity);
-    void updateCollisionWithEntities(EntityItem* Entity);
+    void updateCollisionWithEntity(EntityItem* entityA, EntityItem* entityB);
     void updateCollisionWithAvatars(EntityItem* Entity);
     void queueEntityPropertiesUpdate(EntityItem* Entity);
 
+    /// the pairs the broadphase found for the last update, and how many of them were actually touching
+    int getCandidatePairCount() const { return _candidatePairCount; }
+    int getCollidingPairCount() const { return _collidingPairCount; }
+    quint64 getBroadphaseUsecs() const { return _broadphaseUsecs; }
+    quint64 getNarrowphaseUsecs() const { return _narrowphaseUsecs; }
+
 signals:
     void entityCollisionWithEntity(const EntityItemID& idA, const EntityItemID& idB, const Collision& collision);
 
+protected:
+    virtual void addEntityInternal(EntityItem* entity);
+    virtual void removeEntityInternal(EntityItem* entity);
+    virtual void entityChangedInternal(EntityItem* entity);
+    virtual void clearEntitiesInternal();
+
 private:
     void applyHardCollision(EntityItem* entity, const CollisionInfo& collisionInfo);
 
@@ -60,6 +72,12 @@ private:
     AbstractAudioInterface* _audio;
     AvatarHashMap* _avatars;
     CollisionList _collisions;
+
+    EntityBroadphase _broadphase;
+    int _candidatePairCount;
+    int _collidingPairCount;
+    quint64 _broadphaseUsecs;
+    quint64 _narrowphaseUsecs;
 };
 
 #endif // hifi_EntityCollisionSystem_h
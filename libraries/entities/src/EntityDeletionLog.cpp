@@ -0,0 +1,122 @@
+//
+//  EntityDeletionLog.cpp
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "EntityDeletionLog.h"
+
+const int MIN_ENTRIES = 64;
+
+EntityDeletionLog::EntityDeletionLog() :
+    _entries(),
+    _first(0),
+    _end(0),
+    _nextReader(0),
+    _cursors(),
+    _cursorCounts()
+{
+}
+
+void EntityDeletionLog::append(quint64 deletedAt, const QUuid& entityID) {
+    if (_cursors.isEmpty()) {
+        return; // no one to tell
+    }
+    if (size() == _entries.size()) {
+        grow();
+    }
+    Entry& entry = _entries[(int)(_end & (_entries.size() - 1))];
+    entry.deletedAt = deletedAt;
+    entry.entityID = entityID;
+    _end++;
+}
+
+int EntityDeletionLog::addReader() {
+    int reader = _nextReader++;
+    _cursors.insert(reader, _end);
+    _cursorCounts[_end]++;
+    return reader;
+}
+
+void EntityDeletionLog::removeReader(int reader) {
+    QHash<int, quint64>::iterator cursor = _cursors.find(reader);
+    if (cursor == _cursors.end()) {
+        return;
+    }
+    QMap<quint64, int>::iterator count = _cursorCounts.find(cursor.value());
+    if (--count.value() == 0) {
+        _cursorCounts.erase(count);
+    }
+    _cursors.erase(cursor);
+    prune();
+}
+
+bool EntityDeletionLog::hasUnread(int reader) const {
+    return _cursors.value(reader, _end) < _end;
+}
+
+int EntityDeletionLog::read(int reader, int maxCount, QVector<QUuid>& entityIDs) {
+    QHash<int, quint64>::iterator cursor = _cursors.find(reader);
+    if (cursor == _cursors.end()) {
+        return 0;
+    }
+    quint64 position = cursor.value();
+    int count = (int)qMin((quint64)qMax(maxCount, 0), _end - position);
+    if (count == 0) {
+        return 0;
+    }
+    int mask = _entries.size() - 1;
+    const Entry* entries = _entries.constData();
+    for (int i = 0; i < count; i++) {
+        entityIDs << entries[(int)((position + i) & mask)].entityID;
+    }
+    moveCursor(cursor, position + count);
+    return count;
+}
+
+void EntityDeletionLog::clear() {
+    _first = _end;
+    for (QHash<int, quint64>::iterator cursor = _cursors.begin(); cursor != _cursors.end(); ++cursor) {
+        cursor.value() = _end;
+    }
+    _cursorCounts.clear();
+    if (!_cursors.isEmpty()) {
+        _cursorCounts.insert(_end, _cursors.size());
+    }
+}
+
+quint64 EntityDeletionLog::getOldestDeletedAt() const {
+    return (_first == _end) ? 0 : _entries.at((int)(_first & (_entries.size() - 1))).deletedAt;
+}
+
+void EntityDeletionLog::moveCursor(QHash<int, quint64>::iterator cursor, quint64 position) {
+    QMap<quint64, int>::iterator count = _cursorCounts.find(cursor.value());
+    bool wasSlowest = (count == _cursorCounts.begin());
+    if (--count.value() == 0) {
+        _cursorCounts.erase(count);
+    }
+    cursor.value() = position;
+    _cursorCounts[position]++;
+    if (wasSlowest) {
+        prune();
+    }
+}
+
+void EntityDeletionLog::prune() {
+    // everything before the slowest cursor has been read by every reader
+    _first = _cursorCounts.isEmpty() ? _end : _cursorCounts.constBegin().key();
+}
+
+void EntityDeletionLog::grow() {
+    QVector<Entry> oldEntries = _entries;
+    int oldMask = oldEntries.size() - 1;
+    _entries = QVector<Entry>(qMax(MIN_ENTRIES, oldEntries.size() * 2));
+    int mask = _entries.size() - 1;
+    for (quint64 position = _first; position < _end; position++) {
+        _entries[(int)(position & mask)] = oldEntries.at((int)(position & oldMask));
+    }
+}
@@ -0,0 +1,71 @@
+//
+//  EntityDeletionLog.h
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityDeletionLog_h
+#define hifi_EntityDeletionLog_h
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+/// The entities deleted on the server that some client still has to hear about, in the order they were deleted. Deletes
+/// are appended to a ring, and each reader, one per client, has a cursor at the first delete it hasn't read. Deletes
+/// behind the slowest reader's cursor are dropped as soon as it moves, so there's nothing to search or prune: reading
+/// copies out of one flat array and forgetting moves the start of the ring.
+///
+/// A reader starts past every delete logged before it was added, and when there are no readers nothing is kept. Not
+/// thread safe, the tree's lock guards it.
+class EntityDeletionLog {
+public:
+    EntityDeletionLog();
+
+    void append(quint64 deletedAt, const QUuid& entityID);
+
+    /// Adds a reader with its cursor at the end of the log, and returns its handle
+    int addReader();
+    void removeReader(int reader);
+
+    bool hasUnread(int reader) const;
+
+    /// Appends up to maxCount of the IDs the reader hasn't read to entityIDs, oldest first, and moves its cursor past
+    /// them. Returns how many it appended.
+    int read(int reader, int maxCount, QVector<QUuid>& entityIDs);
+
+    /// Drops every delete, the readers stay
+    void clear();
+
+    int size() const { return (int)(_end - _first); }
+    int getReaderCount() const { return _cursors.size(); }
+
+    /// When the oldest delete still in the log happened, or 0 if it's empty
+    quint64 getOldestDeletedAt() const;
+
+private:
+    class Entry {
+    public:
+        quint64 deletedAt;
+        QUuid entityID;
+    };
+
+    void moveCursor(QHash<int, quint64>::iterator cursor, quint64 position);
+    void prune();
+    void grow();
+
+    QVector<Entry> _entries; // a power of two of them, or none. The entry at a position is at position & (size - 1)
+    quint64 _first; // the position of the oldest delete kept
+    quint64 _end; // the position the next delete goes
+
+    int _nextReader;
+    QHash<int, quint64> _cursors;
+    QMap<quint64, int> _cursorCounts; // how many cursors are at each position, so the first is the slowest reader's
+};
+
+#endif // hifi_EntityDeletionLog_h
@@ -0,0 +1,115 @@
+//
+//  EntityEncodeCache.cpp
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include "EntityEncodeCache.h"
+
+QAtomicInteger<quint64> EntityEncodeCache::_hits(0);
+QAtomicInteger<quint64> EntityEncodeCache::_misses(0);
+QAtomicInteger<qint64> EntityEncodeCache::_cachedBytes(0);
+QAtomicInteger<qint64> EntityEncodeCache::_cachedEntities(0);
+QAtomicInteger<quint64> EntityEncodeCache::_overBudget(0);
+QAtomicInteger<qint64> EntityEncodeCache::_maximumBytes(DEFAULT_ENTITY_ENCODE_CACHE_SIZE);
+
+EntityEncodeCache::EntityEncodeCache() :
+    _mutex(),
+    _lastEdited(0),
+    _lastSimulated(0),
+    _properties(),
+    _encoded()
+{
+}
+
+// a copy starts out empty: copies are made of entities that are about to change, or to publish them, and a published
+// copy gets its own encoding the first time it's sent
+EntityEncodeCache::EntityEncodeCache(const EntityEncodeCache& other) :
+    _mutex(),
+    _lastEdited(0),
+    _lastSimulated(0),
+    _properties(),
+    _encoded()
+{
+}
+
+EntityEncodeCache& EntityEncodeCache::operator=(const EntityEncodeCache& other) {
+    QMutexLocker locker(&_mutex);
+    setEncoded(QByteArray());
+    return *this;
+}
+
+EntityEncodeCache::~EntityEncodeCache() {
+    setEncoded(QByteArray());
+}
+
+bool EntityEncodeCache::find(quint64 lastEdited, quint64 lastSimulated, const EntityPropertyFlags& properties,
+                             QByteArray& encoded) const {
+    bool found;
+    {
+        QMutexLocker locker(&_mutex);
+        found = !_encoded.isEmpty() && _lastEdited == lastEdited && _lastSimulated == lastSimulated &&
+            _properties == properties;
+        if (found) {
+            encoded = _encoded;
+        }
+    }
+    if (found) {
+        _hits.fetchAndAddRelaxed(1);
+    } else {
+        _misses.fetchAndAddRelaxed(1);
+    }
+    return found;
+}
+
+void EntityEncodeCache::store(quint64 lastEdited, quint64 lastSimulated, const EntityPropertyFlags& properties,
+                              const QByteArray& encoded) {
+    QMutexLocker locker(&_mutex);
+    // the budget is checked without holding anyone else's lock, so several stores at once can overshoot it a little
+    if (_cachedBytes.load() + encoded.size() - _encoded.size() > _maximumBytes.load()) {
+        _overBudget.fetchAndAddRelaxed(1);
+        setEncoded(QByteArray());
+        return;
+    }
+    _lastEdited = lastEdited;
+    _lastSimulated = lastSimulated;
+    _properties = properties;
+    setEncoded(encoded);
+}
+
+void EntityEncodeCache::clear() {
+    QMutexLocker locker(&_mutex);
+    setEncoded(QByteArray());
+}
+
+void EntityEncodeCache::setEncoded(const QByteArray& encoded) {
+    _cachedBytes.fetchAndAddRelaxed(encoded.size() - _encoded.size());
+    _cachedEntities.fetchAndAddRelaxed((encoded.isEmpty() ? 0 : 1) - (_encoded.isEmpty() ? 0 : 1));
+    _encoded = encoded;
+}
+
+quint64 EntityEncodeCache::getHits() {
+    return _hits.load();
+}
+
+quint64 EntityEncodeCache::getMisses() {
+    return _misses.load();
+}
+
+quint64 EntityEncodeCache::getCachedBytes() {
+    return (quint64)_cachedBytes.load();
+}
+
+quint64 EntityEncodeCache::getCachedEntities() {
+    return (quint64)_cachedEntities.load();
+}
+
+quint64 EntityEncodeCache::getOverBudget() {
+    return _overBudget.load();
+}
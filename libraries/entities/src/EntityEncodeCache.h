@@ -0,0 +1,69 @@
+//
+//  EntityEncodeCache.h
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityEncodeCache_h
+#define hifi_EntityEncodeCache_h
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+
+#include "EntityItemProperties.h"
+
+const qint64 DEFAULT_ENTITY_ENCODE_CACHE_SIZE = 64 * 1024 * 1024; // bytes of encodings across all entities
+
+/// An entity's last complete encoding by EntityItem::appendEntityData(), so sending an entity that hasn't changed to
+/// another client is a copy of its bytes. The encoding is only used while the entity's edit and simulation times, and
+/// the properties asked for, are the ones it was encoded with. Anything else that changes what's encoded, like an
+/// animation playing, has to clear() it.
+///
+/// Several senders can encode the same entity at once, so it has its own lock. Copying an entity doesn't copy its
+/// encoding. The encodings of all entities together are kept under a budget, past which new ones aren't stored, and an
+/// entity drops its encoding as soon as it's edited or simulated rather than waiting to be sent again.
+class EntityEncodeCache {
+public:
+    EntityEncodeCache();
+    EntityEncodeCache(const EntityEncodeCache& other);
+    EntityEncodeCache& operator=(const EntityEncodeCache& other);
+    ~EntityEncodeCache();
+
+    /// Sets encoded to the cached encoding and returns true if there is one for these times and properties.
+    bool find(quint64 lastEdited, quint64 lastSimulated, const EntityPropertyFlags& properties, QByteArray& encoded) const;
+    void store(quint64 lastEdited, quint64 lastSimulated, const EntityPropertyFlags& properties, const QByteArray& encoded);
+    void clear();
+
+    static quint64 getHits();
+    static quint64 getMisses();
+    static quint64 getCachedBytes();
+    static quint64 getCachedEntities();
+    static quint64 getOverBudget();
+
+    static void setMaximumBytes(qint64 maximumBytes) { _maximumBytes.store(maximumBytes); }
+    static qint64 getMaximumBytes() { return _maximumBytes.load(); }
+
+private:
+    void setEncoded(const QByteArray& encoded); // caller holds _mutex
+
+    mutable QMutex _mutex;
+    quint64 _lastEdited;
+    quint64 _lastSimulated;
+    EntityPropertyFlags _properties;
+    QByteArray _encoded;
+
+    // every send thread counts here, so these are atomic rather than locked
+    static QAtomicInteger<quint64> _hits;
+    static QAtomicInteger<quint64> _misses;
+    static QAtomicInteger<qint64> _cachedBytes;
+    static QAtomicInteger<qint64> _cachedEntities;
+    static QAtomicInteger<quint64> _overBudget;
+    static QAtomicInteger<qint64> _maximumBytes;
+};
+
+#endif // hifi_EntityEncodeCache_h
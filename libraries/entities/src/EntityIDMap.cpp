@@ -0,0 +1,179 @@
+//
+//  EntityIDMap.cpp
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+
+#include "EntityIDMap.h"
+
+const int MIN_SLOTS = 64;
+
+EntityIDMap::EntityIDMap() :
+    _slots(),
+    _size(0),
+    _creatorTokenEntries()
+{
+}
+
+void EntityIDMap::splitUUID(const QUuid& id, quint64& high, quint64& low) {
+    high = ((quint64)id.data1 << 32) | ((quint64)id.data2 << 16) | id.data3;
+    low = 0;
+    for (int i = 0; i < 8; i++) {
+        low = (low << 8) | id.data4[i];
+    }
+}
+
+quint32 EntityIDMap::hashUUID(quint64 high, quint64 low) {
+    // most IDs are random already, but mix all 128 bits in anyway so IDs that only differ in a few bits still spread out
+    quint64 hash = high ^ (low * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return (quint32)hash;
+}
+
+int EntityIDMap::probe(quint64 high, quint64 low, quint32 hash) const {
+    int mask = _slots.size() - 1;
+    const Slot* slots = _slots.constData();
+    for (int i = hash & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (!slot.element || (slot.hash == hash && slot.high == high && slot.low == low)) {
+            return i;
+        }
+    }
+}
+
+EntityTreeElement* EntityIDMap::find(const EntityItemID& entityItemID, EntityItem** entity) const {
+    Entry found = { NULL, NULL };
+    if (entityItemID.id == UNKNOWN_ENTITY_ID) {
+        found = _creatorTokenEntries.value(entityItemID.creatorTokenID, found);
+
+    } else if (_size > 0) {
+        quint64 high, low;
+        splitUUID(entityItemID.id, high, low);
+        const Slot& slot = _slots.at(probe(high, low, hashUUID(high, low)));
+        found.element = slot.element;
+        found.entity = slot.entity;
+    }
+    if (entity) {
+        *entity = found.entity;
+    }
+    return found.element;
+}
+
+void EntityIDMap::insert(const EntityItemID& entityItemID, EntityTreeElement* element, EntityItem* entity) {
+    if (!element) {
+        remove(entityItemID);
+        return;
+    }
+    if (entityItemID.id == UNKNOWN_ENTITY_ID) {
+        Entry& entry = _creatorTokenEntries[entityItemID.creatorTokenID];
+        entry.element = element;
+        if (entity) {
+            entry.entity = entity;
+        }
+        return;
+    }
+
+    // keep the table at most three quarters full so probes stay short
+    if ((_size + 1) * 4 > _slots.size() * 3) {
+        grow();
+    }
+    quint64 high, low;
+    splitUUID(entityItemID.id, high, low);
+    quint32 hash = hashUUID(high, low);
+    Slot& slot = _slots[probe(high, low, hash)];
+    if (!slot.element) {
+        slot.high = high;
+        slot.low = low;
+        slot.hash = hash;
+        slot.entity = NULL;
+        _size++;
+    }
+    slot.element = element;
+    if (entity) {
+        slot.entity = entity;
+    }
+}
+
+void EntityIDMap::remove(const EntityItemID& entityItemID) {
+    if (entityItemID.id == UNKNOWN_ENTITY_ID) {
+        _creatorTokenEntries.remove(entityItemID.creatorTokenID);
+        return;
+    }
+    if (_size == 0) {
+        return;
+    }
+    quint64 high, low;
+    splitUUID(entityItemID.id, high, low);
+    int hole = probe(high, low, hashUUID(high, low));
+    if (!_slots.at(hole).element) {
+        return;
+    }
+    _size--;
+
+    // rather than leave a tombstone, shift back any slot after the hole whose probe would otherwise have to cross it
+    Slot* slots = _slots.data();
+    int mask = _slots.size() - 1;
+    for (int i = (hole + 1) & mask; slots[i].element; i = (i + 1) & mask) {
+        int home = slots[i].hash & mask;
+        bool homeIsAfterHole = (hole < i) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!homeIsAfterHole) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole].element = NULL;
+    slots[hole].entity = NULL;
+}
+
+void EntityIDMap::clear() {
+    _slots.clear();
+    _size = 0;
+    _creatorTokenEntries.clear();
+}
+
+void EntityIDMap::grow() {
+    QVector<Slot> oldSlots = _slots;
+    _slots = QVector<Slot>(qMax(MIN_SLOTS, oldSlots.size() * 2));
+    foreach (const Slot& oldSlot, oldSlots) {
+        if (oldSlot.element) {
+            _slots[probe(oldSlot.high, oldSlot.low, oldSlot.hash)] = oldSlot;
+        }
+    }
+}
+
+QList<EntityTreeElement*> EntityIDMap::getElements() const {
+    QList<EntityTreeElement*> elements;
+    foreach (const Slot& slot, _slots) {
+        if (slot.element) {
+            elements << slot.element;
+        }
+    }
+    foreach (const Entry& entry, _creatorTokenEntries) {
+        elements << entry.element;
+    }
+    return elements;
+}
+
+void EntityIDMap::debugDump() const {
+    foreach (const Slot& slot, _slots) {
+        if (slot.element) {
+            QUuid id((uint)(slot.high >> 32), (ushort)(slot.high >> 16), (ushort)slot.high,
+                     (uchar)(slot.low >> 56), (uchar)(slot.low >> 48), (uchar)(slot.low >> 40), (uchar)(slot.low >> 32),
+                     (uchar)(slot.low >> 24), (uchar)(slot.low >> 16), (uchar)(slot.low >> 8), (uchar)slot.low);
+            qDebug() << id << ": " << slot.element;
+        }
+    }
+    QHashIterator<uint32_t, Entry> i(_creatorTokenEntries);
+    while (i.hasNext()) {
+        i.next();
+        qDebug() << "creatorTokenID:" << i.key() << ": " << i.value().element;
+    }
+}
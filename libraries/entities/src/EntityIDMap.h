@@ -0,0 +1,78 @@
+//
+//  EntityIDMap.h
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityIDMap_h
+#define hifi_EntityIDMap_h
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include "EntityItemID.h"
+
+class EntityItem;
+class EntityTreeElement;
+
+/// Maps entity IDs to the element containing the entity, and the entity itself. Known IDs live in an open addressing
+/// table keyed by the 128 bits of the UUID, with linear probing and the hash stored in each slot, so a lookup is a few
+/// compares in one flat array and adding an entity doesn't allocate a node. IDs that are only a creator token, which
+/// only a client that's waiting to hear the real ID from the server has, are kept apart in a QHash.
+///
+/// An ID matches the same way EntityItemID's operator==() matches: by UUID if it has one, otherwise by creator token.
+/// Not thread safe, the tree's lock guards it.
+class EntityIDMap {
+public:
+    EntityIDMap();
+
+    /// Returns the element containing the entity with the ID, or NULL. If entity is given it's set to the entity, or to
+    /// NULL if the entity wasn't given when it was inserted.
+    EntityTreeElement* find(const EntityItemID& entityItemID, EntityItem** entity = NULL) const;
+
+    /// Adds or updates the ID. Updating with a NULL entity keeps the entity it already had.
+    void insert(const EntityItemID& entityItemID, EntityTreeElement* element, EntityItem* entity = NULL);
+    void remove(const EntityItemID& entityItemID);
+    void clear();
+
+    int size() const { return _size + _creatorTokenEntries.size(); }
+
+    /// The containing element of every entity, once per entity
+    QList<EntityTreeElement*> getElements() const;
+
+    void debugDump() const;
+
+private:
+    class Slot {
+    public:
+        quint64 high;
+        quint64 low;
+        EntityTreeElement* element; // NULL for an empty slot
+        EntityItem* entity;
+        quint32 hash;
+    };
+
+    class Entry {
+    public:
+        EntityTreeElement* element;
+        EntityItem* entity;
+    };
+
+    static void splitUUID(const QUuid& id, quint64& high, quint64& low);
+    static quint32 hashUUID(quint64 high, quint64 low);
+
+    /// The slot holding the UUID, or the empty slot where it would go
+    int probe(quint64 high, quint64 low, quint32 hash) const;
+    void grow();
+
+    QVector<Slot> _slots; // a power of two of them, or none
+    int _size;
+    QHash<uint32_t, Entry> _creatorTokenEntries;
+};
+
+#endif // hifi_EntityIDMap_h
@@ -155,29 +155,42 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
     
     OctreeElement::AppendState appendState = OctreeElement::COMPLETED; // assume the best
 
-    // encode our ID as a byte count coded byte stream
-    QByteArray encodedID = getID().toRfc4122();
-
-    // encode our type as a byte count coded byte stream
-    ByteCountCoded<quint32> typeCoder = getType();
-    QByteArray encodedType = typeCoder;
-
-    quint64 updateDelta = getLastSimulated() <= getLastEdited() ? 0 : getLastSimulated() - getLastEdited();
-    ByteCountCoded<quint64> updateDeltaCoder = updateDelta;
-    QByteArray encodedUpdateDelta = updateDeltaCoder;
     EntityPropertyFlags propertyFlags(PROP_LAST_ITEM);
     EntityPropertyFlags requestedProperties = getEntityProperties(params);
     EntityPropertyFlags propertiesDidntFit = requestedProperties;
+    bool isFirstPass = true;
 
     // If we are being called for a subsequent pass at appendEntityData() that failed to completely encode this item,
     // then our entityTreeElementExtraEncodeData should include data about which properties we need to append.
     if (entityTreeElementExtraEncodeData && entityTreeElementExtraEncodeData->entities.contains(getEntityItemID())) {
         requestedProperties = entityTreeElementExtraEncodeData->entities.value(getEntityItemID());
+        isFirstPass = false;
     }
 
-    LevelDetails entityLevel = packetData->startLevel();
-
     quint64 lastEdited = getLastEdited();
+    quint64 lastSimulated = getLastSimulated();
+
+    // if we haven't changed since we were last encoded in full, and all of that fits, it's the same bytes again.
+    // Otherwise we encode as much as fits below.
+    QByteArray cachedEncoding;
+    if (isFirstPass && _encodeCache.find(lastEdited, lastSimulated, requestedProperties, cachedEncoding) &&
+            packetData->appendRawData((const unsigned char*)cachedEncoding.constData(), cachedEncoding.size())) {
+        return appendState;
+    }
+
+    // encode our ID as a byte count coded byte stream
+    QByteArray encodedID = getID().toRfc4122();
+
+    // encode our type as a byte count coded byte stream
+    ByteCountCoded<quint32> typeCoder = getType();
+    QByteArray encodedType = typeCoder;
+
+    quint64 updateDelta = lastSimulated <= lastEdited ? 0 : lastSimulated - lastEdited;
+    ByteCountCoded<quint64> updateDeltaCoder = updateDelta;
+    QByteArray encodedUpdateDelta = updateDeltaCoder;
+
+    LevelDetails entityLevel = packetData->startLevel();
+    int startOfEntity = packetData->getUncompressedByteOffset();
 
     const bool wantDebug = false;
     if (wantDebug) {
@@ -195,7 +208,7 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
     bool successPropertyFlagsFits = false;
     int propertyFlagsOffset = 0;
     int oldPropertyFlagsLength = 0;
-    QByteArray encodedPropertyFlags;
+    unsigned char encodedPropertyFlags[EntityPropertyFlags::MAX_ENCODED_LENGTH];
     int propertyCount = 0;
 
     successIDFits = packetData->appendValue(encodedID);
@@ -214,9 +227,8 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
     
     if (successLastUpdatedFits) {
         propertyFlagsOffset = packetData->getUncompressedByteOffset();
-        encodedPropertyFlags = propertyFlags;
-        oldPropertyFlagsLength = encodedPropertyFlags.length();
-        successPropertyFlagsFits = packetData->appendValue(encodedPropertyFlags);
+        oldPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags, sizeof(encodedPropertyFlags));
+        successPropertyFlagsFits = packetData->appendRawData(encodedPropertyFlags, oldPropertyFlagsLength);
     }
 
     bool headerFits = successIDFits && successTypeFits && successCreatedFits && successLastEditedFits 
@@ -266,10 +278,8 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
 
     if (propertyCount > 0) {
         int endOfEntityItemData = packetData->getUncompressedByteOffset();
-        encodedPropertyFlags = propertyFlags;
-        int newPropertyFlagsLength = encodedPropertyFlags.length();
-        packetData->updatePriorBytes(propertyFlagsOffset, 
-                (const unsigned char*)encodedPropertyFlags.constData(), encodedPropertyFlags.length());
+        int newPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags, sizeof(encodedPropertyFlags));
+        packetData->updatePriorBytes(propertyFlagsOffset, encodedPropertyFlags, newPropertyFlagsLength);
         
         // if the size of the PropertyFlags shrunk, we need to shift everything down to front of packet.
         if (newPropertyFlagsLength < oldPropertyFlagsLength) {
@@ -286,6 +296,12 @@ OctreeElement::AppendState EntityItem::appendEntityData(OctreePacketData* packet
         }
        
         packetData->endLevel(entityLevel);
+
+        if (isFirstPass && appendState == OctreeElement::COMPLETED) {
+            int endOfEntity = packetData->getUncompressedByteOffset();
+            _encodeCache.store(lastEdited, lastSimulated, requestedProperties,
+                QByteArray((const char*)packetData->getUncompressedData(startOfEntity), endOfEntity - startOfEntity));
+        }
     } else {
         packetData->discardLevel(entityLevel);
         appendState = OctreeElement::NONE; // if we got here, then we didn't include the item
@@ -482,8 +498,9 @@ int EntityItem::readEntityDataFromBuffer(const unsigned char* data, int bytesLef
         bytesRead += encodedUpdateDelta.size();
 
         // Property Flags
-        QByteArray encodedPropertyFlags = originalDataBuffer.mid(bytesRead); // maximum possible size
-        EntityPropertyFlags propertyFlags = encodedPropertyFlags;
+        EntityPropertyFlags propertyFlags;
+        propertyFlags.decode((const unsigned char*)originalDataBuffer.constData() + bytesRead,
+                             originalDataBuffer.size() - bytesRead); // maximum possible size
         dataAt += propertyFlags.getEncodedLength();
         bytesRead += propertyFlags.getEncodedLength();
         
@@ -498,6 +515,8 @@ int EntityItem::readEntityDataFromBuffer(const unsigned char* data, int bytesLef
                 bytesRead += sizeof(fromBuffer);
                 if (overwriteLocalData) {
                     setRadius(fromBuffer);
+                    recalculateCollisionShape();
+                    _dirtyFlags |= (EntityItem::DIRTY_SHAPE | EntityItem::DIRTY_MASS);
                 }
 
                 if (wantDebug) {
@@ -506,7 +525,7 @@ int EntityItem::readEntityDataFromBuffer(const unsigned char* data, int bytesLef
 
             }
         } else {
-            READ_ENTITY_PROPERTY_SETTER(PROP_DIMENSIONS, glm::vec3, setDimensions);
+            READ_ENTITY_PROPERTY_SETTER(PROP_DIMENSIONS, glm::vec3, updateDimensions);
             if (wantDebug) {
                 qDebug() << "    readEntityDataFromBuffer() NEW FORMAT... look for PROP_DIMENSIONS";
             }
@@ -523,7 +542,7 @@ int EntityItem::readEntityDataFromBuffer(const unsigned char* data, int bytesLef
         READ_ENTITY_PROPERTY(PROP_DAMPING, float, _damping);
         READ_ENTITY_PROPERTY_SETTER(PROP_LIFETIME, float, updateLifetime);
         READ_ENTITY_PROPERTY_STRING(PROP_SCRIPT, setScript);
-        READ_ENTITY_PROPERTY(PROP_REGISTRATION_POINT, glm::vec3, _registrationPoint);
+        READ_ENTITY_PROPERTY_SETTER(PROP_REGISTRATION_POINT, glm::vec3, updateRegistrationPoint);
         READ_ENTITY_PROPERTY_SETTER(PROP_ANGULAR_VELOCITY, glm::vec3, updateAngularVelocity);
         READ_ENTITY_PROPERTY(PROP_ANGULAR_DAMPING, float, _angularDamping);
         READ_ENTITY_PROPERTY(PROP_VISIBLE, bool, _visible);
@@ -760,6 +779,7 @@ void EntityItem::simulate(const quint64& now) {
     }
 
     _lastSimulated = now;
+    _encodeCache.clear(); // no longer matches our simulated time, so don't hold on to it until we're sent again
 }
 
 bool EntityItem::isMoving() const {
@@ -825,7 +845,7 @@ bool EntityItem::setProperties(const EntityItemProperties& properties) {
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(damping, updateDamping);
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(lifetime, updateLifetime);
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(script, setScript);
-    SET_ENTITY_PROPERTY_FROM_PROPERTIES(registrationPoint, setRegistrationPoint);
+    SET_ENTITY_PROPERTY_FROM_PROPERTIES(registrationPoint, updateRegistrationPoint);
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(angularVelocity, updateAngularVelocity);
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(angularDamping, updateAngularDamping);
     SET_ENTITY_PROPERTY_FROM_PROPERTIES(glowLevel, setGlowLevel);
@@ -1046,18 +1066,25 @@ void EntityItem::updatePositionInMeters(const glm::vec3& value) {
 
 void EntityItem::updateDimensions(const glm::vec3& value) { 
     if (glm::distance(_dimensions, value) * (float)TREE_SCALE > MIN_DIMENSION_DELTA) {
-        _dimensions = value; 
-        recalculateCollisionShape();
-        _dirtyFlags |= (EntityItem::DIRTY_SHAPE | EntityItem::DIRTY_MASS);
+        // subclasses may constrain the dimensions, so it's what they end up as that counts
+        glm::vec3 oldDimensions = _dimensions;
+        setDimensions(value);
+        if (_dimensions != oldDimensions) {
+            _dirtyFlags |= (EntityItem::DIRTY_SHAPE | EntityItem::DIRTY_MASS);
+        }
     }
 }
 
 void EntityItem::updateDimensionsInMeters(const glm::vec3& value) { 
-    glm::vec3 dimensions = value / (float) TREE_SCALE;
-    if (glm::distance(_dimensions, dimensions) * (float)TREE_SCALE > MIN_DIMENSION_DELTA) {
-        _dimensions = dimensions; 
+    updateDimensions(value / (float) TREE_SCALE);
+}
+
+void EntityItem::updateRegistrationPoint(const glm::vec3& value) {
+    glm::vec3 registrationPoint = glm::clamp(value, 0.0f, 1.0f);
+    if (registrationPoint != _registrationPoint) {
+        _registrationPoint = registrationPoint;
         recalculateCollisionShape();
-        _dirtyFlags |= (EntityItem::DIRTY_SHAPE | EntityItem::DIRTY_MASS);
+        _dirtyFlags |= EntityItem::DIRTY_SHAPE;
     }
 }
 
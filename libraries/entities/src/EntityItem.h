@@ -24,6 +24,7 @@
 #include <OctreePacketData.h>
 #include <ShapeInfo.h>
 
+#include "EntityEncodeCache.h"
 #include "EntityItemID.h" 
 #include "EntityItemProperties.h" 
 #include "EntityTypes.h"
@@ -73,17 +74,27 @@ public:
     /// returns true if something changed
     virtual bool setProperties(const EntityItemProperties& properties);
 
+    /// Returns a copy of this entity that isn't part of any tree or simulation. Trees with versioned reads publish these
+    /// to their readers.
+    virtual EntityItem* clone() const = 0;
+
     /// Override this in your derived class if you'd like to be informed when something about the state of the entity
     /// has changed. This will be called with properties change or when new data is loaded from a stream
     virtual void somethingChangedNotification() { }
 
     void recordCreationTime();    // set _created to 'now'
     quint64 getLastSimulated() const { return _lastSimulated; } /// Last simulated time of this entity universal usecs
+    /// for simulations that integrate the entity themselves
+    void setLastSimulated(quint64 now) { _lastSimulated = now; _encodeCache.clear(); }
 
      /// Last edited time of this entity universal usecs
     quint64 getLastEdited() const { return _lastEdited; }
-    void setLastEdited(quint64 lastEdited) 
-        { _lastEdited = _lastUpdated = lastEdited; _changedOnServer = glm::max(lastEdited, _changedOnServer); }
+    quint64 getLastUpdated() const { return _lastUpdated; } /// Last time update() was called, universal usecs
+    void setLastEdited(quint64 lastEdited) {
+        _lastEdited = _lastUpdated = lastEdited; 
+        _changedOnServer = glm::max(lastEdited, _changedOnServer);
+        _encodeCache.clear();
+    }
     float getEditedAgo() const /// Elapsed seconds since this entity was last edited
         { return (float)(usecTimestampNow() - getLastEdited()) / (float)USECS_PER_SECOND; }
 
@@ -280,6 +291,7 @@ public:
     void updatePositionInMeters(const glm::vec3& value);
     void updateDimensions(const glm::vec3& value);
     void updateDimensionsInMeters(const glm::vec3& value);
+    void updateRegistrationPoint(const glm::vec3& value);
     void updateRotation(const glm::quat& rotation);
     void updateMass(float value);
     void updateVelocity(const glm::vec3& value);
@@ -338,6 +350,8 @@ protected:
     bool _locked;
     QString _userData;
 
+    mutable EntityEncodeCache _encodeCache; // our last complete encoding, see appendEntityData()
+
     // NOTE: Damping is applied like this:  v *= pow(1 - damping, dt)
     //
     // Hence the damping coefficient must range from 0 (no damping) to 1 (immediate stop).
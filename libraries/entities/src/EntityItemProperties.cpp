@@ -357,9 +357,8 @@ void EntityItemPropertiesFromScriptValue(const QScriptValue &object, EntityItemP
     properties.copyFromScriptValue(object);
 }
 
-// TODO: Implement support for edit packets that can span an MTU sized buffer. We need to implement a mechanism for the 
-//       encodeEntityEditPacket() method to communicate the the caller which properties couldn't fit in the buffer. Similar 
-//       to how we handle this in the Octree streaming case.
+// TODO: Implement support for edit packets that can span an MTU sized buffer. The form of encodeEntityEditPacket() that
+//       takes the requested properties tells the caller which of them didn't fit, but only the edit log uses it so far.
 //
 // TODO: Right now, all possible properties for all subclasses are handled here. Ideally we'd prefer
 //       to handle this in a more generic way. Allowing subclasses of EntityItem to register their properties
@@ -374,6 +373,21 @@ void EntityItemPropertiesFromScriptValue(const QScriptValue &object, EntityItemP
 //
 bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItemID id, const EntityItemProperties& properties,
         unsigned char* bufferOut, int sizeIn, int& sizeOut) {
+    EntityPropertyFlags propertiesDidntFit;
+    bool success = encodeEntityEditPacket(command, id, properties, properties.getChangedProperties(), 
+                                          bufferOut, sizeIn, sizeOut, propertiesDidntFit);
+
+    // for now, if it's not complete, it's not successful
+    if (success && !propertiesDidntFit) {
+        return true;
+    }
+    sizeOut = 0;
+    return false;
+}
+
+bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItemID id, const EntityItemProperties& properties,
+        const EntityPropertyFlags& requestedProperties, unsigned char* bufferOut, int sizeIn, int& sizeOut, 
+        EntityPropertyFlags& propertiesDidntFit) {
     OctreePacketData ourDataPacket(false, sizeIn); // create a packetData object to add out packet details too.
     OctreePacketData* packetData = &ourDataPacket; // we want a pointer to this so we can use our APPEND_ENTITY_PROPERTY macro
 
@@ -424,8 +438,7 @@ bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItem
         QByteArray encodedUpdateDelta = updateDeltaCoder;
 
         EntityPropertyFlags propertyFlags(PROP_LAST_ITEM);
-        EntityPropertyFlags requestedProperties = properties.getChangedProperties();
-        EntityPropertyFlags propertiesDidntFit = requestedProperties;
+        propertiesDidntFit = requestedProperties;
 
         // TODO: we need to handle the multi-pass form of this, similar to how we handle entity data
         //
@@ -456,9 +469,9 @@ bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItem
         bool successLastUpdatedFits = packetData->appendValue(encodedUpdateDelta);
     
         int propertyFlagsOffset = packetData->getUncompressedByteOffset();
-        QByteArray encodedPropertyFlags = propertyFlags;
-        int oldPropertyFlagsLength = encodedPropertyFlags.length();
-        bool successPropertyFlagsFits = packetData->appendValue(encodedPropertyFlags);
+        unsigned char encodedPropertyFlags[EntityPropertyFlags::MAX_ENCODED_LENGTH];
+        int oldPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags, sizeof(encodedPropertyFlags));
+        bool successPropertyFlagsFits = packetData->appendRawData(encodedPropertyFlags, oldPropertyFlagsLength);
         int propertyCount = 0;
 
         bool headerFits = successIDFits && successTypeFits && successLastEditedFits
@@ -525,10 +538,8 @@ bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItem
         if (propertyCount > 0) {
             int endOfEntityItemData = packetData->getUncompressedByteOffset();
         
-            encodedPropertyFlags = propertyFlags;
-            int newPropertyFlagsLength = encodedPropertyFlags.length();
-            packetData->updatePriorBytes(propertyFlagsOffset, 
-                    (const unsigned char*)encodedPropertyFlags.constData(), encodedPropertyFlags.length());
+            int newPropertyFlagsLength = propertyFlags.encode(encodedPropertyFlags, sizeof(encodedPropertyFlags));
+            packetData->updatePriorBytes(propertyFlagsOffset, encodedPropertyFlags, newPropertyFlagsLength);
         
             // if the size of the PropertyFlags shrunk, we need to shift everything down to front of packet.
             if (newPropertyFlagsLength < oldPropertyFlagsLength) {
@@ -552,14 +563,9 @@ bool EntityItemProperties::encodeEntityEditPacket(PacketType command, EntityItem
             appendState = OctreeElement::NONE; // if we got here, then we didn't include the item
         }
     
-        // If any part of the model items didn't fit, then the element is considered partial
-        if (appendState != OctreeElement::COMPLETED) {
-
-            // TODO: handle mechanism for handling partial fitting data!
-            // add this item into our list for the next appendElementData() pass
-            //modelTreeElementExtraEncodeData->includedItems.insert(getEntityItemID(), propertiesDidntFit);
-
-            // for now, if it's not complete, it's not successful
+        // If none of the item fit there's nothing to send. If only part of it did, propertiesDidntFit has what's left
+        // for the caller to send in another packet.
+        if (appendState == OctreeElement::NONE) {
             success = false;
         }
     }
@@ -690,8 +696,8 @@ bool EntityItemProperties::decodeEntityEditPacket(const unsigned char* data, int
     //quint64 lastUpdated = lastEdited + updateDelta; // don't adjust for clock skew since we already did that for lastEdited
     
     // Property Flags...
-    QByteArray encodedPropertyFlags((const char*)dataAt, (bytesToRead - processedBytes));
-    EntityPropertyFlags propertyFlags = encodedPropertyFlags;
+    EntityPropertyFlags propertyFlags;
+    propertyFlags.decode(dataAt, bytesToRead - processedBytes);
     dataAt += propertyFlags.getEncodedLength();
     processedBytes += propertyFlags.getEncodedLength();
 
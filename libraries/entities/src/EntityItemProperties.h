@@ -93,6 +93,11 @@ enum EntityPropertyList {
     PROP_BACKGROUND_COLOR = PROP_ANIMATION_FPS,
 };
 
+// so EntityPropertyFlags keep their bits inline
+template<> struct PropertyFlagsTraits<EntityPropertyList> {
+    static const int LAST_FLAG = PROP_LAST_ITEM;
+};
+
 typedef PropertyFlags<EntityPropertyList> EntityPropertyFlags;
 
 const quint64 UNKNOWN_CREATED_TIME = 0;
@@ -200,6 +205,12 @@ public:
     static bool encodeEntityEditPacket(PacketType command, EntityItemID id, const EntityItemProperties& properties,
         unsigned char* bufferOut, int sizeIn, int& sizeOut);
 
+    /// Encodes the requested properties that fit in sizeIn, and sets propertiesDidntFit to the ones that didn't.
+    /// Fails only if none of them fit.
+    static bool encodeEntityEditPacket(PacketType command, EntityItemID id, const EntityItemProperties& properties,
+        const EntityPropertyFlags& requestedProperties, unsigned char* bufferOut, int sizeIn, int& sizeOut,
+        EntityPropertyFlags& propertiesDidntFit);
+
     static bool encodeEraseEntityMessage(const EntityItemID& entityItemID, 
                                             unsigned char* outputBuffer, size_t maxLength, size_t& outputLength);
 
@@ -0,0 +1,330 @@
+//
+//  EntityKinematics.cpp
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <float.h>
+#include <math.h>
+
+#include <OctreeConstants.h>
+
+#include "EntityItem.h"
+#include "EntityKinematics.h"
+#include "EntityTree.h"
+#include "EntityTreeElement.h"
+
+EntityKinematics::EntityKinematics() :
+    _entities(),
+    _rows(),
+    _lastSimulated(),
+    _positionX(),
+    _positionY(),
+    _positionZ(),
+    _velocityX(),
+    _velocityY(),
+    _velocityZ(),
+    _gravityX(),
+    _gravityY(),
+    _gravityZ(),
+    _logDamping(),
+    _distanceToBottom(),
+    _cubeRadius(),
+    _elementX(),
+    _elementY(),
+    _elementZ(),
+    _elementScale(),
+    _timeElapsed()
+{
+}
+
+bool EntityKinematics::canIntegrate(const EntityItem* entity) {
+    return !entity->getPhysicsInfo() && !entity->hasAngularVelocity();
+}
+
+void EntityKinematics::add(EntityItem* entity) {
+    QHash<EntityItem*, int>::const_iterator rowItr = _rows.constFind(entity);
+    int row;
+    if (rowItr != _rows.constEnd()) {
+        row = rowItr.value();
+    } else {
+        row = _entities.size();
+        resize(row + 1);
+        _entities[row] = entity;
+        _rows.insert(entity, row);
+    }
+    load(row);
+}
+
+void EntityKinematics::remove(EntityItem* entity) {
+    QHash<EntityItem*, int>::iterator rowItr = _rows.find(entity);
+    if (rowItr == _rows.end()) {
+        return;
+    }
+    int row = rowItr.value();
+    _rows.erase(rowItr);
+
+    // the last row fills the hole, so the arrays stay packed
+    int lastRow = _entities.size() - 1;
+    if (row != lastRow) {
+        moveRow(lastRow, row);
+        _rows[_entities[row]] = row;
+    }
+    resize(lastRow);
+}
+
+void EntityKinematics::clear() {
+    _rows.clear();
+    resize(0);
+}
+
+void EntityKinematics::load(int row) {
+    EntityItem* entity = _entities[row];
+    _lastSimulated[row] = entity->getLastSimulated();
+
+    glm::vec3 position = entity->getPosition();
+    _positionX[row] = position.x;
+    _positionY[row] = position.y;
+    _positionZ[row] = position.z;
+
+    glm::vec3 velocity = entity->getVelocity();
+    _velocityX[row] = velocity.x;
+    _velocityY[row] = velocity.y;
+    _velocityZ[row] = velocity.z;
+
+    glm::vec3 gravity = entity->getGravity();
+    _gravityX[row] = gravity.x;
+    _gravityY[row] = gravity.y;
+    _gravityZ[row] = gravity.z;
+
+    // simulate() only damps when there's damping, and exp(0) is exactly 1. Full damping stops the entity outright.
+    float damping = entity->getDamping();
+    _logDamping[row] = (damping <= 0.0f) ? 0.0f : ((damping >= 1.0f) ? -FLT_MAX : logf(1.0f - damping));
+
+    _distanceToBottom[row] = entity->getDistanceToBottomOfEntity();
+    _cubeRadius[row] = entity->getMaximumAACube().getScale() / 2.0f;
+
+    // the entity may be about to move to another element, so look the element up when it's next needed
+    _elementScale[row] = 0.0f;
+}
+
+void EntityKinematics::loadElement(int row, EntityTree* tree) {
+    EntityTreeElement* element = tree->getContainingElement(_entities[row]->getEntityItemID());
+    if (element) {
+        const AACube& cube = element->getAACube();
+        _elementX[row] = cube.getCorner().x;
+        _elementY[row] = cube.getCorner().y;
+        _elementZ[row] = cube.getCorner().z;
+        _elementScale[row] = cube.getScale();
+    }
+}
+
+void EntityKinematics::resize(int size) {
+    _entities.resize(size);
+    _lastSimulated.resize(size);
+    _positionX.resize(size);
+    _positionY.resize(size);
+    _positionZ.resize(size);
+    _velocityX.resize(size);
+    _velocityY.resize(size);
+    _velocityZ.resize(size);
+    _gravityX.resize(size);
+    _gravityY.resize(size);
+    _gravityZ.resize(size);
+    _logDamping.resize(size);
+    _distanceToBottom.resize(size);
+    _cubeRadius.resize(size);
+    _elementX.resize(size);
+    _elementY.resize(size);
+    _elementZ.resize(size);
+    _elementScale.resize(size);
+}
+
+void EntityKinematics::moveRow(int from, int to) {
+    _entities[to] = _entities[from];
+    _lastSimulated[to] = _lastSimulated[from];
+    _positionX[to] = _positionX[from];
+    _positionY[to] = _positionY[from];
+    _positionZ[to] = _positionZ[from];
+    _velocityX[to] = _velocityX[from];
+    _velocityY[to] = _velocityY[from];
+    _velocityZ[to] = _velocityZ[from];
+    _gravityX[to] = _gravityX[from];
+    _gravityY[to] = _gravityY[from];
+    _gravityZ[to] = _gravityZ[from];
+    _logDamping[to] = _logDamping[from];
+    _distanceToBottom[to] = _distanceToBottom[from];
+    _cubeRadius[to] = _cubeRadius[from];
+    _elementX[to] = _elementX[from];
+    _elementY[to] = _elementY[from];
+    _elementZ[to] = _elementZ[from];
+    _elementScale[to] = _elementScale[from];
+}
+
+// true if a cube of the radius around the position is still best fit by the element, the same test as
+// EntityTreeElement::bestFitBounds(). False once it's left the domain, since sorting is what deletes it for that.
+static bool stillBestFits(float x, float y, float z, float radius,
+                          float elementX, float elementY, float elementZ, float elementScale) {
+    if (x + radius < 0.0f || x - radius > 1.0f || y + radius < 0.0f || y - radius > 1.0f ||
+            z + radius < 0.0f || z - radius > 1.0f) {
+        return false;
+    }
+    float minX = glm::clamp(x - radius, 0.0f, 1.0f);
+    float minY = glm::clamp(y - radius, 0.0f, 1.0f);
+    float minZ = glm::clamp(z - radius, 0.0f, 1.0f);
+    float maxX = glm::clamp(x + radius, 0.0f, 1.0f);
+    float maxY = glm::clamp(y + radius, 0.0f, 1.0f);
+    float maxZ = glm::clamp(z + radius, 0.0f, 1.0f);
+    if (minX < elementX || minY < elementY || minZ < elementZ || maxX > elementX + elementScale ||
+            maxY > elementY + elementScale || maxZ > elementZ + elementScale) {
+        return false;
+    }
+    float childScale = elementScale / 2.0f;
+    if (childScale <= SMALLEST_REASONABLE_OCTREE_ELEMENT_SCALE) {
+        return true;
+    }
+
+    // it's the element's to keep as long as no one child could hold it
+    float centerX = elementX + childScale;
+    float centerY = elementY + childScale;
+    float centerZ = elementZ + childScale;
+    return (minX > centerX) != (maxX > centerX) || (minY > centerY) != (maxY > centerY) ||
+        (minZ > centerZ) != (maxZ > centerZ);
+}
+
+void EntityKinematics::integrate(const quint64& now, EntityTree* tree, QVector<EntityItem*>& entitiesToBeSorted,
+                                 QVector<EntityItem*>& stoppedEntities) {
+    int count = _entities.size();
+    int firstStopped = stoppedEntities.size();
+    _timeElapsed.resize(count);
+
+    quint64* lastSimulated = _lastSimulated.data();
+    float* timeElapsed = _timeElapsed.data();
+    float* positionX = _positionX.data();
+    float* positionY = _positionY.data();
+    float* positionZ = _positionZ.data();
+    float* velocityX = _velocityX.data();
+    float* velocityY = _velocityY.data();
+    float* velocityZ = _velocityZ.data();
+    const float* gravityX = _gravityX.constData();
+    const float* gravityY = _gravityY.constData();
+    const float* gravityZ = _gravityZ.constData();
+    const float* logDamping = _logDamping.constData();
+    const float* distanceToBottom = _distanceToBottom.constData();
+
+    for (int i = 0; i < count; i++) {
+        quint64 since = lastSimulated[i] ? lastSimulated[i] : now;
+        timeElapsed[i] = (float)(now - since) / (float)(USECS_PER_SECOND);
+        lastSimulated[i] = now;
+    }
+
+    const float EPSILON_VELOCITY_LENGTH_SQUARED = EntityItem::EPSILON_VELOCITY_LENGTH *
+        EntityItem::EPSILON_VELOCITY_LENGTH;
+    for (int i = 0; i < count; i++) {
+        float dt = timeElapsed[i];
+        float vx = velocityX[i];
+        float vy = velocityY[i];
+        float vz = velocityZ[i];
+        float gx = gravityX[i];
+        float gy = gravityY[i];
+        float gz = gravityZ[i];
+        bool hasGravity = gx != 0.0f || gy != 0.0f || gz != 0.0f;
+#ifdef USE_BULLET_PHYSICS
+        bool moves = vx != 0.0f || vy != 0.0f || vz != 0.0f;
+#else // !USE_BULLET_PHYSICS
+        bool moves = vx != 0.0f || vy != 0.0f || vz != 0.0f || hasGravity;
+#endif // USE_BULLET_PHYSICS
+        EntityItem* entity = _entities[i];
+        if (!moves) {
+            stoppedEntities << entity;
+            continue;
+        }
+
+        float bottom = distanceToBottom[i];
+        float y = positionY[i];
+        bool wasRestingOnSurface = y <= bottom && fabsf(vy) <= EntityItem::EPSILON_VELOCITY_LENGTH && gy < 0.0f;
+
+        // linear damping, then integrate position forward
+        float damping = expf(dt * logDamping[i]);
+        vx *= damping;
+        vy *= damping;
+        vz *= damping;
+        float x = positionX[i] + vx * dt;
+        float z = positionZ[i] + vz * dt;
+        y += vy * dt;
+
+        // bounce off the ground at the distance to the bottom of the entity
+        if (y <= bottom) {
+            vy = -vy;
+#ifndef USE_BULLET_PHYSICS
+            if (vx * vx + vy * vy + vz * vz <= EPSILON_VELOCITY_LENGTH_SQUARED) {
+                vx = vy = vz = 0.0f;
+            }
+#endif // !USE_BULLET_PHYSICS
+            y = bottom;
+        }
+        if (hasGravity) {
+            if (wasRestingOnSurface) {
+                vy = 0.0f;
+                y = bottom;
+            } else {
+                vx += gx * dt;
+                vy += gy * dt;
+                vz += gz * dt;
+            }
+        }
+#ifndef USE_BULLET_PHYSICS
+        if (vx * vx + vy * vy + vz * vz <= EPSILON_VELOCITY_LENGTH_SQUARED) {
+            vx = vy = vz = 0.0f;
+        }
+#endif // !USE_BULLET_PHYSICS
+
+        positionX[i] = x;
+        positionY[i] = y;
+        positionZ[i] = z;
+        velocityX[i] = vx;
+        velocityY[i] = vy;
+        velocityZ[i] = vz;
+
+        entity->setPosition(glm::vec3(x, y, z)); // this will automatically recalculate our collision shape
+        entity->setVelocity(glm::vec3(vx, vy, vz));
+        entity->setLastSimulated(now);
+
+        if (_elementScale[i] == 0.0f) {
+            loadElement(i, tree);
+        }
+        if (_elementScale[i] > 0.0f && stillBestFits(x, y, z, _cubeRadius[i],
+                                                     _elementX[i], _elementY[i], _elementZ[i], _elementScale[i])) {
+            // staying put in the tree, but the element and everything above it have still changed as far as sending goes
+            EntityTreeElement* element = tree->getContainingElement(entity->getEntityItemID());
+            if (element) {
+                tree->markPathWithChangedTime(element);
+            }
+            tree->markEntityToPublish(entity);
+            tree->logEntityChange(entity);
+        } else {
+            entitiesToBeSorted << entity;
+            _elementScale[i] = 0.0f;
+        }
+
+        // the same test as EntityItem::isMoving(), for an entity without angular velocity
+        bool hasVelocity = vx != 0.0f || vy != 0.0f || vz != 0.0f;
+#ifdef USE_BULLET_PHYSICS
+        bool isMoving = hasVelocity;
+#else // !USE_BULLET_PHYSICS
+        bool isRestingOnSurface = y <= bottom && fabsf(vy) <= EntityItem::EPSILON_VELOCITY_LENGTH && gy < 0.0f;
+        bool isMoving = hasVelocity || (hasGravity && !isRestingOnSurface);
+#endif // USE_BULLET_PHYSICS
+        if (!isMoving) {
+            stoppedEntities << entity;
+        }
+    }
+
+    for (int i = firstStopped; i < stoppedEntities.size(); i++) {
+        remove(stoppedEntities[i]);
+    }
+}
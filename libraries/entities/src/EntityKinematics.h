@@ -0,0 +1,77 @@
+//
+//  EntityKinematics.h
+//  libraries/entities/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityKinematics_h
+#define hifi_EntityKinematics_h
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+class EntityItem;
+class EntityTree;
+
+/// The linear motion of moving entities, kept in parallel arrays so SimpleEntitySimulation integrates them in one pass
+/// over packed floats instead of a virtual simulate() per entity that reads its state from all over the entity. The math
+/// is EntityItem::simulate()'s for an entity without angular velocity, which is the only kind it takes.
+///
+/// A row is loaded from its entity when the entity is added or changes, and integrating only writes back the new
+/// position, velocity and simulation time. The containing element's cube is kept too, so only the entities that no
+/// longer best fit their element have to be sorted in the tree.
+class EntityKinematics {
+public:
+    EntityKinematics();
+
+    /// Whether the arrays can integrate the entity, otherwise it has to simulate() itself
+    static bool canIntegrate(const EntityItem* entity);
+
+    /// Adds the entity, or reloads its row if it's already here
+    void add(EntityItem* entity);
+    void remove(EntityItem* entity);
+    bool contains(EntityItem* entity) const { return _rows.contains(entity); }
+    void clear();
+    int size() const { return _entities.size(); }
+
+    /// Advances every entity to now. Entities that moved out of their element's best fit are appended to
+    /// entitiesToBeSorted and the others that moved are marked to be published. Entities that came to rest are removed
+    /// and appended to stoppedEntities.
+    void integrate(const quint64& now, EntityTree* tree, QVector<EntityItem*>& entitiesToBeSorted,
+                   QVector<EntityItem*>& stoppedEntities);
+
+private:
+    void load(int row);
+    void loadElement(int row, EntityTree* tree);
+    void resize(int size);
+    void moveRow(int from, int to);
+
+    QVector<EntityItem*> _entities;
+    QHash<EntityItem*, int> _rows;
+
+    QVector<quint64> _lastSimulated;
+    QVector<float> _positionX; // tree units, like the rest
+    QVector<float> _positionY;
+    QVector<float> _positionZ;
+    QVector<float> _velocityX;
+    QVector<float> _velocityY;
+    QVector<float> _velocityZ;
+    QVector<float> _gravityX;
+    QVector<float> _gravityY;
+    QVector<float> _gravityZ;
+    QVector<float> _logDamping; // log(1 - damping), so the damping over t seconds is exp(t * _logDamping)
+    QVector<float> _distanceToBottom;
+    QVector<float> _cubeRadius; // half the scale of the entity's maximum AACube, which is centered on its position
+    QVector<float> _elementX; // the containing element's cube
+    QVector<float> _elementY;
+    QVector<float> _elementZ;
+    QVector<float> _elementScale; // 0 until the element is looked up
+
+    QVector<float> _timeElapsed; // scratch for integrate()
+};
+
+#endif // hifi_EntityKinematics_h
@@ -17,7 +17,7 @@
 void EntitySimulation::setEntityTree(EntityTree* tree) {
     if (_entityTree && _entityTree != tree) {
         _mortalEntities.clear();
-        _nextExpiry = quint64(-1);
+        _mortalEntityExpiries.clear();
         _updateableEntities.clear();
         _entitiesToBeSorted.clear();
     }
@@ -39,30 +39,43 @@ void EntitySimulation::updateEntities(QSet<EntityItem*>& entitiesToDelete) {
 }
 
 void EntitySimulation::expireMortalEntities(const quint64& now) {
-    if (now > _nextExpiry) {
-        // only search for expired entities if we expect to find one
-        _nextExpiry = quint64(-1);
-        QSet<EntityItem*>::iterator itemItr = _mortalEntities.begin();
-        while (itemItr != _mortalEntities.end()) {
-            EntityItem* entity = *itemItr;
-            quint64 expiry = entity->getExpiry();
-            if (expiry < now) {
-                _entitiesToDelete.insert(entity);
-                itemItr = _mortalEntities.erase(itemItr);
-                _updateableEntities.remove(entity);
-                _entitiesToBeSorted.remove(entity);
-                removeEntityInternal(entity);
-            } else {
-                if (expiry < _nextExpiry) {
-                    // remeber the smallest _nextExpiry so we know when to start the next search
-                    _nextExpiry = expiry;
-                }
-                ++itemItr;
-            }
+    // entities come out of _mortalEntities soonest expiry first, so we only ever look at the ones that are due
+    while (!_mortalEntities.isEmpty() && _mortalEntities.begin().key() < now) {
+        QMultiMap<quint64, EntityItem*>::iterator itemItr = _mortalEntities.begin();
+        EntityItem* entity = itemItr.value();
+        _mortalEntities.erase(itemItr);
+        _mortalEntityExpiries.remove(entity);
+
+        // the entity's lifetime can change without us hearing about it, so check it's really due
+        if (!entity->isMortal()) {
+            continue;
+        }
+        if (entity->getExpiry() < now) {
+            _entitiesToDelete.insert(entity);
+            _updateableEntities.remove(entity);
+            _entitiesToBeSorted.remove(entity);
+            removeEntityInternal(entity);
+        } else {
+            addMortalEntity(entity);
         }
     }
 }
 
+void EntitySimulation::addMortalEntity(EntityItem* entity) {
+    removeMortalEntity(entity);
+    quint64 expiry = entity->getExpiry();
+    _mortalEntities.insert(expiry, entity);
+    _mortalEntityExpiries.insert(entity, expiry);
+}
+
+void EntitySimulation::removeMortalEntity(EntityItem* entity) {
+    QHash<EntityItem*, quint64>::iterator expiryItr = _mortalEntityExpiries.find(entity);
+    if (expiryItr != _mortalEntityExpiries.end()) {
+        _mortalEntities.remove(expiryItr.value(), entity);
+        _mortalEntityExpiries.erase(expiryItr);
+    }
+}
+
 void EntitySimulation::callUpdateOnEntitiesThatNeedIt(const quint64& now) {
     PerformanceTimer perfTimer("updatingEntities");
     QSet<EntityItem*>::iterator itemItr = _updateableEntities.begin();
@@ -74,6 +87,8 @@ void EntitySimulation::callUpdateOnEntitiesThatNeedIt(const quint64& now) {
             itemItr = _updateableEntities.erase(itemItr);
         } else {
             entity->update(now);
+            _entityTree->markEntityToPublish(entity);
+            _entityTree->logEntityChange(entity);
             ++itemItr;
         }
     }
@@ -93,17 +108,21 @@ void EntitySimulation::sortEntitiesThatMoved() {
         if (!domainBounds.touches(newCube)) {
             qDebug() << "Entity " << entity->getEntityItemID() << " moved out of domain bounds.";
             _entitiesToDelete.insert(entity);
-            _mortalEntities.remove(entity);
+            removeMortalEntity(entity);
             _updateableEntities.remove(entity);
             removeEntityInternal(entity);
         } else {
+            _entityTree->markEntityToPublish(entity);
+            _entityTree->logEntityChange(entity);
             moveOperator.addEntityToMoveList(entity, newCube);
         }
         ++itemItr;
     }
     if (moveOperator.hasMovingEntities()) {
         PerformanceTimer perfTimer("recurseTreeWithOperator");
+        _entityTree->lockForWrite();
         _entityTree->recurseTreeWithOperator(&moveOperator);
+        _entityTree->unlock();
     }
 
     sortEntitiesThatMovedInternal();
@@ -113,11 +132,7 @@ void EntitySimulation::sortEntitiesThatMoved() {
 void EntitySimulation::addEntity(EntityItem* entity) {
     assert(entity);
     if (entity->isMortal()) {
-        _mortalEntities.insert(entity);
-        quint64 expiry = entity->getExpiry();
-        if (expiry < _nextExpiry) {
-            _nextExpiry = expiry;
-        }
+        addMortalEntity(entity);
     }
     if (entity->needsToCallUpdate()) {
         _updateableEntities.insert(entity);
@@ -132,7 +147,7 @@ void EntitySimulation::addEntity(EntityItem* entity) {
 void EntitySimulation::removeEntity(EntityItem* entity) {
     assert(entity);
     _updateableEntities.remove(entity);
-    _mortalEntities.remove(entity);
+    removeMortalEntity(entity);
     _entitiesToBeSorted.remove(entity);
     _entitiesToDelete.remove(entity);
     removeEntityInternal(entity);
@@ -152,7 +167,7 @@ void EntitySimulation::entityChanged(EntityItem* entity) {
         if (!domainBounds.touches(newCube)) {
             qDebug() << "Entity " << entity->getEntityItemID() << " moved out of domain bounds.";
             _entitiesToDelete.insert(entity);
-            _mortalEntities.remove(entity);
+            removeMortalEntity(entity);
             _updateableEntities.remove(entity);
             removeEntityInternal(entity);
             wasRemoved = true;
@@ -161,13 +176,9 @@ void EntitySimulation::entityChanged(EntityItem* entity) {
     if (!wasRemoved) {
         if (dirtyFlags & EntityItem::DIRTY_LIFETIME) {
             if (entity->isMortal()) {
-                _mortalEntities.insert(entity);
-                quint64 expiry = entity->getExpiry();
-                if (expiry < _nextExpiry) {
-                    _nextExpiry = expiry;
-                }
+                addMortalEntity(entity);
             } else {
-                _mortalEntities.remove(entity);
+                removeMortalEntity(entity);
             }
             entity->clearDirtyFlags(EntityItem::DIRTY_LIFETIME);
         }
@@ -182,7 +193,7 @@ void EntitySimulation::entityChanged(EntityItem* entity) {
 
 void EntitySimulation::clearEntities() {
     _mortalEntities.clear();
-    _nextExpiry = quint64(-1);
+    _mortalEntityExpiries.clear();
     _updateableEntities.clear();
     _entitiesToBeSorted.clear();
     clearEntitiesInternal();
@@ -12,6 +12,8 @@
 #ifndef hifi_EntitySimulation_h
 #define hifi_EntitySimulation_h
 
+#include <QHash>
+#include <QMultiMap>
 #include <QSet>
 
 #include <PerfStat.h>
@@ -77,6 +79,8 @@ protected:
     virtual void clearEntitiesInternal() = 0;
 
     void expireMortalEntities(const quint64& now);
+    void addMortalEntity(EntityItem* entity); // adds the entity, or moves it to its current expiry if it's already in
+    void removeMortalEntity(EntityItem* entity);
     void callUpdateOnEntitiesThatNeedIt(const quint64& now);
     void sortEntitiesThatMoved();
 
@@ -85,8 +89,8 @@ protected:
 
     // We maintain multiple lists, each for its distinct purpose.
     // An entity may be in more than one list.
-    QSet<EntityItem*> _mortalEntities; // entities that have an expiry
-    quint64 _nextExpiry;
+    QMultiMap<quint64, EntityItem*> _mortalEntities; // entities that have an expiry, soonest expiry first
+    QHash<EntityItem*, quint64> _mortalEntityExpiries; // the expiry each entity in _mortalEntities is filed under
     QSet<EntityItem*> _updateableEntities; // entities that need update() called
     QSet<EntityItem*> _entitiesToBeSorted; // entities that were moved by THIS simulation and might need to be resorted in the tree
     QSet<EntityItem*> _entitiesToDelete;
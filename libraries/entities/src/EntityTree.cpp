@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <OctreeEditLog.h>
+#include <OctreeElementPool.h>
 #include <PerfStat.h>
 
 #include "EntityTree.h"
@@ -21,9 +23,16 @@
 
 EntityTree::EntityTree(bool shouldReaverage) : 
     Octree(shouldReaverage), 
+    _recentlyDeletedEntities(),
+    _changeSequence(1), // 0 is for trees without a log
+    _changeLog(),
+    _changeLogSequences(),
     _fbxService(NULL),
-    _simulation(NULL)
+    _simulation(NULL),
+    _inEditBatch(false),
+    _batchedEdits()
 {
+    _elementPool = new OctreeElementPool(sizeof(EntityTreeElement));
     _rootElement = createNewElement();
 }
 
@@ -32,7 +41,7 @@ EntityTree::~EntityTree() {
 }
 
 EntityTreeElement* EntityTree::createNewElement(unsigned char * octalCode) {
-    EntityTreeElement* newElement = new EntityTreeElement(octalCode);
+    EntityTreeElement* newElement = new (_elementPool) EntityTreeElement(octalCode);
     newElement->setTree(this);
     return newElement;
 }
@@ -42,10 +51,17 @@ void EntityTree::eraseAllOctreeElements(bool createNewRoot) {
     if (_simulation) {
         _simulation->clearEntities();
     }
-    foreach (EntityTreeElement* element, _entityToElementMap) {
+    foreach (EntityTreeElement* element, _entityToElementMap.getElements()) {
         element->cleanupEntities();
     }
     _entityToElementMap.clear();
+
+    _changeLogLock.lockForWrite();
+    _changeLog.clear();
+    _changeLogSequences.clear();
+    _changeSequence++;
+    _changeLogLock.unlock();
+
     Octree::eraseAllOctreeElements(createNewRoot);
 }
 
@@ -127,14 +143,14 @@ bool EntityTree::updateEntityWithElement(EntityItem* entity, const EntityItemPro
                 EntityItemProperties tempProperties;
                 tempProperties.setLocked(wantsLocked);
                 UpdateEntityOperator theOperator(this, containingElement, entity, tempProperties);
-                recurseTreeWithOperator(&theOperator);
+                recurseWithUpdateOperator(theOperator);
                 _isDirty = true;
             }
         }
     } else {
         uint32_t preFlags = entity->getDirtyFlags();
         UpdateEntityOperator theOperator(this, containingElement, entity, properties);
-        recurseTreeWithOperator(&theOperator);
+        recurseWithUpdateOperator(theOperator);
         _isDirty = true;
 
         uint32_t newFlags = entity->getDirtyFlags() & ~preFlags;
@@ -149,6 +165,9 @@ bool EntityTree::updateEntityWithElement(EntityItem* entity, const EntityItemPro
             }
         }
     }
+
+    // edits from the network are logged by their callers, but the collision system changes entities through here too
+    logEntityChange(entity);
     
     // TODO: this final containingElement check should eventually be removed (or wrapped in an #ifdef DEBUG).
     containingElement = getContainingElement(entity->getEntityItemID());
@@ -161,6 +180,19 @@ bool EntityTree::updateEntityWithElement(EntityItem* entity, const EntityItemPro
     return true;
 }
 
+void EntityTree::recurseWithUpdateOperator(UpdateEntityOperator& theOperator) {
+    // an update that keeps the entity in its element only changes the entity, which readers of a tree with versioned
+    // reads don't see until it's published, but moving it changes the tree itself
+    bool changesTree = theOperator.mightMoveEntity();
+    if (changesTree) {
+        lockForWrite();
+    }
+    recurseTreeWithOperator(&theOperator);
+    if (changesTree) {
+        unlock();
+    }
+}
+
 EntityItem* EntityTree::addEntity(const EntityItemID& entityID, const EntityItemProperties& properties) {
     EntityItem* result = NULL;
 
@@ -197,7 +229,9 @@ EntityItem* EntityTree::addEntity(const EntityItemID& entityID, const EntityItem
         }
         // Recurse the tree and store the entity in the correct tree element
         AddEntityOperator theOperator(this, result);
+        lockForWrite();
         recurseTreeWithOperator(&theOperator);
+        unlock();
 
         postAddEntity(result);
     }
@@ -214,8 +248,11 @@ void EntityTree::trackDeletedEntity(EntityItem* entity) {
         // set up the deleted entities ID
         quint64 deletedAt = usecTimestampNow();
         _recentlyDeletedEntitiesLock.lockForWrite();
-        _recentlyDeletedEntityItemIDs.insert(deletedAt, entity->getEntityItemID().id);
+        _recentlyDeletedEntities.append(deletedAt, entity->getEntityItemID().id);
         _recentlyDeletedEntitiesLock.unlock();
+
+        // the delete message tells clients about this one
+        forgetEntityChange(entity->getEntityItemID().id);
     }
 }
 
@@ -241,7 +278,9 @@ void EntityTree::deleteEntity(const EntityItemID& entityID) {
 
     // NOTE: callers must lock the tree before using this method
     DeleteEntityOperator theOperator(this, entityID);
+    lockForWrite();
     recurseTreeWithOperator(&theOperator);
+    unlock();
     _isDirty = true;
 }
 
@@ -254,7 +293,9 @@ void EntityTree::deleteEntities(QSet<EntityItemID> entityIDs) {
         emit deletingEntity(entityID);
     }
 
+    lockForWrite();
     recurseTreeWithOperator(&theOperator);
+    unlock();
     _isDirty = true;
 }
 
@@ -336,7 +377,7 @@ void EntityTree::handleAddEntityResponse(const QByteArray& packet) {
         if (foundEntity) {
             creatorTokenContainingElement->updateEntityItemID(creatorTokenVersion, knownIDVersion);
             setContainingElement(creatorTokenVersion, NULL);
-            setContainingElement(knownIDVersion, creatorTokenContainingElement);
+            setContainingElement(knownIDVersion, creatorTokenContainingElement, foundEntity);
             
             // because the ID of the entity is switching, we need to emit these signals for any 
             // listeners who care about the changing of IDs
@@ -402,24 +443,41 @@ const EntityItem* EntityTree::findClosestEntity(glm::vec3 position, float target
     return args.closestEntity;
 }
 
-class FindAllNearPointArgs {
+/// Gathers the entities touching a sphere. Each subtree of a parallel search gathers its own, and they're appended after
+/// the ones found above the level the search forked at, so the results hold the same entities as a serial search but
+/// not necessarily in the same order.
+class FindInSphereOperator : public RecurseOctreeOperator {
 public:
-    glm::vec3 position;
-    float targetRadius;
-    QVector<const EntityItem*> entities;
-};
+    FindInSphereOperator(const glm::vec3& position, float targetRadius) :
+        _position(position),
+        _targetRadius(targetRadius),
+        _foundEntities()
+    {
+    }
 
+    virtual bool preRecursion(OctreeElement* element);
+    virtual bool postRecursion(OctreeElement* element) { return true; }
+    virtual RecurseOctreeOperator* forkForSubtree() { return new FindInSphereOperator(_position, _targetRadius); }
+    virtual void joinSubtree(RecurseOctreeOperator* subtreeOperator) {
+        _foundEntities += static_cast<FindInSphereOperator*>(subtreeOperator)->_foundEntities;
+    }
 
-bool EntityTree::findInSphereOperation(OctreeElement* element, void* extraData) {
-    FindAllNearPointArgs* args = static_cast<FindAllNearPointArgs*>(extraData);
+    QVector<const EntityItem*>& getFoundEntities() { return _foundEntities; }
+
+private:
+    glm::vec3 _position;
+    float _targetRadius;
+    QVector<const EntityItem*> _foundEntities;
+};
+
+bool FindInSphereOperator::preRecursion(OctreeElement* element) {
     glm::vec3 penetration;
-    bool sphereIntersection = element->getAACube().findSpherePenetration(args->position,
-                                                                    args->targetRadius, penetration);
+    bool sphereIntersection = element->getAACube().findSpherePenetration(_position, _targetRadius, penetration);
 
     // If this element contains the point, then search it...
     if (sphereIntersection) {
         EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(element);
-        entityTreeElement->getEntities(args->position, args->targetRadius, args->entities);
+        entityTreeElement->getEntities(_position, _targetRadius, _foundEntities);
         return true; // keep searching in case children have closer entities
     }
 
@@ -429,30 +487,42 @@ bool EntityTree::findInSphereOperation(OctreeElement* element, void* extraData)
 
 // NOTE: assumes caller has handled locking
 void EntityTree::findEntities(const glm::vec3& center, float radius, QVector<const EntityItem*>& foundEntities) {
-    FindAllNearPointArgs args = { center, radius };
+    FindInSphereOperator theOperator(center, radius);
     // NOTE: This should use recursion, since this is a spatial operation
-    recurseTreeWithOperation(findInSphereOperation, &args);
+    recurseTreeWithOperatorInParallel(&theOperator);
 
     // swap the two lists of entity pointers instead of copy
-    foundEntities.swap(args.entities);
+    foundEntities.swap(theOperator.getFoundEntities());
 }
 
-class FindEntitiesInCubeArgs {
+/// Gathers the entities touching a cube, in parallel the same way as FindInSphereOperator
+class FindInCubeOperator : public RecurseOctreeOperator {
 public:
-    FindEntitiesInCubeArgs(const AACube& cube) 
-        : _cube(cube), _foundEntities() {
+    FindInCubeOperator(const AACube& cube) :
+        _cube(cube),
+        _foundEntities()
+    {
+    }
+
+    virtual bool preRecursion(OctreeElement* element);
+    virtual bool postRecursion(OctreeElement* element) { return true; }
+    virtual RecurseOctreeOperator* forkForSubtree() { return new FindInCubeOperator(_cube); }
+    virtual void joinSubtree(RecurseOctreeOperator* subtreeOperator) {
+        _foundEntities += static_cast<FindInCubeOperator*>(subtreeOperator)->_foundEntities;
     }
 
+    QVector<EntityItem*>& getFoundEntities() { return _foundEntities; }
+
+private:
     AACube _cube;
     QVector<EntityItem*> _foundEntities;
 };
 
-bool EntityTree::findInCubeOperation(OctreeElement* element, void* extraData) {
-    FindEntitiesInCubeArgs* args = static_cast<FindEntitiesInCubeArgs*>(extraData);
+bool FindInCubeOperator::preRecursion(OctreeElement* element) {
     const AACube& elementCube = element->getAACube();
-    if (elementCube.touches(args->_cube)) {
+    if (elementCube.touches(_cube)) {
         EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(element);
-        entityTreeElement->getEntities(args->_cube, args->_foundEntities);
+        entityTreeElement->getEntities(_cube, _foundEntities);
         return true;
     }
     return false;
@@ -460,11 +530,11 @@ bool EntityTree::findInCubeOperation(OctreeElement* element, void* extraData) {
 
 // NOTE: assumes caller has handled locking
 void EntityTree::findEntities(const AACube& cube, QVector<EntityItem*>& foundEntities) {
-    FindEntitiesInCubeArgs args(cube);
+    FindInCubeOperator theOperator(cube);
     // NOTE: This should use recursion, since this is a spatial operation
-    recurseTreeWithOperation(findInCubeOperation, &args);
+    recurseTreeWithOperatorInParallel(&theOperator);
     // swap the two lists of entity pointers instead of copy
-    foundEntities.swap(args._foundEntities);
+    foundEntities.swap(theOperator.getFoundEntities());
 }
 
 EntityItem* EntityTree::findEntityByID(const QUuid& id) {
@@ -474,8 +544,8 @@ EntityItem* EntityTree::findEntityByID(const QUuid& id) {
 
 EntityItem* EntityTree::findEntityByEntityItemID(const EntityItemID& entityID) /*const*/ {
     EntityItem* foundEntity = NULL;
-    EntityTreeElement* containingElement = getContainingElement(entityID);
-    if (containingElement) {
+    EntityTreeElement* containingElement = getContainingElement(entityID, &foundEntity);
+    if (containingElement && !foundEntity) {
         foundEntity = containingElement->getEntityWithEntityItemID(entityID);
     }
     return foundEntity;
@@ -508,8 +578,13 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
     // we handle these types of "edit" packets
     switch (packetType) {
         case PacketTypeEntityErase: {
+            // finish the batched edits first, they may be to the entities being erased
+            applyBatchedEdits();
             QByteArray dataByteArray((const char*)editData, maxLength);
             processedBytes = processEraseMessageDetails(dataByteArray, senderNode);
+            if (_editLog && processedBytes > 0) {
+                _editLog->append(packetType, dataByteArray.left(processedBytes));
+            }
             break;
         }
         
@@ -529,9 +604,14 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
                     EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
                     
                     // if the EntityItem exists, then update it
-                    if (existingEntity) {
+                    if (existingEntity && _inEditBatch) {
+                        batchEntityEdit(existingEntity, properties);
+                    } else if (existingEntity) {
                         updateEntity(entityItemID, properties);
                         existingEntity->markAsChangedOnServer();
+                        markEntityToPublish(existingEntity);
+                        logEntityEdit(existingEntity);
+                        logEntityChange(existingEntity);
                     } else {
                         qDebug() << "User attempted to edit an unknown entity. ID:" << entityItemID;
                     }
@@ -541,6 +621,8 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
                     EntityItem* newEntity = addEntity(entityItemID, properties);
                     if (newEntity) {
                         newEntity->markAsChangedOnServer();
+                        logEntityEdit(newEntity);
+                        logEntityChange(newEntity);
                         notifyNewlyCreatedEntity(*newEntity, senderNode);
                     }
                 }
@@ -555,6 +637,250 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
     return processedBytes;
 }
 
+void EntityTree::beginEditBatch() {
+    _inEditBatch = true;
+}
+
+void EntityTree::endEditBatch() {
+    applyBatchedEdits();
+    _inEditBatch = false;
+}
+
+void EntityTree::batchEntityEdit(EntityItem* entity, const EntityItemProperties& properties) {
+    if (!_batchedEdits.contains(entity)) {
+        BatchedEdit batchedEdit;
+        batchedEdit.dirtyFlags = entity->getDirtyFlags();
+        batchedEdit.maximumAACube = entity->getMaximumAACube();
+        _batchedEdits.insert(entity, batchedEdit);
+    }
+
+    // same rule as updateEntityWithElement(), the only change a locked entity takes is being unlocked
+    if (entity->getLocked()) {
+        if (properties.lockedChanged() && !properties.getLocked()) {
+            EntityItemProperties tempProperties;
+            tempProperties.setLocked(false);
+            entity->setProperties(tempProperties);
+        }
+    } else {
+        entity->setProperties(properties);
+    }
+}
+
+void EntityTree::applyBatchedEdits() {
+    if (_batchedEdits.isEmpty()) {
+        return;
+    }
+
+    // the entities that no longer fit their elements all move in one pass, the same way the simulation moves them, but
+    // like updateEntity() only entities whose bounds changed are looked at
+    MovingEntitiesOperator moveOperator(this);
+    QHashIterator<EntityItem*, BatchedEdit> i(_batchedEdits);
+    while (i.hasNext()) {
+        i.next();
+        AACube newCube = i.key()->getMaximumAACube();
+        if (newCube != i.value().maximumAACube) {
+            moveOperator.addEntityToMoveList(i.key(), newCube);
+        }
+    }
+    if (moveOperator.hasMovingEntities()) {
+        lockForWrite();
+        recurseTreeWithOperator(&moveOperator);
+        unlock();
+    }
+    _isDirty = true;
+
+    i.toFront();
+    while (i.hasNext()) {
+        i.next();
+        EntityItem* entity = i.key();
+        EntityTreeElement* containingElement = getContainingElement(entity->getEntityItemID());
+        if (containingElement) {
+            markPathWithChangedTime(containingElement);
+        }
+
+        uint32_t newFlags = entity->getDirtyFlags() & ~i.value().dirtyFlags;
+        if (newFlags) {
+            if (_simulation) {
+                if (newFlags & DIRTY_SIMULATION_FLAGS) {
+                    _simulation->entityChanged(entity);
+                }
+            } else {
+                // normally the _simulation clears ALL updateFlags, but since there is none we do it explicitly
+                entity->clearDirtyFlags();
+            }
+        }
+        entity->markAsChangedOnServer();
+        markEntityToPublish(entity);
+        logEntityEdit(entity);
+        logEntityChange(entity);
+    }
+    _batchedEdits.clear();
+}
+
+// marks the element and every element above it, like the unwinding of an UpdateEntityOperator that didn't move anything
+void EntityTree::markPathWithChangedTime(EntityTreeElement* element) {
+    OctreeElement* pathElement = _rootElement;
+    while (pathElement && pathElement != element) {
+        pathElement->markWithChangedTime();
+        int branch = branchIndexWithDescendant(pathElement->getOctalCode(), element->getOctalCode());
+        pathElement = pathElement->getChildAtIndex(branch);
+    }
+    element->markWithChangedTime();
+}
+
+// Edits are logged with the entity's whole state after the edit, rather than the edit as it came in, so that replaying
+// them recreates new entities with the IDs we gave them and gives the same result over a snapshot that has them already.
+void EntityTree::logEntityEdit(EntityItem* entity) {
+    if (!_editLog) {
+        return;
+    }
+    QList<QByteArray> records;
+    encodeEntityRecords(entity, records);
+    foreach (const QByteArray& record, records) {
+        _editLog->append(PacketTypeEntityAddOrEdit, record);
+    }
+}
+
+void EntityTree::logEntityChange(const EntityItem* entity) {
+    if (!getIsServer()) {
+        return;
+    }
+    const QUuid& id = entity->getEntityItemID().id;
+    _changeLogLock.lockForWrite();
+    QHash<QUuid, quint64>::iterator logged = _changeLogSequences.find(id);
+    if (logged != _changeLogSequences.end()) {
+        // only the latest change matters, so each entity is in the log once
+        _changeLog.remove(logged.value());
+        logged.value() = ++_changeSequence;
+    } else {
+        _changeLogSequences.insert(id, ++_changeSequence);
+    }
+    _changeLog.insert(_changeSequence, id);
+    _changeLogLock.unlock();
+}
+
+void EntityTree::forgetEntityChange(const QUuid& id) {
+    _changeLogLock.lockForWrite();
+    quint64 sequence = _changeLogSequences.take(id);
+    if (sequence) {
+        _changeLog.remove(sequence);
+    }
+    // there's nothing left to encode, but the tree did change, so senders shouldn't think it's the same as before
+    _changeSequence++;
+    _changeLogLock.unlock();
+}
+
+quint64 EntityTree::getChangeSequence() {
+    QReadLocker locker(&_changeLogLock);
+    return _changeSequence;
+}
+
+void EntityTree::findElementsChangedSince(quint64 sequence, QSet<OctreeElement*>& elements) {
+    QVector<QUuid> changedIDs;
+    _changeLogLock.lockForRead();
+    for (QMap<quint64, QUuid>::const_iterator change = _changeLog.upperBound(sequence); change != _changeLog.constEnd();
+            ++change) {
+        changedIDs << change.value();
+    }
+    _changeLogLock.unlock();
+
+    foreach (const QUuid& id, changedIDs) {
+        EntityTreeElement* containingElement = getContainingElement(EntityItemID(id));
+        if (!containingElement) {
+            continue;
+        }
+        // an element's entities are encoded along with its siblings under their parent, except the root's own
+        OctreeElement* parentElement = NULL;
+        if (containingElement != _rootElement) {
+            nodeForOctalCode(_rootElement, containingElement->getOctalCode(), &parentElement);
+        }
+        elements.insert(parentElement ? parentElement : _rootElement);
+    }
+}
+
+// An entity too big for one record is split across several, each an edit of the same entity with the properties that
+// didn't fit in the ones before it, so that replaying them in order adds the entity and then fills in the rest of it.
+void EntityTree::encodeEntityRecords(const EntityItem* entity, QList<QByteArray>& records) {
+    EntityItemProperties properties = entity->getProperties();
+    EncodeBitstreamParams params;
+    EntityPropertyFlags propertiesLeft = entity->getEntityProperties(params);
+    while (true) {
+        QByteArray record(MAX_PACKET_SIZE, 0);
+        int recordLength = 0;
+        EntityPropertyFlags propertiesDidntFit;
+        if (!EntityItemProperties::encodeEntityEditPacket(PacketTypeEntityAddOrEdit, entity->getEntityItemID(), properties,
+                propertiesLeft, (unsigned char*)record.data(), record.size(), recordLength, propertiesDidntFit)) {
+            // a single property bigger than a whole record couldn't have arrived in an edit either, so this shouldn't
+            // happen, but keep the records we have rather than lose the whole entity
+            qDebug() << "UNEXPECTED!!! entity property too big for an edit record, some properties not saved. entityID=" 
+                << entity->getEntityItemID();
+            return;
+        }
+        record.resize(recordLength);
+        records << record;
+        if (!propertiesDidntFit) {
+            return;
+        }
+        propertiesLeft = propertiesDidntFit;
+    }
+}
+
+// Saved elements hold the same records as the edit log, so loading an indexed persist file is a replay of them
+void EntityTree::appendElementEditRecords(OctreeElement* element, QList<OctreeEditRecord>& records) {
+    EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(element);
+    EntityItemVersionsPointer published;
+    const QList<EntityItem*>& entities = entityTreeElement->getEntitiesToEncode(published);
+    for (int i = 0; i < entities.size(); i++) {
+        QList<QByteArray> entityRecords;
+        encodeEntityRecords(entities[i], entityRecords);
+        foreach (const QByteArray& entityRecord, entityRecords) {
+            OctreeEditRecord record;
+            record.packetType = PacketTypeEntityAddOrEdit;
+            record.data = entityRecord;
+            records << record;
+        }
+    }
+}
+
+bool EntityTree::replayEditLogRecord(PacketType packetType, const unsigned char* record, int length) {
+    switch (packetType) {
+        case PacketTypeEntityErase: {
+            QByteArray dataByteArray((const char*)record, length);
+            return processEraseMessageDetails(dataByteArray, SharedNodePointer()) > 0;
+        }
+
+        case PacketTypeEntityAddOrEdit: {
+            EntityItemID entityItemID;
+            EntityItemProperties properties;
+            int processedBytes = 0;
+            if (!EntityItemProperties::decodeEntityEditPacket(record, length, processedBytes, entityItemID, properties)) {
+                return false;
+            }
+            // Clients can be getting scenes while chunks of the persist file load, so a replayed entity is a change
+            // like any other edit. Otherwise the delta scenes of clients that already have their view would skip it.
+            EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
+            if (existingEntity) {
+                if (!updateEntity(existingEntity, properties)) {
+                    return false;
+                }
+                existingEntity->markAsChangedOnServer();
+                markEntityToPublish(existingEntity);
+                logEntityChange(existingEntity);
+                return true;
+            }
+            EntityItem* newEntity = addEntity(entityItemID, properties);
+            if (!newEntity) {
+                return false;
+            }
+            newEntity->markAsChangedOnServer();
+            logEntityChange(newEntity);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
 
 void EntityTree::notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode) {
     _newlyCreatedHooksLock.lockForRead();
@@ -598,7 +924,8 @@ void EntityTree::entityChanged(EntityItem* entity) {
 
 void EntityTree::update() {
     if (_simulation) {
-        lockForWrite();
+        lockForEdit();
+        quint64 changeSequence = getChangeSequence();
         QSet<EntityItem*> entitiesToDelete;
         _simulation->updateEntities(entitiesToDelete);
         if (entitiesToDelete.size() > 0) {
@@ -609,31 +936,99 @@ void EntityTree::update() {
             }
             deleteEntities(idsToDelete);
         }
-        unlock();
+
+        // nothing else edits while we hold the edit lock, so anything logged since we took it is the simulation's, and
+        // the simulation's changes don't go in the edit log
+        if (getChangeSequence() != changeSequence) {
+            setUnloggedChanges();
+            setDirtyBit();
+        }
+        unlockForEdit();
     }
 }
 
-bool EntityTree::hasEntitiesDeletedSince(quint64 sinceTime) {
-    // we can probably leverage the ordered nature of QMultiMap to do this quickly...
-    bool hasSomethingNewer = false;
+void EntityTree::markElementToPublish(EntityTreeElement* element) {
+    if (getVersionedReads()) {
+        _elementsToPublish.insert(element);
+    }
+}
 
-    _recentlyDeletedEntitiesLock.lockForRead();
-    QMultiMap<quint64, QUuid>::const_iterator iterator = _recentlyDeletedEntityItemIDs.constBegin();
-    while (iterator != _recentlyDeletedEntityItemIDs.constEnd()) {
-        if (iterator.key() > sinceTime) {
-            hasSomethingNewer = true;
+void EntityTree::markEntityToPublish(EntityItem* entity) {
+    if (getVersionedReads()) {
+        EntityTreeElement* containingElement = getContainingElement(entity->getEntityItemID());
+        if (containingElement) {
+            _elementsToPublish.insert(containingElement);
         }
-        ++iterator;
     }
-    _recentlyDeletedEntitiesLock.unlock();
-    return hasSomethingNewer;
 }
 
-// sinceTime is an in/out parameter - it will be side effected with the last time sent out
-bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* outputBuffer,
-                                            size_t maxLength, size_t& outputLength) {
-    bool hasMoreToSend = true;
+void EntityTree::forgetElementToPublish(EntityTreeElement* element) {
+    _elementsToPublish.remove(element);
+}
+
+EntityItemVersionsPointer EntityTree::getPublishedEntities(const EntityTreeElement* element) {
+    if (!getVersionedReads()) {
+        return EntityItemVersionsPointer();
+    }
+    QReadLocker locker(&_publishedEntitiesLock);
+    return element->_publishedEntities;
+}
 
+void EntityTree::publishVersions() {
+    if (_elementsToPublish.isEmpty()) {
+        return;
+    }
+
+    // copy the changed entities before taking the lock, so readers only wait for the pointers to be swapped
+    QHash<EntityTreeElement*, EntityItemVersionsPointer> versions;
+    foreach (EntityTreeElement* element, _elementsToPublish) {
+        versions.insert(element, element->createPublishedEntities());
+    }
+    _elementsToPublish.clear();
+
+    // the versions we replace are freed when we and the last reader that still holds them let go of them
+    QHash<EntityTreeElement*, EntityItemVersionsPointer> replaced;
+    _publishedEntitiesLock.lockForWrite();
+    for (QHash<EntityTreeElement*, EntityItemVersionsPointer>::const_iterator version = versions.constBegin();
+            version != versions.constEnd(); ++version) {
+        replaced.insert(version.key(), version.key()->_publishedEntities);
+        version.key()->_publishedEntities = version.value();
+    }
+    _publishedEntitiesLock.unlock();
+
+    // anything encoded from the versions we replaced is stale now
+    foreach (EntityTreeElement* element, versions.keys()) {
+        element->markWithChangedTime();
+    }
+}
+
+int EntityTree::addDeletedEntitiesReader() {
+    QWriteLocker locker(&_recentlyDeletedEntitiesLock);
+    return _recentlyDeletedEntities.addReader();
+}
+
+void EntityTree::removeDeletedEntitiesReader(int reader) {
+    QWriteLocker locker(&_recentlyDeletedEntitiesLock);
+    _recentlyDeletedEntities.removeReader(reader);
+}
+
+bool EntityTree::hasDeletedEntitiesToSend(int reader) {
+    QReadLocker locker(&_recentlyDeletedEntitiesLock);
+    return _recentlyDeletedEntities.hasUnread(reader);
+}
+
+int EntityTree::getDeletedEntitiesLogSize() {
+    QReadLocker locker(&_recentlyDeletedEntitiesLock);
+    return _recentlyDeletedEntities.size();
+}
+
+quint64 EntityTree::getOldestLoggedDeleteTime() {
+    QReadLocker locker(&_recentlyDeletedEntitiesLock);
+    return _recentlyDeletedEntities.getOldestDeletedAt();
+}
+
+bool EntityTree::encodeDeletedEntities(OCTREE_PACKET_SEQUENCE sequenceNumber, int reader, unsigned char* outputBuffer,
+                                       size_t maxLength, size_t& outputLength) {
     unsigned char* copyAt = outputBuffer;
     size_t numBytesPacketHeader = populatePacketHeader(reinterpret_cast<char*>(outputBuffer), PacketTypeEntityErase);
     copyAt += numBytesPacketHeader;
@@ -665,46 +1060,20 @@ bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumbe
     copyAt += sizeof(numberOfIds);
     outputLength += sizeof(numberOfIds);
     
-    // we keep a multi map of entity IDs to timestamps, we only want to include the entity IDs that have been
-    // deleted since we last sent to this node
-    _recentlyDeletedEntitiesLock.lockForRead();
-
-    QMultiMap<quint64, QUuid>::const_iterator iterator = _recentlyDeletedEntityItemIDs.constBegin();
-    while (iterator != _recentlyDeletedEntityItemIDs.constEnd()) {
-        QList<QUuid> values = _recentlyDeletedEntityItemIDs.values(iterator.key());
-        for (int valueItem = 0; valueItem < values.size(); ++valueItem) {
-
-            // if the timestamp is more recent then out last sent time, include it
-            if (iterator.key() > sinceTime) {
-                QUuid entityID = values.at(valueItem);
-                QByteArray encodedEntityID = entityID.toRfc4122();
-                memcpy(copyAt, encodedEntityID.constData(), NUM_BYTES_RFC4122_UUID);
-                copyAt += NUM_BYTES_RFC4122_UUID;
-                outputLength += NUM_BYTES_RFC4122_UUID;
-                numberOfIds++;
-
-                // check to make sure we have room for one more id...
-                if (outputLength + NUM_BYTES_RFC4122_UUID > maxLength) {
-                    break;
-                }
-            }
-        }
-
-        // check to make sure we have room for one more id...
-        if (outputLength + NUM_BYTES_RFC4122_UUID > maxLength) {
-
-            // let our caller know how far we got
-            sinceTime = iterator.key();
-            break;
-        }
-        ++iterator;
-    }
+    // the log hands out the IDs this reader hasn't had yet, and forgets them once every reader has
+    size_t maxIDs = (maxLength - outputLength) / NUM_BYTES_RFC4122_UUID;
+    QVector<QUuid> entityIDs;
+    _recentlyDeletedEntitiesLock.lockForWrite();
+    numberOfIds = _recentlyDeletedEntities.read(reader, (int)maxIDs, entityIDs);
+    bool hasMoreToSend = _recentlyDeletedEntities.hasUnread(reader);
+    _recentlyDeletedEntitiesLock.unlock();
 
-    // if we got to the end, then we're done sending
-    if (iterator == _recentlyDeletedEntityItemIDs.constEnd()) {
-        hasMoreToSend = false;
+    foreach (const QUuid& entityID, entityIDs) {
+        QByteArray encodedEntityID = entityID.toRfc4122();
+        memcpy(copyAt, encodedEntityID.constData(), NUM_BYTES_RFC4122_UUID);
+        copyAt += NUM_BYTES_RFC4122_UUID;
+        outputLength += NUM_BYTES_RFC4122_UUID;
     }
-    _recentlyDeletedEntitiesLock.unlock();
 
     // replace the correct count for ids included
     memcpy(numberOfIDsAt, &numberOfIds, sizeof(numberOfIds));
@@ -713,30 +1082,6 @@ bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumbe
 }
 
 
-// called by the server when it knows all nodes have been sent deleted packets
-void EntityTree::forgetEntitiesDeletedBefore(quint64 sinceTime) {
-    QSet<quint64> keysToRemove;
-
-    _recentlyDeletedEntitiesLock.lockForWrite();
-    QMultiMap<quint64, QUuid>::iterator iterator = _recentlyDeletedEntityItemIDs.begin();
-
-    // First find all the keys in the map that are older and need to be deleted
-    while (iterator != _recentlyDeletedEntityItemIDs.end()) {
-        if (iterator.key() <= sinceTime) {
-            keysToRemove << iterator.key();
-        }
-        ++iterator;
-    }
-
-    // Now run through the keysToRemove and remove them
-    foreach (quint64 value, keysToRemove) {
-        _recentlyDeletedEntityItemIDs.remove(value);
-    }
-    
-    _recentlyDeletedEntitiesLock.unlock();
-}
-
-
 // TODO: consider consolidating processEraseMessageDetails() and processEraseMessage()
 int EntityTree::processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode) {
     lockForWrite();
@@ -826,15 +1171,19 @@ int EntityTree::processEraseMessageDetails(const QByteArray& dataByteArray, cons
 }
 
 EntityTreeElement* EntityTree::getContainingElement(const EntityItemID& entityItemID)  /*const*/ {
+    return getContainingElement(entityItemID, NULL);
+}
+
+EntityTreeElement* EntityTree::getContainingElement(const EntityItemID& entityItemID, EntityItem** entity) {
     // TODO: do we need to make this thread safe? Or is it acceptable as is
-    EntityTreeElement* element = _entityToElementMap.value(entityItemID);
+    EntityTreeElement* element = _entityToElementMap.find(entityItemID, entity);
     if (!element && entityItemID.creatorTokenID != UNKNOWN_ENTITY_TOKEN){
         // check the creator token version too...
         EntityItemID creatorTokenOnly;
         creatorTokenOnly.id = UNKNOWN_ENTITY_ID;
         creatorTokenOnly.creatorTokenID = entityItemID.creatorTokenID;
         creatorTokenOnly.isKnownID = false;
-        element = _entityToElementMap.value(creatorTokenOnly);
+        element = _entityToElementMap.find(creatorTokenOnly, entity);
     }
     return element;
 }
@@ -862,13 +1211,15 @@ void EntityTree::resetContainingElement(const EntityItemID& entityItemID, Entity
     creatorTokenVersion.id = UNKNOWN_ENTITY_ID;
     creatorTokenVersion.isKnownID = false;
     creatorTokenVersion.creatorTokenID = entityItemID.creatorTokenID;
+    EntityItem* entity = NULL;
+    _entityToElementMap.find(creatorTokenVersion, &entity);
     _entityToElementMap.remove(creatorTokenVersion);
 
     // set the new version with both creator token and real ID
-    _entityToElementMap[entityItemID] = element;
+    _entityToElementMap.insert(entityItemID, element, entity);
 }
 
-void EntityTree::setContainingElement(const EntityItemID& entityItemID, EntityTreeElement* element) {
+void EntityTree::setContainingElement(const EntityItemID& entityItemID, EntityTreeElement* element, EntityItem* entity) {
     // TODO: do we need to make this thread safe? Or is it acceptable as is
     
     // If we're a sever side tree, we always remove the creator tokens from our map items
@@ -879,7 +1230,7 @@ void EntityTree::setContainingElement(const EntityItemID& entityItemID, EntityTr
     }
     
     if (element) {
-        _entityToElementMap[storedEntityItemID] = element;
+        _entityToElementMap.insert(storedEntityItemID, element, entity);
     } else {
         _entityToElementMap.remove(storedEntityItemID);
     }
@@ -887,11 +1238,7 @@ void EntityTree::setContainingElement(const EntityItemID& entityItemID, EntityTr
 
 void EntityTree::debugDumpMap() {
     qDebug() << "EntityTree::debugDumpMap() --------------------------";
-    QHashIterator<EntityItemID, EntityTreeElement*> i(_entityToElementMap);
-    while (i.hasNext()) {
-        i.next();
-        qDebug() << i.key() << ": " << i.value();
-    }
+    _entityToElementMap.debugDump();
     qDebug() << "-----------------------------------------------------";
 }
 
@@ -927,7 +1274,9 @@ bool PruneOperator::postRecursion(OctreeElement* element) {
 
 void EntityTree::pruneTree() {
     PruneOperator theOperator;
+    lockForWrite();
     recurseTreeWithOperator(&theOperator);
+    unlock();
 }
 
 void EntityTree::sendEntities(EntityEditPacketSender* packetSender, EntityTree* localTree, float x, float y, float z) {
@@ -15,11 +15,15 @@
 #include <QSet>
 
 #include <Octree.h>
+#include "EntityDeletionLog.h"
+#include "EntityIDMap.h"
 #include "EntityTreeElement.h"
 
 
 class Model;
 class EntitySimulation;
+class EntityItemVersions;
+class UpdateEntityOperator;
 
 class NewlyCreatedEntityHook {
 public:
@@ -63,6 +67,9 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const;
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& senderNode);
+    virtual bool replayEditLogRecord(PacketType packetType, const unsigned char* record, int length);
+    virtual bool canWriteEditRecords() const { return true; }
+    virtual void appendElementEditRecords(OctreeElement* element, QList<OctreeEditRecord>& records);
 
     virtual bool rootElementHasData() const { return true; }
     
@@ -77,6 +84,17 @@ public:
                     
     virtual void update();
 
+    /// While a batch is open, edits to entities already in the tree change the entity right away but leave moving it to
+    /// the element it now fits, publishing, logging and telling the simulation until the batch ends, where they happen
+    /// once per entity however many edits it had.
+    virtual void beginEditBatch();
+    virtual void endEditBatch();
+
+    /// The server logs the last change to each entity that clients have to hear about, so a client whose view hasn't
+    /// changed only has the elements holding those entities encoded, rather than a walk from the root.
+    virtual quint64 getChangeSequence();
+    virtual void findElementsChangedSince(quint64 sequence, QSet<OctreeElement*>& elements);
+
     // The newer API...
     EntityItem* getOrCreateEntityItem(const EntityItemID& entityID, const EntityItemProperties& properties);
     void postAddEntity(EntityItem* entityItem);
@@ -116,11 +134,16 @@ public:
     void addNewlyCreatedHook(NewlyCreatedEntityHook* hook);
     void removeNewlyCreatedHook(NewlyCreatedEntityHook* hook);
 
-    bool hasAnyDeletedEntities() const { return _recentlyDeletedEntityItemIDs.size() > 0; }
-    bool hasEntitiesDeletedSince(quint64 sinceTime);
-    bool encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, 
-                                    unsigned char* packetData, size_t maxLength, size_t& outputLength);
-    void forgetEntitiesDeletedBefore(quint64 sinceTime);
+    /// Adds a reader of the deletes, which will hear about every entity deleted from now on. Deletes are kept until
+    /// every reader has had them, so readers must be removed once they're done.
+    int addDeletedEntitiesReader();
+    void removeDeletedEntitiesReader(int reader);
+    bool hasDeletedEntitiesToSend(int reader);
+    /// Encodes as many of the deletes the reader hasn't had as fit in an erase packet, and returns whether there are more
+    bool encodeDeletedEntities(OCTREE_PACKET_SEQUENCE sequenceNumber, int reader,
+                               unsigned char* packetData, size_t maxLength, size_t& outputLength);
+    int getDeletedEntitiesLogSize();
+    quint64 getOldestLoggedDeleteTime();
 
     int processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     int processEraseMessageDetails(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
@@ -136,7 +159,9 @@ public:
     }
     
     EntityTreeElement* getContainingElement(const EntityItemID& entityItemID)  /*const*/;
-    void setContainingElement(const EntityItemID& entityItemID, EntityTreeElement* element);
+    /// Remembers, or forgets for a NULL element, the element containing the entity. Passing the entity as well lets
+    /// findEntityByEntityItemID() return it without searching the element's entities.
+    void setContainingElement(const EntityItemID& entityItemID, EntityTreeElement* element, EntityItem* entity = NULL);
     void resetContainingElement(const EntityItemID& entityItemID, EntityTreeElement* element);
     void debugDumpMap();
     virtual void dumpTree();
@@ -152,6 +177,27 @@ public:
 
     void setSimulation(EntitySimulation* simulation);
 
+    /// Queues the element's entities to be published when the current edit finishes. Does nothing unless the tree has
+    /// versioned reads. Callers must hold the edit lock.
+    void markElementToPublish(EntityTreeElement* element);
+    void markEntityToPublish(EntityItem* entity);
+    void forgetElementToPublish(EntityTreeElement* element);
+
+    /// Notes that the entity changed, so that senders include it in what they send to clients that already have the rest
+    /// of their view. Does nothing on clients. Everything that changes an entity on the server, edits and simulation
+    /// alike, has to call this.
+    void logEntityChange(const EntityItem* entity);
+
+    /// Marks the element and every element above it as changed, so that delta sends, which skip subtrees whose root
+    /// hasn't changed, pick up a change to the element's entities.
+    void markPathWithChangedTime(EntityTreeElement* element);
+
+    /// The last published version of the element's entities, or NULL if the tree doesn't have versioned reads.
+    QSharedPointer<const EntityItemVersions> getPublishedEntities(const EntityTreeElement* element);
+
+protected:
+    virtual void publishVersions();
+
 signals:
     void deletingEntity(const EntityItemID& entityID);
     void addingEntity(const EntityItemID& entityID);
@@ -162,9 +208,15 @@ private:
 
     bool updateEntityWithElement(EntityItem* entity, const EntityItemProperties& properties, 
             EntityTreeElement* containingElement);
+    void recurseWithUpdateOperator(UpdateEntityOperator& theOperator);
+    void logEntityEdit(EntityItem* entity);
+    void forgetEntityChange(const QUuid& id);
+    void batchEntityEdit(EntityItem* entity, const EntityItemProperties& properties);
+    void applyBatchedEdits();
+    static void encodeEntityRecords(const EntityItem* entity, QList<QByteArray>& records);
+    EntityTreeElement* getContainingElement(const EntityItemID& entityItemID, EntityItem** entity);
+
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
-    static bool findInSphereOperation(OctreeElement* element, void* extraData);
-    static bool findInCubeOperation(OctreeElement* element, void* extraData);
     static bool sendEntitiesOperation(OctreeElement* element, void* extraData);
 
     void notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode);
@@ -173,12 +225,31 @@ private:
     QVector<NewlyCreatedEntityHook*> _newlyCreatedHooks;
 
     QReadWriteLock _recentlyDeletedEntitiesLock;
-    QMultiMap<quint64, QUuid> _recentlyDeletedEntityItemIDs;
+    EntityDeletionLog _recentlyDeletedEntities;
+
+    QReadWriteLock _changeLogLock; // senders read the log holding only the read lock, while edits go on
+    quint64 _changeSequence;
+    QMap<quint64, QUuid> _changeLog; // the last change to each entity, in sequence order
+    QHash<QUuid, quint64> _changeLogSequences;
+
     EntityItemFBXService* _fbxService;
 
-    QHash<EntityItemID, EntityTreeElement*> _entityToElementMap;
+    EntityIDMap _entityToElementMap;
 
     EntitySimulation* _simulation;
+
+    /// What an entity edited in the open batch was like before it
+    class BatchedEdit {
+    public:
+        uint32_t dirtyFlags;
+        AACube maximumAACube;
+    };
+
+    bool _inEditBatch;
+    QHash<EntityItem*, BatchedEdit> _batchedEdits;
+
+    QReadWriteLock _publishedEntitiesLock; // guards the published versions of all our elements
+    QSet<EntityTreeElement*> _elementsToPublish;
 };
 
 #endif // hifi_EntityTree_h
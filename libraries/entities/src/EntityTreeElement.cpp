@@ -20,28 +20,33 @@
 #include "EntityTree.h"
 #include "EntityTreeElement.h"
 
-EntityTreeElement::EntityTreeElement(unsigned char* octalCode) : OctreeElement(), _entityItems(NULL) {
+EntityTreeElement::EntityTreeElement(unsigned char* octalCode) :
+    OctreeElement(),
+    _myTree(NULL),
+    _entityItems(),
+    _publishedEntities()
+{
     init(octalCode);
 };
 
 EntityTreeElement::~EntityTreeElement() {
+    if (_myTree) {
+        _myTree->forgetElementToPublish(this);
+    }
     _octreeMemoryUsage -= sizeof(EntityTreeElement);
-    delete _entityItems;
-    _entityItems = NULL;
 }
 
 // This will be called primarily on addChildAt(), which means we're adding a child of our
 // own type to our own tree. This means we should initialize that child with any tree and type
 // specific settings that our children must have. 
 OctreeElement* EntityTreeElement::createNewElement(unsigned char* octalCode) {
-    EntityTreeElement* newChild = new EntityTreeElement(octalCode);
+    EntityTreeElement* newChild = new (_myTree ? _myTree->getElementPool() : NULL) EntityTreeElement(octalCode);
     newChild->setTree(_myTree);
     return newChild;
 }
 
 void EntityTreeElement::init(unsigned char* octalCode) {
     OctreeElement::init(octalCode);
-    _entityItems = new QList<EntityItem*>;
     _octreeMemoryUsage += sizeof(EntityTreeElement);
 }
 
@@ -72,8 +77,10 @@ void EntityTreeElement::initializeExtraEncodeData(EncodeBitstreamParams& params)
     assert(extraEncodeData); // EntityTrees always require extra encode data on their encoding passes
     // Check to see if this element yet has encode data... if it doesn't create it
     if (!extraEncodeData->contains(this)) {
+        EntityItemVersionsPointer published;
+        const QList<EntityItem*>& entities = getEntitiesToEncode(published);
         EntityTreeElementExtraEncodeData* entityTreeElementExtraEncodeData = new EntityTreeElementExtraEncodeData();
-        entityTreeElementExtraEncodeData->elementCompleted = (_entityItems->size() == 0);
+        entityTreeElementExtraEncodeData->elementCompleted = (entities.size() == 0);
         for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
             EntityTreeElement* child = getChildAtIndex(i);
             if (!child) {
@@ -86,8 +93,8 @@ void EntityTreeElement::initializeExtraEncodeData(EncodeBitstreamParams& params)
                 }
             }
         }
-        for (uint16_t i = 0; i < _entityItems->size(); i++) {
-            EntityItem* entity = (*_entityItems)[i];
+        for (uint16_t i = 0; i < entities.size(); i++) {
+            EntityItem* entity = entities[i];
             entityTreeElementExtraEncodeData->entities.insert(entity->getEntityItemID(), entity->getEntityProperties(params));
         }
         
@@ -235,10 +242,79 @@ void EntityTreeElement::elementEncodeComplete(EncodeBitstreamParams& params, Oct
     }
 }
 
+bool EntityTreeElement::canShareEncodedChildren(EncodeBitstreamParams& params) const {
+    OctreeElementExtraEncodeData* extraEncodeData = params.extraEncodeData;
+    assert(extraEncodeData); // EntityTrees always require extra encode data on their encoding passes
+
+    // Our own encode data is created when our parent encodes our entities. That's fine, but if any of our children were
+    // already encoded on this pass, or were only partially sent, our encoding would be a continuation and not the
+    // whole subtree.
+    if (extraEncodeData->contains(this)) {
+        EntityTreeElementExtraEncodeData* thisExtraEncodeData
+                    = static_cast<EntityTreeElementExtraEncodeData*>(extraEncodeData->value(this));
+        if (thisExtraEncodeData->subtreeCompleted) {
+            return false;
+        }
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            EntityTreeElement* child = getChildAtIndex(i);
+            bool childStartsCompleted = !child || !child->hasEntities();
+            if (thisExtraEncodeData->childCompleted[i] != childStartsCompleted) {
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        EntityTreeElement* child = getChildAtIndex(i);
+        if (child) {
+            // anything below the child that was encoded on this pass was reached through the child, so it's enough to
+            // look at our children here
+            if (extraEncodeData->contains(child)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool EntityTreeElement::hasStableEncoding() const {
+    // with versioned reads the encoders only see simulated entities once they're published, which marks us as changed
+    if (_myTree && _myTree->getVersionedReads()) {
+        return true;
+    }
+
+    // otherwise entities that are being simulated change without their element being marked as changed, so the bytes
+    // we'd share could already be stale
+    for (int i = 0; i < _entityItems.size(); i++) {
+        EntityItem* entity = _entityItems[i];
+        if (entity->isMoving() || entity->needsToCallUpdate()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EntityTreeElement::sharedSubtreeEncoded(EncodeBitstreamParams& params) const {
+    OctreeElementExtraEncodeData* extraEncodeData = params.extraEncodeData;
+    assert(extraEncodeData); // EntityTrees always require extra encode data on their encoding passes
+
+    initializeExtraEncodeData(params);
+    EntityTreeElementExtraEncodeData* thisExtraEncodeData
+                = static_cast<EntityTreeElementExtraEncodeData*>(extraEncodeData->value(this));
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        thisExtraEncodeData->childCompleted[i] = true;
+    }
+    thisExtraEncodeData->subtreeCompleted = true;
+}
+
 OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData* packetData, 
                                                                     EncodeBitstreamParams& params) const {
 
     OctreeElement::AppendState appendElementState = OctreeElement::COMPLETED; // assume the best...
+
+    // hold on to the version we encode from, so that a publish in the middle of our encode doesn't free it
+    EntityItemVersionsPointer published;
+    const QList<EntityItem*>& entities = getEntitiesToEncode(published);
     
     // first, check the params.extraEncodeData to see if there's any partial re-encode data for this element
     OctreeElementExtraEncodeData* extraEncodeData = params.extraEncodeData;
@@ -250,7 +326,7 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
     } else {
         // if there wasn't one already, then create one
         entityTreeElementExtraEncodeData = new EntityTreeElementExtraEncodeData();
-        entityTreeElementExtraEncodeData->elementCompleted = (_entityItems->size() == 0);
+        entityTreeElementExtraEncodeData->elementCompleted = (entities.size() == 0);
 
         for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
             EntityTreeElement* child = getChildAtIndex(i);
@@ -264,8 +340,8 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
                 }
             }
         }
-        for (uint16_t i = 0; i < _entityItems->size(); i++) {
-            EntityItem* entity = (*_entityItems)[i];
+        for (uint16_t i = 0; i < entities.size(); i++) {
+            EntityItem* entity = entities[i];
             entityTreeElementExtraEncodeData->entities.insert(entity->getEntityItemID(), entity->getEntityProperties(params));
         }
     }
@@ -285,8 +361,8 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
     // entities for encoding. This is needed because we encode the element data at the "parent" level, and so we 
     // need to handle the case where our sibling elements need encoding but we don't.
     if (!entityTreeElementExtraEncodeData->elementCompleted) {
-        for (uint16_t i = 0; i < _entityItems->size(); i++) {
-            EntityItem* entity = (*_entityItems)[i];
+        for (uint16_t i = 0; i < entities.size(); i++) {
+            EntityItem* entity = entities[i];
             bool includeThisEntity = true;
             
             if (!params.forceSendScene && entity->getLastChangedOnServer() < params.lastViewFrustumSent) {
@@ -323,7 +399,7 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
 
     if (successAppendEntityCount) {
         foreach (uint16_t i, indexesOfEntitiesToInclude) {
-            EntityItem* entity = (*_entityItems)[i];
+            EntityItem* entity = entities[i];
             LevelDetails entityLevel = packetData->startLevel();
             OctreeElement::AppendState appendEntityState = entity->appendEntityData(packetData, 
                                                                         params, entityTreeElementExtraEncodeData);
@@ -479,8 +555,8 @@ bool EntityTreeElement::findDetailedRayIntersection(const glm::vec3& origin, con
     // only called if we do intersect our bounding cube, but find if we actually intersect with entities...
     int entityNumber = 0;
     
-    QList<EntityItem*>::iterator entityItr = _entityItems->begin();
-    QList<EntityItem*>::const_iterator entityEnd = _entityItems->end();
+    QList<EntityItem*>::iterator entityItr = _entityItems.begin();
+    QList<EntityItem*>::const_iterator entityEnd = _entityItems.end();
     bool somethingIntersected = false;
     
     //float bestEntityDistance = distance;
@@ -548,8 +624,8 @@ bool EntityTreeElement::findDetailedRayIntersection(const glm::vec3& origin, con
 // TODO: change this to use better bounding shape for entity than sphere
 bool EntityTreeElement::findSpherePenetration(const glm::vec3& center, float radius,
                                     glm::vec3& penetration, void** penetratedObject) const {
-    QList<EntityItem*>::iterator entityItr = _entityItems->begin();
-    QList<EntityItem*>::const_iterator entityEnd = _entityItems->end();
+    QList<EntityItem*>::const_iterator entityItr = _entityItems.constBegin();
+    QList<EntityItem*>::const_iterator entityEnd = _entityItems.constEnd();
     while(entityItr != entityEnd) {
         EntityItem* entity = (*entityItr);
         glm::vec3 entityCenter = entity->getPosition();
@@ -572,8 +648,8 @@ bool EntityTreeElement::findSpherePenetration(const glm::vec3& center, float rad
 
 bool EntityTreeElement::findShapeCollisions(const Shape* shape, CollisionList& collisions) const {
     bool atLeastOneCollision = false;
-    QList<EntityItem*>::iterator entityItr = _entityItems->begin();
-    QList<EntityItem*>::const_iterator entityEnd = _entityItems->end();
+    QList<EntityItem*>::const_iterator entityItr = _entityItems.constBegin();
+    QList<EntityItem*>::const_iterator entityEnd = _entityItems.constEnd();
     while(entityItr != entityEnd) {
         EntityItem* entity = (*entityItr);
         
@@ -598,9 +674,9 @@ bool EntityTreeElement::findShapeCollisions(const Shape* shape, CollisionList& c
 }
 
 void EntityTreeElement::updateEntityItemID(const EntityItemID& creatorTokenEntityID, const EntityItemID& knownIDEntityID) {
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        EntityItem* thisEntity = (*_entityItems)[i];
+        EntityItem* thisEntity = _entityItems[i];
 
         EntityItemID thisEntityID = thisEntity->getEntityItemID();
         
@@ -613,11 +689,11 @@ void EntityTreeElement::updateEntityItemID(const EntityItemID& creatorTokenEntit
 const EntityItem* EntityTreeElement::getClosestEntity(glm::vec3 position) const {
     const EntityItem* closestEntity = NULL;
     float closestEntityDistance = FLT_MAX;
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        float distanceToEntity = glm::distance(position, (*_entityItems)[i]->getPosition());
+        float distanceToEntity = glm::distance(position, _entityItems[i]->getPosition());
         if (distanceToEntity < closestEntityDistance) {
-            closestEntity = (*_entityItems)[i];
+            closestEntity = _entityItems[i];
         }
     }
     return closestEntity;
@@ -625,9 +701,9 @@ const EntityItem* EntityTreeElement::getClosestEntity(glm::vec3 position) const
 
 // TODO: change this to use better bounding shape for entity than sphere
 void EntityTreeElement::getEntities(const glm::vec3& searchPosition, float searchRadius, QVector<const EntityItem*>& foundEntities) const {
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        const EntityItem* entity = (*_entityItems)[i];
+        const EntityItem* entity = _entityItems[i];
         float distance = glm::length(entity->getPosition() - searchPosition);
         if (distance < searchRadius + entity->getRadius()) {
             foundEntities.push_back(entity);
@@ -637,8 +713,8 @@ void EntityTreeElement::getEntities(const glm::vec3& searchPosition, float searc
 
 // TODO: change this to use better bounding shape for entity than sphere
 void EntityTreeElement::getEntities(const AACube& box, QVector<EntityItem*>& foundEntities) {
-    QList<EntityItem*>::iterator entityItr = _entityItems->begin();
-    QList<EntityItem*>::iterator entityEnd = _entityItems->end();
+    QList<EntityItem*>::iterator entityItr = _entityItems.begin();
+    QList<EntityItem*>::iterator entityEnd = _entityItems.end();
     AACube entityCube;
     while(entityItr != entityEnd) {
         EntityItem* entity = (*entityItr);
@@ -656,10 +732,10 @@ void EntityTreeElement::getEntities(const AACube& box, QVector<EntityItem*>& fou
 
 const EntityItem* EntityTreeElement::getEntityWithEntityItemID(const EntityItemID& id) const {
     const EntityItem* foundEntity = NULL;
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        if ((*_entityItems)[i]->getEntityItemID() == id) {
-            foundEntity = (*_entityItems)[i];
+        if (_entityItems[i]->getEntityItemID() == id) {
+            foundEntity = _entityItems[i];
             break;
         }
     }
@@ -668,10 +744,10 @@ const EntityItem* EntityTreeElement::getEntityWithEntityItemID(const EntityItemI
 
 EntityItem* EntityTreeElement::getEntityWithEntityItemID(const EntityItemID& id) {
     EntityItem* foundEntity = NULL;
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        if ((*_entityItems)[i]->getEntityItemID() == id) {
-            foundEntity = (*_entityItems)[i];
+        if (_entityItems[i]->getEntityItemID() == id) {
+            foundEntity = _entityItems[i];
             break;
         }
     }
@@ -679,21 +755,25 @@ EntityItem* EntityTreeElement::getEntityWithEntityItemID(const EntityItemID& id)
 }
 
 void EntityTreeElement::cleanupEntities() {
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        EntityItem* entity = (*_entityItems)[i];
+        EntityItem* entity = _entityItems[i];
         delete entity;
     }
-    _entityItems->clear();
+    _entityItems.clear();
+    if (_myTree) {
+        _myTree->markElementToPublish(this);
+    }
 }
 
 bool EntityTreeElement::removeEntityWithEntityItemID(const EntityItemID& id) {
     bool foundEntity = false;
-    uint16_t numberOfEntities = _entityItems->size();
+    uint16_t numberOfEntities = _entityItems.size();
     for (uint16_t i = 0; i < numberOfEntities; i++) {
-        if ((*_entityItems)[i]->getEntityItemID() == id) {
+        if (_entityItems[i]->getEntityItemID() == id) {
             foundEntity = true;
-            _entityItems->removeAt(i);
+            _entityItems.removeAt(i);
+            _myTree->markElementToPublish(this);
             break;
         }
     }
@@ -701,7 +781,40 @@ bool EntityTreeElement::removeEntityWithEntityItemID(const EntityItemID& id) {
 }
 
 bool EntityTreeElement::removeEntityItem(EntityItem* entity) {
-    return _entityItems->removeAll(entity) > 0;
+    if (_entityItems.removeAll(entity) > 0) {
+        _myTree->markElementToPublish(this);
+        return true;
+    }
+    return false;
+}
+
+const QList<EntityItem*>& EntityTreeElement::getEntitiesToEncode(EntityItemVersionsPointer& published) const {
+    published = _myTree ? _myTree->getPublishedEntities(this) : EntityItemVersionsPointer();
+    return published ? published->entities : _entityItems;
+}
+
+EntityItemVersionsPointer EntityTreeElement::createPublishedEntities() const {
+    EntityItemVersions* versions = new EntityItemVersions();
+    for (int i = 0; i < _entityItems.size(); i++) {
+        EntityItem* entity = _entityItems[i];
+        EntityItemID entityItemID = entity->getEntityItemID();
+
+        // entities that didn't change since the last version share its copy
+        QSharedPointer<EntityItem> copy;
+        if (_publishedEntities) {
+            copy = _publishedEntities->copies.value(entityItemID);
+        }
+        if (!copy || copy->getLastEdited() != entity->getLastEdited() ||
+                copy->getLastSimulated() != entity->getLastSimulated() ||
+                copy->getLastUpdated() != entity->getLastUpdated() ||
+                copy->getLastChangedOnServer() != entity->getLastChangedOnServer()) {
+            copy = QSharedPointer<EntityItem>(entity->clone());
+            copy->setPhysicsInfo(NULL); // the physics info belongs to the live entity
+        }
+        versions->entities.append(copy.data());
+        versions->copies.insert(entityItemID, copy);
+    }
+    return EntityItemVersionsPointer(versions);
 }
 
 
@@ -776,11 +889,13 @@ int EntityTreeElement::readElementDataFromBuffer(const unsigned char* data, int
                             if (currentContainingElement != this) {
                                 currentContainingElement->removeEntityItem(entityItem);
                                 addEntityItem(entityItem);
-                                _myTree->setContainingElement(entityItemID, this);
+                                _myTree->setContainingElement(entityItemID, this, entityItem);
                             }
                         }
                     }
 
+                    _myTree->markEntityToPublish(entityItem);
+
                     QString entityScriptAfter = entityItem->getScript();
                     if (entityScriptBefore != entityScriptAfter) {
                         _myTree->emitEntityScriptChanging(entityItemID); // the entity script has changed
@@ -792,7 +907,7 @@ int EntityTreeElement::readElementDataFromBuffer(const unsigned char* data, int
                         bytesForThisEntity = entityItem->readEntityDataFromBuffer(dataAt, bytesLeftToRead, args);
                         addEntityItem(entityItem); // add this new entity to this elements entities
                         entityItemID = entityItem->getEntityItemID();
-                        _myTree->setContainingElement(entityItemID, this);
+                        _myTree->setContainingElement(entityItemID, this, entityItem);
                         _myTree->postAddEntity(entityItem);
                     }
                 }
@@ -808,7 +923,8 @@ int EntityTreeElement::readElementDataFromBuffer(const unsigned char* data, int
 }
 
 void EntityTreeElement::addEntityItem(EntityItem* entity) {
-    _entityItems->push_back(entity);
+    _entityItems.push_back(entity);
+    _myTree->markElementToPublish(this);
 }
 
 // will average a "common reduced LOD view" from the the child elements...
@@ -846,11 +962,11 @@ void EntityTreeElement::debugDump() {
     temp.scale((float)TREE_SCALE);
     qDebug() << "    cube:" << temp;
     qDebug() << "    has child elements:" << getChildCount();
-    if (_entityItems->size()) {
-        qDebug() << "    has entities:" << _entityItems->size();
+    if (_entityItems.size()) {
+        qDebug() << "    has entities:" << _entityItems.size();
         qDebug() << "--------------------------------------------------";
-        for (uint16_t i = 0; i < _entityItems->size(); i++) {
-            EntityItem* entity = (*_entityItems)[i];
+        for (uint16_t i = 0; i < _entityItems.size(); i++) {
+            EntityItem* entity = _entityItems[i];
             entity->debugDump();
         }
         qDebug() << "--------------------------------------------------";
@@ -14,6 +14,7 @@
 
 #include <OctreeElement.h>
 #include <QList>
+#include <QSharedPointer>
 
 #include "EntityEditPacketSender.h"
 #include "EntityItem.h"
@@ -63,6 +64,17 @@ inline QDebug operator<<(QDebug debug, const EntityTreeElementExtraEncodeData* d
 }
 
 
+/// A published version of the entities of an element, for the readers of a tree with versioned reads. A version never
+/// changes once it's published. The next change to the element publishes a new one, which shares the copies of entities
+/// that didn't change with this one, and a version goes away once no reader holds it any more.
+class EntityItemVersions {
+public:
+    QList<EntityItem*> entities; // in the same order as the element's own entities
+    QHash<EntityItemID, QSharedPointer<EntityItem> > copies;
+};
+
+typedef QSharedPointer<const EntityItemVersions> EntityItemVersionsPointer;
+
 class SendModelsOperationArgs {
 public:
     glm::vec3 root;
@@ -116,6 +128,9 @@ public:
     virtual bool shouldRecurseChildTree(int childIndex, EncodeBitstreamParams& params) const;
     virtual void updateEncodedData(int childIndex, AppendState childAppendState, EncodeBitstreamParams& params) const;
     virtual void elementEncodeComplete(EncodeBitstreamParams& params, OctreeElementBag* bag) const;
+    virtual bool canShareEncodedChildren(EncodeBitstreamParams& params) const;
+    virtual bool hasStableEncoding() const;
+    virtual void sharedSubtreeEncoded(EncodeBitstreamParams& params) const;
 
     bool alreadyFullyEncoded(EncodeBitstreamParams& params) const;
 
@@ -144,9 +159,13 @@ public:
 
     virtual bool findShapeCollisions(const Shape* shape, CollisionList& collisions) const;
 
-    const QList<EntityItem*>& getEntities() const { return *_entityItems; }
-    QList<EntityItem*>& getEntities() { return *_entityItems; }
-    bool hasEntities() const { return _entityItems ? _entityItems->size() > 0 : false; }
+    const QList<EntityItem*>& getEntities() const { return _entityItems; }
+    QList<EntityItem*>& getEntities() { return _entityItems; }
+    bool hasEntities() const { return !_entityItems.isEmpty(); }
+
+    /// The entities encoders should read. On trees with versioned reads that's the last published version, which the
+    /// published pointer keeps alive for the caller, otherwise it's our own entities.
+    const QList<EntityItem*>& getEntitiesToEncode(EntityItemVersionsPointer& published) const;
 
     void setTree(EntityTree* tree) { _myTree = tree; }
 
@@ -201,7 +220,12 @@ public:
 protected:
     virtual void init(unsigned char * octalCode);
     EntityTree* _myTree;
-    QList<EntityItem*>* _entityItems;
+    QList<EntityItem*> _entityItems;
+
+private:
+    EntityItemVersionsPointer createPublishedEntities() const;
+
+    EntityItemVersionsPointer _publishedEntities; // swapped by EntityTree::publishVersions()
 };
 
 #endif // hifi_EntityTreeElement_h
@@ -378,6 +378,9 @@ void ModelEntityItem::update(const quint64& now) {
         float deltaTime = (float)(now - _lastAnimated) / (float)USECS_PER_SECOND;
         _lastAnimated = now;
         _animationLoop.simulate(deltaTime);
+
+        // the frame index moved without an edit or a simulation, so our last encoding is out of date
+        _encodeCache.clear();
     } else {
         _lastAnimated = now;
     }
@@ -23,6 +23,7 @@ public:
     ModelEntityItem(const EntityItemID& entityItemID, const EntityItemProperties& properties);
 
     ALLOW_INSTANTIATION // This class can be instantiated
+    virtual EntityItem* clone() const { return new ModelEntityItem(*this); }
 
     // methods for getting/setting all properties of an entity
     virtual EntityItemProperties getProperties() const;
@@ -194,7 +194,7 @@ bool MovingEntitiesOperator::preRecursion(OctreeElement* element) {
             if (!details.newFound && entityTreeElement->bestFitBounds(details.newCube)) {
                 EntityItemID entityItemID = details.entity->getEntityItemID();
                 entityTreeElement->addEntityItem(details.entity);
-                _tree->setContainingElement(entityItemID, entityTreeElement);
+                _tree->setContainingElement(entityItemID, entityTreeElement, details.entity);
                 _foundNewCount++;
                 //details.newFound = true; // TODO: would be nice to add this optimization
                 if (_wantDebug) {
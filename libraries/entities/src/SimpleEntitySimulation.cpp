@@ -15,16 +15,34 @@
 #include "SimpleEntitySimulation.h"
 
 void SimpleEntitySimulation::updateEntitiesInternal(const quint64& now) {
-    QSet<EntityItem*>::iterator itemItr = _movingEntities.begin();
-    while (itemItr != _movingEntities.end()) {
+    QVector<EntityItem*> entitiesToBeSorted;
+    QVector<EntityItem*> stoppedEntities;
+    _kinematics.integrate(now, _entityTree, entitiesToBeSorted, stoppedEntities);
+    foreach (EntityItem* entity, entitiesToBeSorted) {
+        _entitiesToBeSorted.insert(entity);
+    }
+    foreach (EntityItem* entity, stoppedEntities) {
+        _movingEntities.remove(entity);
+        _movableButStoppedEntities.insert(entity);
+    }
+
+    QSet<EntityItem*>::iterator itemItr = _spinningEntities.begin();
+    while (itemItr != _spinningEntities.end()) {
         EntityItem* entity = *itemItr;
         if (!entity->isMoving()) {
-            itemItr = _movingEntities.erase(itemItr);
+            itemItr = _spinningEntities.erase(itemItr);
+            _movingEntities.remove(entity);
             _movableButStoppedEntities.insert(entity);
         } else {
             entity->simulate(now);
             _entitiesToBeSorted.insert(entity);
-            ++itemItr;
+            if (EntityKinematics::canIntegrate(entity)) {
+                // its spin has been damped away
+                itemItr = _spinningEntities.erase(itemItr);
+                _kinematics.add(entity);
+            } else {
+                ++itemItr;
+            }
         }
     }
 }
@@ -32,6 +50,7 @@ void SimpleEntitySimulation::updateEntitiesInternal(const quint64& now) {
 void SimpleEntitySimulation::addEntityInternal(EntityItem* entity) {
     if (entity->isMoving()) {
         _movingEntities.insert(entity);
+        placeMovingEntity(entity);
     } else if (entity->getCollisionsWillMove()) {
         _movableButStoppedEntities.insert(entity);
     }
@@ -40,6 +59,8 @@ void SimpleEntitySimulation::addEntityInternal(EntityItem* entity) {
 void SimpleEntitySimulation::removeEntityInternal(EntityItem* entity) {
     _movingEntities.remove(entity);
     _movableButStoppedEntities.remove(entity);
+    _kinematics.remove(entity);
+    _spinningEntities.remove(entity);
 }
 
 const int SIMPLE_SIMULATION_DIRTY_FLAGS = EntityItem::DIRTY_VELOCITY | EntityItem::DIRTY_MOTION_TYPE;
@@ -56,11 +77,29 @@ void SimpleEntitySimulation::entityChangedInternal(EntityItem* entity) {
             _movableButStoppedEntities.remove(entity);
         }
     }
+    // any change can matter to the arrays, a new position or size as much as a new velocity
+    placeMovingEntity(entity);
     entity->clearDirtyFlags();
 }
 
 void SimpleEntitySimulation::clearEntitiesInternal() {
     _movingEntities.clear();
     _movableButStoppedEntities.clear();
+    _kinematics.clear();
+    _spinningEntities.clear();
+}
+
+// moving entities are integrated in the arrays unless they need simulate(), which is the only thing that handles spin
+void SimpleEntitySimulation::placeMovingEntity(EntityItem* entity) {
+    if (!_movingEntities.contains(entity)) {
+        _kinematics.remove(entity);
+        _spinningEntities.remove(entity);
+    } else if (EntityKinematics::canIntegrate(entity)) {
+        _spinningEntities.remove(entity);
+        _kinematics.add(entity);
+    } else {
+        _kinematics.remove(entity);
+        _spinningEntities.insert(entity);
+    }
 }
 
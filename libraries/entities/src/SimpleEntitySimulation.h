@@ -12,6 +12,7 @@
 #ifndef hifi_SimpleEntitySimulation_h
 #define hifi_SimpleEntitySimulation_h
 
+#include "EntityKinematics.h"
 #include "EntitySimulation.h"
 
 /// provides simple velocity + gravity extrapolation of EntityItem's
@@ -28,8 +29,12 @@ protected:
     virtual void entityChangedInternal(EntityItem* entity);
     virtual void clearEntitiesInternal();
 
+    void placeMovingEntity(EntityItem* entity);
+
     QSet<EntityItem*> _movingEntities;
     QSet<EntityItem*> _movableButStoppedEntities;
+    EntityKinematics _kinematics; // the moving entities we integrate in arrays
+    QSet<EntityItem*> _spinningEntities; // the moving entities that simulate() themselves, see EntityKinematics
 };
 
 #endif // hifi_SimpleEntitySimulation_h
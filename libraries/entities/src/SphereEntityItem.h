@@ -22,6 +22,7 @@ public:
     SphereEntityItem(const EntityItemID& entityItemID, const EntityItemProperties& properties);
     
     ALLOW_INSTANTIATION // This class can be instantiated
+    virtual EntityItem* clone() const { return new SphereEntityItem(*this); }
     
     // methods for getting/setting all properties of an entity
     virtual EntityItemProperties getProperties() const;
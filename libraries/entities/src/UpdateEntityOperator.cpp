@@ -294,7 +294,7 @@ bool UpdateEntityOperator::preRecursion(OctreeElement* element) {
                             qDebug() << "    *** REPAIRING PREVIOUS REMOVAL from ELEMENT and MAP ***";
                         }
                         entityTreeElement->addEntityItem(_existingEntity);
-                        _tree->setContainingElement(_entityItemID, entityTreeElement);
+                        _tree->setContainingElement(_entityItemID, entityTreeElement, _existingEntity);
                     }
                 }
 
@@ -307,7 +307,7 @@ bool UpdateEntityOperator::preRecursion(OctreeElement* element) {
                 // otherwise, this is an add case.
                 entityTreeElement->addEntityItem(_existingEntity);
                 _existingEntity->setProperties(_properties); // still need to update the properties!
-                _tree->setContainingElement(_entityItemID, entityTreeElement);
+                _tree->setContainingElement(_entityItemID, entityTreeElement, _existingEntity);
                 if (_wantDebug) {
                     qDebug() << "    *** ADDING ENTITY to ELEMENT and MAP and SETTING PROPERTIES ***";
                 }
@@ -351,7 +351,9 @@ bool UpdateEntityOperator::postRecursion(OctreeElement* element) {
     // 1) we're not removing the old
     // 2) we are removing the old, but this subtree doesn't contain the old
     // 3) we are removing the old, this subtree contains the old, but this element isn't a direct parent of _containingElement
-    if (!_removeOld || !subtreeContainsOld || !element->isParentOf(_containingElement)) {
+    //
+    // If we didn't move the entity we leave pruning to others, since we may not hold the tree's write lock.
+    if (!_dontMove && (!_removeOld || !subtreeContainsOld || !element->isParentOf(_containingElement))) {
         EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(element);
         entityTreeElement->pruneChildren(); // take this opportunity to prune any empty leaves
     }
@@ -21,6 +21,9 @@ public:
     virtual bool preRecursion(OctreeElement* element);
     virtual bool postRecursion(OctreeElement* element);
     virtual OctreeElement* possiblyCreateChildAt(OctreeElement* element, int childIndex);
+
+    /// False when the entity stays in its containing element, so the update won't add or remove any elements
+    bool mightMoveEntity() const { return !_dontMove; }
 private:
     EntityTree* _tree;
     EntityItem* _existingEntity;
@@ -0,0 +1,204 @@
+//
+//  DatagramCapture.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QtCore/QDebug>
+
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "DatagramCapture.h"
+
+const int DATAGRAM_CAPTURE_MAGIC_BYTES = sizeof(DATAGRAM_CAPTURE_MAGIC) - 1;
+
+DatagramCapture::DatagramCapture() :
+    _mutex(),
+    _file(),
+    _stream(),
+    _isCapturing(false),
+    _startedUsecs(0),
+    _lastDatagramUsecs(0),
+    _numCapturedDatagrams(0),
+    _senderIndexes()
+{
+}
+
+DatagramCapture::~DatagramCapture() {
+    stop();
+}
+
+bool DatagramCapture::start(const QString& filename) {
+    QMutexLocker locker(&_mutex);
+
+    if (_isCapturing) {
+        qDebug() << "DatagramCapture already capturing to" << _file.fileName() << "- not starting a capture to" << filename;
+        return false;
+    }
+
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "DatagramCapture could not open" << filename << "for writing -" << _file.errorString();
+        return false;
+    }
+
+    _stream.setDevice(&_file);
+    _stream.setByteOrder(QDataStream::LittleEndian);
+
+    _startedUsecs = usecTimestampNow();
+    _lastDatagramUsecs = _startedUsecs;
+    _numCapturedDatagrams = 0;
+    _senderIndexes.clear();
+
+    _stream.writeRawData(DATAGRAM_CAPTURE_MAGIC, DATAGRAM_CAPTURE_MAGIC_BYTES);
+    _stream << DATAGRAM_CAPTURE_VERSION << _startedUsecs;
+
+    qDebug() << "DatagramCapture started capturing inbound datagrams to" << filename;
+    _isCapturing = true;
+    return true;
+}
+
+void DatagramCapture::stop() {
+    QMutexLocker locker(&_mutex);
+
+    if (_isCapturing) {
+        _isCapturing = false;
+        _stream.setDevice(NULL);
+        _file.close();
+
+        qDebug() << "DatagramCapture stopped capturing," << _numCapturedDatagrams << "datagrams written to"
+            << _file.fileName();
+    }
+}
+
+void DatagramCapture::datagramReceived(const QByteArray& datagram, const QUuid& senderUUID) {
+    if (!_isCapturing) {
+        return;
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    // we may have been stopped while waiting on the lock
+    if (!_isCapturing) {
+        return;
+    }
+
+    quint64 now = usecTimestampNow();
+    const quint64 MAX_USECS_SINCE_LAST = std::numeric_limits<quint32>::max();
+    quint32 usecsSinceLast = (now > _lastDatagramUsecs) ? std::min(now - _lastDatagramUsecs, MAX_USECS_SINCE_LAST) : 0;
+    _lastDatagramUsecs = now;
+
+    _stream << usecsSinceLast;
+
+    QHash<QUuid, quint16>::const_iterator senderIndex = _senderIndexes.constFind(senderUUID);
+    if (senderIndex == _senderIndexes.constEnd()) {
+        // first time we've heard from this sender, write the UUID after its new index
+        quint16 newIndex = _senderIndexes.size();
+        _senderIndexes.insert(senderUUID, newIndex);
+
+        _stream << newIndex;
+        _stream.writeRawData(senderUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    } else {
+        _stream << senderIndex.value();
+    }
+
+    _stream << (quint16)datagram.size();
+    _stream.writeRawData(datagram.constData(), datagram.size());
+
+    _numCapturedDatagrams++;
+}
+
+DatagramCaptureReader::DatagramCaptureReader() :
+    _file(),
+    _stream(),
+    _startedUsecs(0),
+    _usecsSinceStart(0),
+    _senders()
+{
+}
+
+bool DatagramCaptureReader::open(const QString& filename) {
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "DatagramCaptureReader could not open" << filename << "-" << _file.errorString();
+        return false;
+    }
+
+    _stream.setDevice(&_file);
+    _stream.setByteOrder(QDataStream::LittleEndian);
+
+    return readHeader();
+}
+
+void DatagramCaptureReader::rewind() {
+    _file.seek(0);
+    _stream.resetStatus();
+    readHeader();
+}
+
+bool DatagramCaptureReader::readHeader() {
+    _usecsSinceStart = 0;
+    _senders.clear();
+
+    char magic[DATAGRAM_CAPTURE_MAGIC_BYTES];
+    quint8 version = 0;
+
+    if (_stream.readRawData(magic, DATAGRAM_CAPTURE_MAGIC_BYTES) != DATAGRAM_CAPTURE_MAGIC_BYTES
+        || memcmp(magic, DATAGRAM_CAPTURE_MAGIC, DATAGRAM_CAPTURE_MAGIC_BYTES) != 0) {
+        qDebug() << "DatagramCaptureReader" << _file.fileName() << "is not a datagram capture";
+        return false;
+    }
+
+    _stream >> version >> _startedUsecs;
+    if (version != DATAGRAM_CAPTURE_VERSION) {
+        qDebug() << "DatagramCaptureReader" << _file.fileName() << "has unsupported version" << version;
+        return false;
+    }
+
+    return _stream.status() == QDataStream::Ok;
+}
+
+bool DatagramCaptureReader::readNext(CapturedDatagram& captured) {
+    if (_stream.atEnd()) {
+        return false;
+    }
+
+    quint32 usecsSinceLast;
+    quint16 senderIndex;
+    _stream >> usecsSinceLast >> senderIndex;
+
+    if (senderIndex == _senders.size()) {
+        char rfcUUID[NUM_BYTES_RFC4122_UUID];
+        _stream.readRawData(rfcUUID, NUM_BYTES_RFC4122_UUID);
+        _senders.append(QUuid::fromRfc4122(QByteArray::fromRawData(rfcUUID, NUM_BYTES_RFC4122_UUID)));
+    } else if (senderIndex > _senders.size()) {
+        qDebug() << "DatagramCaptureReader found an unknown sender index in" << _file.fileName() << "- stopping";
+        return false;
+    }
+
+    quint16 datagramLength;
+    _stream >> datagramLength;
+
+    captured.datagram.resize(datagramLength);
+    _stream.readRawData(captured.datagram.data(), datagramLength);
+
+    if (_stream.status() != QDataStream::Ok) {
+        // a capture that was cut off mid-record, everything before this is still good
+        return false;
+    }
+
+    _usecsSinceStart += usecsSinceLast;
+    captured.usecsSinceStart = _usecsSinceStart;
+    captured.senderUUID = _senders[senderIndex];
+
+    return true;
+}
@@ -0,0 +1,86 @@
+//
+//  DatagramCapture.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramCapture_h
+#define hifi_DatagramCapture_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QUuid>
+
+// Capture file layout (little endian):
+//
+//   header:  "HFDC" | quint8 version | quint64 usecTimestamp of capture start
+//   record:  quint32 usecs since previous record | quint16 sender index | [16 byte RFC4122 sender UUID] |
+//            quint16 datagram length | datagram bytes
+//
+// Senders are numbered in order of first appearance, the UUID only follows the index the first time a sender is seen.
+const char DATAGRAM_CAPTURE_MAGIC[] = "HFDC";
+const quint8 DATAGRAM_CAPTURE_VERSION = 1;
+
+class CapturedDatagram {
+public:
+    quint64 usecsSinceStart;
+    QUuid senderUUID;
+    QByteArray datagram;
+};
+
+/// Writes timestamped inbound datagrams to a compact binary log, safe to call from the datagram processing threads
+class DatagramCapture {
+public:
+    DatagramCapture();
+    ~DatagramCapture();
+
+    bool start(const QString& filename);
+    void stop();
+
+    bool isCapturing() const { return _isCapturing; }
+    quint64 getNumCapturedDatagrams() const { return _numCapturedDatagrams; }
+
+    void datagramReceived(const QByteArray& datagram, const QUuid& senderUUID);
+
+private:
+    QMutex _mutex;
+    QFile _file;
+    QDataStream _stream;
+    volatile bool _isCapturing;
+    quint64 _startedUsecs;
+    quint64 _lastDatagramUsecs;
+    quint64 _numCapturedDatagrams;
+    QHash<QUuid, quint16> _senderIndexes;
+};
+
+/// Reads back the datagrams written by DatagramCapture, one at a time so large captures don't need to fit in memory
+class DatagramCaptureReader {
+public:
+    DatagramCaptureReader();
+
+    bool open(const QString& filename);
+    void rewind();
+
+    bool readNext(CapturedDatagram& captured);
+
+    quint64 getCaptureStartedUsecs() const { return _startedUsecs; }
+
+private:
+    bool readHeader();
+
+    QFile _file;
+    QDataStream _stream;
+    quint64 _startedUsecs;
+    quint64 _usecsSinceStart;
+    QList<QUuid> _senders;
+};
+
+#endif // hifi_DatagramCapture_h
@@ -77,7 +77,8 @@ LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short
     _stunSockAddr(STUN_SERVER_HOSTNAME, STUN_SERVER_PORT),
     _numCollectedPackets(0),
     _numCollectedBytes(0),
-    _packetStatTimer()
+    _packetStatTimer(),
+    _datagramCapture()
 {
     _nodeSocket.bind(QHostAddress::AnyIPv4, socketListenPort);
     qDebug() << "NodeList socket is listening on" << _nodeSocket.localPort();
@@ -201,6 +202,7 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         if (sendingNode) {
             // check if the md5 hash in the header matches the hash we would expect
             if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+                captureReceivedDatagram(packet);
                 return true;
             } else {
                 static QMultiMap<QUuid, PacketType> hashDebugSuppressMap;
@@ -221,12 +223,20 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
                 << qPrintable(uuidStringWithoutCurlyBraces(uuidFromPacketHeader(packet)));
         }
     } else {
+        captureReceivedDatagram(packet);
         return true;
     }
     
     return false;
 }
 
+void LimitedNodeList::captureReceivedDatagram(const QByteArray& packet) {
+    // only datagrams that passed the version and hash checks are captured, so a replay sees what the handlers saw
+    if (_datagramCapture.isCapturing()) {
+        _datagramCapture.datagramReceived(packet, uuidFromPacketHeader(packet));
+    }
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
                                       const QUuid& connectionSecret) {
     QByteArray datagramCopy = datagram;
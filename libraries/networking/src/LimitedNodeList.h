@@ -29,6 +29,7 @@
 
 #include <tbb/concurrent_unordered_map.h>
 
+#include "DatagramCapture.h"
 #include "DomainHandler.h"
 #include "Node.h"
 #include "UUIDHasher.h"
@@ -129,6 +130,11 @@ public:
     
     void sendHeartbeatToIceServer(const HifiSockAddr& iceServerSockAddr,
                                   QUuid headerID = QUuid(), const QUuid& connectRequestID = QUuid());
+
+    // capture every inbound datagram that passes the version check to a binary log for replay with packet-replay
+    bool startDatagramCapture(const QString& filename) { return _datagramCapture.start(filename); }
+    void stopDatagramCapture() { _datagramCapture.stop(); }
+    const DatagramCapture& getDatagramCapture() const { return _datagramCapture; }
     
     template<typename NodeLambda>
     void eachNode(NodeLambda functor) {
@@ -190,6 +196,7 @@ protected:
                          const QUuid& connectionSecret);
     
     void changeSocketBufferSizes(int numBytes);
+    void captureReceivedDatagram(const QByteArray& packet);
     
     void handleNodeKill(const SharedNodePointer& node);
 
@@ -204,6 +211,7 @@ protected:
     int _numCollectedPackets;
     int _numCollectedBytes;
     QElapsedTimer _packetStatTimer;
+    DatagramCapture _datagramCapture;
     
     template<typename IteratorLambda>
     void eachNodeHashIterator(IteratorLambda functor) {
@@ -11,6 +11,8 @@
 
 #include <QThreadStorage>
 
+#include "ResourceDiskCache.h"
+
 #include "NetworkAccessManager.h"
 
 QThreadStorage<QNetworkAccessManager*> networkAccessManagers;
@@ -20,5 +22,15 @@ QNetworkAccessManager& NetworkAccessManager::getInstance() {
         networkAccessManagers.setLocalData(new QNetworkAccessManager());
     }
     
-    return *networkAccessManagers.localData();
+    QNetworkAccessManager* networkAccessManager = networkAccessManagers.localData();
+    
+    // every thread's manager shares the one persistent resource cache, once it has been set up
+    if (!networkAccessManager->cache()) {
+        QSharedPointer<ResourceDiskCache> diskCache = ResourceDiskCache::getInstance();
+        if (diskCache) {
+            networkAccessManager->setCache(new ResourceNetworkCache(diskCache));
+        }
+    }
+    
+    return *networkAccessManager;
 }
@@ -69,7 +69,7 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeRequestAssignment:
             return 2;
         case PacketTypeOctreeStats:
-            return 1;
+            return 2;
         case PacketTypeEntityAddOrEdit:
         case PacketTypeEntityData:
             return VERSION_ENTITIES_HAVE_USER_DATA;
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 
@@ -22,7 +23,9 @@
 
 ResourceCache::ResourceCache(QObject* parent) :
     QObject(parent),
-    _lastLRUKey(0)
+    _lastLRUKey(0),
+    _timeToFirstByte(),
+    _cancelledRequestCount(0)
 {
     
 }
@@ -84,57 +87,214 @@ void ResourceCache::addUnusedResource(const QSharedPointer<Resource>& resource)
     _unusedResources.insert(resource->getLRUKey(), resource);
 }
 
+int ResourceCache::getQueueDepth() const {
+    int queueDepth = 0;
+    foreach (const PendingRequest& request, _pendingRequests) {
+        if (request.resource && request.resource->_cache == this) {
+            queueDepth++;
+        }
+    }
+    return queueDepth;
+}
+
+static bool hasLowerPriority(const PendingRequest& first, const PendingRequest& second) {
+    return first.priority < second.priority;
+}
+
 void ResourceCache::attemptRequest(Resource* resource) {
-    if (_requestLimit <= 0) {
+    if (_loadingRequests.size() >= _activeRequestLimit) {
         // wait until a slot becomes available
-        _pendingRequests.append(resource);
+        PendingRequest request;
+        request.resource = resource;
+        request.priority = resource->getLoadPriority();
+        request.queuedUsecs = usecTimestampNow();
+        request.wasCancelled = false;
+        _pendingRequests.append(request);
+        std::push_heap(_pendingRequests.begin(), _pendingRequests.end(), hasLowerPriority);
         return;
     }
-    _requestLimit--;
-    _loadingRequests.append(resource);
-    resource->makeRequest();
+    startRequest(resource);
 }
 
 void ResourceCache::requestCompleted(Resource* resource) {
     _loadingRequests.removeOne(resource);
-    _requestLimit++;
     
-    // look for the highest priority pending request
-    int highestIndex = -1;
-    float highestPriority = -FLT_MAX;
-    for (int i = 0; i < _pendingRequests.size(); ) {
-        Resource* resource = _pendingRequests.at(i).data();
-        if (!resource) {
-            _pendingRequests.removeAt(i);
+    adaptRequestLimit();
+    startPendingRequests();
+}
+
+void ResourceCache::loadPriorityChanged() {
+    const quint64 REPRIORITIZE_INTERVAL_USECS = 100 * USECS_PER_MSEC;
+    if (_pendingRequests.isEmpty() || usecTimestampNow() - _lastReprioritizeUsecs < REPRIORITIZE_INTERVAL_USECS) {
+        return;
+    }
+    reprioritizePendingRequests();
+    cancelStaleRequest();
+    adaptRequestLimit();
+    startPendingRequests();
+}
+
+void ResourceCache::startRequest(Resource* resource) {
+    _loadingRequests.append(resource);
+    resource->_requestPriority = resource->getLoadPriority();
+    resource->makeRequest();
+}
+
+void ResourceCache::startPendingRequests() {
+    if (!_pendingRequests.isEmpty() && _loadingRequests.size() < _activeRequestLimit) {
+        reprioritizePendingRequests();
+    }
+    while (!_pendingRequests.isEmpty() && _loadingRequests.size() < _activeRequestLimit) {
+        std::pop_heap(_pendingRequests.begin(), _pendingRequests.end(), hasLowerPriority);
+        Resource* resource = _pendingRequests.last().resource.data();
+        _pendingRequests.removeLast();
+        if (resource) {
+            startRequest(resource);
+        }
+    }
+}
+
+void ResourceCache::reprioritizePendingRequests() {
+    const quint64 MIN_REPRIORITIZE_INTERVAL_USECS = 20 * USECS_PER_MSEC;
+    const quint64 STARVATION_USECS = 5 * USECS_PER_SECOND;
+    
+    // priorities move with the camera, but there's no point in re-sorting more often than that changes anything
+    quint64 now = usecTimestampNow();
+    if (now - _lastReprioritizeUsecs < MIN_REPRIORITIZE_INTERVAL_USECS) {
+        return;
+    }
+    _lastReprioritizeUsecs = now;
+    
+    int liveRequests = 0;
+    for (int i = 0; i < _pendingRequests.size(); i++) {
+        PendingRequest& request = _pendingRequests[i];
+        if (!request.resource) {
+            continue;
+        }
+        // anything that has waited too long jumps the queue, so background assets are never starved
+        request.priority = (now - request.queuedUsecs > STARVATION_USECS) ? FLT_MAX : request.resource->getLoadPriority();
+        _pendingRequests[liveRequests++] = request;
+    }
+    _pendingRequests.resize(liveRequests);
+    std::make_heap(_pendingRequests.begin(), _pendingRequests.end(), hasLowerPriority);
+}
+
+void ResourceCache::cancelStaleRequest() {
+    if (_pendingRequests.isEmpty() || _loadingRequests.size() < _activeRequestLimit) {
+        return;
+    }
+    
+    // only downloads that were started for someone in particular are considered - resources that never get a
+    // priority (sounds, scripts) would otherwise be cancelled every time
+    Resource* lowestResource = NULL;
+    float lowestPriority = FLT_MAX;
+    foreach (Resource* resource, _loadingRequests) {
+        if (resource->_requestPriority == -FLT_MAX) {
             continue;
         }
         float priority = resource->getLoadPriority();
-        if (priority >= highestPriority) {
-            highestPriority = priority;
-            highestIndex = i;
+        if (priority < lowestPriority) {
+            lowestPriority = priority;
+            lowestResource = resource;
         }
-        i++;
     }
-    if (highestIndex >= 0) {
-        attemptRequest(_pendingRequests.takeAt(highestIndex));
+    if (!lowestResource) {
+        return;
+    }
+    
+    // cancel if everyone that wanted it has let go of it, or if something much more important is waiting and we
+    // haven't got far with this one yet. The waiting request is judged by its own priority rather than the one it may
+    // have been boosted to for waiting too long, and one that was itself cancelled never cancels anything, otherwise
+    // big downloads could keep cancelling each other
+    const float CANCELLATION_PRIORITY_MARGIN = 10.0f;
+    const float MAX_CANCELLATION_PROGRESS = 0.5f;
+    bool isOrphaned = (lowestPriority == -FLT_MAX);
+    if (!isOrphaned) {
+        const PendingRequest& waitingRequest = _pendingRequests.first();
+        if (!waitingRequest.resource || waitingRequest.wasCancelled ||
+                waitingRequest.resource->getLoadPriority() - lowestPriority < CANCELLATION_PRIORITY_MARGIN ||
+                lowestResource->getProgress() > MAX_CANCELLATION_PROGRESS) {
+            return;
+        }
+    }
+    
+    lowestResource->cancelRequest();
+    _loadingRequests.removeOne(lowestResource);
+    if (lowestResource->_cache) {
+        lowestResource->_cache->_cancelledRequestCount++;
+    }
+    
+    PendingRequest request;
+    request.resource = lowestResource;
+    request.priority = lowestPriority;
+    request.queuedUsecs = usecTimestampNow();
+    request.wasCancelled = true;
+    _pendingRequests.append(request);
+    std::push_heap(_pendingRequests.begin(), _pendingRequests.end(), hasLowerPriority);
+}
+
+void ResourceCache::adaptRequestLimit() {
+    const quint64 ADAPT_INTERVAL_USECS = 2 * USECS_PER_SECOND;
+    const float MIN_THROUGHPUT_GAIN = 0.05f;
+    const int MIN_REQUEST_LIMIT = 2;
+    
+    quint64 now = usecTimestampNow();
+    if (now - _lastAdaptUsecs < ADAPT_INTERVAL_USECS) {
+        return;
+    }
+    float throughput = (float)(_bytesDownloaded - _lastAdaptBytesDownloaded) * USECS_PER_SECOND / (now - _lastAdaptUsecs);
+    _lastAdaptUsecs = now;
+    _lastAdaptBytesDownloaded = _bytesDownloaded;
+    
+    if (_pendingRequests.isEmpty()) {
+        // without a backlog the throughput says nothing about the concurrency
+        _throughput = throughput;
+        return;
+    }
+    
+    // hill climb: keep moving the limit in the same direction while that helps, turn around when it stops helping
+    if (throughput < _throughput * (1.0f + MIN_THROUGHPUT_GAIN)) {
+        _requestLimitStep = -_requestLimitStep;
     }
+    _throughput = throughput;
+    _activeRequestLimit = qMax(qMin(MIN_REQUEST_LIMIT, _requestLimit),
+        qMin(_activeRequestLimit + _requestLimitStep, _requestLimit));
+}
+
+void ResourceCache::setRequestLimit(int limit) {
+    _requestLimit = limit;
+    _activeRequestLimit = qMin(_activeRequestLimit, limit);
+    startPendingRequests();
 }
 
 const int DEFAULT_REQUEST_LIMIT = 10;
 int ResourceCache::_requestLimit = DEFAULT_REQUEST_LIMIT;
+int ResourceCache::_activeRequestLimit = DEFAULT_REQUEST_LIMIT / 2;
 
-QList<QPointer<Resource> > ResourceCache::_pendingRequests;
+QVector<PendingRequest> ResourceCache::_pendingRequests;
 QList<Resource*> ResourceCache::_loadingRequests;
+quint64 ResourceCache::_lastReprioritizeUsecs = 0;
+
+qint64 ResourceCache::_bytesDownloaded = 0;
+qint64 ResourceCache::_lastAdaptBytesDownloaded = 0;
+quint64 ResourceCache::_lastAdaptUsecs = 0;
+float ResourceCache::_throughput = 0.0f;
+int ResourceCache::_requestLimitStep = 1;
 
 Resource::Resource(const QUrl& url, bool delayLoad) :
     _url(url),
     _request(url),
     _lruKey(0),
-    _reply(NULL) {
+    _reply(NULL),
+    _requestPriority(-FLT_MAX),
+    _requestStartUsecs(0),
+    _receivedFirstByte(false) {
     
     init();
     
-    _request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+    // use the disk cache while the entry is fresh, then revalidate it with its ETag/Last-Modified rather than
+    // downloading the whole thing again
+    _request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
     
     // start loading immediately unless instructed otherwise
     if (!(_startedLoading || delayLoad)) {    
@@ -158,6 +318,7 @@ void Resource::ensureLoading() {
 void Resource::setLoadPriority(const QPointer<QObject>& owner, float priority) {
     if (!(_failedToLoad || _loaded)) {
         _loadPriorities.insert(owner, priority);
+        ResourceCache::loadPriorityChanged();
     }
 }
 
@@ -169,11 +330,13 @@ void Resource::setLoadPriorities(const QHash<QPointer<QObject>, float>& prioriti
             it != priorities.constEnd(); it++) {
         _loadPriorities.insert(it.key(), it.value());
     }
+    ResourceCache::loadPriorityChanged();
 }
 
 void Resource::clearLoadPriority(const QPointer<QObject>& owner) {
     if (!(_failedToLoad || _loaded)) {
         _loadPriorities.remove(owner);
+        ResourceCache::loadPriorityChanged();
     }
 }
 
@@ -265,6 +428,16 @@ void Resource::reinsert() {
 const int REPLY_TIMEOUT_MS = 5000;
 
 void Resource::handleDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
+    if (bytesReceived > _bytesReceived) {
+        ResourceCache::_bytesDownloaded += bytesReceived - _bytesReceived;
+        
+        if (!_receivedFirstByte) {
+            _receivedFirstByte = true;
+            if (_cache) {
+                _cache->_timeToFirstByte.updateAverage(usecTimestampNow() - _requestStartUsecs);
+            }
+        }
+    }
     if (!_reply->isFinished()) {
         _bytesReceived = bytesReceived;
         _bytesTotal = bytesTotal;
@@ -303,6 +476,19 @@ void Resource::makeRequest() {
     _replyTimer->setSingleShot(true);
     _replyTimer->start(REPLY_TIMEOUT_MS);
     _bytesReceived = _bytesTotal = 0;
+    _requestStartUsecs = usecTimestampNow();
+    _receivedFirstByte = false;
+}
+
+void Resource::cancelRequest() {
+    _reply->disconnect(this);
+    _reply->abort();
+    _reply->deleteLater();
+    _reply = NULL;
+    _replyTimer->disconnect(this);
+    _replyTimer->deleteLater();
+    _replyTimer = NULL;
+    _bytesReceived = _bytesTotal = 0;
 }
 
 void Resource::handleReplyError(QNetworkReply::NetworkError error, QDebug debug) {
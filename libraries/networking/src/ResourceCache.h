@@ -20,21 +20,41 @@
 #include <QPointer>
 #include <QSharedPointer>
 #include <QUrl>
+#include <QVector>
 #include <QWeakPointer>
 
+#include <SharedUtil.h>
+#include <SimpleMovingAverage.h>
+
 class QNetworkReply;
 class QTimer;
 
 class Resource;
 
+/// A request waiting for a download slot, along with the priority it was last sorted by.
+class PendingRequest {
+public:
+    QPointer<Resource> resource;
+    float priority;
+    quint64 queuedUsecs;
+    bool wasCancelled; ///< requeued after being cancelled for something else, so it never cancels anything in turn
+};
+
 /// Base class for resource caches.
 class ResourceCache : public QObject {
     Q_OBJECT
     
 public:
-    static void setRequestLimit(int limit) { _requestLimit = limit; }
+    /// Sets the maximum number of concurrent downloads; the number actually used adapts to the measured throughput.
+    static void setRequestLimit(int limit);
     static int getRequestLimit() { return _requestLimit; }
 
+    /// Returns the number of concurrent downloads currently allowed.
+    static int getActiveRequestLimit() { return _activeRequestLimit; }
+
+    /// Returns the download throughput measured over the last adaptation interval, in bytes per second.
+    static float getThroughput() { return _throughput; }
+
     static const QList<Resource*>& getLoadingRequests() { return _loadingRequests; }
 
     static int getPendingRequestCount() { return _pendingRequests.size(); }
@@ -44,6 +64,15 @@ public:
 
     void refresh(const QUrl& url);
 
+    /// Returns the number of this cache's resources waiting for a download slot.
+    int getQueueDepth() const;
+
+    /// Returns the average time from starting a download to receiving its first bytes, in milliseconds.
+    float getAverageTimeToFirstByte() const { return _timeToFirstByte.getAverage() / USECS_PER_MSEC; }
+
+    /// Returns the number of this cache's downloads cancelled in favor of higher priority ones.
+    int getCancelledRequestCount() const { return _cancelledRequestCount; }
+
 protected:
 
     QMap<int, QSharedPointer<Resource> > _unusedResources;
@@ -64,16 +93,36 @@ protected:
     static void attemptRequest(Resource* resource);
     static void requestCompleted(Resource* resource);
 
+    /// Called whenever a load priority changes, so that the pending requests are resorted as the camera moves.
+    static void loadPriorityChanged();
+
 private:
     
     friend class Resource;
 
+    static void startRequest(Resource* resource);
+    static void startPendingRequests();
+    static void reprioritizePendingRequests();
+    static void cancelStaleRequest();
+    static void adaptRequestLimit();
+
     QHash<QUrl, QWeakPointer<Resource> > _resources;
     int _lastLRUKey;
     
+    SimpleMovingAverage _timeToFirstByte;
+    int _cancelledRequestCount;
+    
     static int _requestLimit;
-    static QList<QPointer<Resource> > _pendingRequests;
+    static int _activeRequestLimit;
+    static QVector<PendingRequest> _pendingRequests;
     static QList<Resource*> _loadingRequests;
+    static quint64 _lastReprioritizeUsecs;
+    
+    static qint64 _bytesDownloaded;
+    static qint64 _lastAdaptBytesDownloaded;
+    static quint64 _lastAdaptUsecs;
+    static float _throughput;
+    static int _requestLimitStep;
 };
 
 /// Base class for resources.
@@ -170,6 +219,9 @@ private:
     
     void makeRequest();
     
+    /// Aborts the download in progress so that it can be requeued.
+    void cancelRequest();
+    
     void handleReplyError(QNetworkReply::NetworkError error, QDebug debug);
     
     friend class ResourceCache;
@@ -181,6 +233,9 @@ private:
     qint64 _bytesReceived;
     qint64 _bytesTotal;
     int _attempts;
+    float _requestPriority;
+    quint64 _requestStartUsecs;
+    bool _receivedFirstByte;
 };
 
 uint qHash(const QPointer<QObject>& value, uint seed = 0);
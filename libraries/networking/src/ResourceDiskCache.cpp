@@ -0,0 +1,439 @@
+//
+//  ResourceDiskCache.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRegExp>
+#include <QtCore/QSaveFile>
+#include <QtCore/QtDebug>
+
+#include "ResourceDiskCache.h"
+
+const QString INDEX_FILENAME = "index";
+const QString CONTENT_DIRECTORY = "content";
+const quint32 INDEX_MAGIC = 0x48465243; // HFRC
+const quint32 INDEX_VERSION = 1;
+const int INDEX_WRITE_INTERVAL_MSECS = 5000;
+
+// QNetworkDiskCache, which this replaces, kept its files in data<version> and prepared directories in the same place
+const QString NETWORK_DISK_CACHE_PREPARED_DIRECTORY = "prepared";
+const QRegExp NETWORK_DISK_CACHE_DATA_DIRECTORY("data\\d+");
+
+QMutex ResourceDiskCache::_instanceMutex;
+QSharedPointer<ResourceDiskCache> ResourceDiskCache::_instance;
+
+void ResourceDiskCache::setCacheDirectory(const QString& directory, qint64 maximumSize) {
+    QMutexLocker locker(&_instanceMutex);
+    if (_instance && _instance->getDirectory() == directory) {
+        QMutexLocker instanceLocker(&_instance->_mutex);
+        _instance->_maximumSize = maximumSize;
+        _instance->evictToSize(maximumSize);
+        return;
+    }
+    _instance = QSharedPointer<ResourceDiskCache>(new ResourceDiskCache(directory, maximumSize));
+}
+
+QSharedPointer<ResourceDiskCache> ResourceDiskCache::getInstance() {
+    QMutexLocker locker(&_instanceMutex);
+    return _instance;
+}
+
+ResourceDiskCache::ResourceDiskCache(const QString& directory, qint64 maximumSize) :
+    _directory(directory),
+    _maximumSize(maximumSize),
+    _mutex(),
+    _entries(),
+    _leastRecentlyUsed(),
+    _lastLRUKey(0),
+    _indexChanged(false),
+    _contentReferenceCounts(),
+    _contentSize(0),
+    _indexFileMutex(),
+    _indexWriteTimer()
+{
+    QDir().mkpath(QDir(_directory).filePath(CONTENT_DIRECTORY));
+    removeNetworkDiskCache();
+    loadIndex();
+    removeUnreferencedContent();
+
+    connect(&_indexWriteTimer, &QTimer::timeout, this, &ResourceDiskCache::saveChangedIndex);
+    _indexWriteTimer.start(INDEX_WRITE_INTERVAL_MSECS);
+}
+
+ResourceDiskCache::~ResourceDiskCache() {
+    // recency only changes in memory while reading, so persist it on the way out along with anything not yet written
+    saveIndex();
+}
+
+QNetworkCacheMetaData ResourceDiskCache::metaData(const QUrl& url) {
+    QMutexLocker locker(&_mutex);
+    QHash<QUrl, Entry>::const_iterator entry = _entries.constFind(url);
+    return (entry == _entries.constEnd()) ? QNetworkCacheMetaData() : entry->metaData;
+}
+
+void ResourceDiskCache::updateMetaData(const QNetworkCacheMetaData& metaData) {
+    // called after a successful revalidation (304), the content stays as it is
+    QMutexLocker locker(&_mutex);
+    QHash<QUrl, Entry>::iterator entry = _entries.find(metaData.url());
+    if (entry != _entries.end()) {
+        entry->metaData = metaData;
+        _indexChanged = true;
+    }
+}
+
+QIODevice* ResourceDiskCache::data(const QUrl& url) {
+    QString contentPath;
+    {
+        QMutexLocker locker(&_mutex);
+        QHash<QUrl, Entry>::iterator entry = _entries.find(url);
+        if (entry == _entries.end()) {
+            return NULL;
+        }
+
+        // most recently used now
+        _leastRecentlyUsed.remove(entry->lruKey);
+        entry->lruKey = ++_lastLRUKey;
+        _leastRecentlyUsed.insert(entry->lruKey, url);
+
+        contentPath = pathForContent(entry->contentHash);
+    }
+
+    MappedCacheFile* device = new MappedCacheFile(contentPath);
+    if (!device->isOpen()) {
+        // the content went missing from underneath us, forget about it
+        delete device;
+        remove(url);
+        return NULL;
+    }
+    return device;
+}
+
+void ResourceDiskCache::insert(const QNetworkCacheMetaData& metaData, const QByteArray& content) {
+    if (content.size() > _maximumSize) {
+        return;
+    }
+
+    QByteArray contentHash = QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+    QString contentPath = pathForContent(contentHash);
+
+    // write new content without holding up everyone else, it isn't referred to until it's in the index
+    bool contentStored;
+    {
+        QMutexLocker locker(&_mutex);
+        contentStored = _contentReferenceCounts.contains(contentHash);
+    }
+    if (!contentStored && !writeContent(contentPath, content)) {
+        return;
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    QHash<QUrl, Entry>::iterator existingEntry = _entries.find(metaData.url());
+    if (existingEntry != _entries.end()) {
+        if (existingEntry->contentHash == contentHash) {
+            existingEntry->metaData = metaData;
+            _indexChanged = true;
+            return;
+        }
+        removeEntry(existingEntry);
+    }
+
+    if (!_contentReferenceCounts.contains(contentHash)) {
+        // the content we found stored may have been released since, along with its file
+        if (QFileInfo(contentPath).size() != content.size() && !writeContent(contentPath, content)) {
+            return;
+        }
+        _contentSize += content.size();
+    }
+    _contentReferenceCounts[contentHash]++;
+
+    Entry entry;
+    entry.contentHash = contentHash;
+    entry.size = content.size();
+    entry.lruKey = ++_lastLRUKey;
+    entry.metaData = metaData;
+    _entries.insert(metaData.url(), entry);
+    _leastRecentlyUsed.insert(entry.lruKey, metaData.url());
+
+    evictToSize(_maximumSize);
+    _indexChanged = true;
+}
+
+bool ResourceDiskCache::remove(const QUrl& url) {
+    QMutexLocker locker(&_mutex);
+    QHash<QUrl, Entry>::iterator entry = _entries.find(url);
+    if (entry == _entries.end()) {
+        return false;
+    }
+    removeEntry(entry);
+    _indexChanged = true;
+    return true;
+}
+
+void ResourceDiskCache::clear() {
+    QMutexLocker locker(&_mutex);
+    while (!_entries.isEmpty()) {
+        removeEntry(_entries.begin());
+    }
+    _indexChanged = true;
+}
+
+qint64 ResourceDiskCache::cacheSize() {
+    QMutexLocker locker(&_mutex);
+    return _contentSize;
+}
+
+int ResourceDiskCache::getEntryCount() {
+    QMutexLocker locker(&_mutex);
+    return _entries.size();
+}
+
+void ResourceDiskCache::saveIndex() {
+    writeIndex(false);
+}
+
+void ResourceDiskCache::saveChangedIndex() {
+    writeIndex(true);
+}
+
+void ResourceDiskCache::writeIndex(bool onlyIfChanged) {
+    // writers go one at a time so an older index can't replace a newer one, but lookups only wait for the copy
+    QMutexLocker indexFileLocker(&_indexFileMutex);
+    QByteArray index;
+    {
+        QMutexLocker locker(&_mutex);
+        if (onlyIfChanged && !_indexChanged) {
+            return;
+        }
+        _indexChanged = false;
+
+        QDataStream indexStream(&index, QIODevice::WriteOnly);
+        indexStream << INDEX_MAGIC << INDEX_VERSION << (quint32)_entries.size();
+
+        // oldest first, so reading it back in order restores the recency
+        foreach (const QUrl& url, _leastRecentlyUsed) {
+            const Entry& entry = _entries[url];
+            indexStream << url << entry.contentHash << entry.size << entry.metaData;
+        }
+    }
+
+    QSaveFile indexFile(QDir(_directory).filePath(INDEX_FILENAME));
+    if (!indexFile.open(QIODevice::WriteOnly) || indexFile.write(index) != index.size() || !indexFile.commit()) {
+        qDebug() << "Failed to write resource cache index -" << indexFile.errorString();
+
+        QMutexLocker locker(&_mutex);
+        _indexChanged = true; // try again next time around
+    }
+}
+
+void ResourceDiskCache::loadIndex() {
+    QFile indexFile(QDir(_directory).filePath(INDEX_FILENAME));
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream indexStream(&indexFile);
+    quint32 magic, version, numEntries;
+    indexStream >> magic >> version >> numEntries;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        qDebug() << "Ignoring resource cache index with unknown format in" << _directory;
+        return;
+    }
+
+    for (quint32 i = 0; i < numEntries && indexStream.status() == QDataStream::Ok; i++) {
+        QUrl url;
+        Entry entry;
+        indexStream >> url >> entry.contentHash >> entry.size >> entry.metaData;
+
+        if (indexStream.status() != QDataStream::Ok || QFileInfo(pathForContent(entry.contentHash)).size() != entry.size) {
+            // the index and the content disagree, we'll just fetch it again
+            continue;
+        }
+
+        if (_contentReferenceCounts[entry.contentHash]++ == 0) {
+            _contentSize += entry.size;
+        }
+        entry.lruKey = ++_lastLRUKey;
+        _entries.insert(url, entry);
+        _leastRecentlyUsed.insert(entry.lruKey, url);
+    }
+
+    evictToSize(_maximumSize);
+
+    qDebug() << "Loaded resource cache index with" << _entries.size() << "entries," << _contentSize << "bytes from"
+        << _directory;
+}
+
+bool ResourceDiskCache::writeContent(const QString& contentPath, const QByteArray& content) {
+    // write through a temporary so a crash can never leave a truncated body under a valid hash, and two threads storing
+    // the same content at once each replace the file whole
+    QSaveFile contentFile(contentPath);
+    if (!contentFile.open(QIODevice::WriteOnly) || contentFile.write(content) != content.size() || !contentFile.commit()) {
+        qDebug() << "Failed to write resource cache content to" << contentPath << "-" << contentFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+void ResourceDiskCache::removeNetworkDiskCache() {
+    // the directory is shared with other files, so only the network disk cache's own directories go
+    QDir directory(_directory);
+    foreach (const QString& name, directory.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (name == NETWORK_DISK_CACHE_PREPARED_DIRECTORY || NETWORK_DISK_CACHE_DATA_DIRECTORY.exactMatch(name)) {
+            qDebug() << "Removing old network disk cache directory" << directory.filePath(name);
+            QDir(directory.filePath(name)).removeRecursively();
+        }
+    }
+}
+
+void ResourceDiskCache::removeUnreferencedContent() {
+    // the index is written a little after the content, so content stored just before we went away may not be in it
+    QDirIterator content(QDir(_directory).filePath(CONTENT_DIRECTORY), QDir::Files);
+    while (content.hasNext()) {
+        content.next();
+        if (!_contentReferenceCounts.contains(content.fileName().toLatin1())) {
+            QFile::remove(content.filePath());
+        }
+    }
+}
+
+void ResourceDiskCache::removeEntry(QHash<QUrl, Entry>::iterator entry) {
+    _leastRecentlyUsed.remove(entry->lruKey);
+    releaseContent(entry->contentHash, entry->size);
+    _entries.erase(entry);
+}
+
+void ResourceDiskCache::releaseContent(const QByteArray& contentHash, qint64 size) {
+    QHash<QByteArray, int>::iterator referenceCount = _contentReferenceCounts.find(contentHash);
+    if (referenceCount == _contentReferenceCounts.end() || --referenceCount.value() > 0) {
+        return;
+    }
+
+    // no URL refers to this content any more
+    _contentReferenceCounts.erase(referenceCount);
+    _contentSize -= size;
+    QFile::remove(pathForContent(contentHash));
+}
+
+void ResourceDiskCache::evictToSize(qint64 maximumSize) {
+    while (_contentSize > maximumSize && !_leastRecentlyUsed.isEmpty()) {
+        removeEntry(_entries.find(_leastRecentlyUsed.begin().value()));
+        _indexChanged = true;
+    }
+}
+
+QString ResourceDiskCache::pathForContent(const QByteArray& contentHash) const {
+    return QDir(_directory).filePath(CONTENT_DIRECTORY + "/" + QString::fromLatin1(contentHash));
+}
+
+ResourceNetworkCache::ResourceNetworkCache(const QSharedPointer<ResourceDiskCache>& diskCache, QObject* parent) :
+    QAbstractNetworkCache(parent),
+    _diskCache(diskCache),
+    _preparedDevices()
+{
+}
+
+ResourceNetworkCache::~ResourceNetworkCache() {
+    qDeleteAll(_preparedDevices.keys());
+}
+
+QNetworkCacheMetaData ResourceNetworkCache::metaData(const QUrl& url) {
+    return _diskCache->metaData(url);
+}
+
+void ResourceNetworkCache::updateMetaData(const QNetworkCacheMetaData& metaData) {
+    _diskCache->updateMetaData(metaData);
+}
+
+QIODevice* ResourceNetworkCache::data(const QUrl& url) {
+    return _diskCache->data(url);
+}
+
+bool ResourceNetworkCache::remove(const QUrl& url) {
+    // drop any download that was still being written for this URL
+    for (QHash<QIODevice*, QNetworkCacheMetaData>::iterator it = _preparedDevices.begin(); it != _preparedDevices.end(); ) {
+        if (it.value().url() == url) {
+            delete it.key();
+            it = _preparedDevices.erase(it);
+        } else {
+            it++;
+        }
+    }
+    return _diskCache->remove(url);
+}
+
+qint64 ResourceNetworkCache::cacheSize() const {
+    return _diskCache->cacheSize();
+}
+
+QIODevice* ResourceNetworkCache::prepare(const QNetworkCacheMetaData& metaData) {
+    if (!metaData.isValid() || !metaData.url().isValid() || !metaData.saveToDisk()) {
+        return NULL;
+    }
+
+    // don't bother buffering anything we know won't fit
+    foreach (const QNetworkCacheMetaData::RawHeader& header, metaData.rawHeaders()) {
+        if (header.first.toLower() == "content-length" && header.second.toLongLong() > _diskCache->getMaximumSize()) {
+            return NULL;
+        }
+    }
+
+    QBuffer* buffer = new QBuffer();
+    buffer->open(QIODevice::ReadWrite);
+    _preparedDevices.insert(buffer, metaData);
+    return buffer;
+}
+
+void ResourceNetworkCache::insert(QIODevice* device) {
+    QHash<QIODevice*, QNetworkCacheMetaData>::iterator prepared = _preparedDevices.find(device);
+    if (prepared == _preparedDevices.end()) {
+        return;
+    }
+
+    _diskCache->insert(prepared.value(), static_cast<QBuffer*>(device)->data());
+    _preparedDevices.erase(prepared);
+    delete device;
+}
+
+void ResourceNetworkCache::clear() {
+    qDeleteAll(_preparedDevices.keys());
+    _preparedDevices.clear();
+    _diskCache->clear();
+}
+
+MappedCacheFile::MappedCacheFile(const QString& path) :
+    QBuffer(),
+    _file(path),
+    _isMapped(false)
+{
+    if (!_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    qint64 size = _file.size();
+    uchar* mapped = (size > 0) ? _file.map(0, size) : NULL;
+    if (mapped) {
+        // no copy - the buffer reads straight out of the page cache
+        setData(QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), size));
+        _isMapped = true;
+    } else {
+        setData(_file.readAll());
+    }
+    open(QIODevice::ReadOnly);
+}
+
+MappedCacheFile::~MappedCacheFile() {
+    // let go of the raw data before the file (and with it the mapping) is closed
+    close();
+    setData(QByteArray());
+}
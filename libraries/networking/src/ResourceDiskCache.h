@@ -0,0 +1,141 @@
+//
+//  ResourceDiskCache.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ResourceDiskCache_h
+#define hifi_ResourceDiskCache_h
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QUrl>
+#include <QtNetwork/QAbstractNetworkCache>
+#include <QtNetwork/QNetworkCacheMetaData>
+
+/// Persistent, content-addressed store for downloaded resources. Bodies are kept once per distinct content (keyed by
+/// their SHA-1) no matter how many URLs serve them, the URL index holds the HTTP metadata used for ETag/Last-Modified
+/// revalidation, and entries are evicted least recently used first once the store goes over its size budget.
+/// Shared by the per-thread network access managers, so everything here is guarded by a mutex, but bodies are written
+/// outside it. Changes to the index are written out every few seconds and on the way out rather than as they happen.
+/// Opening it removes what QNetworkDiskCache, which it replaces, left in the same directory.
+class ResourceDiskCache : public QObject {
+    Q_OBJECT
+public:
+    /// Opens (or creates) the shared cache in the given directory. Until this is called no disk caching takes place.
+    static void setCacheDirectory(const QString& directory, qint64 maximumSize);
+    static QSharedPointer<ResourceDiskCache> getInstance();
+
+    ResourceDiskCache(const QString& directory, qint64 maximumSize);
+    ~ResourceDiskCache();
+
+    const QString& getDirectory() const { return _directory; }
+    qint64 getMaximumSize() const { return _maximumSize; }
+
+    QNetworkCacheMetaData metaData(const QUrl& url);
+    void updateMetaData(const QNetworkCacheMetaData& metaData);
+
+    /// Returns a read-only device over the memory mapped body for the URL, or NULL if it isn't cached.
+    /// The caller takes ownership of the device.
+    QIODevice* data(const QUrl& url);
+
+    void insert(const QNetworkCacheMetaData& metaData, const QByteArray& content);
+    bool remove(const QUrl& url);
+    void clear();
+
+    /// Returns the number of bytes of content on disk.
+    qint64 cacheSize();
+
+    int getEntryCount();
+
+    /// Writes the URL index out now, whether or not it changed since it was last written.
+    void saveIndex();
+
+private slots:
+    void saveChangedIndex();
+
+private:
+    class Entry {
+    public:
+        QByteArray contentHash;
+        qint64 size;
+        int lruKey;
+        QNetworkCacheMetaData metaData;
+    };
+
+    void loadIndex();
+    void writeIndex(bool onlyIfChanged);
+    void removeNetworkDiskCache();
+    void removeUnreferencedContent();
+    void removeEntry(QHash<QUrl, Entry>::iterator entry);
+    void releaseContent(const QByteArray& contentHash, qint64 size);
+    void evictToSize(qint64 maximumSize);
+    QString pathForContent(const QByteArray& contentHash) const;
+    static bool writeContent(const QString& contentPath, const QByteArray& content);
+
+    QString _directory;
+    qint64 _maximumSize;
+
+    QMutex _mutex;
+    QHash<QUrl, Entry> _entries;
+    QMap<int, QUrl> _leastRecentlyUsed;
+    int _lastLRUKey;
+    bool _indexChanged;
+
+    QHash<QByteArray, int> _contentReferenceCounts;
+    qint64 _contentSize;
+
+    QMutex _indexFileMutex;
+    QTimer _indexWriteTimer;
+
+    static QMutex _instanceMutex;
+    static QSharedPointer<ResourceDiskCache> _instance;
+};
+
+/// Adapts the shared disk cache to QNetworkAccessManager, which wants a cache object of its own per manager.
+class ResourceNetworkCache : public QAbstractNetworkCache {
+    Q_OBJECT
+public:
+    ResourceNetworkCache(const QSharedPointer<ResourceDiskCache>& diskCache, QObject* parent = NULL);
+    virtual ~ResourceNetworkCache();
+
+    virtual QNetworkCacheMetaData metaData(const QUrl& url);
+    virtual void updateMetaData(const QNetworkCacheMetaData& metaData);
+    virtual QIODevice* data(const QUrl& url);
+    virtual bool remove(const QUrl& url);
+    virtual qint64 cacheSize() const;
+    virtual QIODevice* prepare(const QNetworkCacheMetaData& metaData);
+    virtual void insert(QIODevice* device);
+
+public slots:
+    virtual void clear();
+
+private:
+    QSharedPointer<ResourceDiskCache> _diskCache;
+    QHash<QIODevice*, QNetworkCacheMetaData> _preparedDevices;
+};
+
+/// A buffer over a memory mapped cache file; the mapping goes away with the device.
+class MappedCacheFile : public QBuffer {
+public:
+    MappedCacheFile(const QString& path);
+    virtual ~MappedCacheFile();
+
+    bool isMapped() const { return _isMapped; }
+
+private:
+    QFile _file;
+    bool _isMapped;
+};
+
+#endif // hifi_ResourceDiskCache_h
@@ -9,16 +9,33 @@
 //
 
 #include <limits>
+#include <string.h>
+
+#include "LimitedNodeList.h"
 #include "SentPacketHistory.h"
 #include <qdebug.h>
 
+const int UINT16_RANGE = std::numeric_limits<uint16_t>::max() + 1;
+
 SentPacketHistory::SentPacketHistory(int size)
-    : _sentPackets(size),
-    _newestSequenceNumber(std::numeric_limits<uint16_t>::max())
+    : _capacity(1),
+    _newestSequenceNumber(std::numeric_limits<uint16_t>::max()),
+    _numEntries(0),
+    _slab(),
+    _lengths()
 {
+    // round the capacity up to a power of 2 (which always divides the uint16 range) so that a sequence number maps
+    // to the same slot before and after a rollover
+    while (_capacity < size && _capacity < UINT16_RANGE) {
+        _capacity <<= 1;
+    }
 }
 
 void SentPacketHistory::packetSent(uint16_t sequenceNumber, const QByteArray& packet) {
+    packetSent(sequenceNumber, packet.constData(), packet.size());
+}
+
+void SentPacketHistory::packetSent(uint16_t sequenceNumber, const char* packet, int packetLength) {
 
     // check if given seq number has the expected value.  if not, something's wrong with
     // the code calling this function
@@ -26,14 +43,33 @@ void SentPacketHistory::packetSent(uint16_t sequenceNumber, const QByteArray& pa
     if (sequenceNumber != expectedSequenceNumber) {
         qDebug() << "Unexpected sequence number passed to SentPacketHistory::packetSent()!"
             << "Expected:" << expectedSequenceNumber << "Actual:" << sequenceNumber;
+
+        // the slots between the expected and actual sequence numbers hold stale packets, forget everything
+        _numEntries = 0;
+    }
+
+    if (packetLength > MAX_PACKET_SIZE) {
+        qDebug() << "SentPacketHistory::packetSent() packet of" << packetLength << "bytes is larger than"
+            << MAX_PACKET_SIZE << "and will not be kept for re-sending";
+        packetLength = 0;
     }
+
+    if (_slab.isEmpty()) {
+        _slab.resize(_capacity * MAX_PACKET_SIZE);
+        _lengths.fill(0, _capacity);
+    }
+
+    int slot = sequenceNumber & (_capacity - 1);
+    memcpy(_slab.data() + slot * MAX_PACKET_SIZE, packet, packetLength);
+    _lengths[slot] = packetLength;
+
     _newestSequenceNumber = sequenceNumber;
-    _sentPackets.insert(packet);
+    if (_numEntries < _capacity) {
+        _numEntries++;
+    }
 }
 
-const QByteArray* SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
-
-    const int UINT16_RANGE = std::numeric_limits<uint16_t>::max() + 1;
+QByteArray SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
 
     // if sequenceNumber > _newestSequenceNumber, assume sequenceNumber is from before the most recent rollover
     // correct the diff so that it correctly represents how far back in the history sequenceNumber is
@@ -41,6 +77,13 @@ const QByteArray* SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
     if (seqDiff < 0) {
         seqDiff += UINT16_RANGE;
     }
+    if (seqDiff >= _numEntries) {
+        return QByteArray();
+    }
 
-    return _sentPackets.get(seqDiff);
+    int slot = sequenceNumber & (_capacity - 1);
+    if (_lengths[slot] == 0) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(_slab.constData() + slot * MAX_PACKET_SIZE, _lengths[slot]);
 }
@@ -13,22 +13,36 @@
 
 #include <stdint.h>
 #include <qbytearray.h>
-#include "RingBufferHistory.h"
+#include <qvector.h>
 
 #include "SequenceNumberStats.h"
 
+// Keeps the most recently sent packets around so they can be re-sent when NACKed. Packets are copied into a
+// fixed-size slab of MTU sized slots indexed by (sequenceNumber % capacity), so once the slab is allocated the history
+// never allocates again and its memory footprint is bounded by getMemoryUsage().
 class SentPacketHistory {
 
 public:
     SentPacketHistory(int size = MAX_REASONABLE_SEQUENCE_GAP);
 
     void packetSent(uint16_t sequenceNumber, const QByteArray& packet);
-    const QByteArray* getPacket(uint16_t sequenceNumber) const;
+    void packetSent(uint16_t sequenceNumber, const char* packet, int packetLength);
 
-private:
-    RingBufferHistory<QByteArray> _sentPackets;    // circular buffer
+    // returns a null QByteArray if the packet is not in the history. The returned array does NOT own its data, it
+    // points into the history's slab and is only valid until the next call to packetSent(), copy it if you need to
+    // hold onto it for longer than that.
+    QByteArray getPacket(uint16_t sequenceNumber) const;
+
+    int getCapacity() const { return _capacity; }
+    quint64 getMemoryUsage() const { return _slab.capacity() + _lengths.capacity() * sizeof(quint16); }
 
+private:
+    int _capacity;                  // always a power of 2 so that slots stay stable across uint16 rollover
     uint16_t _newestSequenceNumber;
+    int _numEntries;
+
+    QByteArray _slab;               // _capacity slots of MAX_PACKET_SIZE bytes, allocated on first send
+    QVector<quint16> _lengths;      // length of the packet stored in each slot
 };
 
 #endif
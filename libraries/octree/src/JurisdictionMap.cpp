@@ -18,6 +18,7 @@
 #include <OctalCode.h>
 
 #include "JurisdictionMap.h"
+#include "OctreeElement.h"
 
 
 // standard assignment
@@ -33,6 +34,7 @@ JurisdictionMap::JurisdictionMap(JurisdictionMap&& other) : _rootOctalCode(NULL)
     init(other._rootOctalCode, other._endNodes);
     other._rootOctalCode = NULL;
     other._endNodes.clear();
+    other.updateOctalKeys();
 }
 
 // move assignment
@@ -40,12 +42,13 @@ JurisdictionMap& JurisdictionMap::operator=(JurisdictionMap&& other) {
     init(other._rootOctalCode, other._endNodes);
     other._rootOctalCode = NULL;
     other._endNodes.clear();
+    other.updateOctalKeys();
     return *this;
 }
 #endif
 
 // Copy constructor
-JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const JurisdictionMap& other) : _rootOctalCode(NULL), _octalKeysValid(false) {
     copyContents(other);
 }
 
@@ -93,9 +96,10 @@ void JurisdictionMap::clear() {
         }
     }
     _endNodes.clear();
+    updateOctalKeys();
 }
 
-JurisdictionMap::JurisdictionMap(NodeType_t type) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(NodeType_t type) : _rootOctalCode(NULL), _octalKeysValid(false) {
     _nodeType = type;
     unsigned char* rootCode = new unsigned char[1];
     *rootCode = 0;
@@ -104,13 +108,13 @@ JurisdictionMap::JurisdictionMap(NodeType_t type) : _rootOctalCode(NULL) {
     init(rootCode, emptyEndNodes);
 }
 
-JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL) {
+JurisdictionMap::JurisdictionMap(const char* filename) : _rootOctalCode(NULL), _octalKeysValid(false) {
     clear(); // clean up our own memory
     readFromFile(filename);
 }
 
 JurisdictionMap::JurisdictionMap(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes)  
-    : _rootOctalCode(NULL) {
+    : _rootOctalCode(NULL), _octalKeysValid(false) {
     init(rootOctalCode, endNodes);
 }
 
@@ -146,7 +150,7 @@ void myDebugPrintOctalCode(const unsigned char* octalCode, bool withNewLine) {
 }
 
 
-JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) {
+JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHexCodes) : _octalKeysValid(false) {
 
     qDebug("JurisdictionMap::JurisdictionMap(const char* rootHexCode=[%p] %s, const char* endNodesHexCodes=[%p] %s)",
         rootHexCode, rootHexCode, endNodesHexCodes, endNodesHexCodes);
@@ -175,6 +179,7 @@ JurisdictionMap::JurisdictionMap(const char* rootHexCode, const char* endNodesHe
         myDebugPrintOctalCode(endNodeOctcode, true);
 
     }    
+    updateOctalKeys();
 }
 
 
@@ -182,6 +187,18 @@ void JurisdictionMap::init(unsigned char* rootOctalCode, const std::vector<unsig
     clear(); // clean up our own memory
     _rootOctalCode = rootOctalCode;
     _endNodes = endNodes;
+    updateOctalKeys();
+}
+
+void JurisdictionMap::updateOctalKeys() {
+    _rootOctalKey = octalKeyForCode(_rootOctalCode);
+    _octalKeysValid = _rootOctalKey != INVALID_OCTAL_KEY;
+    _endNodeKeys.clear();
+    for (size_t i = 0; i < _endNodes.size(); i++) {
+        OctalKey endNodeKey = octalKeyForCode(_endNodes[i]);
+        _octalKeysValid = _octalKeysValid && endNodeKey != INVALID_OCTAL_KEY;
+        _endNodeKeys.push_back(endNodeKey);
+    }
 }
 
 JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const unsigned char* nodeOctalCode, int childIndex) const {
@@ -207,6 +224,28 @@ JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const unsigned char* nod
     return isInJurisdiction ? WITHIN : BELOW;
 }
 
+JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const OctreeElement* element, int childIndex) const {
+    OctalKey nodeKey = element->getOctalKey();
+    if (!_octalKeysValid || nodeKey == INVALID_OCTAL_KEY) {
+        return isMyJurisdiction(element->getOctalCode(), childIndex);
+    }
+
+    // the same tests as above, as integer compares
+    if (isAncestorOfKey(nodeKey, _rootOctalKey)) {
+        return ABOVE;
+    }
+    OctalKey descendentKey = (childIndex == CHECK_NODE_ONLY) ? nodeKey : childOctalKey(nodeKey, childIndex);
+    if (!isAncestorOfKey(_rootOctalKey, descendentKey)) {
+        return BELOW;
+    }
+    for (size_t i = 0; i < _endNodeKeys.size(); i++) {
+        if (isAncestorOfKey(_endNodeKeys[i], nodeKey)) {
+            return BELOW;
+        }
+    }
+    return WITHIN;
+}
+
 
 bool JurisdictionMap::readFromFile(const char* filename) {
     QString     settingsFile(filename);
@@ -231,6 +270,7 @@ bool JurisdictionMap::readFromFile(const char* filename) {
         _endNodes.push_back(octcode);
     }
     settings.endGroup();
+    updateOctalKeys();
     return true;
 }
 
@@ -371,6 +411,7 @@ int JurisdictionMap::unpackFromMessage(const unsigned char* sourceBuffer, int av
             }
         }
     }
+    updateOctalKeys();
     
     return sourceBuffer - startPosition; // includes header!
 }
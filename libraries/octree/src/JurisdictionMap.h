@@ -21,6 +21,9 @@
 #include <QReadWriteLock>
 
 #include <Node.h>
+#include <OctalCode.h>
+
+class OctreeElement;
 
 class JurisdictionMap {
 public:
@@ -51,6 +54,9 @@ public:
 
     Area isMyJurisdiction(const unsigned char* nodeOctalCode, int childIndex) const;
 
+    /// Same as above, but compares the element's octal key rather than its code when it can
+    Area isMyJurisdiction(const OctreeElement* element, int childIndex) const;
+
     bool writeToFile(const char* filename);
     bool readFromFile(const char* filename);
 
@@ -75,9 +81,13 @@ private:
     void copyContents(const JurisdictionMap& other); // use assignment instead
     void clear();
     void init(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes);
+    void updateOctalKeys();
 
     unsigned char* _rootOctalCode;
     std::vector<unsigned char*> _endNodes;
+    OctalKey _rootOctalKey;
+    std::vector<OctalKey> _endNodeKeys;
+    bool _octalKeysValid; // false if there's no root or any of the codes are too deep for a key
     NodeType_t _nodeType;
 };
 
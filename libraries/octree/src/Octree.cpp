@@ -19,8 +19,13 @@
 #include <fstream> // to load voxels from file
 
 #include <QDebug>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThreadPool>
 #include <QVector>
+#include <QWaitCondition>
 
+#include <FileUtils.h>
 #include <GeometryUtil.h>
 #include <OctalCode.h>
 #include <LogHandler.h>
@@ -32,27 +37,125 @@
 #include "CoverageMap.h"
 #include "OctreeConstants.h"
 #include "OctreeElementBag.h"
+#include "OctreeElementPool.h"
+#include "OctreeEncodeCache.h"
 #include "Octree.h"
 #include "ViewFrustum.h"
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale) {
-    return voxelSizeScale / powf(2, renderLevel);
+    // halving is exact, so this is voxelSizeScale / powf(2, renderLevel) without the powf(). Past the largest float
+    // power of two, which is where a negative level adjust that wrapped around ends up, powf() made it 0.
+    const unsigned int MAX_FLOAT_EXPONENT = 127;
+    return (renderLevel <= MAX_FLOAT_EXPONENT) ? ldexpf(voxelSizeScale, -(int)renderLevel) : 0.0f;
 }
 
 Octree::Octree(bool shouldReaverage) :
     _rootElement(NULL),
     _isDirty(true),
+    _hasUnloggedChanges(false),
     _shouldReaverage(shouldReaverage),
     _stopImport(false),
     _lock(QReadWriteLock::Recursive),
+    _editLock(QMutex::Recursive),
+    _writerThread(NULL),
+    _writeDepth(0),
+    _writerReadDepth(0),
+    _versionedReads(false),
     _isViewing(false),
-    _isServer(false)
+    _isServer(false),
+    _encodeCache(NULL),
+    _elementPool(NULL),
+    _editLog(NULL)
 {
 }
 
 Octree::~Octree() {
     // This will delete all children, don't create a new root in this case.
     eraseAllOctreeElements(false);
+
+    // the cache listens for element deletes, so it has to outlive our elements
+    delete _encodeCache;
+    delete _elementPool;
+}
+
+void Octree::lockForRead() {
+    _lock.lockForRead();
+    if (_writerThread.load() == QThread::currentThread()) {
+        _writerReadDepth++;
+    }
+}
+
+bool Octree::tryLockForRead() {
+    if (!_lock.tryLockForRead()) {
+        return false;
+    }
+    if (_writerThread.load() == QThread::currentThread()) {
+        _writerReadDepth++;
+    }
+    return true;
+}
+
+void Octree::lockForWrite() {
+    _editLock.lock();
+    _lock.lockForWrite();
+    _writerThread.store(QThread::currentThread());
+    _writeDepth++;
+}
+
+bool Octree::tryLockForWrite() {
+    if (!_editLock.tryLock()) {
+        return false;
+    }
+    if (!_lock.tryLockForWrite()) {
+        _editLock.unlock();
+        return false;
+    }
+    _writerThread.store(QThread::currentThread());
+    _writeDepth++;
+    return true;
+}
+
+void Octree::unlock() {
+    // the writer can take read locks on top of its write lock, for instance when a script it runs searches the tree, and
+    // those unlock before the write does. Unlocks from any other thread are reads.
+    if (_writerThread.load() != QThread::currentThread() || _writerReadDepth > 0) {
+        if (_writerThread.load() == QThread::currentThread()) {
+            _writerReadDepth--;
+        }
+        _lock.unlock();
+        return;
+    }
+    _writeDepth--;
+    if (_writeDepth == 0) {
+        publishVersions();
+        _writerThread.store(NULL);
+    }
+    _lock.unlock();
+    _editLock.unlock();
+}
+
+void Octree::lockForEdit() {
+    if (_versionedReads) {
+        _editLock.lock();
+    } else {
+        lockForWrite();
+    }
+}
+
+void Octree::unlockForEdit() {
+    if (_versionedReads) {
+        publishVersions();
+        _editLock.unlock();
+    } else {
+        unlock();
+    }
+}
+
+void Octree::setEncodeCache(OctreeEncodeCache* encodeCache) {
+    if (_encodeCache != encodeCache) {
+        delete _encodeCache;
+        _encodeCache = encodeCache;
+    }
 }
 
 // Recurses voxel tree calling the RecurseOctreeOperation function for each element.
@@ -192,6 +295,134 @@ bool Octree::recurseElementWithOperator(OctreeElement* element, RecurseOctreeOpe
     return operatorObject->postRecursion(element);
 }
 
+// The subtrees of a parallel recursion, shared by the calling thread and its tasks on the pool. Each of them takes the
+// next subtree nobody has started until there are none left, so a thread that gets small subtrees just takes more of
+// them, and a task that only starts once the others are done finds nothing left to do.
+class ParallelRecursion {
+public:
+    ParallelRecursion(Octree* tree, int forkLevel) :
+        _tree(tree),
+        _forkLevel(forkLevel),
+        _subtrees(),
+        _operators(),
+        _nextSubtree(0),
+        _mutex(),
+        _allRecursed(),
+        _subtreesRecursed(0)
+    {
+    }
+
+    QVector<OctreeElement*>& getSubtrees() { return _subtrees; }
+    QVector<RecurseOctreeOperator*>& getOperators() { return _operators; }
+
+    void recurseSubtrees() {
+        int subtreeIndex;
+        while ((subtreeIndex = _nextSubtree.fetchAndAddOrdered(1)) < _subtrees.size()) {
+            _tree->recurseElementWithOperator(_subtrees[subtreeIndex], _operators[subtreeIndex], _forkLevel - 1);
+
+            QMutexLocker locker(&_mutex);
+            if (++_subtreesRecursed == _subtrees.size()) {
+                _allRecursed.wakeAll();
+            }
+        }
+    }
+
+    void waitUntilRecursed() {
+        QMutexLocker locker(&_mutex);
+        while (_subtreesRecursed < _subtrees.size()) {
+            _allRecursed.wait(&_mutex);
+        }
+    }
+
+private:
+    Octree* _tree;
+    int _forkLevel;
+    QVector<OctreeElement*> _subtrees;
+    QVector<RecurseOctreeOperator*> _operators;
+    QAtomicInt _nextSubtree;
+    QMutex _mutex;
+    QWaitCondition _allRecursed;
+    int _subtreesRecursed;
+};
+
+class ParallelRecursionTask : public QRunnable {
+public:
+    ParallelRecursionTask(const QSharedPointer<ParallelRecursion>& recursion) : _recursion(recursion) { }
+    virtual void run() { _recursion->recurseSubtrees(); }
+
+private:
+    QSharedPointer<ParallelRecursion> _recursion;
+};
+
+void Octree::recurseTreeWithOperatorInParallel(RecurseOctreeOperator* operatorObject, int forkLevel) {
+    if (forkLevel <= _rootElement->getLevel()) {
+        recurseTreeWithOperator(operatorObject);
+        return;
+    }
+
+    QSharedPointer<ParallelRecursion> recursion(new ParallelRecursion(this, forkLevel));
+    QVector<OctreeElement*>& subtrees = recursion->getSubtrees();
+    QVector<OctreeElement*> elementsAbove;
+    gatherSubtreesWithOperator(_rootElement, operatorObject, forkLevel, subtrees, elementsAbove);
+
+    // a single subtree, or an operator that can't fork, is quicker to recurse right here
+    RecurseOctreeOperator* firstSubtreeOperator = subtrees.size() > 1 ? operatorObject->forkForSubtree() : NULL;
+    if (!firstSubtreeOperator) {
+        foreach (OctreeElement* subtree, subtrees) {
+            recurseElementWithOperator(subtree, operatorObject, forkLevel - 1);
+        }
+    } else {
+        QVector<RecurseOctreeOperator*>& operators = recursion->getOperators();
+        operators << firstSubtreeOperator;
+        for (int i = 1; i < subtrees.size(); i++) {
+            operators << operatorObject->forkForSubtree();
+        }
+
+        // this thread takes subtrees too, so it only needs help with the rest of them
+        QThreadPool* threadPool = QThreadPool::globalInstance();
+        int tasks = qMin(subtrees.size() - 1, threadPool->maxThreadCount());
+        for (int i = 0; i < tasks; i++) {
+            threadPool->start(new ParallelRecursionTask(recursion));
+        }
+        recursion->recurseSubtrees();
+        recursion->waitUntilRecursed();
+
+        foreach (RecurseOctreeOperator* subtreeOperator, operators) {
+            if (subtreeOperator != operatorObject) {
+                operatorObject->joinSubtree(subtreeOperator);
+                delete subtreeOperator;
+            }
+        }
+    }
+
+    foreach (OctreeElement* element, elementsAbove) {
+        operatorObject->postRecursion(element);
+    }
+}
+
+// Does the preRecursion() half of recurseElementWithOperator() down to the fork level, collecting the elements at the
+// fork level as subtrees, and the elements above it in the order their postRecursion() is due.
+void Octree::gatherSubtreesWithOperator(OctreeElement* element, RecurseOctreeOperator* operatorObject, int forkLevel,
+                                        QVector<OctreeElement*>& subtrees, QVector<OctreeElement*>& elementsAbove) {
+    if (element->getLevel() >= forkLevel) {
+        subtrees << element;
+        return;
+    }
+
+    if (operatorObject->preRecursion(element)) {
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = element->getChildAtIndex(i);
+            if (!child) {
+                child = operatorObject->possiblyCreateChildAt(element, i);
+            }
+            if (child) {
+                gatherSubtreesWithOperator(child, operatorObject, forkLevel, subtrees, elementsAbove);
+            }
+        }
+    }
+    elementsAbove << element;
+}
+
 
 OctreeElement* Octree::nodeForOctalCode(OctreeElement* ancestorElement,
                                        const unsigned char* needleCode, OctreeElement** parentOfFoundElement) const {
@@ -200,6 +431,27 @@ OctreeElement* Octree::nodeForOctalCode(OctreeElement* ancestorElement,
         return _rootElement;
     }
 
+    // with keys for both we can walk straight down, taking the needle's section at each level as the branch
+    OctalKey needleKey = octalKeyForCode(needleCode);
+    if (needleKey != INVALID_OCTAL_KEY && ancestorElement->getOctalKey() != INVALID_OCTAL_KEY) {
+        int needleSections = numberOfSectionsInOctalKey(needleKey);
+        OctreeElement* element = ancestorElement;
+        OctreeElement* parentElement = NULL;
+        for (int sections = numberOfSectionsInOctalKey(element->getOctalKey()); sections < needleSections; sections++) {
+            int branch = ancestorOctalKey(needleKey, needleSections - sections - 1) & (NUMBER_OF_CHILDREN - 1);
+            OctreeElement* childElement = element->getChildAtIndex(branch);
+            if (!childElement) {
+                return element; // the last created parent of the code we don't have an element for
+            }
+            parentElement = element;
+            element = childElement;
+        }
+        if (parentOfFoundElement && parentElement) {
+            *parentOfFoundElement = parentElement;
+        }
+        return element;
+    }
+
     // find the appropriate branch index based on this ancestorElement
     if (*needleCode > 0) {
         int branchForNeedle = branchIndexWithDescendant(ancestorElement->getOctalCode(), needleCode);
@@ -567,6 +819,9 @@ void Octree::deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extr
 void Octree::eraseAllOctreeElements(bool createNewRoot) {
     delete _rootElement; // this will recurse and delete all children
     _rootElement = NULL;
+    if (_elementPool) {
+        _elementPool->releaseSlabsIfUnused();
+    }
     
     if (createNewRoot) {
         _rootElement = createNewElement();
@@ -1169,7 +1424,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
     if (params.jurisdictionMap) {
         // here's how it works... if we're currently above our root jurisdiction, then we proceed normally.
         // but once we're in our own jurisdiction, then we need to make sure we're not below it.
-        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(element->getOctalCode(), CHECK_NODE_ONLY)) {
+        if (JurisdictionMap::BELOW == params.jurisdictionMap->isMyJurisdiction(element, CHECK_NODE_ONLY)) {
             params.stopReason = EncodeBitstreamParams::OUT_OF_JURISDICTION;
             return bytesAtThisLevel;
         }
@@ -1331,6 +1586,10 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
     int indexOfChildren[NUMBER_OF_CHILDREN] = { 0, 0, 0, 0, 0, 0, 0, 0 };
     int currentCount = 0;
 
+    if (params.wantOcclusionCulling && params.viewFrustum) {
+        element->childDistancesToCamera(*params.viewFrustum, distancesToChildren);
+    }
+
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         OctreeElement* childElement = element->getChildAtIndex(i);
 
@@ -1339,7 +1598,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         // even if they don't in our local tree
         bool notMyJurisdiction = false;
         if (params.jurisdictionMap) {
-            notMyJurisdiction = JurisdictionMap::WITHIN != params.jurisdictionMap->isMyJurisdiction(element->getOctalCode(), i);
+            notMyJurisdiction = JurisdictionMap::WITHIN != params.jurisdictionMap->isMyJurisdiction(element, i);
         }
         if (params.includeExistsBits) {
             // If the child is known to exist, OR, it's not my jurisdiction, then we mark the bit as existing
@@ -1350,7 +1609,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
 
         if (params.wantOcclusionCulling) {
             if (childElement) {
-                float distance = params.viewFrustum ? childElement->distanceToCamera(*params.viewFrustum) : 0;
+                float distance = params.viewFrustum ? distancesToChildren[i] : 0;
 
                 currentCount = insertIntoSortedArrays((void*)childElement, distance, i,
                                                       (void**)&sortedChildren, (float*)&distancesToChildren,
@@ -1370,6 +1629,25 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         }
     }
 
+    // when the parent intersects, find which children are in view all at once
+    unsigned char childrenInViewBits = 0;
+    if (params.viewFrustum && nodeLocationThisView == ViewFrustum::INTERSECT) {
+        unsigned char childrenInsideBits = 0;
+        unsigned char childrenIntersectBits = 0;
+        element->childrenInFrustum(*params.viewFrustum, childrenInsideBits, childrenIntersectBits);
+        childrenInViewBits = childrenInsideBits | childrenIntersectBits;
+    }
+
+    // all the children are on the same level, so they share an LOD boundary
+    float childBoundaryDistance = !params.viewFrustum ? 1 :
+                                  boundaryDistanceForRenderLevel(element->getLevel() + 1 + params.boundaryLevelAdjust,
+                                                                 params.octreeElementSizeScale);
+
+    // the children's locations in the last view, only worked out if some child needs them
+    bool haveChildrenInLastView = false;
+    unsigned char childrenInsideLastViewBits = 0;
+    unsigned char childrenIntersectLastViewBits = 0;
+
     // for each child element in Distance sorted order..., check to see if they exist, are colored, and in view, and if so
     // add them to our distance ordered array of children
     for (int i = 0; i < currentCount; i++) {
@@ -1380,7 +1658,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                 ( !params.viewFrustum || // no view frustum was given, everything is assumed in view
                   (nodeLocationThisView == ViewFrustum::INSIDE) || // parent was fully in view, we can assume ALL children are
                   (nodeLocationThisView == ViewFrustum::INTERSECT && 
-                        childElement->isInView(*params.viewFrustum)) // the parent intersects and the child is in view
+                        (childrenInViewBits & (1 << originalIndex))) // the parent intersects and the child is in view
                 ));
 
         if (!childIsInView) {
@@ -1391,11 +1669,8 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         } else {
             // Before we determine consider this further, let's see if it's in our LOD scope...
             float distance = distancesToChildren[i];
-            float boundaryDistance = !params.viewFrustum ? 1 :
-                                     boundaryDistanceForRenderLevel(childElement->getLevel() + params.boundaryLevelAdjust,
-                                            params.octreeElementSizeScale);
 
-            if (!(distance < boundaryDistance)) {
+            if (!(distance < childBoundaryDistance)) {
                 // don't need to check childElement here, because we can't get here with no childElement
                 if (params.stats) {
                     params.stats->skippedDistance(childElement);
@@ -1466,13 +1741,18 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                     bool childWasInView = false;
 
                     if (childElement && params.deltaViewFrustum && params.lastViewFrustum) {
-                        ViewFrustum::location location = childElement->inFrustum(*params.lastViewFrustum);
+                        if (!haveChildrenInLastView) {
+                            element->childrenInFrustum(*params.lastViewFrustum,
+                                                       childrenInsideLastViewBits, childrenIntersectLastViewBits);
+                            haveChildrenInLastView = true;
+                        }
 
                         // If we're a leaf, then either intersect or inside is considered "formerly in view"
                         if (childElement->isLeaf()) {
-                            childWasInView = location != ViewFrustum::OUTSIDE;
+                            childWasInView = (childrenInsideLastViewBits | childrenIntersectLastViewBits) &
+                                (1 << originalIndex);
                         } else {
-                            childWasInView = location == ViewFrustum::INSIDE;
+                            childWasInView = childrenInsideLastViewBits & (1 << originalIndex);
                         }
                     }
 
@@ -1698,8 +1978,13 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                     // Allow the datatype a chance to determine if it really wants to recurse this tree. Usually this
                     // will be true. But if the tree has already been encoded, we will skip this.
                     if (element->shouldRecurseChildTree(originalIndex, params)) {
-                        childTreeBytesOut = encodeTreeBitstreamRecursion(childElement, packetData, bag, params,
-                                                                                thisLevel, nodeLocationThisView);
+                        if (_encodeCache && OctreeEncodeCache::paramsAllowSharing(params, nodeLocationThisView)) {
+                            childTreeBytesOut = encodeSharedTreeBitstreamRecursion(childElement, packetData, bag, params,
+                                                                                   thisLevel, nodeLocationThisView);
+                        } else {
+                            childTreeBytesOut = encodeTreeBitstreamRecursion(childElement, packetData, bag, params,
+                                                                             thisLevel, nodeLocationThisView);
+                        }
                     } else {
                         childTreeBytesOut = 0;
                     }
@@ -1901,6 +2186,54 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
     return bytesAtThisLevel;
 }
 
+// Wraps encodeTreeBitstreamRecursion() for subtrees that might be encoded the same way for many clients. If another
+// send thread already encoded this subtree we append its bytes, otherwise we encode it normally and, if the whole
+// subtree made it into this packet, hand the result to the cache for the next client.
+int Octree::encodeSharedTreeBitstreamRecursion(OctreeElement* element,
+                                               OctreePacketData* packetData, OctreeElementBag& bag,
+                                               EncodeBitstreamParams& params, int& currentEncodeLevel,
+                                               const ViewFrustum::location& parentLocationThisView) const {
+
+    if (!_encodeCache->isSubtreeShareable(element, params)) {
+        return encodeTreeBitstreamRecursion(element, packetData, bag, params, currentEncodeLevel, parentLocationThisView);
+    }
+
+    QByteArray encoded;
+    if (_encodeCache->findSubtree(element, params, encoded)) {
+        if (packetData->appendRawData((const unsigned char*)encoded.constData(), encoded.size())) {
+            element->sharedSubtreeEncoded(params);
+            return encoded.size();
+        }
+
+        // the shared encoding doesn't fit in what's left of this packet, so encode it normally which lets the subtree
+        // be split across packets
+        _encodeCache->subtreeDidntFit(encoded.size());
+        return encodeTreeBitstreamRecursion(element, packetData, bag, params, currentEncodeLevel, parentLocationThisView);
+    }
+
+    quint64 subtreeVersion = _encodeCache->getSubtreeVersion(element);
+    int bytesBefore = packetData->getUncompressedSize();
+    int bagCountBefore = bag.count();
+    EncodeBitstreamParams::reason stopReasonBefore = params.stopReason;
+    params.stopReason = EncodeBitstreamParams::UNKNOWN;
+
+    int bytesWritten = encodeTreeBitstreamRecursion(element, packetData, bag, params,
+                                                    currentEncodeLevel, parentLocationThisView);
+
+    // only complete encodings can be shared, anything that was left for a later packet would be missing
+    bool completelyEncoded = bytesWritten > 0 && params.stopReason != EncodeBitstreamParams::DIDNT_FIT &&
+        bag.count() == bagCountBefore && packetData->getUncompressedSize() - bytesBefore == bytesWritten;
+    if (completelyEncoded) {
+        _encodeCache->storeSubtree(element, params, packetData->getUncompressedData(bytesBefore), bytesWritten,
+                                   subtreeVersion);
+    }
+
+    if (params.stopReason == EncodeBitstreamParams::UNKNOWN) {
+        params.stopReason = stopReasonBefore;
+    }
+    return bytesWritten;
+}
+
 bool Octree::readFromSVOFile(const char* fileName) {
     bool fileOk = false;
 
@@ -2043,10 +2376,12 @@ bool Octree::readFromSVOFile(const char* fileName) {
     return fileOk;
 }
 
-void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
-    std::ofstream file(fileName, std::ios::out|std::ios::binary);
-
-    if(file.is_open()) {
+bool Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
+    // Encode everything up front under one read lock so the file is a consistent picture of the tree, then write it
+    // next to the real file and only replace the real file once what's on disk checks out. Readers keep going while
+    // we encode, and so do edits on trees with versioned reads, and nothing waits on the disk.
+    QByteArray fileContents;
+    {
         qDebug("Saving to file %s...", fileName);
 
         PacketType expectedType = expectedDataPacketType();
@@ -2056,8 +2391,8 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
         // before reading the file, check to see if this version of the Octree supports file versions
         if (getWantSVOfileVersions()) {
             // if so, read the first byte of the file and see if it matches the expected version code
-            file.write(reinterpret_cast<char*>(&expectedType), sizeof(expectedType));
-            file.write(&expectedVersion, sizeof(expectedVersion));
+            fileContents.append(reinterpret_cast<char*>(&expectedType), sizeof(expectedType));
+            fileContents.append(&expectedVersion, sizeof(expectedVersion));
             qDebug() << "SVO file type: " << nameForPacketType(expectedType) << " version: " << (int)expectedVersion;
 
             hasBufferBreaks = versionHasSVOfileBreaks(expectedVersion);
@@ -2082,14 +2417,13 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
         int bytesWritten = 0;
         bool lastPacketWritten = false;
 
+        lockForRead();
         while (!elementBag.isEmpty()) {
             OctreeElement* subTree = elementBag.extract();
             
-            lockForRead(); // do tree locking down here so that we have shorter slices and less thread contention
             EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
             params.extraEncodeData = &extraEncodeData;
             bytesWritten = encodeTreeBitstream(subTree, &packetData, elementBag, params);
-            unlock();
 
             // if the subTree couldn't fit, and so we should reset the packet and reinsert the element in our bag and try again
             if (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT)) {
@@ -2098,9 +2432,9 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
                     // buffer to allow the reader to read this file in chunks.
                     if (hasBufferBreaks) {
                         quint16 bufferSize = packetData.getFinalizedSize();
-                        file.write((const char*)&bufferSize, sizeof(bufferSize));
+                        fileContents.append((const char*)&bufferSize, sizeof(bufferSize));
                     }
-                    file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+                    fileContents.append((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
                     lastPacketWritten = true;
                 }
                 packetData.reset(); // is there a better way to do this? could we fit more?
@@ -2109,20 +2443,22 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
                 lastPacketWritten = false;
             }
         }
+        unlock();
 
         if (!lastPacketWritten) {
             // if this type of SVO file should have buffer breaks, then we will write a buffer size before each
             // buffer to allow the reader to read this file in chunks.
             if (hasBufferBreaks) {
                 quint16 bufferSize = packetData.getFinalizedSize();
-                file.write((const char*)&bufferSize, sizeof(bufferSize));
+                fileContents.append((const char*)&bufferSize, sizeof(bufferSize));
             }
-            file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+            fileContents.append((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
         }
         
         releaseSceneEncodeData(&extraEncodeData);
     }
-    file.close();
+
+    return FileUtils::saveFileAtomically(fileName, fileContents);
 }
 
 unsigned long Octree::getOctreeElementsCount() {
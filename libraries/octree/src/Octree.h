@@ -20,6 +20,9 @@ class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
 class OctreeElementBag;
+class OctreeElementPool;
+class OctreeEditLog;
+class OctreeEncodeCache;
 class OctreePacketData;
 class Shape;
 
@@ -32,15 +35,29 @@ class Shape;
 #include "OctreeSceneStats.h"
 
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QSet>
+#include <QThread>
+#include <QVector>
 
 /// derive from this class to use the Octree::recurseTreeWithOperator() method
 class RecurseOctreeOperator {
 public:
+    virtual ~RecurseOctreeOperator() { }
     virtual bool preRecursion(OctreeElement* element) = 0;
     virtual bool postRecursion(OctreeElement* element) = 0;
     virtual OctreeElement* possiblyCreateChildAt(OctreeElement* element, int childIndex) { return NULL; }
+
+    /// Operators that Octree::recurseTreeWithOperatorInParallel() may run on several subtrees at once return an operator
+    /// for one subtree: a fresh copy that gathers its own results, or themselves if they're thread safe. The default of
+    /// NULL runs the whole recursion on the calling thread.
+    virtual RecurseOctreeOperator* forkForSubtree() { return NULL; }
+
+    /// Folds the results of an operator from forkForSubtree() back into this one. Called on the calling thread, in the
+    /// order the subtrees would have been visited, before the subtree operator is deleted.
+    virtual void joinSubtree(RecurseOctreeOperator* subtreeOperator) { }
 };
 
 // Callback function, for recuseTreeWithOperation
@@ -48,6 +65,9 @@ typedef bool (*RecurseOctreeOperation)(OctreeElement* element, void* extraData);
 typedef enum {GRADIENT, RANDOM, NATURAL} creationMode;
 typedef QHash<uint, AACube> CubeList;
 
+// elements at level 3 split the tree into at most 64 subtrees, enough to keep a server's cores busy
+const int DEFAULT_PARALLEL_RECURSION_FORK_LEVEL = 3;
+
 const bool NO_EXISTS_BITS         = false;
 const bool WANT_EXISTS_BITS       = true;
 const bool NO_COLOR               = false;
@@ -211,6 +231,13 @@ public:
     {}
 };
 
+/// An edit that recreates some of an element's data when replayed through Octree::replayEditLogRecord()
+class OctreeEditRecord {
+public:
+    PacketType packetType;
+    QByteArray data;
+};
+
 class Octree : public QObject {
     Q_OBJECT
 public:
@@ -230,6 +257,14 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const { return false; }
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& sourceNode) { return 0; }
+
+    /// Applies an edit the tree wrote to its edit log in an earlier run. Called with the tree locked for writing.
+    virtual bool replayEditLogRecord(PacketType packetType, const unsigned char* record, int length) { return false; }
+
+    /// Trees that can describe their elements' data as edit records can be saved in the indexed persist format, see
+    /// OctreeIndexedFile. Called with the tree locked for reading.
+    virtual bool canWriteEditRecords() const { return false; }
+    virtual void appendElementEditRecords(OctreeElement* element, QList<OctreeEditRecord>& records) { }
                     
     virtual bool recurseChildrenWithData() const { return true; }
     virtual bool rootElementHasData() const { return false; }
@@ -275,19 +310,69 @@ public:
 
     void recurseTreeWithOperator(RecurseOctreeOperator* operatorObject);
 
+    /// Like recurseTreeWithOperator(), except that below forkLevel each subtree is recursed as a task on the global
+    /// thread pool, with the calling thread working through them alongside the pool. Elements above forkLevel get their
+    /// preRecursion() before and their postRecursion() after the subtrees, as usual. An operator that doesn't fork (see
+    /// RecurseOctreeOperator::forkForSubtree()) is recursed serially, and a subtree returning false doesn't stop its
+    /// siblings. The caller handles locking, as with recurseTreeWithOperator().
+    void recurseTreeWithOperatorInParallel(RecurseOctreeOperator* operatorObject,
+                                           int forkLevel = DEFAULT_PARALLEL_RECURSION_FORK_LEVEL);
+
     int encodeTreeBitstream(OctreeElement* element, OctreePacketData* packetData, OctreeElementBag& bag,
                             EncodeBitstreamParams& params) ;
+
+    /// Lets concurrent encoders of this tree share the encoding of subtrees they all send in full. The tree takes
+    /// ownership of the cache.
+    void setEncodeCache(OctreeEncodeCache* encodeCache);
+    OctreeEncodeCache* getEncodeCache() const { return _encodeCache; }
+
+    /// Trees whose elements come from a pool create it in their constructor, before their root element.
+    OctreeElementPool* getElementPool() const { return _elementPool; }
+
+    /// Trees that support it log the edits they process here, so they can be persisted without saving the whole tree.
+    /// The log is owned by whoever persists the tree.
+    void setEditLog(OctreeEditLog* editLog) { _editLog = editLog; }
+    OctreeEditLog* getEditLog() const { return _editLog; }
                             
     bool isDirty() const { return _isDirty; }
     void clearDirtyBit() { _isDirty = false; }
     void setDirtyBit() { _isDirty = true; }
 
+    /// Changes that aren't in the edit log, like the ones the simulation makes, only make it to disk with a snapshot.
+    bool hasUnloggedChanges() const { return _hasUnloggedChanges; }
+    void clearUnloggedChanges() { _hasUnloggedChanges = false; }
+    void setUnloggedChanges() { _hasUnloggedChanges = true; }
+
     // Octree does not currently handle its own locking, caller must use these to lock/unlock
-    void lockForRead() { _lock.lockForRead(); }
-    bool tryLockForRead() { return _lock.tryLockForRead(); }
-    void lockForWrite() { _lock.lockForWrite(); }
-    bool tryLockForWrite() { return _lock.tryLockForWrite(); }
-    void unlock() { _lock.unlock(); }
+    void lockForRead();
+    bool tryLockForRead();
+    void lockForWrite();
+    bool tryLockForWrite();
+    void unlock();
+
+    /// Locks the tree for an edit that only changes the contents of elements already in the tree. On trees with versioned
+    /// reads this keeps out other writers but not readers, and edits that do need to add or remove elements also take
+    /// lockForWrite() for that part. On other trees it's the same as lockForWrite().
+    void lockForEdit();
+    void unlockForEdit();
+
+    /// The server calls these, holding lockForEdit(), around a run of processEditPacketData() calls that all happen under
+    /// that one lock, so trees can put off work that only has to happen once per run. Default does nothing.
+    virtual void beginEditBatch() { }
+    virtual void endEditBatch() { }
+
+    /// Trees that log what changes can tell a sender what to encode for a client that already has the rest of its view.
+    /// The sequence goes up with every change, and is 0 for trees that don't keep a log.
+    virtual quint64 getChangeSequence() { return 0; }
+
+    /// Adds the subtrees that have to be encoded to send everything that changed after the sequence. Callers must hold
+    /// the read lock.
+    virtual void findElementsChangedSince(quint64 sequence, QSet<OctreeElement*>& elements) { }
+
+    /// With versioned reads, readers holding lockForRead() only look at element contents through the versions the tree
+    /// publishes at the end of each write, which is what lets lockForEdit() leave them running.
+    void setVersionedReads(bool versionedReads) { _versionedReads = versionedReads; }
+    bool getVersionedReads() const { return _versionedReads; }
     // output hints from the encode process
     typedef enum {
         Lock,
@@ -320,7 +405,9 @@ public:
     void loadOctreeFile(const char* fileName, bool wantColorRandomizer);
 
     // these will read/write files that match the wireformat, excluding the 'V' leading
-    void writeToSVOFile(const char* filename, OctreeElement* element = NULL);
+    /// Saves the tree, or the subtree below the element, replacing the file atomically. Returns false, leaving any
+    /// existing file alone, if the save failed.
+    bool writeToSVOFile(const char* filename, OctreeElement* element = NULL);
     bool readFromSVOFile(const char* filename);
     
 
@@ -343,6 +430,8 @@ public:
                 const glm::vec3& point, void* extraData, int recursionCount = 0);
 
     bool recurseElementWithOperator(OctreeElement* element, RecurseOctreeOperator* operatorObject, int recursionCount = 0);
+    void gatherSubtreesWithOperator(OctreeElement* element, RecurseOctreeOperator* operatorObject, int forkLevel,
+                                    QVector<OctreeElement*>& subtrees, QVector<OctreeElement*>& elementsAbove);
 
     bool getIsViewing() const { return _isViewing; } /// This tree is receiving inbound viewer datagrams.
     void setIsViewing(bool isViewing) { _isViewing = isViewing; }
@@ -365,6 +454,10 @@ public slots:
 
 
 protected:
+    /// Called at the end of every write, while other writers are still kept out. Trees with versioned reads publish new
+    /// versions of the element contents that changed.
+    virtual void publishVersions() { }
+
     void deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extraData);
 
     int encodeTreeBitstreamRecursion(OctreeElement* element,
@@ -372,6 +465,11 @@ protected:
                                      EncodeBitstreamParams& params, int& currentEncodeLevel,
                                      const ViewFrustum::location& parentLocationThisView) const;
 
+    int encodeSharedTreeBitstreamRecursion(OctreeElement* element,
+                                           OctreePacketData* packetData, OctreeElementBag& bag,
+                                           EncodeBitstreamParams& params, int& currentEncodeLevel,
+                                           const ViewFrustum::location& parentLocationThisView) const;
+
     static bool countOctreeElementsOperation(OctreeElement* element, void* extraData);
 
     OctreeElement* nodeForOctalCode(OctreeElement* ancestorElement, const unsigned char* needleCode, OctreeElement** parentOfFoundElement) const;
@@ -382,13 +480,23 @@ protected:
     OctreeElement* _rootElement;
 
     bool _isDirty;
+    bool _hasUnloggedChanges;
     bool _shouldReaverage;
     bool _stopImport;
 
     QReadWriteLock _lock;
+    QMutex _editLock; // held by every writer, readers only take _lock
+    QAtomicPointer<QThread> _writerThread; // the thread holding the write lock, if any
+    int _writeDepth;
+    int _writerReadDepth; // read locks the writer took on top of its write lock
+    bool _versionedReads;
     
     bool _isViewing; 
     bool _isServer;
+
+    OctreeEncodeCache* _encodeCache;
+    OctreeElementPool* _elementPool;
+    OctreeEditLog* _editLog;
 };
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale);
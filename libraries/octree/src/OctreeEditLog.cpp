@@ -0,0 +1,256 @@
+//
+//  OctreeEditLog.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include <FileUtils.h>
+#include <SharedUtil.h>
+
+#include "Octree.h"
+#include "OctreeEditLog.h"
+
+const int OctreeEditLog::DEFAULT_COMMIT_INTERVAL = 100; // msecs
+const int OctreeEditLog::DEFAULT_COMPACT_SIZE = 64 * 1024 * 1024; // bytes
+
+// the log starts with a magic number and format version, then each record is its length, packet type, the record itself
+// and a checksum of the type and record
+const char EDIT_LOG_MAGIC[] = { 'H', 'F', 'E', 'L' };
+const quint8 EDIT_LOG_VERSION = 1;
+const int EDIT_LOG_HEADER_SIZE = sizeof(EDIT_LOG_MAGIC) + sizeof(EDIT_LOG_VERSION);
+const int RECORD_OVERHEAD = sizeof(quint32) + sizeof(quint8) + sizeof(quint16);
+
+static quint16 checksumRecord(quint8 packetType, const char* record, int length) {
+    QByteArray checked;
+    checked.reserve(sizeof(packetType) + length);
+    checked.append((char)packetType);
+    checked.append(record, length);
+    return qChecksum(checked.constData(), checked.size());
+}
+
+OctreeEditLog::OctreeEditLog(const QString& persistFilename) :
+    _filename(persistFilename + ".log"),
+    _compactingFilename(persistFilename + ".log.compacting"),
+    _fileMutex(QMutex::Recursive),
+    _file(),
+    _mutex(),
+    _pending(),
+    _pendingRecords(0),
+    _size(0),
+    _recordsAppended(0),
+    _commits(0),
+    _compactions(0),
+    _recordsReplayed(0),
+    _averageCommitTime(),
+    _averageRecordsPerCommit()
+{
+}
+
+OctreeEditLog::~OctreeEditLog() {
+    close();
+}
+
+int OctreeEditLog::replay(Octree* tree) {
+    // the compacting log is left over if we went away before its snapshot was saved, and its edits come first
+    int replayed = 0;
+    if (QFile::exists(_compactingFilename)) {
+        replayed += replayFile(_compactingFilename, tree);
+    }
+    if (QFile::exists(_filename)) {
+        replayed += replayFile(_filename, tree);
+    }
+    _recordsReplayed += replayed;
+    return replayed;
+}
+
+int OctreeEditLog::replayFile(const QString& filename, Octree* tree) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR opening edit log" << filename << "for replay:" << file.errorString();
+        return 0;
+    }
+    QByteArray contents = file.readAll();
+    if (contents.size() < EDIT_LOG_HEADER_SIZE || memcmp(contents.constData(), EDIT_LOG_MAGIC, sizeof(EDIT_LOG_MAGIC)) != 0 ||
+            (quint8)contents.at(sizeof(EDIT_LOG_MAGIC)) != EDIT_LOG_VERSION) {
+        qDebug() << "Ignoring edit log" << filename << "with an unknown format";
+        return 0;
+    }
+
+    int replayed = 0;
+    int skipped = 0;
+    const char* dataAt = contents.constData() + EDIT_LOG_HEADER_SIZE;
+    int bytesLeft = contents.size() - EDIT_LOG_HEADER_SIZE;
+    while (bytesLeft >= RECORD_OVERHEAD) {
+        quint32 length;
+        memcpy(&length, dataAt, sizeof(length));
+        if (length > (quint32)(bytesLeft - RECORD_OVERHEAD)) {
+            break; // a record we were in the middle of writing when we went away
+        }
+        quint8 packetType = (quint8)dataAt[sizeof(length)];
+        const char* record = dataAt + sizeof(length) + sizeof(packetType);
+        quint16 checksum;
+        memcpy(&checksum, record + length, sizeof(checksum));
+        if (checksum != checksumRecord(packetType, record, length)) {
+            break; // nothing after a torn write can be trusted
+        }
+
+        if (tree->replayEditLogRecord((PacketType)packetType, (const unsigned char*)record, length)) {
+            replayed++;
+        } else {
+            skipped++;
+        }
+        dataAt += RECORD_OVERHEAD + length;
+        bytesLeft -= RECORD_OVERHEAD + length;
+    }
+    if (bytesLeft > 0) {
+        qDebug() << "Edit log" << filename << "ends in" << bytesLeft << "bytes of incomplete edits, dropping them";
+    }
+    qDebug() << "Replayed" << replayed << "edits from" << filename << "skipped:" << skipped;
+    return replayed;
+}
+
+bool OctreeEditLog::open() {
+    QMutexLocker fileLocker(&_fileMutex);
+    if (_file.isOpen()) {
+        return true;
+    }
+    _file.setFileName(_filename);
+    if (!_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "ERROR opening edit log" << _filename << ":" << _file.errorString();
+        return false;
+    }
+
+    // start over if we can't append to what's there, the edits in it were replayed when we loaded
+    QByteArray header = _file.read(EDIT_LOG_HEADER_SIZE);
+    if (header.size() < EDIT_LOG_HEADER_SIZE || memcmp(header.constData(), EDIT_LOG_MAGIC, sizeof(EDIT_LOG_MAGIC)) != 0 ||
+            (quint8)header.at(sizeof(EDIT_LOG_MAGIC)) != EDIT_LOG_VERSION) {
+        _file.resize(0);
+        _file.seek(0);
+        _file.write(EDIT_LOG_MAGIC, sizeof(EDIT_LOG_MAGIC));
+        _file.write((const char*)&EDIT_LOG_VERSION, sizeof(EDIT_LOG_VERSION));
+        FileUtils::syncToDisk(_file);
+    }
+    _file.seek(_file.size());
+    QMutexLocker locker(&_mutex);
+    _size = _file.size();
+    return true;
+}
+
+void OctreeEditLog::close() {
+    QMutexLocker fileLocker(&_fileMutex);
+    if (_file.isOpen()) {
+        writePending(true);
+        _file.close();
+    }
+}
+
+void OctreeEditLog::append(PacketType packetType, const QByteArray& record) {
+    QMutexLocker locker(&_mutex);
+    quint32 length = record.size();
+    quint8 type = (quint8)packetType;
+    quint16 checksum = checksumRecord(type, record.constData(), record.size());
+    _pending.append((const char*)&length, sizeof(length));
+    _pending.append((const char*)&type, sizeof(type));
+    _pending.append(record);
+    _pending.append((const char*)&checksum, sizeof(checksum));
+    _pendingRecords++;
+    _recordsAppended++;
+}
+
+bool OctreeEditLog::commit() {
+    QMutexLocker fileLocker(&_fileMutex);
+    bool committed = writePending(true);
+    if (!committed) {
+        qDebug() << "ERROR committing edit log" << _filename << ":" << _file.errorString();
+    }
+    return committed;
+}
+
+bool OctreeEditLog::writePending(bool sync) {
+    // take the queued edits and let append() carry on queueing while we write them
+    QByteArray pending;
+    int pendingRecords;
+    {
+        QMutexLocker locker(&_mutex);
+        if (_pending.isEmpty()) {
+            return true;
+        }
+        if (!_file.isOpen()) {
+            return false;
+        }
+        pending.swap(_pending);
+        pendingRecords = _pendingRecords;
+        _pendingRecords = 0;
+    }
+
+    quint64 start = usecTimestampNow();
+    qint64 written = _file.write(pending);
+    bool committed = (written == pending.size()) && (!sync || FileUtils::syncToDisk(_file));
+
+    QMutexLocker locker(&_mutex);
+    if (written <= 0) {
+        // nothing made it out, so the edits go back in front of anything queued since
+        _pending.prepend(pending);
+        _pendingRecords += pendingRecords;
+    } else {
+        _size += written;
+    }
+    if (sync) {
+        _averageRecordsPerCommit.updateAverage(pendingRecords);
+        _commits++;
+        _averageCommitTime.updateAverage(usecTimestampNow() - start);
+    }
+    return committed;
+}
+
+bool OctreeEditLog::beginCompaction() {
+    QMutexLocker fileLocker(&_fileMutex);
+    if (!commit()) {
+        return false;
+    }
+    close();
+
+    // if the last snapshot failed its edits are still set aside, and ours go after them
+    bool started;
+    if (QFile::exists(_compactingFilename)) {
+        started = appendFile(_filename, _compactingFilename) && QFile::remove(_filename);
+    } else {
+        started = QFile::rename(_filename, _compactingFilename);
+    }
+    if (!started) {
+        qDebug() << "ERROR setting aside edit log" << _filename << "for compaction";
+    }
+    _compactions++;
+    return open() && started;
+}
+
+void OctreeEditLog::endCompaction(bool snapshotSaved) {
+    if (snapshotSaved) {
+        QFile::remove(_compactingFilename);
+    } else {
+        qDebug() << "Keeping edit log" << _compactingFilename << "since its snapshot wasn't saved";
+    }
+}
+
+bool OctreeEditLog::appendFile(const QString& fromFilename, const QString& toFilename) {
+    QFile from(fromFilename);
+    QFile to(toFilename);
+    if (!from.open(QIODevice::ReadOnly) || !to.open(QIODevice::Append)) {
+        return false;
+    }
+    from.seek(EDIT_LOG_HEADER_SIZE);
+    QByteArray records = from.readAll();
+    return to.write(records) == records.size() && FileUtils::syncToDisk(to);
+}
+
+qint64 OctreeEditLog::getSize() {
+    QMutexLocker locker(&_mutex);
+    return _size + _pending.size();
+}
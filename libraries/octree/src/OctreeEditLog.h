@@ -0,0 +1,98 @@
+//
+//  OctreeEditLog.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEditLog_h
+#define hifi_OctreeEditLog_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include <PacketHeaders.h>
+#include <SimpleMovingAverage.h>
+
+class Octree;
+
+/// Append-only journal of the edits applied to an octree since its last saved snapshot, kept next to the persist file.
+/// Edits are queued as they are applied and written and synced to disk together on every commit, so a crash loses at
+/// most the edits since the last commit. Commits write and sync without holding up the edits being queued meanwhile. Compacting starts a new log and sets the old one aside until a snapshot that
+/// includes its edits has been saved. On startup the tree loads the snapshot and then replays what's left of the logs.
+///
+/// Records are whatever the tree hands to append() and are replayed through Octree::replayEditLogRecord(), so the tree
+/// decides what goes in them; they have to give the same result when replayed over a snapshot that already has them.
+class OctreeEditLog {
+public:
+    static const int DEFAULT_COMMIT_INTERVAL; // msecs
+    static const int DEFAULT_COMPACT_SIZE; // bytes
+
+    OctreeEditLog(const QString& persistFilename);
+    ~OctreeEditLog();
+
+    const QString& getFilename() const { return _filename; }
+
+    /// Replays the logs left by a previous run into the tree. The caller must hold the tree's write lock, and should
+    /// do this after loading the snapshot and before opening the log. Returns the number of edits replayed.
+    int replay(Octree* tree);
+
+    /// Opens the log for appending, creating it if needed.
+    bool open();
+    void close();
+
+    /// Queues an edit for the next commit. Call with the tree locked for edits, so edits are logged in the order they
+    /// were applied.
+    void append(PacketType packetType, const QByteArray& record);
+
+    /// Writes the queued edits and syncs them to disk.
+    bool commit();
+
+    /// Commits and starts a new log. Call with the tree locked for edits, right before saving a snapshot, so the old
+    /// log holds exactly the edits before the snapshot.
+    bool beginCompaction();
+
+    /// Drops the old log once the snapshot that includes its edits is saved. If the snapshot failed, the old log is
+    /// kept and the next compaction adds to it.
+    void endCompaction(bool snapshotSaved);
+
+    /// Bytes in the current log, including queued edits.
+    qint64 getSize();
+
+    quint64 getRecordsAppended() const { return _recordsAppended; }
+    quint64 getCommits() const { return _commits; }
+    quint64 getCompactions() const { return _compactions; }
+    quint64 getRecordsReplayed() const { return _recordsReplayed; }
+    float getAverageCommitTime() const { return _averageCommitTime.getAverage(); }
+    float getAverageRecordsPerCommit() const { return _averageRecordsPerCommit.getAverage(); }
+
+private:
+    int replayFile(const QString& filename, Octree* tree);
+    bool writePending(bool sync);
+    bool appendFile(const QString& fromFilename, const QString& toFilename);
+
+    QString _filename;
+    QString _compactingFilename;
+
+    QMutex _fileMutex; // held while writing, syncing, opening and compacting, so those happen one at a time
+    QFile _file;
+
+    QMutex _mutex; // guards the queued edits, the size and the stats
+    QByteArray _pending;
+    int _pendingRecords;
+    qint64 _size;
+
+    quint64 _recordsAppended;
+    quint64 _commits;
+    quint64 _compactions;
+    quint64 _recordsReplayed;
+    SimpleMovingAverage _averageCommitTime;
+    SimpleMovingAverage _averageRecordsPerCommit;
+};
+
+#endif // hifi_OctreeEditLog_h
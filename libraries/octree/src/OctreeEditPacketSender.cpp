@@ -378,10 +378,11 @@ void OctreeEditPacketSender::processNackPacket(const QByteArray& packet) {
         dataAt += sizeof(unsigned short int);
 
         // retrieve packet from history
-        const QByteArray* packet = sentPacketHistory.getPacket(sequenceNumber);
-        if (packet) {
+        QByteArray packet = sentPacketHistory.getPacket(sequenceNumber);
+        if (!packet.isNull()) {
+            // the history only lends us its slab, take a real copy since the packet sits in the send queue for a while
             const SharedNodePointer& node = NodeList::getInstance()->nodeWithUUID(sendingNodeUUID);
-            queuePacketForSending(node, *packet);
+            queuePacketForSending(node, QByteArray(packet.constData(), packet.size()));
         }
     }
 }
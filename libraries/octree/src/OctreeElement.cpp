@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <cmath>
 #include <cstring>
+#include <new>
 #include <stdio.h>
 
 #include <QtCore/QDebug>
@@ -26,6 +27,7 @@
 #include "OctalCode.h"
 #include "OctreeConstants.h"
 #include "OctreeElement.h"
+#include "OctreeElementPool.h"
 #include "Octree.h"
 #include "SharedUtil.h"
 
@@ -55,6 +57,7 @@ void OctreeElement::init(unsigned char * octalCode) {
     _voxelNodeLeafCount++; // all nodes start as leaf nodes
 
 
+    _octalKey = octalKeyForCode(octalCode);
     size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
         _octalCode.pointer = octalCode;
@@ -117,6 +120,32 @@ OctreeElement::~OctreeElement() {
     deleteAllChildren();
 }
 
+void* OctreeElement::operator new(size_t size, OctreeElementPool* pool) {
+    void* element = OctreeElementPool::allocateElement(pool, size);
+    if (!element) {
+        throw std::bad_alloc();
+    }
+    return element;
+}
+
+void OctreeElement::operator delete(void* element) {
+    OctreeElementPool::release(element);
+}
+
+// child arrays come from the same pool as the element they belong to
+OctreeElement** OctreeElement::allocateChildArray() {
+    void* childArray = OctreeElementPool::allocateChildArray(OctreeElementPool::poolOf(this));
+    if (!childArray) {
+        throw std::bad_alloc();
+    }
+    memset(childArray, 0, sizeof(OctreeElement*) * NUMBER_OF_CHILDREN);
+    return (OctreeElement**)childArray;
+}
+
+void OctreeElement::releaseChildArray(OctreeElement** childArray) {
+    OctreeElementPool::release(childArray);
+}
+
 void OctreeElement::markWithChangedTime() {
     _lastChanged = usecTimestampNow();
     notifyUpdateHooks(); // if the node has changed, notify our hooks
@@ -665,7 +694,11 @@ void OctreeElement::deleteAllChildren() {
     
     if (_childrenExternal) {
         // if the children_t union represents _children.external we need to delete it here
+#ifdef SIMPLE_EXTERNAL_CHILDREN
+        releaseChildArray(_children.external);
+#else
         delete[] _children.external;
+#endif
     }
 
 #ifdef BLENDED_UNION_CHILDREN
@@ -760,8 +793,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         _children.single = child;
     } else if (previousChildCount == 1 && newChildCount == 2) {
         OctreeElement* previousChild = _children.single;
-        _children.external = new OctreeElement*[NUMBER_OF_CHILDREN];
-        memset(_children.external, 0, sizeof(OctreeElement*) * NUMBER_OF_CHILDREN);
+        _children.external = allocateChildArray();
         _children.external[firstIndex] = previousChild;
         _children.external[childIndex] = child;
         
@@ -774,7 +806,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         OctreeElement* previousFirstChild = _children.external[firstIndex];
         OctreeElement* previousSecondChild = _children.external[secondIndex];
 
-        delete[] _children.external;
+        releaseChildArray(_children.external);
         _childrenExternal = false;
         
         _externalChildrenMemoryUsage -= NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
@@ -1227,6 +1259,19 @@ ViewFrustum::location OctreeElement::inFrustum(const ViewFrustum& viewFrustum) c
     return viewFrustum.cubeInFrustum(cube);
 }
 
+void OctreeElement::childrenInFrustum(const ViewFrustum& viewFrustum,
+                                      unsigned char& insideMask, unsigned char& intersectMask) const {
+    AACube cube = _cube; // use temporary cube so we can scale it
+    cube.scale(TREE_SCALE);
+    viewFrustum.childrenInFrustum(cube, insideMask, intersectMask);
+}
+
+void OctreeElement::childDistancesToCamera(const ViewFrustum& viewFrustum, float distances[NUMBER_OF_CHILDREN]) const {
+    AACube cube = _cube; // use temporary cube so we can scale it
+    cube.scale(TREE_SCALE);
+    viewFrustum.childDistancesToCamera(cube, distances);
+}
+
 // There are two types of nodes for which we want to "render"
 // 1) Leaves that are in the LOD
 // 2) Non-leaves are more complicated though... usually you don't want to render them, but if their children
@@ -31,6 +31,7 @@ class Octree;
 class OctreeElement;
 class OctreeElementBag;
 class OctreeElementDeleteHook;
+class OctreeElementPool;
 class OctreePacketData;
 class ReadBitstreamToTreeParams;
 class Shape;
@@ -61,6 +62,13 @@ public:
     virtual void init(unsigned char * octalCode); /// Your subclass must call init on construction.
     virtual ~OctreeElement();
 
+    /// Elements come from their tree's OctreeElementPool, create them with new (pool) YourElement(...) where pool is
+    /// the tree's pool or NULL. Plain new allocates from the heap, and delete works either way.
+    static void* operator new(size_t size) { return operator new(size, (OctreeElementPool*)NULL); }
+    static void* operator new(size_t size, OctreeElementPool* pool);
+    static void operator delete(void* element);
+    static void operator delete(void* element, OctreeElementPool* pool) { operator delete(element); }
+
     // methods you can and should override to implement your tree functionality
     
     /// Adds a child to the current element. Override this if there is additional child initialization your class needs.
@@ -99,6 +107,19 @@ public:
     virtual void updateEncodedData(int childIndex, AppendState childAppendState, EncodeBitstreamParams& params) const { }
     virtual void elementEncodeComplete(EncodeBitstreamParams& params, OctreeElementBag* bag) const { }
 
+    /// Used by the OctreeEncodeCache. Override to return false if what this element encodes for its children on this pass
+    /// could differ from what it encodes for another client, for example because some of it was already sent. Only
+    /// called on the element at the top of a shared subtree, so it should also look at the children's state for the pass.
+    virtual bool canShareEncodedChildren(EncodeBitstreamParams& params) const { return true; }
+
+    /// Used by the OctreeEncodeCache, which remembers the answer until this element or one below it is marked as changed.
+    /// Override to return false if what this element encodes could change without it being marked as changed.
+    virtual bool hasStableEncoding() const { return true; }
+
+    /// Called instead of encoding the subtree below this element when a shared encoding of it was used, so that any
+    /// extra encode data can be brought up to date as if the subtree had been encoded completely.
+    virtual void sharedSubtreeEncoded(EncodeBitstreamParams& params) const { }
+
     /// Override to serialize the state of this element. This is used for persistance and for transmission across the network.
     virtual AppendState appendElementData(OctreePacketData* packetData, EncodeBitstreamParams& params) const 
                                 { return COMPLETED; }
@@ -132,6 +153,9 @@ public:
 
     // Base class methods you don't need to implement
     const unsigned char* getOctalCode() const { return (_octcodePointer) ? _octalCode.pointer : &_octalCode.buffer[0]; }
+
+    /// The element's octal code as a Morton key, see OctalKey. INVALID_OCTAL_KEY for elements too deep to have one.
+    OctalKey getOctalKey() const { return _octalKey; }
     OctreeElement* getChildAtIndex(int childIndex) const;
     void deleteChildAtIndex(int childIndex);
     OctreeElement* removeChildAtIndex(int childIndex);
@@ -144,7 +168,8 @@ public:
     const AACube& getAACube() const { return _cube; }
     const glm::vec3& getCorner() const { return _cube.getCorner(); }
     float getScale() const { return _cube.getScale(); }
-    int getLevel() const { return numberOfThreeBitSectionsInCode(getOctalCode()) + 1; }
+    int getLevel() const { return (_octalKey != INVALID_OCTAL_KEY ? numberOfSectionsInOctalKey(_octalKey) :
+                                   numberOfThreeBitSectionsInCode(getOctalCode())) + 1; }
     
     float getEnclosingRadius() const;
     bool isInView(const ViewFrustum& viewFrustum) const { return inFrustum(viewFrustum) != ViewFrustum::OUTSIDE; }
@@ -152,6 +177,11 @@ public:
     float distanceToCamera(const ViewFrustum& viewFrustum) const; 
     float furthestDistanceToCamera(const ViewFrustum& viewFrustum) const;
 
+    /// inFrustum() and distanceToCamera() for all eight children at once, whether or not they exist. See
+    /// ViewFrustum::childrenInFrustum() for how the locations come back.
+    void childrenInFrustum(const ViewFrustum& viewFrustum, unsigned char& insideMask, unsigned char& intersectMask) const;
+    void childDistancesToCamera(const ViewFrustum& viewFrustum, float distances[NUMBER_OF_CHILDREN]) const;
+
     bool calculateShouldRender(const ViewFrustum* viewFrustum, 
                 float voxelSizeScale = DEFAULT_OCTREE_SIZE_SCALE, int boundaryLevelAdjust = 0) const;
     
@@ -258,6 +288,8 @@ protected:
 
     void deleteAllChildren();
     void setChildAtIndex(int childIndex, OctreeElement* child);
+    OctreeElement** allocateChildArray();
+    void releaseChildArray(OctreeElement** childArray);
 
 #ifdef BLENDED_UNION_CHILDREN
     void storeTwoChildren(OctreeElement* childOne, OctreeElement* childTwo);
@@ -280,6 +312,8 @@ protected:
       unsigned char* pointer;
     } _octalCode;  
 
+    OctalKey _octalKey; /// Client and server, the octal code as a key for integer compares, 8 bytes
+
     quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
 
     /// Client and server, pointers to child nodes, various encodings
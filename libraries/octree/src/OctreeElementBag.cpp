@@ -9,11 +9,24 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+
 #include "OctreeElementBag.h"
 #include <OctalCode.h>
 
+// how much an element right behind the camera counts next to the same element dead ahead
+const float BEHIND_VIEW_PRIORITY_SCALE = 0.1f;
+
+// past this many removed entries per element in the queue, it's cheaper to build it again
+const int MAX_QUEUE_ENTRIES_PER_ELEMENT = 2;
+const int MIN_QUEUE_ENTRIES_TO_REBUILD = 64;
+
 OctreeElementBag::OctreeElementBag() : 
-    _bagElements()
+    _bagElements(),
+    _queue(),
+    _hasPriorityView(false),
+    _viewPosition(),
+    _viewDirection()
 {
     OctreeElement::addDeleteHook(this);
     _hooked = true;
@@ -38,22 +51,34 @@ void OctreeElementBag::elementDeleted(OctreeElement* element) {
 
 void OctreeElementBag::deleteAll() {
     _bagElements.clear();
+    _queue.clear();
 }
 
 
 void OctreeElementBag::insert(OctreeElement* element) {
-    _bagElements.insert(element);
+    if (_bagElements.contains(element)) {
+        return;
+    }
+    Entry entry = { calculatePriority(element), element };
+    _bagElements.insert(element, entry.priority);
+    _queue << entry;
+    std::push_heap(_queue.begin(), _queue.end());
 }
 
 OctreeElement* OctreeElementBag::extract() {
-    OctreeElement* result = NULL;
+    while (!_queue.isEmpty()) {
+        std::pop_heap(_queue.begin(), _queue.end());
+        Entry entry = _queue.last();
+        _queue.pop_back();
 
-    if (_bagElements.size() > 0) {
-        QSet<OctreeElement*>::iterator front = _bagElements.begin();
-        result = *front;
-        _bagElements.erase(front);
+        // skip what was removed, or removed and inserted again since then with another priority
+        QHash<OctreeElement*, float>::iterator element = _bagElements.find(entry.element);
+        if (element != _bagElements.end() && element.value() == entry.priority) {
+            _bagElements.erase(element);
+            return entry.element;
+        }
     }
-    return result;
+    return NULL;
 }
 
 bool OctreeElementBag::contains(OctreeElement* element) {
@@ -61,5 +86,46 @@ bool OctreeElementBag::contains(OctreeElement* element) {
 }
 
 void OctreeElementBag::remove(OctreeElement* element) {
-    _bagElements.remove(element);
+    if (_bagElements.remove(element) > 0 && _queue.size() > MIN_QUEUE_ENTRIES_TO_REBUILD &&
+            _queue.size() > _bagElements.size() * MAX_QUEUE_ENTRIES_PER_ELEMENT) {
+        rebuildQueue();
+    }
+}
+
+void OctreeElementBag::setPriorityView(const ViewFrustum& viewFrustum) {
+    _hasPriorityView = true;
+    _viewPosition = viewFrustum.getPositionVoxelScale();
+    _viewDirection = viewFrustum.getDirection();
+    for (QHash<OctreeElement*, float>::iterator element = _bagElements.begin(); element != _bagElements.end(); ++element) {
+        element.value() = calculatePriority(element.key());
+    }
+    rebuildQueue();
+}
+
+// How big the element looks from the view, scaled down the further it is from the middle of the view, so what's in
+// front of the camera comes before what's beside or behind it
+float OctreeElementBag::calculatePriority(const OctreeElement* element) const {
+    if (!_hasPriorityView) {
+        return 0.0f;
+    }
+    glm::vec3 offset = element->getAACube().calcCenter() - _viewPosition;
+    float distance = glm::length(offset);
+    float radius = element->getEnclosingRadius();
+    if (distance <= radius) {
+        return 1.0f; // the camera is in it, nothing looks bigger
+    }
+    float facing = glm::dot(offset, _viewDirection) / distance;
+    float viewScale = BEHIND_VIEW_PRIORITY_SCALE + (1.0f - BEHIND_VIEW_PRIORITY_SCALE) * (1.0f + facing) / 2.0f;
+    return viewScale * radius / distance;
+}
+
+void OctreeElementBag::rebuildQueue() {
+    _queue.clear();
+    _queue.reserve(_bagElements.size());
+    for (QHash<OctreeElement*, float>::const_iterator element = _bagElements.constBegin();
+            element != _bagElements.constEnd(); ++element) {
+        Entry entry = { element.value(), element.key() };
+        _queue << entry;
+    }
+    std::make_heap(_queue.begin(), _queue.end());
 }
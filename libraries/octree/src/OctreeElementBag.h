@@ -7,7 +7,8 @@
 //
 //  This class is used by the Octree:encodeTreeBitstream() functions to store elements and element data that need to be sent.
 //  It's a generic bag style storage mechanism. But It has the property that you can't put the same element into the bag
-//  more than once (in other words, it de-dupes automatically).
+//  more than once (in other words, it de-dupes automatically). Once it's given a view, it hands out the elements that
+//  look biggest from that view first.
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -16,6 +17,9 @@
 #ifndef hifi_OctreeElementBag_h
 #define hifi_OctreeElementBag_h
 
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
 #include "OctreeElement.h"
 
 class OctreeElementBag : public OctreeElementDeleteHook {
@@ -25,19 +29,39 @@ public:
     ~OctreeElementBag();
     
     void insert(OctreeElement* element); // put a element into the bag
-    OctreeElement* extract(); // pull a element out of the bag (could come in any order)
+    OctreeElement* extract(); // pull a element out of the bag, the highest priority first
     bool contains(OctreeElement* element); // is this element in the bag?
     void remove(OctreeElement* element); // remove a specific element from the bag
     bool isEmpty() const { return _bagElements.isEmpty(); }
     int count() const { return _bagElements.size(); }
 
+    /// Ranks the elements by how big they look from the view, nearest and most in front of the camera first, and keeps
+    /// ranking the ones inserted after the same way. Call again when the view changes to re-rank what's in the bag.
+    /// Without a view the elements come out in no particular order.
+    void setPriorityView(const ViewFrustum& viewFrustum);
+
     void deleteAll();
     virtual void elementDeleted(OctreeElement* element);
 
     void unhookNotifications();
 
 private:
-    QSet<OctreeElement*> _bagElements;
+    class Entry {
+    public:
+        float priority;
+        OctreeElement* element;
+
+        bool operator<(const Entry& other) const { return priority < other.priority; }
+    };
+
+    float calculatePriority(const OctreeElement* element) const;
+    void rebuildQueue();
+
+    QHash<OctreeElement*, float> _bagElements; // the elements in the bag, and their priorities
+    QVector<Entry> _queue; // a max heap of priorities. Removed elements stay until they reach the top.
+    bool _hasPriorityView;
+    glm::vec3 _viewPosition; // in voxel scale
+    glm::vec3 _viewDirection;
     bool _hooked;
 };
 
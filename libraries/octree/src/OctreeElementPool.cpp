@@ -0,0 +1,180 @@
+//
+//  OctreeElementPool.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include "OctreeConstants.h"
+#include "OctreeElementPool.h"
+
+class OctreeElement;
+
+const int SLOTS_PER_SLAB = 256;
+
+// sits in front of every allocation, padded so what follows it is aligned for anything an element holds
+union SlotHeader {
+    struct {
+        OctreeElementPool* pool;
+        void* sizeClass;
+    } owner;
+    double alignment[2];
+};
+
+static SlotHeader* headerOf(const void* memory) {
+    return (SlotHeader*)memory - 1;
+}
+
+static void* allocateFromHeap(size_t size) {
+    SlotHeader* header = (SlotHeader*)malloc(sizeof(SlotHeader) + size);
+    if (!header) {
+        return NULL;
+    }
+    header->owner.pool = NULL;
+    header->owner.sizeClass = NULL;
+    return header + 1;
+}
+
+OctreeElementPool::OctreeElementPool(size_t elementSize) :
+    _mutex(),
+    _elements(),
+    _childArrays()
+{
+    _elements.slotSize = sizeof(SlotHeader) + elementSize;
+    _elements.freeList = NULL;
+    _elements.inUse = 0;
+    _childArrays.slotSize = sizeof(SlotHeader) + NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
+    _childArrays.freeList = NULL;
+    _childArrays.inUse = 0;
+}
+
+OctreeElementPool::~OctreeElementPool() {
+    QMutexLocker locker(&_mutex);
+    if (_elements.inUse > 0 || _childArrays.inUse > 0) {
+        // something outlived its tree, leak the slabs rather than pull the memory out from under it
+        qDebug() << "OctreeElementPool deleted with" << _elements.inUse << "elements and" << _childArrays.inUse
+            << "child arrays still in use";
+        return;
+    }
+    foreach (char* slab, _elements.slabs) {
+        free(slab);
+    }
+    foreach (char* slab, _childArrays.slabs) {
+        free(slab);
+    }
+}
+
+void* OctreeElementPool::allocateElement(OctreeElementPool* pool, size_t size) {
+    if (pool && sizeof(SlotHeader) + size <= pool->_elements.slotSize) {
+        QMutexLocker locker(&pool->_mutex);
+        return pool->allocate(pool->_elements);
+    }
+    return allocateFromHeap(size);
+}
+
+void* OctreeElementPool::allocateChildArray(OctreeElementPool* pool) {
+    if (pool) {
+        QMutexLocker locker(&pool->_mutex);
+        return pool->allocate(pool->_childArrays);
+    }
+    return allocateFromHeap(NUMBER_OF_CHILDREN * sizeof(OctreeElement*));
+}
+
+void OctreeElementPool::release(void* memory) {
+    if (!memory) {
+        return;
+    }
+    SlotHeader* header = headerOf(memory);
+    OctreeElementPool* pool = header->owner.pool;
+    if (!pool) {
+        free(header);
+        return;
+    }
+    QMutexLocker locker(&pool->_mutex);
+    SizeClass* sizeClass = (SizeClass*)header->owner.sizeClass;
+    *(void**)memory = sizeClass->freeList;
+    sizeClass->freeList = memory;
+    sizeClass->inUse--;
+}
+
+OctreeElementPool* OctreeElementPool::poolOf(const void* memory) {
+    return headerOf(memory)->owner.pool;
+}
+
+void* OctreeElementPool::allocate(SizeClass& sizeClass) {
+    if (!sizeClass.freeList) {
+        addSlab(sizeClass);
+        if (!sizeClass.freeList) {
+            return NULL;
+        }
+    }
+    void* memory = sizeClass.freeList;
+    sizeClass.freeList = *(void**)memory;
+    sizeClass.inUse++;
+    return memory;
+}
+
+void OctreeElementPool::addSlab(SizeClass& sizeClass) {
+    char* slab = (char*)malloc(sizeClass.slotSize * SLOTS_PER_SLAB);
+    if (!slab) {
+        return;
+    }
+    sizeClass.slabs << slab;
+
+    // the headers never change, so they're written once here, and free slots are chained through their first bytes.
+    // Slots are chained front to back so elements created one after another end up next to each other.
+    for (int i = SLOTS_PER_SLAB - 1; i >= 0; i--) {
+        SlotHeader* header = (SlotHeader*)(slab + i * sizeClass.slotSize);
+        header->owner.pool = this;
+        header->owner.sizeClass = &sizeClass;
+        void* memory = header + 1;
+        *(void**)memory = sizeClass.freeList;
+        sizeClass.freeList = memory;
+    }
+}
+
+void OctreeElementPool::releaseSlabsIfUnused() {
+    QMutexLocker locker(&_mutex);
+    if (_elements.inUse > 0 || _childArrays.inUse > 0) {
+        return;
+    }
+    foreach (char* slab, _elements.slabs) {
+        free(slab);
+    }
+    foreach (char* slab, _childArrays.slabs) {
+        free(slab);
+    }
+    _elements.slabs.clear();
+    _elements.freeList = NULL;
+    _childArrays.slabs.clear();
+    _childArrays.freeList = NULL;
+}
+
+int OctreeElementPool::getSlabCount() {
+    QMutexLocker locker(&_mutex);
+    return _elements.slabs.size() + _childArrays.slabs.size();
+}
+
+quint64 OctreeElementPool::getReservedBytes() {
+    QMutexLocker locker(&_mutex);
+    return (quint64)SLOTS_PER_SLAB * (_elements.slabs.size() * _elements.slotSize +
+                                      _childArrays.slabs.size() * _childArrays.slotSize);
+}
+
+quint64 OctreeElementPool::getElementsInUse() {
+    QMutexLocker locker(&_mutex);
+    return _elements.inUse;
+}
+
+quint64 OctreeElementPool::getChildArraysInUse() {
+    QMutexLocker locker(&_mutex);
+    return _childArrays.inUse;
+}
@@ -0,0 +1,67 @@
+//
+//  OctreeElementPool.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementPool_h
+#define hifi_OctreeElementPool_h
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+
+/// Per tree slab allocator for the tree's elements and their external child arrays. Memory is handed out from slabs of
+/// fixed size slots, so elements that are created together sit next to each other, and once a tree has deleted all of
+/// its elements the slabs are freed in one go instead of element by element.
+///
+/// Every slot is preceded by a small header naming the pool it came from, so memory is released without knowing which
+/// tree it belonged to, and memory that didn't come from a pool (no pool, or an element bigger than the pool's slots)
+/// is allocated from the heap with the same header.
+class OctreeElementPool {
+public:
+    OctreeElementPool(size_t elementSize);
+    ~OctreeElementPool();
+
+    /// Returns memory for an element of size bytes from the pool, or from the heap if pool is NULL.
+    static void* allocateElement(OctreeElementPool* pool, size_t size);
+
+    /// Returns memory for a NUMBER_OF_CHILDREN array of child pointers from the pool, or from the heap if pool is NULL.
+    static void* allocateChildArray(OctreeElementPool* pool);
+
+    /// Releases memory from either of the allocate methods, to its pool or to the heap.
+    static void release(void* memory);
+
+    /// The pool the memory came from, or NULL if it came from the heap.
+    static OctreeElementPool* poolOf(const void* memory);
+
+    /// Frees all the slabs if nothing allocated from them is still in use. Trees call this after erasing all their
+    /// elements.
+    void releaseSlabsIfUnused();
+
+    int getSlabCount();
+    quint64 getReservedBytes();
+    quint64 getElementsInUse();
+    quint64 getChildArraysInUse();
+
+private:
+    class SizeClass {
+    public:
+        size_t slotSize; // including the header
+        void* freeList;
+        QList<char*> slabs;
+        quint64 inUse;
+    };
+
+    void* allocate(SizeClass& sizeClass);
+    void addSlab(SizeClass& sizeClass);
+
+    QMutex _mutex;
+    SizeClass _elements;
+    SizeClass _childArrays;
+};
+
+#endif // hifi_OctreeElementPool_h
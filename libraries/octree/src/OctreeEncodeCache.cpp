@@ -0,0 +1,275 @@
+//
+//  OctreeEncodeCache.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QMutexLocker>
+
+#include <SharedUtil.h>
+
+#include "Octree.h"
+#include "OctreeEncodeCache.h"
+
+// keys are the element's octal key with the encode variant (color, exists bits) in the bottom 2 bits, so the key of an
+// element's parent is its own key shifted down a level
+const int MAX_CACHED_LEVEL = 20;
+const int ENCODE_VARIANT_BITS = 2;
+const int ENCODE_VARIANTS = 1 << ENCODE_VARIANT_BITS;
+
+// elements that encode differently without being marked as changed, like ones with entities being simulated, can settle
+// down without being marked either, so subtrees that weren't stable are looked at again after a while
+const quint64 UNSTABLE_SUBTREE_RECHECK_USECS = USECS_PER_SECOND;
+
+// subtree versions are kept for every element that had something below it change, so once there are this many we forget
+// them all, which looks to anyone holding one from before like everything changed
+const int MAX_SUBTREE_VERSIONS = 256 * 1024;
+
+static quint64 packKey(OctalKey octalKey, int variant) {
+    return (octalKey << ENCODE_VARIANT_BITS) | variant;
+}
+
+OctreeEncodeCache::OctreeEncodeCache(int maximumSize) :
+    _maximumSize(maximumSize),
+    _mutex(),
+    _entries(),
+    _leastRecentlyUsed(),
+    _subtreeStates(),
+    _subtreeVersions(),
+    _lastVersion(0),
+    _forgottenVersion(0),
+    _lastLRUKey(0),
+    _size(0),
+    _hits(0),
+    _misses(0),
+    _stores(0),
+    _invalidations(0),
+    _evictions(0),
+    _didntFit(0),
+    _bytesReused(0)
+{
+    OctreeElement::addUpdateHook(this);
+    OctreeElement::addDeleteHook(this);
+}
+
+OctreeEncodeCache::~OctreeEncodeCache() {
+    OctreeElement::removeUpdateHook(this);
+    OctreeElement::removeDeleteHook(this);
+}
+
+bool OctreeEncodeCache::paramsAllowSharing(const EncodeBitstreamParams& params,
+                                           const ViewFrustum::location& parentLocationThisView) {
+    return params.viewFrustum && parentLocationThisView == ViewFrustum::INSIDE && params.forceSendScene &&
+        !params.deltaViewFrustum && !params.wantOcclusionCulling && params.maxEncodeLevel == INT_MAX;
+}
+
+bool OctreeEncodeCache::isSubtreeShareable(OctreeElement* element, EncodeBitstreamParams& params) {
+    int level = element->getLevel();
+    if (level > MAX_CACHED_LEVEL) {
+        return false;
+    }
+    if (!element->canShareEncodedChildren(params)) {
+        return false;
+    }
+
+    // the element's own encoding was written by its parent, so only what's below it has to be stable
+    int maxLevel = level;
+    quint64 now = usecTimestampNow();
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* childElement = element->getChildAtIndex(i);
+        if (childElement) {
+            SubtreeState childState = getSubtreeState(childElement, level + 1, now);
+            if (!childState.stable) {
+                return false;
+            }
+            maxLevel = std::max(maxLevel, childState.maxLevel);
+        }
+    }
+
+    // every element below us is at least as close to the camera as our furthest corner, so if the deepest of them is
+    // within LOD from there, the whole subtree is encoded at full detail and the client's LOD settings don't matter
+    float furthestDistance = element->furthestDistanceToCamera(*params.viewFrustum);
+    return furthestDistance < boundaryDistanceForRenderLevel(maxLevel + params.boundaryLevelAdjust,
+                                                             params.octreeElementSizeScale);
+}
+
+OctreeEncodeCache::SubtreeState OctreeEncodeCache::getSubtreeState(OctreeElement* element, int level, quint64 now) {
+    // elements too deep to have a key aren't remembered, they're only looked at as part of the subtree above them
+    OctalKey octalKey = element->getOctalKey();
+    quint64 version = 0;
+    if (octalKey != INVALID_OCTAL_KEY) {
+        QMutexLocker locker(&_mutex);
+        version = versionFor(octalKey);
+        QHash<OctalKey, SubtreeState>::const_iterator known = _subtreeStates.constFind(octalKey);
+        if (known != _subtreeStates.constEnd() && known.value().element == element &&
+                (known.value().stable || now - known.value().checkedAt < UNSTABLE_SUBTREE_RECHECK_USECS)) {
+            return known.value();
+        }
+    }
+
+    SubtreeState state;
+    state.element = element;
+    state.stable = element->hasStableEncoding();
+    state.maxLevel = level;
+    state.checkedAt = now;
+    for (int i = 0; state.stable && i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* childElement = element->getChildAtIndex(i);
+        if (childElement) {
+            SubtreeState childState = getSubtreeState(childElement, level + 1, now);
+            state.stable = childState.stable;
+            state.maxLevel = std::max(state.maxLevel, childState.maxLevel);
+        }
+    }
+
+    if (octalKey != INVALID_OCTAL_KEY) {
+        QMutexLocker locker(&_mutex);
+        if (versionFor(octalKey) == version) { // otherwise something below us changed while we looked
+            _subtreeStates.insert(octalKey, state);
+        }
+    }
+    return state;
+}
+
+quint64 OctreeEncodeCache::keyFor(const OctreeElement* element, const EncodeBitstreamParams& params) {
+    int variant = (params.includeColor ? 2 : 0) + (params.includeExistsBits ? 1 : 0);
+    return packKey(element->getOctalKey(), variant);
+}
+
+bool OctreeEncodeCache::findSubtree(OctreeElement* element, const EncodeBitstreamParams& params, QByteArray& encoded) {
+    QMutexLocker locker(&_mutex);
+    QHash<quint64, Entry>::iterator entry = _entries.find(keyFor(element, params));
+    if (entry == _entries.end()) {
+        _misses++;
+        return false;
+    }
+    if (entry.value().element != element || entry.value().lastChanged != element->getLastChanged()) {
+        removeEntry(entry);
+        _misses++;
+        return false;
+    }
+    _leastRecentlyUsed.remove(entry.value().lruKey);
+    entry.value().lruKey = ++_lastLRUKey;
+    _leastRecentlyUsed.insert(entry.value().lruKey, entry.key());
+
+    encoded = entry.value().encoded;
+    _hits++;
+    _bytesReused += encoded.size();
+    return true;
+}
+
+quint64 OctreeEncodeCache::getSubtreeVersion(const OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
+    return versionFor(element->getOctalKey());
+}
+
+quint64 OctreeEncodeCache::versionFor(OctalKey octalKey) const {
+    return _subtreeVersions.value(octalKey, _forgottenVersion);
+}
+
+void OctreeEncodeCache::storeSubtree(OctreeElement* element, const EncodeBitstreamParams& params,
+                                     const unsigned char* data, int length, quint64 version) {
+    if (length <= 0 || length > _maximumSize) {
+        return;
+    }
+    QMutexLocker locker(&_mutex);
+    if (versionFor(element->getOctalKey()) != version) {
+        return; // the subtree changed while it was encoded
+    }
+    quint64 key = keyFor(element, params);
+    QHash<quint64, Entry>::iterator existing = _entries.find(key);
+    if (existing != _entries.end()) {
+        removeEntry(existing);
+    }
+    evictToSize(_maximumSize - length);
+
+    Entry entry;
+    entry.element = element;
+    entry.lastChanged = element->getLastChanged();
+    entry.encoded = QByteArray((const char*)data, length);
+    entry.lruKey = ++_lastLRUKey;
+    _entries.insert(key, entry);
+    _leastRecentlyUsed.insert(entry.lruKey, key);
+    _size += length;
+    _stores++;
+}
+
+void OctreeEncodeCache::subtreeDidntFit(int length) {
+    QMutexLocker locker(&_mutex);
+    _didntFit++;
+    _bytesReused -= length;
+}
+
+int OctreeEncodeCache::getEntryCount() {
+    QMutexLocker locker(&_mutex);
+    return _entries.size();
+}
+
+void OctreeEncodeCache::clear() {
+    QMutexLocker locker(&_mutex);
+    _entries.clear();
+    _leastRecentlyUsed.clear();
+    _subtreeStates.clear();
+    _subtreeVersions.clear();
+    _forgottenVersion = ++_lastVersion;
+    _size = 0;
+}
+
+void OctreeEncodeCache::elementUpdated(OctreeElement* element) {
+    invalidate(element);
+}
+
+void OctreeEncodeCache::elementDeleted(OctreeElement* element) {
+    invalidate(element);
+}
+
+void OctreeEncodeCache::invalidate(const OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
+    if (_subtreeVersions.size() >= MAX_SUBTREE_VERSIONS) {
+        _subtreeVersions.clear();
+        _forgottenVersion = _lastVersion + 1;
+    }
+    quint64 version = ++_lastVersion;
+
+    // a change anywhere in a subtree changes the encoding and state of every subtree that contains it, and since elements
+    // don't know their parents we find the ancestors by shifting our key up a level at a time
+    OctalKey octalKey = element->getOctalKey();
+    if (octalKey == INVALID_OCTAL_KEY) {
+        octalKey = ancestorOctalKeyForCode(element->getOctalCode(), MAX_CACHED_LEVEL - 1); // too deep to have a key
+    }
+    for (OctalKey ancestorKey = octalKey; ancestorKey >= ROOT_OCTAL_KEY; ancestorKey >>= BITS_IN_OCTAL) {
+        _subtreeVersions.insert(ancestorKey, version);
+        _subtreeStates.remove(ancestorKey);
+        for (int variant = 0; variant < ENCODE_VARIANTS; variant++) {
+            QHash<quint64, Entry>::iterator entry = _entries.find(packKey(ancestorKey, variant));
+            if (entry != _entries.end()) {
+                removeEntry(entry);
+                _invalidations++;
+            }
+        }
+    }
+}
+
+void OctreeEncodeCache::removeEntry(QHash<quint64, Entry>::iterator entry) {
+    _size -= entry.value().encoded.size();
+    _leastRecentlyUsed.remove(entry.value().lruKey);
+    _entries.erase(entry);
+}
+
+void OctreeEncodeCache::evictToSize(int maximumSize) {
+    while (_size > maximumSize && !_leastRecentlyUsed.isEmpty()) {
+        QMap<int, quint64>::iterator oldest = _leastRecentlyUsed.begin();
+        QHash<quint64, Entry>::iterator entry = _entries.find(oldest.value());
+        if (entry == _entries.end()) {
+            _leastRecentlyUsed.erase(oldest);
+            continue;
+        }
+        removeEntry(entry);
+        _evictions++;
+    }
+}
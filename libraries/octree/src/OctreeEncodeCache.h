@@ -0,0 +1,125 @@
+//
+//  OctreeEncodeCache.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEncodeCache_h
+#define hifi_OctreeEncodeCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+
+#include "OctreeElement.h"
+#include "ViewFrustum.h"
+
+class EncodeBitstreamParams;
+
+const int DEFAULT_ENCODE_CACHE_SIZE = 16 * 1024 * 1024; // bytes of encoded subtrees
+
+/// Encoded subtrees shared between the send threads of an octree server. When a subtree sits fully inside a client's
+/// view and fully inside its LOD, the bytes encodeTreeBitstreamRecursion() writes for it are the same for every client
+/// that asks for a full scene with the same color/exists bits settings, so the first client to encode it stores the
+/// bytes and everyone after just appends them. Entries are keyed by element position, level and encode variant, carry
+/// the element's last changed time, and are dropped along with all their ancestors when an element changes or goes away.
+class OctreeEncodeCache : public OctreeElementUpdateHook, public OctreeElementDeleteHook {
+public:
+    OctreeEncodeCache(int maximumSize = DEFAULT_ENCODE_CACHE_SIZE);
+    virtual ~OctreeEncodeCache();
+
+    /// Cheap check of the encode parameters; subtrees are only shared on full scene passes without delta sending or
+    /// occlusion culling, below a parent that is fully in view.
+    static bool paramsAllowSharing(const EncodeBitstreamParams& params, const ViewFrustum::location& parentLocationThisView);
+
+    /// Checks that the element is willing to share the encoding of its children for this pass, that nothing below it
+    /// encodes differently without being marked as changed, and that the whole subtree is within the client's LOD. What
+    /// the subtree below an element looks like is remembered until something in it changes, so this doesn't walk the
+    /// subtree once that's known. Must be called with the tree locked.
+    bool isSubtreeShareable(OctreeElement* element, EncodeBitstreamParams& params);
+
+    /// Looks up the encoded bytes for the subtree below the element. Returns false on a miss.
+    bool findSubtree(OctreeElement* element, const EncodeBitstreamParams& params, QByteArray& encoded);
+
+    /// Bumped whenever the element or anything below it is invalidated. Encoders take it before encoding a subtree and
+    /// hand it back to storeSubtree(), since on trees with versioned reads an edit can change the subtree while it's
+    /// being encoded.
+    quint64 getSubtreeVersion(const OctreeElement* element);
+
+    /// Stores the bytes a complete encode of the subtree below the element produced, unless something in the subtree was
+    /// invalidated since the encode started at the given version.
+    void storeSubtree(OctreeElement* element, const EncodeBitstreamParams& params, const unsigned char* data, int length,
+                      quint64 version);
+
+    /// Lets the cache know a hit could not be used because it didn't fit in the packet being built.
+    void subtreeDidntFit(int length);
+
+    void clear();
+
+    virtual void elementUpdated(OctreeElement* element);
+    virtual void elementDeleted(OctreeElement* element);
+
+    int getMaximumSize() const { return _maximumSize; }
+    int getSize() const { return _size; }
+    int getEntryCount();
+
+    quint64 getHits() const { return _hits; }
+    quint64 getMisses() const { return _misses; }
+    quint64 getStores() const { return _stores; }
+    quint64 getInvalidations() const { return _invalidations; }
+    quint64 getEvictions() const { return _evictions; }
+    quint64 getDidntFit() const { return _didntFit; }
+    quint64 getBytesReused() const { return _bytesReused; }
+
+private:
+    class Entry {
+    public:
+        const OctreeElement* element;
+        quint64 lastChanged;
+        QByteArray encoded;
+        int lruKey;
+    };
+
+    /// What's below an element and the element itself, independent of the pass
+    class SubtreeState {
+    public:
+        const OctreeElement* element;
+        bool stable;
+        int maxLevel;
+        quint64 checkedAt;
+    };
+
+    SubtreeState getSubtreeState(OctreeElement* element, int level, quint64 now);
+    quint64 versionFor(OctalKey octalKey) const;
+    static quint64 keyFor(const OctreeElement* element, const EncodeBitstreamParams& params);
+    void invalidate(const OctreeElement* element);
+    void removeEntry(QHash<quint64, Entry>::iterator entry);
+    void evictToSize(int maximumSize);
+
+    int _maximumSize;
+
+    QMutex _mutex;
+    QHash<quint64, Entry> _entries;
+    QMap<int, quint64> _leastRecentlyUsed;
+    QHash<OctalKey, SubtreeState> _subtreeStates;
+    QHash<OctalKey, quint64> _subtreeVersions;
+    quint64 _lastVersion;
+    quint64 _forgottenVersion;
+    int _lastLRUKey;
+    int _size;
+
+    quint64 _hits;
+    quint64 _misses;
+    quint64 _stores;
+    quint64 _invalidations;
+    quint64 _evictions;
+    quint64 _didntFit;
+    quint64 _bytesReused;
+};
+
+#endif // hifi_OctreeEncodeCache_h
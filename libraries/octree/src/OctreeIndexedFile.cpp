@@ -0,0 +1,282 @@
+//
+//  OctreeIndexedFile.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+
+#include <FileUtils.h>
+
+#include "Octree.h"
+#include "OctreeConstants.h"
+#include "OctreeIndexedFile.h"
+#include "ViewFrustum.h"
+
+// elements at level 4 are 1/8th of the tree on a side, so a tree is at most 512 chunks plus the top one
+const int OctreeIndexedFile::DEFAULT_CHUNK_LEVEL = 4;
+
+// the file starts with a magic number, format version and the chunk level, then the records of each chunk, each of them
+// its length, packet type and the record itself. The index and a footer with the index's offset come last, so the file
+// can be written in one pass.
+const char INDEXED_FILE_MAGIC[] = { 'H', 'F', 'O', 'I' };
+const quint8 INDEXED_FILE_VERSION = 1;
+const int INDEXED_FILE_HEADER_SIZE = sizeof(INDEXED_FILE_MAGIC) + sizeof(INDEXED_FILE_VERSION) + sizeof(quint8);
+const int INDEXED_FILE_FOOTER_SIZE = sizeof(quint32) + sizeof(quint64) + sizeof(INDEXED_FILE_MAGIC);
+const int INDEX_ENTRY_SIZE = 4 * sizeof(float) + sizeof(quint64) + 2 * sizeof(quint32) + sizeof(quint16);
+const int RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(quint8);
+
+template<typename T> static void appendValue(QByteArray& buffer, const T& value) {
+    buffer.append((const char*)&value, sizeof(value));
+}
+
+template<typename T> static const uchar* readValue(const uchar* dataAt, T& value) {
+    memcpy(&value, dataAt, sizeof(value));
+    return dataAt + sizeof(value);
+}
+
+class IndexedChunk {
+public:
+    AACube cube;
+    QList<OctreeEditRecord> records;
+};
+
+/// Walks the tree depth first, so everything below an element at the chunk level goes into that element's chunk
+class GatherChunksOperator : public RecurseOctreeOperator {
+public:
+    GatherChunksOperator(Octree* tree, int chunkLevel) :
+        _tree(tree),
+        _chunkLevel(chunkLevel),
+        _chunks()
+    {
+        IndexedChunk topChunk;
+        topChunk.cube = AACube(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f);
+        _chunks << topChunk;
+    }
+
+    virtual bool preRecursion(OctreeElement* element) {
+        int level = element->getLevel();
+        if (level == _chunkLevel) {
+            IndexedChunk chunk;
+            chunk.cube = element->getAACube();
+            _chunks << chunk;
+        }
+        _tree->appendElementEditRecords(element, level < _chunkLevel ? _chunks.first().records : _chunks.last().records);
+        return true;
+    }
+
+    virtual bool postRecursion(OctreeElement* element) {
+        // chunks with nothing in them don't need to be in the file
+        if (element->getLevel() == _chunkLevel && _chunks.last().records.isEmpty()) {
+            _chunks.removeLast();
+        }
+        return true;
+    }
+
+    const QList<IndexedChunk>& getChunks() const { return _chunks; }
+
+private:
+    Octree* _tree;
+    int _chunkLevel;
+    QList<IndexedChunk> _chunks;
+};
+
+bool OctreeIndexedFile::isIndexedFile(const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray magic = file.read(sizeof(INDEXED_FILE_MAGIC));
+    return magic.size() == sizeof(INDEXED_FILE_MAGIC) &&
+        memcmp(magic.constData(), INDEXED_FILE_MAGIC, sizeof(INDEXED_FILE_MAGIC)) == 0;
+}
+
+bool OctreeIndexedFile::write(Octree* tree, const QString& fileName, int chunkLevel) {
+    if (!tree->canWriteEditRecords()) {
+        qDebug() << "ERROR this tree can't be saved to the indexed file" << fileName;
+        return false;
+    }
+    qDebug() << "Saving to indexed file" << fileName << "...";
+
+    GatherChunksOperator theOperator(tree, chunkLevel);
+    tree->lockForRead();
+    tree->recurseTreeWithOperator(&theOperator);
+    tree->unlock();
+
+    QByteArray fileContents;
+    fileContents.append(INDEXED_FILE_MAGIC, sizeof(INDEXED_FILE_MAGIC));
+    appendValue(fileContents, INDEXED_FILE_VERSION);
+    appendValue(fileContents, (quint8)chunkLevel);
+
+    QByteArray index;
+    const QList<IndexedChunk>& chunks = theOperator.getChunks();
+    foreach (const IndexedChunk& chunk, chunks) {
+        quint64 offset = fileContents.size();
+        foreach (const OctreeEditRecord& record, chunk.records) {
+            appendValue(fileContents, (quint32)record.data.size());
+            appendValue(fileContents, (quint8)record.packetType);
+            fileContents.append(record.data);
+        }
+        quint32 length = fileContents.size() - offset;
+
+        appendValue(index, chunk.cube.getCorner().x);
+        appendValue(index, chunk.cube.getCorner().y);
+        appendValue(index, chunk.cube.getCorner().z);
+        appendValue(index, chunk.cube.getScale());
+        appendValue(index, offset);
+        appendValue(index, length);
+        appendValue(index, (quint32)chunk.records.size());
+        appendValue(index, qChecksum(fileContents.constData() + offset, length));
+    }
+
+    quint64 indexOffset = fileContents.size();
+    fileContents.append(index);
+    appendValue(fileContents, (quint32)chunks.size());
+    appendValue(fileContents, indexOffset);
+    fileContents.append(INDEXED_FILE_MAGIC, sizeof(INDEXED_FILE_MAGIC));
+
+    qDebug() << "    " << chunks.size() << "chunks," << fileContents.size() << "bytes";
+    return FileUtils::saveFileAtomically(fileName, fileContents);
+}
+
+OctreeIndexedFile::OctreeIndexedFile(const QString& fileName) :
+    _fileName(fileName),
+    _file(fileName),
+    _data(NULL),
+    _size(0),
+    _contents(),
+    _chunks(),
+    _chunksLoaded(0)
+{
+}
+
+OctreeIndexedFile::~OctreeIndexedFile() {
+    close();
+}
+
+bool OctreeIndexedFile::open() {
+    if (isOpen()) {
+        return true;
+    }
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "ERROR opening indexed file" << _fileName << ":" << _file.errorString();
+        return false;
+    }
+    _size = _file.size();
+    _data = _file.map(0, _size);
+    if (!_data) {
+        _contents = _file.readAll();
+        _data = (const uchar*)_contents.constData();
+        _size = _contents.size();
+    }
+
+    if (_size < INDEXED_FILE_HEADER_SIZE + INDEXED_FILE_FOOTER_SIZE ||
+            memcmp(_data, INDEXED_FILE_MAGIC, sizeof(INDEXED_FILE_MAGIC)) != 0 ||
+            _data[sizeof(INDEXED_FILE_MAGIC)] != INDEXED_FILE_VERSION ||
+            memcmp(_data + _size - sizeof(INDEXED_FILE_MAGIC), INDEXED_FILE_MAGIC, sizeof(INDEXED_FILE_MAGIC)) != 0) {
+        qDebug() << "ERROR indexed file" << _fileName << "has an unknown format or was cut short";
+        close();
+        return false;
+    }
+
+    quint32 chunkCount;
+    quint64 indexOffset;
+    const uchar* footer = readValue(_data + _size - INDEXED_FILE_FOOTER_SIZE, chunkCount);
+    readValue(footer, indexOffset);
+    if (indexOffset + (quint64)chunkCount * INDEX_ENTRY_SIZE != (quint64)(_size - INDEXED_FILE_FOOTER_SIZE)) {
+        qDebug() << "ERROR indexed file" << _fileName << "has a damaged index";
+        close();
+        return false;
+    }
+
+    _chunks.resize(chunkCount);
+    const uchar* entryAt = _data + indexOffset;
+    for (quint32 i = 0; i < chunkCount; i++) {
+        Chunk& chunk = _chunks[i];
+        glm::vec3 corner;
+        float scale;
+        entryAt = readValue(entryAt, corner.x);
+        entryAt = readValue(entryAt, corner.y);
+        entryAt = readValue(entryAt, corner.z);
+        entryAt = readValue(entryAt, scale);
+        entryAt = readValue(entryAt, chunk.offset);
+        entryAt = readValue(entryAt, chunk.length);
+        entryAt = readValue(entryAt, chunk.recordCount);
+        entryAt = readValue(entryAt, chunk.checksum);
+        chunk.cube = AACube(corner, scale);
+        chunk.loaded = chunk.offset + chunk.length > indexOffset; // nothing to load from a chunk outside the file
+        if (chunk.loaded) {
+            qDebug() << "ERROR indexed file" << _fileName << "chunk" << i << "is outside the file, skipping it";
+            _chunksLoaded++;
+        }
+    }
+    qDebug() << "Opened indexed file" << _fileName << "with" << chunkCount << "chunks";
+    return true;
+}
+
+void OctreeIndexedFile::close() {
+    if (_file.isOpen()) {
+        if (_contents.isEmpty() && _data) {
+            _file.unmap(const_cast<uchar*>(_data));
+        }
+        _file.close();
+    }
+    _contents.clear();
+    _data = NULL;
+    _size = 0;
+}
+
+int OctreeIndexedFile::findChunkToLoad(const ViewFrustum* viewFrustum) const {
+    for (int i = 0; i < _chunks.size(); i++) {
+        if (_chunks[i].loaded) {
+            continue;
+        }
+        if (!viewFrustum) {
+            return i;
+        }
+        AACube cube = _chunks[i].cube;
+        cube.scale(TREE_SCALE);
+        if (viewFrustum->cubeInFrustum(cube) != ViewFrustum::OUTSIDE) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int OctreeIndexedFile::loadChunk(int chunkIndex, Octree* tree) {
+    Chunk& chunk = _chunks[chunkIndex];
+    if (chunk.loaded || !isOpen()) {
+        return 0;
+    }
+    chunk.loaded = true;
+    _chunksLoaded++;
+
+    const uchar* dataAt = _data + chunk.offset;
+    if (qChecksum((const char*)dataAt, chunk.length) != chunk.checksum) {
+        qDebug() << "ERROR indexed file" << _fileName << "chunk" << chunkIndex << "is damaged, skipping it";
+        return 0;
+    }
+
+    int replayed = 0;
+    quint32 bytesLeft = chunk.length;
+    for (quint32 i = 0; i < chunk.recordCount && bytesLeft >= (quint32)RECORD_HEADER_SIZE; i++) {
+        quint32 length;
+        quint8 packetType;
+        dataAt = readValue(dataAt, length);
+        dataAt = readValue(dataAt, packetType);
+        bytesLeft -= RECORD_HEADER_SIZE;
+        if (length > bytesLeft) {
+            break;
+        }
+        if (tree->replayEditLogRecord((PacketType)packetType, dataAt, length)) {
+            replayed++;
+        }
+        dataAt += length;
+        bytesLeft -= length;
+    }
+    return replayed;
+}
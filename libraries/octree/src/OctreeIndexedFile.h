@@ -0,0 +1,86 @@
+//
+//  OctreeIndexedFile.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeIndexedFile_h
+#define hifi_OctreeIndexedFile_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <AACube.h>
+
+class Octree;
+class ViewFrustum;
+
+/// Persist format that can be loaded a piece at a time. The tree is saved as the edit records of its elements (see
+/// Octree::appendElementEditRecords()), grouped into chunks: one for the elements above the chunk level, then one for
+/// each element at the chunk level along with everything below it. An index of where each chunk is and what cube of
+/// the tree it covers is written at the end of the file, so a server can map the file, load the top chunk, and start
+/// serving while it loads the chunks its clients are looking at first and the rest in the background.
+///
+/// Not thread safe, the persist thread that owns it loads chunks one at a time.
+class OctreeIndexedFile {
+public:
+    static const int DEFAULT_CHUNK_LEVEL;
+
+    /// True if the file at fileName is in this format rather than an SVO file.
+    static bool isIndexedFile(const QString& fileName);
+
+    /// Saves the whole tree, which must be able to write edit records. Takes the tree's read lock while it gathers the
+    /// records and then replaces the file the same way Octree::writeToSVOFile() does.
+    static bool write(Octree* tree, const QString& fileName, int chunkLevel = DEFAULT_CHUNK_LEVEL);
+
+    OctreeIndexedFile(const QString& fileName);
+    ~OctreeIndexedFile();
+
+    /// Maps the file and reads its index.
+    bool open();
+    void close();
+    bool isOpen() const { return _data != NULL; }
+
+    int getChunkCount() const { return _chunks.size(); }
+    int getChunksLoaded() const { return _chunksLoaded; }
+    bool isChunkLoaded(int chunkIndex) const { return _chunks[chunkIndex].loaded; }
+    bool isFullyLoaded() const { return _chunksLoaded == _chunks.size(); }
+
+    /// Cube covered by the chunk, in tree units. The top chunk covers the whole tree.
+    const AACube& getChunkCube(int chunkIndex) const { return _chunks[chunkIndex].cube; }
+
+    /// Returns the first chunk that isn't loaded yet and is in view, or any chunk that isn't loaded if viewFrustum is
+    /// NULL. Returns -1 if there isn't one.
+    int findChunkToLoad(const ViewFrustum* viewFrustum) const;
+
+    /// Replays the chunk's records into the tree, which the caller must have locked for writing. Chunks that fail their
+    /// checksum are skipped and count as loaded. Returns the number of records replayed.
+    int loadChunk(int chunkIndex, Octree* tree);
+
+private:
+    class Chunk {
+    public:
+        AACube cube;
+        quint64 offset;
+        quint32 length;
+        quint32 recordCount;
+        quint16 checksum;
+        bool loaded;
+    };
+
+    QString _fileName;
+    QFile _file;
+    const uchar* _data;
+    qint64 _size;
+    QByteArray _contents; // used where the file can't be mapped
+    QVector<Chunk> _chunks;
+    int _chunksLoaded;
+};
+
+#endif // hifi_OctreeIndexedFile_h
@@ -13,7 +13,9 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QMutexLocker>
 
+#include <FileUtils.h>
 #include <PerfStat.h>
 #include <SharedUtil.h>
 
@@ -24,6 +26,8 @@ const int OctreePersistThread::DEFAULT_BACKUP_INTERVAL = 1000 * 60 * 30; // ever
 const QString OctreePersistThread::DEFAULT_BACKUP_EXTENSION_FORMAT(".backup.%N");
 const int OctreePersistThread::DEFAULT_MAX_BACKUP_VERSIONS = 5;
 
+const int MAX_HYDRATION_VIEWS = 16;
+
 
 OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval, 
                                                 bool wantBackup, int backupInterval, const QString& backupExtensionFormat,
@@ -40,32 +44,69 @@ OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename,
     _lastBackup(0),
     _wantBackup(wantBackup),
     _debugTimestampNow(debugTimestampNow),
-    _lastTimeDebug(0)
+    _lastTimeDebug(0),
+    _editLog(NULL),
+    _editLogCommitInterval(OctreeEditLog::DEFAULT_COMMIT_INTERVAL),
+    _editLogCompactSize(OctreeEditLog::DEFAULT_COMPACT_SIZE),
+    _lastEditLogCommit(0),
+    _wantIndexedFile(false),
+    _fullyLoaded(false),
+    _hydrationStarted(0),
+    _hydrationTimeUSecs(0),
+    _indexedFile(NULL),
+    _hydrationMutex(),
+    _hydrationViews()
 {
 }
 
+OctreePersistThread::~OctreePersistThread() {
+    // our owner deletes the tree before us, so we don't clear its pointer to the log
+    delete _editLog;
+    delete _indexedFile;
+}
+
+void OctreePersistThread::enableEditLog(int commitInterval, int compactSize) {
+    if (!_editLog) {
+        _editLog = new OctreeEditLog(_filename);
+    }
+    _editLogCommitInterval = commitInterval;
+    _editLogCompactSize = compactSize;
+}
+
 bool OctreePersistThread::process() {
 
     if (!_initialLoadComplete) {
         quint64 loadStarted = usecTimestampNow();
         qDebug() << "loading Octrees from file: " << _filename << "...";
 
-        bool persistantFileRead;
+        bool persistantFileRead = beginHydration();
+        if (!persistantFileRead) {
+            int editsReplayed = 0;
+
+            _tree->lockForWrite();
+            {
+                PerformanceWarning warn(true, "Loading Octree File", true);
+                persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
+                if (_editLog) {
+                    // bring the snapshot up to date with the edits since it was saved
+                    editsReplayed = _editLog->replay(_tree);
+                }
+                _tree->pruneTree();
+            }
+            _tree->unlock();
 
-        _tree->lockForWrite();
-        {
-            PerformanceWarning warn(true, "Loading Octree File", true);
-            persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
-            _tree->pruneTree();
+            loadEditLog(editsReplayed);
+            if (persistantFileRead && _wantIndexedFile && _tree->canWriteEditRecords()) {
+                _tree->setDirtyBit(); // so the next save is in the format we want
+            }
+            _fullyLoaded = true;
+            qDebug("DONE loading Octrees from file... fileRead=%s editsReplayed=%d", debug::valueOf(persistantFileRead),
+                   editsReplayed);
         }
-        _tree->unlock();
 
         quint64 loadDone = usecTimestampNow();
         _loadTimeUSecs = loadDone - loadStarted;
 
-        _tree->clearDirtyBit(); // the tree is clean since we just loaded it
-        qDebug("DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
-
         unsigned long nodeCount = OctreeElement::getNodeCount();
         unsigned long internalNodeCount = OctreeElement::getInternalNodeCount();
         unsigned long leafNodeCount = OctreeElement::getLeafNodeCount();
@@ -94,12 +135,23 @@ bool OctreePersistThread::process() {
     if (isStillRunning()) {
         quint64 MSECS_TO_USECS = 1000;
         quint64 USECS_TO_SLEEP = 10 * MSECS_TO_USECS; // every 10ms
-        usleep(USECS_TO_SLEEP);
+        if (_fullyLoaded) {
+            usleep(USECS_TO_SLEEP);
+        } else {
+            hydrateNextChunk(); // in place of sleeping, until the whole tree is loaded
+        }
 
         // do our updates then check to save...
         _tree->update();
 
         quint64 now = usecTimestampNow();
+
+        // group commit the edits logged since the last time around
+        if (_editLog && now - _lastEditLogCommit > _editLogCommitInterval * MSECS_TO_USECS) {
+            _lastEditLogCommit = now;
+            _editLog->commit();
+        }
+
         quint64 sinceLastSave = now - _lastCheck;
         quint64 intervalToCheck = _persistInterval * MSECS_TO_USECS;
 
@@ -124,14 +176,166 @@ bool OctreePersistThread::process() {
 }
 
 
+bool OctreePersistThread::beginHydration() {
+    if (!OctreeIndexedFile::isIndexedFile(_filename)) {
+        return false;
+    }
+    _indexedFile = new OctreeIndexedFile(_filename);
+    if (!_indexedFile->open()) {
+        delete _indexedFile;
+        _indexedFile = NULL;
+        return false;
+    }
+
+    // the top of the tree is enough to start serving, the chunks below it are loaded as clients look at them
+    QMutexLocker locker(&_hydrationMutex);
+    _hydrationStarted = usecTimestampNow();
+    _tree->lockForWrite();
+    if (_indexedFile->getChunkCount() > 0) {
+        _indexedFile->loadChunk(0, _tree);
+    }
+    _tree->unlock();
+    qDebug() << "Loaded the top of the tree from indexed file" << _filename << ", loading"
+        << _indexedFile->getChunkCount() - _indexedFile->getChunksLoaded() << "more chunks in the background...";
+
+    if (_indexedFile->isFullyLoaded()) {
+        endHydration();
+    }
+    return true;
+}
+
+void OctreePersistThread::hydrateView(const ViewFrustum& viewFrustum) {
+    QMutexLocker locker(&_hydrationMutex);
+    if (_fullyLoaded) {
+        return;
+    }
+    if (_hydrationViews.size() >= MAX_HYDRATION_VIEWS) {
+        _hydrationViews.removeFirst();
+    }
+    _hydrationViews << viewFrustum;
+}
+
+void OctreePersistThread::finishLoading() {
+    if (_fullyLoaded) {
+        return;
+    }
+    PerformanceWarning warn(true, "Waiting for the rest of the Octree to load", true);
+    while (!_fullyLoaded) {
+        hydrateNextChunk();
+    }
+}
+
+void OctreePersistThread::hydrateNextChunk() {
+    QMutexLocker locker(&_hydrationMutex);
+    if (_fullyLoaded) {
+        return;
+    }
+
+    // chunks someone is looking at come first, and views are dropped once everything in them is loaded
+    int chunkIndex = -1;
+    while (chunkIndex < 0 && !_hydrationViews.isEmpty()) {
+        chunkIndex = _indexedFile->findChunkToLoad(&_hydrationViews.first());
+        if (chunkIndex < 0) {
+            _hydrationViews.removeFirst();
+        }
+    }
+    if (chunkIndex < 0) {
+        chunkIndex = _indexedFile->findChunkToLoad(NULL);
+    }
+    if (chunkIndex >= 0) {
+        _tree->lockForWrite();
+        _indexedFile->loadChunk(chunkIndex, _tree);
+        _tree->unlock();
+    }
+
+    if (_indexedFile->isFullyLoaded()) {
+        endHydration();
+    }
+}
+
+// called with the hydration mutex locked, once the last chunk is loaded
+void OctreePersistThread::endHydration() {
+    int chunkCount = _indexedFile->getChunkCount();
+    delete _indexedFile;
+    _indexedFile = NULL;
+    _hydrationViews.clear();
+
+    int editsReplayed = 0;
+    _tree->lockForWrite();
+    if (_editLog) {
+        editsReplayed = _editLog->replay(_tree);
+    }
+    _tree->pruneTree();
+    _tree->unlock();
+
+    loadEditLog(editsReplayed);
+    if (!_wantIndexedFile) {
+        _tree->setDirtyBit(); // so the next save is in the format we want
+    }
+    _hydrationTimeUSecs = usecTimestampNow() - _hydrationStarted;
+    _fullyLoaded = true;
+    qDebug("DONE loading Octrees from indexed file... chunks=%d editsReplayed=%d in %llu usecs", chunkCount,
+           editsReplayed, _hydrationTimeUSecs);
+}
+
+void OctreePersistThread::loadEditLog(int editsReplayed) {
+    if (_editLog) {
+        _editLog->open();
+        _tree->setEditLog(_editLog);
+        _lastEditLogCommit = usecTimestampNow();
+    }
+
+    _tree->clearDirtyBit(); // the tree is clean since we just loaded it
+    if (editsReplayed > 0) {
+        _tree->setDirtyBit(); // unless the logs had edits that aren't in the snapshot yet
+    }
+}
+
 void OctreePersistThread::aboutToFinish() {
     qDebug() << "Persist thread about to finish...";
-    persist();
+    if (!_fullyLoaded) {
+        qDebug() << "Persist thread never finished loading, leaving the persist file as it is...";
+        return;
+    }
+    if (_editLog) {
+        // our edits are safe in the log, but fold it into the snapshot so the next start doesn't have to replay it
+        _editLog->commit();
+        saveSnapshot();
+    } else {
+        persist();
+    }
     qDebug() << "Persist thread done with about to finish...";
 }
 
 void OctreePersistThread::persist() {
+    if (!_fullyLoaded) {
+        return; // a save now would drop whatever isn't loaded yet
+    }
+    if (_editLog) {
+        // edits are persisted as they are committed to the log, so we only need a new snapshot once replaying the log
+        // on startup would take a while, or to save the changes that don't go in the log
+        _editLog->commit();
+        if (_editLog->getSize() < _editLogCompactSize) {
+            if (!_tree->hasUnloggedChanges()) {
+                return;
+            }
+        } else {
+            qDebug() << "Edit log" << _editLog->getFilename() << "is" << _editLog->getSize() << "bytes, compacting...";
+            _tree->setDirtyBit();
+        }
+    }
+    saveSnapshot();
+}
+
+void OctreePersistThread::saveSnapshot() {
     if (_tree->isDirty()) {
+        if (_editLog) {
+            // keep out edits while we switch logs, so the old log has exactly the edits before the snapshot
+            _tree->lockForEdit();
+            _editLog->beginCompaction();
+            _tree->unlockForEdit();
+        }
+
         _tree->lockForWrite();
         {
             qDebug() << "pruning Octree before saving...";
@@ -142,11 +346,28 @@ void OctreePersistThread::persist() {
 
         backup(); // handle backup if requested        
 
+        // clear the dirty bit before we look at the tree, so edits made while we save get saved next time
         qDebug() << "saving Octree to file " << _filename << "...";
-        _tree->writeToSVOFile(qPrintable(_filename));
-        time(&_lastPersistTime);
-        _tree->clearDirtyBit(); // tree is clean after saving
-        qDebug() << "DONE saving Octree to file...";
+        _tree->clearDirtyBit();
+        _tree->clearUnloggedChanges();
+        bool saved;
+        if (_wantIndexedFile && _tree->canWriteEditRecords()) {
+            saved = OctreeIndexedFile::write(_tree, _filename);
+        } else {
+            saved = _tree->writeToSVOFile(qPrintable(_filename));
+        }
+        if (saved) {
+            time(&_lastPersistTime);
+            qDebug() << "DONE saving Octree to file...";
+        } else {
+            _tree->setDirtyBit(); // try again next time, the last good save is still there
+            _tree->setUnloggedChanges();
+            qDebug() << "FAILED saving Octree to file...";
+        }
+
+        if (_editLog) {
+            _editLog->endCompaction(saved);
+        }
     }
 }
 
@@ -209,9 +430,11 @@ void OctreePersistThread::backup() {
             }
 
 
+            // the persist file is replaced rather than rewritten when we save, so a hard link keeps what's in it now
             qDebug() << "backing up persist file " << _filename << "to" << backupFileName << "...";
-            int result = rename(qPrintable(_filename), qPrintable(backupFileName));
-            if (result == 0) {
+            if (!QFile::exists(_filename)) {
+                qDebug() << "No persist file to back up yet...";
+            } else if (FileUtils::hardLinkFile(_filename, backupFileName)) {
                 qDebug() << "DONE backing up persist file...";
             } else {
                 qDebug() << "ERROR in backing up persist file...";
@@ -14,9 +14,14 @@
 #ifndef hifi_OctreePersistThread_h
 #define hifi_OctreePersistThread_h
 
+#include <QList>
+#include <QMutex>
 #include <QString>
 #include <GenericThread.h>
 #include "Octree.h"
+#include "OctreeEditLog.h"
+#include "OctreeIndexedFile.h"
+#include "ViewFrustum.h"
 
 /// Generalized threaded processor for handling received inbound packets.
 class OctreePersistThread : public GenericThread {
@@ -32,9 +37,30 @@ public:
                                 const QString& backupExtensionFormat = DEFAULT_BACKUP_EXTENSION_FORMAT,
                                 int maxBackupVersions = DEFAULT_MAX_BACKUP_VERSIONS,
                                 bool debugTimestampNow = false);
+    ~OctreePersistThread();
 
+    /// Persists edits through an edit log committed every commitInterval msecs, and only saves the whole tree once the
+    /// log grows past compactSize bytes. Call before the thread starts.
+    void enableEditLog(int commitInterval = OctreeEditLog::DEFAULT_COMMIT_INTERVAL,
+                       int compactSize = OctreeEditLog::DEFAULT_COMPACT_SIZE);
+    OctreeEditLog* getEditLog() const { return _editLog; }
+
+    /// Saves in the indexed format (see OctreeIndexedFile) when the tree supports it. Files in either format are loaded
+    /// no matter what. Call before the thread starts.
+    void setWantIndexedFile(bool wantIndexedFile) { _wantIndexedFile = wantIndexedFile; }
+
+    /// When loading an indexed file the initial load is complete once the top of the tree is loaded, and the rest of it
+    /// is loaded in the background. Until then edits have to wait for finishLoading().
     bool isInitialLoadComplete() const { return _initialLoadComplete; }
+    bool isFullyLoaded() const { return _fullyLoaded; }
     quint64 getLoadElapsedTime() const { return _loadTimeUSecs; }
+    quint64 getHydrationElapsedTime() const { return _hydrationTimeUSecs; }
+
+    /// Asks for the parts of the tree in this view to be loaded before the rest. Safe to call from any thread.
+    void hydrateView(const ViewFrustum& viewFrustum);
+
+    /// Loads the rest of the tree before returning. Safe to call from any thread that doesn't have the tree locked.
+    void finishLoading();
 
     void aboutToFinish(); /// call this to inform the persist thread that the owner is about to finish to support final persist
 
@@ -46,8 +72,14 @@ protected:
     virtual bool process();
     
     void persist();
+    void saveSnapshot();
     void backup();
     void rollOldBackupVersions();
+
+    bool beginHydration();
+    void hydrateNextChunk();
+    void endHydration();
+    void loadEditLog(int editsReplayed);
 private:
     Octree* _tree;
     QString _filename;
@@ -65,6 +97,19 @@ private:
     
     bool _debugTimestampNow;
     quint64 _lastTimeDebug;
+
+    OctreeEditLog* _editLog;
+    int _editLogCommitInterval;
+    qint64 _editLogCompactSize;
+    quint64 _lastEditLogCommit;
+
+    bool _wantIndexedFile;
+    bool _fullyLoaded;
+    quint64 _hydrationStarted;
+    quint64 _hydrationTimeUSecs;
+    OctreeIndexedFile* _indexedFile;
+    QMutex _hydrationMutex;
+    QList<ViewFrustum> _hydrationViews;
 };
 
 #endif // hifi_OctreePersistThread_h
@@ -68,6 +68,10 @@ void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _bytes = other._bytes;
     _passes = other._passes;
 
+    _timeToMostBytes = other._timeToMostBytes;
+    _packetSentTimes = other._packetSentTimes;
+    _bytesSentBy = other._bytesSentBy;
+
     _totalElements = other._totalElements;
     _totalInternal = other._totalInternal;
     _totalLeaves = other._totalLeaves;
@@ -206,6 +210,15 @@ void OctreeSceneStats::sceneCompleted() {
             _lastFullTotalEncodeTime = _totalEncodeTime;
         }
 
+        // the packets were sent in order, so the first to take the scene past most of its bytes is when it got there
+        _timeToMostBytes = 0;
+        for (int i = 0; i < _bytesSentBy.size(); i++) {
+            if (_bytesSentBy.at(i) * 100 >= _bytes * MOST_BYTES_PERCENT) {
+                _timeToMostBytes = _packetSentTimes.at(i);
+                break;
+            }
+        }
+
         _statsMessageLength = packIntoMessage(_statsMessage, sizeof(_statsMessage));
         _isReadyToSend = true;
         _isStarted = false;
@@ -228,6 +241,10 @@ void OctreeSceneStats::reset() {
     _bytes = 0;
     _passes = 0;
 
+    _timeToMostBytes = 0;
+    _packetSentTimes.clear();
+    _bytesSentBy.clear();
+
     _totalElements = 0;
     _totalInternal = 0;
     _totalLeaves = 0;
@@ -284,6 +301,10 @@ void OctreeSceneStats::reset() {
 void OctreeSceneStats::packetSent(int bytes) {
     _packets++;
     _bytes += bytes;
+    if (_isStarted) {
+        _packetSentTimes << usecTimestampNow() - _start;
+        _bytesSentBy << _bytes;
+    }
 }
 
 void OctreeSceneStats::traversed(const OctreeElement* element) {
@@ -403,6 +424,8 @@ int OctreeSceneStats::packIntoMessage(unsigned char* destinationBuffer, int avai
     destinationBuffer += sizeof(_packets);
     memcpy(destinationBuffer, &_bytes, sizeof(_bytes));
     destinationBuffer += sizeof(_bytes);
+    memcpy(destinationBuffer, &_timeToMostBytes, sizeof(_timeToMostBytes));
+    destinationBuffer += sizeof(_timeToMostBytes);
 
     memcpy(destinationBuffer, &_totalInternal, sizeof(_totalInternal));
     destinationBuffer += sizeof(_totalInternal);
@@ -505,6 +528,8 @@ int OctreeSceneStats::unpackFromMessage(const unsigned char* sourceBuffer, int a
     sourceBuffer += sizeof(_packets);
     memcpy(&_bytes, sourceBuffer, sizeof(_bytes));
     sourceBuffer += sizeof(_bytes);
+    memcpy(&_timeToMostBytes, sourceBuffer, sizeof(_timeToMostBytes));
+    sourceBuffer += sizeof(_timeToMostBytes);
 
     if (_isFullScene) {
         _lastFullElapsed = _elapsed;
@@ -642,6 +667,7 @@ void OctreeSceneStats::printDebugDetails() {
     qDebug();
     qDebug() << "packets: " << _packets;
     qDebug() << "bytes: " << _bytes;
+    qDebug() << "time to most bytes: " << _timeToMostBytes;
     qDebug();
     qDebug() << "total elements: " << _totalElements;
     qDebug() << "internal: " << _totalInternal;
@@ -694,6 +720,7 @@ OctreeSceneStats::ItemInfo OctreeSceneStats::_ITEMS[] = {
     { "Skipped - Occluded", YELLOWISH, 3, "Total,Internal,Leaves" },
     { "Didn't fit in packet", GREYISH, 4, "Total,Internal,Leaves,Removed" },
     { "Mode", GREENISH, 4, "Moving,Stationary,Partial,Full" },
+    { "Time to 90% of Bytes", YELLOWISH, 1, "Time" },
 };
 
 const char* OctreeSceneStats::getItemValue(Item item) {
@@ -817,6 +844,12 @@ const char* OctreeSceneStats::getItemValue(Item item) {
                     (_isMoving ? "Moving" : "Stationary"));
             break;
         }
+        case ITEM_TIME_TO_MOST_BYTES: {
+            float percentOfElapsed = _elapsed == 0 ? 0 : (float)_timeToMostBytes * 100.0f / (float)_elapsed;
+            sprintf(_itemValueBuffer, "%llu usecs (%.0f%% of elapsed)", (long long unsigned int)_timeToMostBytes,
+                    percentOfElapsed);
+            break;
+        }
         default:
             break;
     }
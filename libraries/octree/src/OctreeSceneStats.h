@@ -13,6 +13,7 @@
 #define hifi_OctreeSceneStats_h
 
 #include <stdint.h>
+#include <QVector>
 #include <NodeList.h>
 #include <SharedUtil.h>
 #include "JurisdictionMap.h"
@@ -122,6 +123,7 @@ public:
         ITEM_SKIPPED_OCCLUDED,
         ITEM_DIDNT_FIT,
         ITEM_MODE,
+        ITEM_TIME_TO_MOST_BYTES,
         ITEM_COUNT
     };
 
@@ -154,6 +156,11 @@ public:
     quint64 getTotalEncodeTime() const { return _totalEncodeTime; }
     quint64 getElapsedTime() const { return _elapsed; }
 
+    /// How long after the scene started most of its bytes, MOST_BYTES_PERCENT of them, had been sent. Since what's
+    /// nearest the camera goes first, this is about how long the scene took to look loaded.
+    quint64 getTimeToMostBytes() const { return _timeToMostBytes; }
+    static const int MOST_BYTES_PERCENT = 90;
+
     quint64 getLastFullElapsedTime() const { return _lastFullElapsed; }
     quint64 getLastFullTotalEncodeTime() const { return _lastFullTotalEncodeTime; }
     quint32 getLastFullTotalPackets() const { return _lastFullTotalPackets; }
@@ -257,6 +264,10 @@ private:
     quint32  _packets;
     quint64 _bytes;
     quint32  _passes;
+
+    quint64 _timeToMostBytes;
+    QVector<quint64> _packetSentTimes; // since the start of the scene
+    QVector<quint64> _bytesSentBy; // in the scene so far, as of each packet
     
     // incoming packets stats
     quint32 _incomingPacket;
@@ -392,6 +392,90 @@ ViewFrustum::location ViewFrustum::cubeInFrustum(const AACube& cube) const {
     return regularResult;
 }
 
+void ViewFrustum::childrenInFrustum(const AACube& cube, unsigned char& insideMask, unsigned char& intersectMask) const {
+    const glm::vec3& corner = cube.getCorner();
+    float childScale = cube.getScale() / 2.0f;
+
+    // the children's corners side by side, so each test below is one straight loop over all eight
+    float cornerX[NUMBER_OF_CHILDREN];
+    float cornerY[NUMBER_OF_CHILDREN];
+    float cornerZ[NUMBER_OF_CHILDREN];
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        cornerX[i] = (i & 4) ? corner.x + childScale : corner.x;
+        cornerY[i] = (i & 2) ? corner.y + childScale : corner.y;
+        cornerZ[i] = (i & 1) ? corner.z + childScale : corner.z;
+    }
+
+    unsigned char keyholeInsideMask = 0;
+    unsigned char keyholeIntersectMask = 0;
+    if (_keyholeRadius >= 0.0f) {
+        // the keyhole is small, so most children fail cubeInKeyhole()'s bounding cube check. Do that check for all of
+        // them at once and only look closer at the ones that pass it.
+        const glm::vec3& boundsMin = _keyholeBoundingCube.getCorner();
+        float boundsScale = _keyholeBoundingCube.getScale();
+        glm::vec3 boundsMax = boundsMin + glm::vec3(boundsScale, boundsScale, boundsScale);
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            float maxX = cornerX[i] + childScale;
+            float maxY = cornerY[i] + childScale;
+            float maxZ = cornerZ[i] + childScale;
+            bool inBounds = cornerX[i] >= boundsMin.x && cornerX[i] <= boundsMax.x &&
+                maxX >= boundsMin.x && maxX <= boundsMax.x &&
+                cornerY[i] >= boundsMin.y && cornerY[i] <= boundsMax.y &&
+                maxY >= boundsMin.y && maxY <= boundsMax.y &&
+                cornerZ[i] >= boundsMin.z && cornerZ[i] <= boundsMax.z &&
+                maxZ >= boundsMin.z && maxZ <= boundsMax.z;
+            if (inBounds) {
+                ViewFrustum::location keyholeResult = cubeInKeyhole(AACube(glm::vec3(cornerX[i], cornerY[i], cornerZ[i]),
+                                                                           childScale));
+                if (keyholeResult == INSIDE) {
+                    keyholeInsideMask |= (1 << i);
+                } else if (keyholeResult == INTERSECT) {
+                    keyholeIntersectMask |= (1 << i);
+                }
+            }
+        }
+    }
+
+    // The P and N vertices of every child are the same corner for a given plane, so they're the child's corner plus
+    // one offset. A child outside any plane gets its keyhole result, otherwise it intersects if it straddles any plane,
+    // which is what cubeInFrustum() comes to checking the planes one at a time.
+    unsigned char outsideMask = 0;
+    unsigned char straddleMask = 0;
+    for (int plane = 0; plane < 6; plane++) {
+        const glm::vec3& normal = _planes[plane].getNormal();
+        float d = _planes[plane].getDCoefficient();
+        float offsetPX = (normal.x > 0) ? childScale : 0.0f;
+        float offsetPY = (normal.y > 0) ? childScale : 0.0f;
+        float offsetPZ = (normal.z > 0) ? childScale : 0.0f;
+        float offsetNX = (normal.x < 0) ? childScale : 0.0f;
+        float offsetNY = (normal.y < 0) ? childScale : 0.0f;
+        float offsetNZ = (normal.z < 0) ? childScale : 0.0f;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            float distanceP = d + (normal.x * (cornerX[i] + offsetPX) + normal.y * (cornerY[i] + offsetPY) +
+                normal.z * (cornerZ[i] + offsetPZ));
+            float distanceN = d + (normal.x * (cornerX[i] + offsetNX) + normal.y * (cornerY[i] + offsetNY) +
+                normal.z * (cornerZ[i] + offsetNZ));
+            outsideMask |= (distanceP < 0) << i;
+            straddleMask |= (distanceN < 0) << i;
+        }
+    }
+
+    insideMask = keyholeInsideMask | (~outsideMask & ~straddleMask);
+    intersectMask = ~keyholeInsideMask & ((outsideMask & keyholeIntersectMask) | (~outsideMask & straddleMask));
+}
+
+void ViewFrustum::childDistancesToCamera(const AACube& cube, float distances[NUMBER_OF_CHILDREN]) const {
+    const glm::vec3& corner = cube.getCorner();
+    float childScale = cube.getScale() / 2.0f;
+    float halfChildScale = childScale * 0.5f;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        float deltaX = _position.x - (((i & 4) ? corner.x + childScale : corner.x) + halfChildScale);
+        float deltaY = _position.y - (((i & 2) ? corner.y + childScale : corner.y) + halfChildScale);
+        float deltaZ = _position.z - (((i & 1) ? corner.z + childScale : corner.z) + halfChildScale);
+        distances[i] = sqrtf(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ);
+    }
+}
+
 ViewFrustum::location ViewFrustum::boxInFrustum(const AABox& box) const {
 
     ViewFrustum::location regularResult = INSIDE;
@@ -100,6 +100,16 @@ public:
     ViewFrustum::location cubeInFrustum(const AACube& cube) const;
     ViewFrustum::location boxInFrustum(const AABox& box) const;
 
+    /// Classifies the eight children of the cube in one pass over the planes, giving each the location cubeInFrustum()
+    /// would. Bit (1 << childIndex) is set in insideMask for the children INSIDE and in intersectMask for the ones that
+    /// INTERSECT, the rest are OUTSIDE. Children are in OctreeElement's order, with x in the 4 bit of the index, y in
+    /// the 2 bit and z in the 1 bit.
+    void childrenInFrustum(const AACube& cube, unsigned char& insideMask, unsigned char& intersectMask) const;
+
+    /// Distances from the camera to the centers of the eight children of the cube, in the same order as
+    /// childrenInFrustum()
+    void childDistancesToCamera(const AACube& cube, float distances[NUMBER_OF_CHILDREN]) const;
+
     // some frustum comparisons
     bool matches(const ViewFrustum& compareTo, bool debug = false) const;
     bool matches(const ViewFrustum* compareTo, bool debug = false) const { return matches(*compareTo, debug); }
@@ -13,6 +13,15 @@
 #include <QtCore>
 #include <QDesktopServices>
 
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
 void FileUtils::locateFile(QString filePath) {
 
     // adapted from
@@ -79,3 +88,82 @@ QString FileUtils::standardPath(QString subfolder) {
     
     return path;
 }
+
+bool FileUtils::syncToDisk(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+bool FileUtils::replaceFile(const QString& fromPath, const QString& toPath) {
+#ifdef Q_OS_WIN
+    return MoveFileExW((const wchar_t*)QDir::toNativeSeparators(fromPath).utf16(),
+                       (const wchar_t*)QDir::toNativeSeparators(toPath).utf16(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(QFile::encodeName(fromPath).constData(), QFile::encodeName(toPath).constData()) != 0) {
+        return false;
+    }
+
+    // the rename itself only survives a crash once the directory is on disk
+    int directory = open(QFile::encodeName(QFileInfo(toPath).absolutePath()).constData(), O_RDONLY);
+    if (directory >= 0) {
+        fsync(directory);
+        close(directory);
+    }
+    return true;
+#endif
+}
+
+bool FileUtils::hardLinkFile(const QString& existingPath, const QString& linkPath) {
+    if (QFile::exists(linkPath) && !QFile::remove(linkPath)) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    if (CreateHardLinkW((const wchar_t*)QDir::toNativeSeparators(linkPath).utf16(),
+                        (const wchar_t*)QDir::toNativeSeparators(existingPath).utf16(), NULL)) {
+        return true;
+    }
+#else
+    if (link(QFile::encodeName(existingPath).constData(), QFile::encodeName(linkPath).constData()) == 0) {
+        return true;
+    }
+#endif
+    return QFile::copy(existingPath, linkPath);
+}
+
+bool FileUtils::saveFileAtomically(const QString& path, const QByteArray& contents) {
+    QString savingPath = path + ".saving";
+    QFile savingFile(savingPath);
+    if (!savingFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || savingFile.write(contents) != contents.size() ||
+            !syncToDisk(savingFile)) {
+        qDebug() << "ERROR writing" << savingPath << ":" << savingFile.errorString();
+        savingFile.close();
+        QFile::remove(savingPath);
+        return false;
+    }
+    savingFile.close();
+
+    // read back what landed on disk before it replaces the last good save
+    QByteArray expectedChecksum = QCryptographicHash::hash(contents, QCryptographicHash::Sha1);
+    if (!savingFile.open(QIODevice::ReadOnly) ||
+            QCryptographicHash::hash(savingFile.readAll(), QCryptographicHash::Sha1) != expectedChecksum) {
+        qDebug() << "ERROR verifying" << savingPath << ", keeping the previous save";
+        savingFile.close();
+        QFile::remove(savingPath);
+        return false;
+    }
+    savingFile.close();
+
+    if (!replaceFile(savingPath, path)) {
+        qDebug() << "ERROR replacing" << path << "with" << savingPath;
+        QFile::remove(savingPath);
+        return false;
+    }
+    return true;
+}
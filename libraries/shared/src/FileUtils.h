@@ -12,6 +12,8 @@
 #ifndef hifi_FileUtils_h
 #define hifi_FileUtils_h
 
+#include <QByteArray>
+#include <QFile>
 #include <QString>
 
 class FileUtils {
@@ -20,6 +22,21 @@ public:
     static void locateFile(QString fileName);
     static QString standardPath(QString subfolder);
 
+    /// Flushes the file and waits for the OS to write it to disk.
+    static bool syncToDisk(QFile& file);
+
+    /// Atomically replaces the file at toPath with the one at fromPath, so that toPath always has either its old or its
+    /// new contents.
+    static bool replaceFile(const QString& fromPath, const QString& toPath);
+
+    /// Makes linkPath a hard link to the file at existingPath, replacing whatever was at linkPath. Copies the file where
+    /// hard links aren't supported.
+    static bool hardLinkFile(const QString& existingPath, const QString& linkPath);
+
+    /// Saves contents to path through a temporary file that is synced, read back and verified before it replaces the
+    /// file at path, so a failed save leaves the previous contents in place.
+    static bool saveFileAtomically(const QString& path, const QByteArray& contents);
+
 };
 
 #endif // hifi_FileUtils_h
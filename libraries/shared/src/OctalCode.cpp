@@ -377,3 +377,40 @@ QString octalCodeToHexString(const unsigned char* octalCode) {
     return output;
 }
 
+
+OctalKey octalKeyForCode(const unsigned char* octalCode) {
+    if (!octalCode) {
+        return INVALID_OCTAL_KEY;
+    }
+    int sections = numberOfThreeBitSectionsInCode(octalCode);
+    if (sections < 0 || sections > MAX_OCTAL_KEY_SECTIONS) {
+        return INVALID_OCTAL_KEY;
+    }
+    return ancestorOctalKeyForCode(octalCode, sections);
+}
+
+OctalKey ancestorOctalKeyForCode(const unsigned char* octalCode, int maxSections) {
+    if (!octalCode) {
+        return INVALID_OCTAL_KEY;
+    }
+    int sections = std::min(numberOfThreeBitSectionsInCode(octalCode), std::min(maxSections, MAX_OCTAL_KEY_SECTIONS));
+    OctalKey key = ROOT_OCTAL_KEY;
+    for (int section = 0; section < sections; section++) {
+        key = childOctalKey(key, getOctalCodeSectionValue(octalCode, section));
+    }
+    return key;
+}
+
+unsigned char* octalCodeForKey(OctalKey key) {
+    if (key == INVALID_OCTAL_KEY) {
+        return NULL;
+    }
+    unsigned char* octalCode = new unsigned char[1];
+    *octalCode = 0;
+    for (int section = numberOfSectionsInOctalKey(key) - 1; section >= 0; section--) {
+        unsigned char* childCode = childOctalCode(octalCode, ancestorOctalKey(key, section) & 7);
+        delete[] octalCode;
+        octalCode = childCode;
+    }
+    return octalCode;
+}
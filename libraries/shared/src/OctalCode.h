@@ -65,4 +65,45 @@ OctalCodeComparison compareOctalCodes(const unsigned char* code1, const unsigned
 QString octalCodeToHexString(const unsigned char* octalCode);
 unsigned char* hexStringToOctalCode(const QString& input);
 
+/// Octal codes as 64 bit Morton keys: a leading 1 bit followed by the three bit section of each level, so the root is 1,
+/// a key's children are (key << 3) | childIndex, and the keys of a subtree at any one depth are a contiguous range.
+/// Codes deeper than MAX_OCTAL_KEY_SECTIONS levels don't fit and get INVALID_OCTAL_KEY.
+typedef quint64 OctalKey;
+const OctalKey INVALID_OCTAL_KEY = 0;
+const OctalKey ROOT_OCTAL_KEY = 1;
+const int MAX_OCTAL_KEY_SECTIONS = 21;
+
+OctalKey octalKeyForCode(const unsigned char* octalCode);
+unsigned char* octalCodeForKey(OctalKey key);
+
+/// The key of the code's ancestor maxSections deep, or of the code itself if it isn't that deep
+OctalKey ancestorOctalKeyForCode(const unsigned char* octalCode, int maxSections);
+
+inline int numberOfSectionsInOctalKey(OctalKey key) {
+#ifdef __GNUC__
+    return key ? (63 - __builtin_clzll(key)) / BITS_IN_OCTAL : 0;
+#else
+    int sections = 0;
+    while (key > ROOT_OCTAL_KEY) {
+        key >>= BITS_IN_OCTAL;
+        sections++;
+    }
+    return sections;
+#endif
+}
+
+inline OctalKey childOctalKey(OctalKey parentKey, int childNumber) {
+    return (parentKey << BITS_IN_OCTAL) | childNumber;
+}
+
+/// The key's ancestor sections levels up, or the key itself for 0
+inline OctalKey ancestorOctalKey(OctalKey key, int sections) {
+    return key >> (sections * BITS_IN_OCTAL);
+}
+
+inline bool isAncestorOfKey(OctalKey possibleAncestor, OctalKey possibleDescendent) {
+    int levelsBetween = numberOfSectionsInOctalKey(possibleDescendent) - numberOfSectionsInOctalKey(possibleAncestor);
+    return levelsBetween >= 0 && ancestorOctalKey(possibleDescendent, levelsBetween) == possibleAncestor;
+}
+
 #endif // hifi_OctalCode_h
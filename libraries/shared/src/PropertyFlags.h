@@ -21,15 +21,70 @@
 
 #include <algorithm>
 #include <climits>
+#include <string.h>
 
 #include <QBitArray>
 #include <QByteArray>
 
 #include <SharedUtil.h>
 
+/// The flags of an enum whose last flag is known at compile time, kept in words inside the PropertyFlags rather than in a
+/// QBitArray, so copying and combining them never allocates. It behaves like the QBitArray it stands in for, size and
+/// all, except that bits past the capacity always read as false and can't be set.
+template<int Words> class PropertyFlagBits {
+public:
+    static const int CAPACITY = Words * 64;
+
+    PropertyFlagBits() : _size(0) { memset(_words, 0, sizeof(_words)); }
+
+    int size() const { return _size; }
+    void resize(int size);
+    void clear() { memset(_words, 0, sizeof(_words)); _size = 0; }
+
+    bool testBit(int i) const { return i < CAPACITY && (_words[i / 64] & (1ULL << (i % 64))); }
+    bool at(int i) const { return testBit(i); }
+    bool operator[](int i) const { return testBit(i); }
+    void setBit(int i, bool value);
+
+    PropertyFlagBits& operator|=(const PropertyFlagBits& other);
+    PropertyFlagBits& operator&=(const PropertyFlagBits& other);
+    PropertyFlagBits& operator^=(const PropertyFlagBits& other);
+    PropertyFlagBits operator~() const;
+
+    bool operator==(const PropertyFlagBits& other) const;
+    bool operator!=(const PropertyFlagBits& other) const { return !(*this == other); }
+
+private:
+    void clearFrom(int bit);
+
+    quint64 _words[Words]; // bits at or past _size are always clear
+    int _size;
+};
+
+/// The last flag of an enum used as PropertyFlags, or -1 if it isn't known. An enum that knows its last flag can say so,
+///     template<> struct PropertyFlagsTraits<MyPropertyList> { static const int LAST_FLAG = MY_PROP_LAST_ITEM; };
+/// and its flags will be kept in a PropertyFlagBits instead of a QBitArray. Flags past the last are still fine up to the
+/// next multiple of 64, but past that they're dropped, so only enums that will never see bigger flags should say.
+template<typename Enum> struct PropertyFlagsTraits {
+    static const int LAST_FLAG = -1;
+};
+
+template<int LastFlag> struct PropertyFlagsStorage {
+    typedef PropertyFlagBits<LastFlag / 64 + 1> Bits;
+    static const int CAPACITY = Bits::CAPACITY;
+};
+
+template<> struct PropertyFlagsStorage<-1> {
+    typedef QBitArray Bits;
+    static const int CAPACITY = INT_MAX;
+};
+
 template<typename Enum>class PropertyFlags {
 public:
     typedef Enum enum_type;
+
+    /// The longest encode() can be, which is only worth knowing for enums with a PropertyFlagsTraits
+    static const int MAX_ENCODED_LENGTH = (PropertyFlagsStorage<PropertyFlagsTraits<Enum>::LAST_FLAG>::CAPACITY - 1) / 7 + 1;
     inline PropertyFlags() : 
             _maxFlag(INT_MIN), _minFlag(INT_MAX), _trailingFlipped(false), _encodedLength(0) { };
 
@@ -53,6 +108,12 @@ public:
     QByteArray encode();
     void decode(const QByteArray& fromEncoded);
 
+    /// Encodes straight into the buffer, and returns the encoded length, or 0 if it doesn't fit in maxLength
+    int encode(unsigned char* buffer, int maxLength);
+
+    /// Decodes from the start of the buffer, which may hold more after the flags, and returns the encoded length
+    int decode(const unsigned char* data, int length);
+
     operator QByteArray() { return encode(); };
 
     bool operator==(const PropertyFlags& other) const { return _flags == other._flags; }
@@ -106,9 +167,11 @@ public:
 
 
 private:
+    typedef PropertyFlagsStorage<PropertyFlagsTraits<Enum>::LAST_FLAG> Storage;
+
     void shrinkIfNeeded();
 
-    QBitArray _flags;
+    typename Storage::Bits _flags;
     int _maxFlag;
     int _minFlag;
     bool _trailingFlipped; /// are the trailing properties flipping in their state (e.g. assumed true, instead of false)
@@ -124,7 +187,74 @@ template<typename Enum> PropertyFlags<Enum>& operator<<(PropertyFlags<Enum>& out
 }
 
 
+template<int Words> inline void PropertyFlagBits<Words>::resize(int size) {
+    if (size > CAPACITY) {
+        size = CAPACITY;
+    }
+    if (size < _size) {
+        clearFrom(size);
+    }
+    _size = size;
+}
+
+template<int Words> inline void PropertyFlagBits<Words>::setBit(int i, bool value) {
+    if (i >= CAPACITY) {
+        return;
+    }
+    if (value) {
+        _words[i / 64] |= (1ULL << (i % 64));
+    } else {
+        _words[i / 64] &= ~(1ULL << (i % 64));
+    }
+}
+
+template<int Words> inline PropertyFlagBits<Words>& PropertyFlagBits<Words>::operator|=(const PropertyFlagBits& other) {
+    for (int i = 0; i < Words; i++) {
+        _words[i] |= other._words[i];
+    }
+    _size = std::max(_size, other._size);
+    return *this;
+}
+
+template<int Words> inline PropertyFlagBits<Words>& PropertyFlagBits<Words>::operator&=(const PropertyFlagBits& other) {
+    for (int i = 0; i < Words; i++) {
+        _words[i] &= other._words[i];
+    }
+    _size = std::max(_size, other._size);
+    return *this;
+}
+
+template<int Words> inline PropertyFlagBits<Words>& PropertyFlagBits<Words>::operator^=(const PropertyFlagBits& other) {
+    for (int i = 0; i < Words; i++) {
+        _words[i] ^= other._words[i];
+    }
+    _size = std::max(_size, other._size);
+    return *this;
+}
+
+template<int Words> inline PropertyFlagBits<Words> PropertyFlagBits<Words>::operator~() const {
+    PropertyFlagBits result(*this);
+    for (int i = 0; i < Words; i++) {
+        result._words[i] = ~_words[i];
+    }
+    result.clearFrom(_size);
+    return result;
+}
+
+template<int Words> inline bool PropertyFlagBits<Words>::operator==(const PropertyFlagBits& other) const {
+    return _size == other._size && memcmp(_words, other._words, sizeof(_words)) == 0;
+}
+
+template<int Words> inline void PropertyFlagBits<Words>::clearFrom(int bit) {
+    for (int i = bit / 64; i < Words; i++) {
+        _words[i] &= (i == bit / 64 && bit % 64 != 0) ? ((1ULL << (bit % 64)) - 1) : 0;
+    }
+}
+
 template<typename Enum> inline void PropertyFlags<Enum>::setHasProperty(Enum flag, bool value) {
+    if ((int)flag >= Storage::CAPACITY) {
+        return; // past the last flag we can hold, see PropertyFlagsTraits
+    }
     // keep track of our min flag
     if (flag < _minFlag) {
         if (value) {
@@ -157,87 +287,85 @@ const int BITS_PER_BYTE = 8;
 
 template<typename Enum> inline QByteArray PropertyFlags<Enum>::encode() {
     QByteArray output;
-    
+    int lengthInBytes = (_maxFlag < _minFlag) ? 1 : (_maxFlag / (BITS_PER_BYTE - 1)) + 1;
+    output.resize(lengthInBytes);
+    encode((unsigned char*)output.data(), lengthInBytes);
+    return output;
+}
+
+template<typename Enum> inline int PropertyFlags<Enum>::encode(unsigned char* buffer, int maxLength) {
     if (_maxFlag < _minFlag) {
-        output.fill(0, 1);
-        return output; // no flags... nothing to encode
+        if (maxLength < 1) {
+            return 0;
+        }
+        buffer[0] = 0;
+        return 1; // no flags... nothing to encode
     }
 
     // we should size the array to the correct size.
     int lengthInBytes = (_maxFlag / (BITS_PER_BYTE - 1)) + 1;
-
-    output.fill(0, lengthInBytes);
+    if (lengthInBytes > maxLength) {
+        return 0;
+    }
+    memset(buffer, 0, lengthInBytes);
 
     // next pack the number of header bits in, the first N-1 to be set to 1, the last to be set to 0
-    for(int i = 0; i < lengthInBytes; i++) {
-        int outputIndex = i;
-        int bitValue = (i < (lengthInBytes - 1)  ? 1 : 0);
-        char original = output.at(outputIndex / BITS_PER_BYTE);
-        int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_PER_BYTE] = (original | thisBit);
+    const unsigned char HIGH_BIT = 0x80;
+    for (int i = 0; i < lengthInBytes - 1; i++) {
+        buffer[i / BITS_PER_BYTE] |= (HIGH_BIT >> (i % BITS_PER_BYTE));
     }
 
     // finally pack the the actual bits from the bit array
-    for(int i = lengthInBytes; i < (lengthInBytes + _maxFlag + 1); i++) {
-        int flagIndex = i - lengthInBytes;
-        int outputIndex = i;
-        int bitValue = ( _flags[flagIndex]  ? 1 : 0);
-        char original = output.at(outputIndex / BITS_PER_BYTE);
-        int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
-        char thisBit = ( bitValue << shiftBy);
-        output[i / BITS_PER_BYTE] = (original | thisBit);
+    for (int flag = 0; flag <= _maxFlag; flag++) {
+        if (_flags.testBit(flag)) {
+            int outputIndex = lengthInBytes + flag;
+            buffer[outputIndex / BITS_PER_BYTE] |= (HIGH_BIT >> (outputIndex % BITS_PER_BYTE));
+        }
     }
-    
+
     _encodedLength = lengthInBytes;
-    return output;
+    return lengthInBytes;
 }
 
 template<typename Enum> inline void PropertyFlags<Enum>::decode(const QByteArray& fromEncodedBytes) {
+    decode((const unsigned char*)fromEncodedBytes.constData(), fromEncodedBytes.size());
+}
+
+template<typename Enum> inline int PropertyFlags<Enum>::decode(const unsigned char* data, int length) {
 
     clear(); // we are cleared out!
 
-    // first convert the ByteArray into a BitArray...
-    QBitArray encodedBits;
-    int bitCount = BITS_PER_BYTE * fromEncodedBytes.count();
-    encodedBits.resize(bitCount);
-    
-    for(int byte = 0; byte < fromEncodedBytes.count(); byte++) {
-        char originalByte = fromEncodedBytes.at(byte);
-        for(int bit = 0; bit < BITS_PER_BYTE; bit++) {
-            int shiftBy = BITS_PER_BYTE - (bit + 1);
-            char maskBit = ( 1 << shiftBy);
-            bool bitValue = originalByte & maskBit;
-            encodedBits.setBit(byte * BITS_PER_BYTE + bit, bitValue);
-        }
-    }
-    
-    // next, read the leading bits to determine the correct number of bytes to decode (may not match the QByteArray)
+    // read the leading bits to determine the correct number of bytes to decode (may not match the length we're given)
+    const unsigned char HIGH_BIT = 0x80;
+    const unsigned char ALL_BITS = 0xFF;
+    int bitCount = BITS_PER_BYTE * length;
     int encodedByteCount = 0;
-    int leadBits = 1;
-    int bitAt;
-    for (bitAt = 0; bitAt < bitCount; bitAt++) {
-        if (encodedBits.at(bitAt)) {
+    int byte = 0;
+    while (byte < length && data[byte] == ALL_BITS) {
+        encodedByteCount += BITS_PER_BYTE;
+        byte++;
+    }
+    if (byte < length) {
+        for (unsigned char bit = HIGH_BIT; data[byte] & bit; bit >>= 1) {
             encodedByteCount++;
-            leadBits++;
-        } else {
-            break;
         }
     }
+    int leadBits = encodedByteCount + 1;
     encodedByteCount++; // always at least one byte
     _encodedLength = encodedByteCount;
 
     int expectedBitCount = encodedByteCount * BITS_PER_BYTE;
-    
+
     // Now, keep reading...
-    if (expectedBitCount <= (encodedBits.size() - leadBits)) {
-        int flagsStartAt = bitAt + 1; 
-        for (bitAt = flagsStartAt; bitAt < expectedBitCount; bitAt++) {
-            if (encodedBits.at(bitAt)) {
+    if (expectedBitCount <= (bitCount - leadBits)) {
+        int flagsStartAt = leadBits;
+        for (int bitAt = flagsStartAt; bitAt < expectedBitCount; bitAt++) {
+            if (data[bitAt / BITS_PER_BYTE] & (HIGH_BIT >> (bitAt % BITS_PER_BYTE))) {
                 setHasProperty((Enum)(bitAt - flagsStartAt));
             }
         }
     }
+    return _encodedLength;
 }
 
 template<typename Enum> inline void PropertyFlags<Enum>::debugDumpBits() {
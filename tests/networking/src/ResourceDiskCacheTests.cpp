@@ -0,0 +1,213 @@
+//
+//  ResourceDiskCacheTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cassert>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTemporaryDir>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include "ResourceDiskCacheTests.h"
+
+void ResourceDiskCacheTests::runAllTests() {
+    contentAddressingTest();
+    evictionTest();
+    persistenceTest();
+    revalidationTest();
+}
+
+static QNetworkCacheMetaData makeMetaData(const QString& url) {
+    QNetworkCacheMetaData metaData;
+    metaData.setUrl(QUrl(url));
+    metaData.setSaveToDisk(true);
+    return metaData;
+}
+
+static QByteArray readCached(ResourceDiskCache& cache, const QString& url) {
+    QIODevice* device = cache.data(QUrl(url));
+    if (!device) {
+        return QByteArray();
+    }
+    QByteArray content = device->readAll();
+    delete device;
+    return content;
+}
+
+void ResourceDiskCacheTests::contentAddressingTest() {
+    QTemporaryDir directory;
+    ResourceDiskCache cache(directory.path(), 1024 * 1024);
+
+    QByteArray model(10000, 'm');
+    QByteArray texture(5000, 't');
+
+    cache.insert(makeMetaData("http://a.example/model.fbx"), model);
+    cache.insert(makeMetaData("http://b.example/mirror/model.fbx"), model);
+    cache.insert(makeMetaData("http://a.example/texture.png"), texture);
+
+    // the same body under two URLs is only stored once
+    assert(cache.getEntryCount() == 3);
+    assert(cache.cacheSize() == model.size() + texture.size());
+
+    assert(readCached(cache, "http://a.example/model.fbx") == model);
+    assert(readCached(cache, "http://b.example/mirror/model.fbx") == model);
+    assert(readCached(cache, "http://a.example/texture.png") == texture);
+
+    QIODevice* device = cache.data(QUrl("http://a.example/model.fbx"));
+    assert(static_cast<MappedCacheFile*>(device)->isMapped());
+    delete device;
+
+    // the shared body stays until the last URL referring to it is gone
+    cache.remove(QUrl("http://a.example/model.fbx"));
+    assert(readCached(cache, "http://b.example/mirror/model.fbx") == model);
+    cache.remove(QUrl("http://b.example/mirror/model.fbx"));
+    assert(cache.cacheSize() == texture.size());
+    assert(readCached(cache, "http://a.example/model.fbx").isEmpty());
+}
+
+void ResourceDiskCacheTests::evictionTest() {
+    QTemporaryDir directory;
+    ResourceDiskCache cache(directory.path(), 3000);
+
+    cache.insert(makeMetaData("http://example/1"), QByteArray(1000, '1'));
+    cache.insert(makeMetaData("http://example/2"), QByteArray(1000, '2'));
+    cache.insert(makeMetaData("http://example/3"), QByteArray(1000, '3'));
+
+    // touch the oldest so the second becomes the least recently used
+    assert(!readCached(cache, "http://example/1").isEmpty());
+
+    cache.insert(makeMetaData("http://example/4"), QByteArray(1000, '4'));
+    assert(cache.cacheSize() <= 3000);
+    assert(cache.metaData(QUrl("http://example/2")).url().isEmpty());
+    assert(readCached(cache, "http://example/1") == QByteArray(1000, '1'));
+    assert(readCached(cache, "http://example/4") == QByteArray(1000, '4'));
+
+    // anything bigger than the whole budget is never stored
+    cache.insert(makeMetaData("http://example/huge"), QByteArray(4000, 'h'));
+    assert(readCached(cache, "http://example/huge").isEmpty());
+    assert(cache.getEntryCount() == 3);
+}
+
+void ResourceDiskCacheTests::persistenceTest() {
+    QTemporaryDir directory;
+
+    QNetworkCacheMetaData metaData = makeMetaData("http://example/script.js");
+    QNetworkCacheMetaData::RawHeaderList headers;
+    headers.append(qMakePair(QByteArray("ETag"), QByteArray("\"abc\"")));
+    metaData.setRawHeaders(headers);
+
+    {
+        ResourceDiskCache cache(directory.path(), 3000);
+        cache.insert(metaData, "print('hello');");
+        cache.insert(makeMetaData("http://example/old"), QByteArray(1000, 'o'));
+        cache.insert(makeMetaData("http://example/new"), QByteArray(1000, 'n'));
+        assert(!readCached(cache, "http://example/old").isEmpty());
+    }
+
+    // content stored after the index was last written, as if we'd crashed before the next write
+    QString strayContentPath = QDir(directory.path()).filePath("content/0123456789abcdef0123456789abcdef01234567");
+    QFile strayContent(strayContentPath);
+    strayContent.open(QIODevice::WriteOnly);
+    strayContent.write("stray");
+    strayContent.close();
+
+    // what the QNetworkDiskCache we replaced left behind, next to a file that isn't ours
+    QDir(directory.path()).mkpath("data8/1");
+    QDir(directory.path()).mkpath("prepared");
+    QString otherFilePath = QDir(directory.path()).filePath("hifi.skipversion");
+    QFile otherFile(otherFilePath);
+    otherFile.open(QIODevice::WriteOnly);
+    otherFile.close();
+
+    // a restart brings back the content, the validators and the recency, and drops what the index doesn't know about
+    ResourceDiskCache cache(directory.path(), 3000);
+    assert(cache.getEntryCount() == 3);
+    assert(!QFile::exists(strayContentPath));
+    assert(!QDir(directory.path()).exists("data8"));
+    assert(!QDir(directory.path()).exists("prepared"));
+    assert(QFile::exists(otherFilePath));
+    assert(readCached(cache, "http://example/script.js") == "print('hello');");
+    assert(cache.metaData(QUrl("http://example/script.js")).rawHeaders() == headers);
+
+    cache.insert(makeMetaData("http://example/newest"), QByteArray(1000, 'x'));
+    assert(cache.metaData(QUrl("http://example/new")).url().isEmpty());
+    assert(!cache.metaData(QUrl("http://example/old")).url().isEmpty());
+}
+
+void ResourceDiskCacheTests::revalidationTest() {
+    int argc = 1;
+    char appName[] = "networking-tests";
+    char* argv[] = { appName };
+    QScopedPointer<QCoreApplication> application;
+    if (!QCoreApplication::instance()) {
+        application.reset(new QCoreApplication(argc, argv));
+    }
+
+    const QByteArray BODY = "pretend this is an fbx";
+    const QByteArray ETAG = "\"v1\"";
+    int fullResponses = 0;
+    int notModifiedResponses = 0;
+
+    // a tiny local HTTP server standing in for the asset server
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost);
+    QObject::connect(&server, &QTcpServer::newConnection, [&]() {
+        QTcpSocket* socket = server.nextPendingConnection();
+        QObject::connect(socket, &QTcpSocket::readyRead, [&, socket]() {
+            QByteArray request = socket->peek(socket->bytesAvailable());
+            if (!request.contains("\r\n\r\n")) {
+                return;
+            }
+            socket->readAll();
+
+            QByteArray response;
+            if (request.contains("If-None-Match: " + ETAG)) {
+                notModifiedResponses++;
+                response = "HTTP/1.1 304 Not Modified\r\nETag: " + ETAG + "\r\nCache-Control: max-age=0\r\n"
+                    "Connection: close\r\n\r\n";
+            } else {
+                fullResponses++;
+                response = "HTTP/1.1 200 OK\r\nETag: " + ETAG + "\r\nCache-Control: max-age=0\r\nContent-Length: "
+                    + QByteArray::number(BODY.size()) + "\r\nConnection: close\r\n\r\n" + BODY;
+            }
+            socket->write(response);
+            socket->disconnectFromHost();
+        });
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    });
+
+    QTemporaryDir directory;
+    QSharedPointer<ResourceDiskCache> diskCache(new ResourceDiskCache(directory.path(), 1024 * 1024));
+    QNetworkAccessManager networkAccessManager;
+    networkAccessManager.setCache(new ResourceNetworkCache(diskCache));
+
+    QNetworkRequest request(QUrl(QString("http://127.0.0.1:%1/model.fbx").arg(server.serverPort())));
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+
+    for (int i = 0; i < 2; i++) {
+        QNetworkReply* reply = networkAccessManager.get(request);
+        QEventLoop loop;
+        QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+
+        assert(reply->error() == QNetworkReply::NoError);
+        assert(reply->readAll() == BODY);
+
+        // the second time around the body comes out of the cache after a 304
+        assert(reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool() == (i == 1));
+        delete reply;
+    }
+
+    assert(fullResponses == 1);
+    assert(notModifiedResponses == 1);
+}
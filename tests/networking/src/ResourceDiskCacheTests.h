@@ -0,0 +1,26 @@
+//
+//  ResourceDiskCacheTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ResourceDiskCacheTests_h
+#define hifi_ResourceDiskCacheTests_h
+
+#include "ResourceDiskCache.h"
+
+namespace ResourceDiskCacheTests {
+
+    void runAllTests();
+
+    void contentAddressingTest();
+    void evictionTest();
+    void persistenceTest();
+    void revalidationTest();
+};
+
+#endif // hifi_ResourceDiskCacheTests_h
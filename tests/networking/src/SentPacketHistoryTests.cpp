@@ -0,0 +1,88 @@
+//
+//  SentPacketHistoryTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cassert>
+#include <limits>
+
+#include "SentPacketHistoryTests.h"
+
+void SentPacketHistoryTests::runAllTests() {
+    rolloverTest();
+    evictionTest();
+    sequenceGapTest();
+}
+
+const quint32 UINT16_RANGE = std::numeric_limits<quint16>::max() + 1;
+
+// every packet carries its own sequence number so we can tell which one we got back
+static QByteArray makePacket(quint16 sequenceNumber) {
+    QByteArray packet(1 + sequenceNumber % 100, (char)(sequenceNumber & 0xFF));
+    packet.prepend(reinterpret_cast<const char*>(&sequenceNumber), sizeof(sequenceNumber));
+    return packet;
+}
+
+void SentPacketHistoryTests::rolloverTest() {
+
+    SentPacketHistory history(1000);
+    assert(history.getCapacity() == 1024);
+
+    quint16 seq = 0;
+    for (quint32 i = 0; i < 3 * UINT16_RANGE; i++) {
+        history.packetSent(seq, makePacket(seq));
+
+        // the newest packet and the oldest one still in the history are both retrievable
+        assert(history.getPacket(seq) == makePacket(seq));
+        if (i >= 1023) {
+            quint16 oldest = seq - (quint16)1023;
+            assert(history.getPacket(oldest) == makePacket(oldest));
+        }
+        seq = seq + (quint16)1;
+    }
+}
+
+void SentPacketHistoryTests::evictionTest() {
+
+    SentPacketHistory history(16);
+    quint64 memoryUsage = 0;
+
+    quint16 seq = 65530;
+    for (int i = 0; i < 100; i++) {
+        history.packetSent(seq, makePacket(seq));
+        if (i == 0) {
+            memoryUsage = history.getMemoryUsage();
+        }
+        seq = seq + (quint16)1;
+    }
+
+    // the slab never grows once it has been allocated
+    assert(history.getMemoryUsage() == memoryUsage);
+
+    quint16 newest = seq - (quint16)1;
+    assert(history.getPacket(newest - (quint16)15) == makePacket(newest - (quint16)15));
+    assert(history.getPacket(newest - (quint16)16).isNull());
+
+    // sequence numbers we haven't sent yet are not in the history
+    assert(history.getPacket(newest + (quint16)1).isNull());
+}
+
+void SentPacketHistoryTests::sequenceGapTest() {
+
+    SentPacketHistory history(16);
+
+    for (quint16 seq = 0; seq < 10; seq++) {
+        history.packetSent(seq, makePacket(seq));
+    }
+
+    // skipping sequence numbers drops the older history rather than returning stale slots
+    history.packetSent(20, makePacket(20));
+    assert(history.getPacket(20) == makePacket(20));
+    assert(history.getPacket(9).isNull());
+    assert(history.getPacket(4).isNull());
+}
@@ -0,0 +1,25 @@
+//
+//  SentPacketHistoryTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SentPacketHistoryTests_h
+#define hifi_SentPacketHistoryTests_h
+
+#include "SentPacketHistory.h"
+
+namespace SentPacketHistoryTests {
+
+    void runAllTests();
+
+    void rolloverTest();
+    void evictionTest();
+    void sequenceGapTest();
+};
+
+#endif // hifi_SentPacketHistoryTests_h
@@ -14,13 +14,17 @@
 
 #include <QDebug>
 
+#include <EntityDeletionLog.h>
+#include <EntityIDMap.h>
 #include <EntityItem.h>
 #include <EntityTree.h>
 #include <EntityTreeElement.h>
+#include <EntityBroadphase.h>
 #include <Octree.h>
 #include <OctreeConstants.h>
 #include <PropertyFlags.h>
 #include <SharedUtil.h>
+#include <SimpleEntitySimulation.h>
 
 //#include "EntityTests.h"
 #include "ModelTests.h" // needs to be EntityTests.h soon
@@ -518,7 +522,465 @@ void EntityTests::entityTreeTests(bool verbose) {
 }
 
 
+void EntityTests::entityIDMapTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "EntityTests::entityIDMapTests()";
+
+    // the map only stores the element and entity pointers, so any distinct values will do
+    const int ENTITY_COUNT = 200000;
+    QVector<EntityItemID> ids;
+    QVector<EntityTreeElement*> elements;
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        ids << EntityItemID(QUuid::createUuid());
+        elements << reinterpret_cast<EntityTreeElement*>((quintptr)(i + 1) * sizeof(void*));
+    }
+
+    EntityIDMap map;
+    QHash<EntityItemID, EntityTreeElement*> hash;
+
+    {
+        testsTaken++;
+        QString testName = "EntityIDMap matches QHash through inserts and removes";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        for (int i = 0; i < ENTITY_COUNT; i++) {
+            map.insert(ids[i], elements[i]);
+            hash.insert(ids[i], elements[i]);
+        }
+        // remove every third one, so the removes have to shift back the slots after them
+        for (int i = 0; i < ENTITY_COUNT; i += 3) {
+            map.remove(ids[i]);
+            hash.remove(ids[i]);
+        }
+
+        bool passed = map.size() == hash.size();
+        for (int i = 0; passed && i < ENTITY_COUNT; i++) {
+            passed = map.find(ids[i]) == hash.value(ids[i]);
+        }
+        passed = passed && !map.find(EntityItemID(QUuid::createUuid()));
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        const int TEST_ITERATIONS = 10;
+        QString testName = "Performance - EntityIDMap vs QHash lookups of " + QString::number(ENTITY_COUNT) + " IDs "
+            + QString::number(TEST_ITERATIONS) + " times";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        int mapFound = 0;
+        quint64 startMap = usecTimestampNow();
+        for (int iteration = 0; iteration < TEST_ITERATIONS; iteration++) {
+            for (int i = 0; i < ENTITY_COUNT; i++) {
+                mapFound += map.find(ids[i]) ? 1 : 0;
+            }
+        }
+        quint64 endMap = usecTimestampNow();
+
+        int hashFound = 0;
+        quint64 startHash = usecTimestampNow();
+        for (int iteration = 0; iteration < TEST_ITERATIONS; iteration++) {
+            for (int i = 0; i < ENTITY_COUNT; i++) {
+                hashFound += hash.value(ids[i]) ? 1 : 0;
+            }
+        }
+        quint64 endHash = usecTimestampNow();
+
+        bool passed = mapFound == hashFound;
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken <<":" << qPrintable(testName)
+                        << "elapsed EntityIDMap=" << (float)(endMap - startMap) / USECS_PER_MSECS << "msecs"
+                        << "elapsed QHash=" << (float)(endHash - startHash) / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
+void EntityTests::kinematicsTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "EntityTests::kinematicsTests()";
+
+    // the same entities in a tree with a simulation and in one without, which we simulate() one by one
+    const int ENTITY_COUNT = 100000;
+    SimpleEntitySimulation simulation;
+    EntityTree simulatedTree;
+    simulation.setEntityTree(&simulatedTree);
+    simulatedTree.setSimulation(&simulation);
+    EntityTree referenceTree;
+
+    QVector<EntityItem*> simulatedEntities;
+    QVector<EntityItem*> referenceEntities;
+    const float MARGIN = 10.0f; // meters, more than anything moves during the test
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        EntityItemID entityID(QUuid::createUuid());
+        entityID.isKnownID = false; // this is a temporary workaround to allow local tree entities to be added with known IDs
+        EntityItemProperties properties;
+        properties.setType(EntityTypes::Box);
+        properties.setVelocity(glm::vec3(randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f),
+                                         randFloatInRange(-1.0f, 1.0f)));
+
+        // a quarter of them fall from near the ground so they bounce, and a quarter are damped
+        float y = randFloatInRange(MARGIN, (float)TREE_SCALE - MARGIN);
+        if (i % 4 == 0) {
+            properties.setGravity(glm::vec3(0.0f, -9.8f, 0.0f));
+            y = randFloatInRange(0.0f, 0.1f);
+        }
+        properties.setDamping(i % 4 == 1 ? 0.5f : 0.0f);
+        properties.setPosition(glm::vec3(randFloatInRange(MARGIN, (float)TREE_SCALE - MARGIN), y,
+                                         randFloatInRange(MARGIN, (float)TREE_SCALE - MARGIN)));
+
+        EntityItem* simulatedEntity = simulatedTree.addEntity(entityID, properties);
+        EntityItem* referenceEntity = referenceTree.addEntity(entityID, properties);
+        if (simulatedEntity && referenceEntity) {
+            referenceEntity->setLastSimulated(simulatedEntity->getLastSimulated());
+            simulatedEntities << simulatedEntity;
+            referenceEntities << referenceEntity;
+        }
+    }
+
+    {
+        testsTaken++;
+        const int TICKS = 10;
+        QString testName = "Performance - SimpleEntitySimulation vs EntityItem::simulate() of "
+            + QString::number(simulatedEntities.size()) + " moving entities " + QString::number(TICKS) + " times";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        quint64 simulationTime = 0;
+        quint64 referenceTime = 0;
+        for (int tick = 0; tick < TICKS; tick++) {
+            quint64 start = usecTimestampNow();
+            simulatedTree.update();
+            simulationTime += usecTimestampNow() - start;
+
+            start = usecTimestampNow();
+            for (int i = 0; i < referenceEntities.size(); i++) {
+                referenceEntities[i]->simulate(simulatedEntities[i]->getLastSimulated());
+            }
+            referenceTime += usecTimestampNow() - start;
+        }
+
+        const float TOLERANCE = 0.001f; // meters, and meters per second
+        bool passed = simulatedEntities.size() == ENTITY_COUNT;
+        for (int i = 0; passed && i < simulatedEntities.size(); i++) {
+            float positionError = glm::distance(simulatedEntities[i]->getPosition(), referenceEntities[i]->getPosition());
+            float velocityError = glm::distance(simulatedEntities[i]->getVelocity(), referenceEntities[i]->getVelocity());
+            passed = positionError * (float)TREE_SCALE <= TOLERANCE && velocityError * (float)TREE_SCALE <= TOLERANCE;
+            if (!passed && verbose) {
+                qDebug() << "    entity" << i << "simulated position=" << simulatedEntities[i]->getPosition()
+                    << "reference position=" << referenceEntities[i]->getPosition();
+            }
+        }
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken <<":" << qPrintable(testName)
+                        << "elapsed SimpleEntitySimulation=" << (float)simulationTime / USECS_PER_MSECS << "msecs"
+                        << "elapsed simulate()=" << (float)referenceTime / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
+// every pair of the entities whose maximum cubes overlap, checked the slow way
+static QSet<EntityPair> findOverlappingPairs(const QVector<EntityItem*>& entities) {
+    QSet<EntityPair> pairs;
+    for (int i = 0; i < entities.size(); i++) {
+        AACube cubeA = entities[i]->getMaximumAACube();
+        for (int j = i + 1; j < entities.size(); j++) {
+            AACube cubeB = entities[j]->getMaximumAACube();
+            if (glm::all(glm::lessThanEqual(cubeA.getCorner(), cubeB.getMaximumPoint())) &&
+                    glm::all(glm::lessThanEqual(cubeB.getCorner(), cubeA.getMaximumPoint()))) {
+                pairs.insert(entities[i] < entities[j] ? EntityPair(entities[i], entities[j]) :
+                    EntityPair(entities[j], entities[i]));
+            }
+        }
+    }
+    return pairs;
+}
+
+void EntityTests::broadphaseTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "EntityTests::broadphaseTests()";
+
+    // boxes packed in a corner of the domain so plenty of them overlap
+    const int ENTITY_COUNT = 2000;
+    const float REGION = 200.0f; // meters
+    EntityTree tree;
+    QVector<EntityItem*> entities;
+    for (int i = 0; i < ENTITY_COUNT; i++) {
+        EntityItemID entityID(QUuid::createUuid());
+        entityID.isKnownID = false; // this is a temporary workaround to allow local tree entities to be added with known IDs
+        EntityItemProperties properties;
+        properties.setType(EntityTypes::Box);
+        properties.setPosition(glm::vec3(randFloatInRange(0.0f, REGION), randFloatInRange(0.0f, REGION),
+                                         randFloatInRange(0.0f, REGION)));
+        properties.setDimensions(glm::vec3(randFloatInRange(0.5f, 5.0f), randFloatInRange(0.5f, 5.0f),
+                                           randFloatInRange(0.5f, 5.0f)));
+        EntityItem* entity = tree.addEntity(entityID, properties);
+        if (entity) {
+            entities << entity;
+        }
+    }
+
+    {
+        testsTaken++;
+        const int TICKS = 100;
+        QString testName = "EntityBroadphase overlaps match every pair of " + QString::number(entities.size())
+            + " entities over " + QString::number(TICKS) + " updates";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        EntityBroadphase broadphase;
+        QSet<EntityItem*> allEntities;
+        foreach (EntityItem* entity, entities) {
+            broadphase.updateEntity(entity);
+            allEntities.insert(entity);
+        }
+
+        QVector<EntityItem*> inBroadphase = entities;
+        QVector<EntityItem*> outOfBroadphase;
+        quint64 updateTime = 0;
+        bool passed = true;
+        for (int tick = 0; passed && tick < TICKS; tick++) {
+            // nudge a tenth of them, and every so often take a few out or put a few back
+            const float MAX_STEP = 1.0f / (float)TREE_SCALE;
+            for (int i = 0; i < inBroadphase.size() / 10; i++) {
+                EntityItem* entity = inBroadphase[randIntInRange(0, inBroadphase.size() - 1)];
+                entity->setPosition(entity->getPosition() + glm::vec3(randFloatInRange(-MAX_STEP, MAX_STEP),
+                    randFloatInRange(-MAX_STEP, MAX_STEP), randFloatInRange(-MAX_STEP, MAX_STEP)));
+                broadphase.updateEntity(entity);
+            }
+            if (tick % 10 == 3) {
+                for (int i = 0; i < 5; i++) {
+                    int index = randIntInRange(0, inBroadphase.size() - 1);
+                    broadphase.removeEntity(inBroadphase[index]);
+                    outOfBroadphase << inBroadphase[index];
+                    inBroadphase.remove(index);
+                }
+            } else if (tick % 10 == 7) {
+                foreach (EntityItem* entity, outOfBroadphase) {
+                    broadphase.updateEntity(entity);
+                }
+                inBroadphase << outOfBroadphase;
+                outOfBroadphase.clear();
+            }
+
+            quint64 start = usecTimestampNow();
+            broadphase.update();
+            updateTime += usecTimestampNow() - start;
+
+            QVector<EntityPair> foundPairs;
+            broadphase.findPairs(allEntities, foundPairs);
+            QSet<EntityPair> pairs;
+            foreach (const EntityPair& pair, foundPairs) {
+                pairs.insert(pair.first < pair.second ? pair : EntityPair(pair.second, pair.first));
+            }
+            passed = pairs == findOverlappingPairs(inBroadphase) && pairs.size() == foundPairs.size();
+            if (!passed && verbose) {
+                qDebug() << "    tick" << tick << "found" << pairs.size() << "pairs, expected"
+                    << findOverlappingPairs(inBroadphase).size();
+            }
+        }
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken <<":" << qPrintable(testName)
+                        << "elapsed=" << (float)updateTime / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
+void EntityTests::deletionLogTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "EntityTests::deletionLogTests()";
+
+    {
+        testsTaken++;
+        const int STEPS = 20000;
+        QString testName = "EntityDeletionLog readers get every delete since they were added, in order, over "
+            + QString::number(STEPS) + " steps";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        // each reader's expected unread deletes, kept the slow way
+        EntityDeletionLog log;
+        QHash<int, QVector<QUuid> > unread;
+        quint64 deletedAt = 0;
+        bool passed = true;
+        for (int step = 0; passed && step < STEPS; step++) {
+            int action = randIntInRange(0, 99);
+            if (action < 2 || unread.isEmpty()) {
+                unread.insert(log.addReader(), QVector<QUuid>());
+            } else if (action < 4) {
+                int reader = unread.keys().at(randIntInRange(0, unread.size() - 1));
+                log.removeReader(reader);
+                unread.remove(reader);
+            } else if (action < 60) {
+                // deletes come in bursts, so the ring has to grow and wrap
+                int count = randIntInRange(1, action < 6 ? 500 : 5);
+                for (int i = 0; i < count; i++) {
+                    QUuid entityID = QUuid::createUuid();
+                    log.append(++deletedAt, entityID);
+                    for (QHash<int, QVector<QUuid> >::iterator reader = unread.begin(); reader != unread.end(); ++reader) {
+                        reader.value() << entityID;
+                    }
+                }
+            } else {
+                int reader = unread.keys().at(randIntInRange(0, unread.size() - 1));
+                int maxCount = randIntInRange(0, 100);
+                QVector<QUuid> entityIDs;
+                int count = log.read(reader, maxCount, entityIDs);
+                QVector<QUuid>& expected = unread[reader];
+                int expectedCount = qMin(maxCount, expected.size());
+                passed = count == expectedCount && entityIDs == expected.mid(0, expectedCount);
+                expected.remove(0, expectedCount);
+            }
+
+            // the log keeps exactly what the slowest reader hasn't read
+            int slowest = 0;
+            for (QHash<int, QVector<QUuid> >::const_iterator reader = unread.constBegin(); reader != unread.constEnd();
+                    ++reader) {
+                slowest = qMax(slowest, reader.value().size());
+                passed = passed && log.hasUnread(reader.key()) == !reader.value().isEmpty();
+            }
+            passed = passed && log.size() == slowest && log.getReaderCount() == unread.size();
+            if (!passed && verbose) {
+                qDebug() << "    step" << step << "log has" << log.size() << "deletes, expected" << slowest;
+            }
+        }
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        const int DELETE_COUNT = 50000;
+        const int READER_COUNT = 8;
+        const int IDS_PER_PACKET = 85;
+        QString testName = "Performance - EntityDeletionLog " + QString::number(DELETE_COUNT) + " deletes read by "
+            + QString::number(READER_COUNT) + " readers a packet at a time";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        QVector<QUuid> deletedIDs;
+        for (int i = 0; i < DELETE_COUNT; i++) {
+            deletedIDs << QUuid::createUuid();
+        }
+
+        quint64 start = usecTimestampNow();
+        EntityDeletionLog log;
+        QVector<int> readers;
+        for (int i = 0; i < READER_COUNT; i++) {
+            readers << log.addReader();
+        }
+        for (int i = 0; i < DELETE_COUNT; i++) {
+            log.append(start, deletedIDs.at(i));
+        }
+        int readCount = 0;
+        foreach (int reader, readers) {
+            QVector<QUuid> entityIDs;
+            while (log.hasUnread(reader)) {
+                entityIDs.clear();
+                readCount += log.read(reader, IDS_PER_PACKET, entityIDs);
+            }
+        }
+        quint64 end = usecTimestampNow();
+
+        bool passed = readCount == DELETE_COUNT * READER_COUNT && log.size() == 0;
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken <<":" << qPrintable(testName)
+                        << "elapsed=" << (float)(end - start) / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
 void EntityTests::runAllTests(bool verbose) {
     entityTreeTests(verbose);
+    entityIDMapTests(verbose);
+    kinematicsTests(verbose);
+    broadphaseTests(verbose);
+    deletionLogTests(verbose);
 }
 
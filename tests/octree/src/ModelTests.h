@@ -14,6 +14,10 @@
 
 namespace EntityTests {
     void entityTreeTests(bool verbose = false);
+    void entityIDMapTests(bool verbose = false);
+    void kinematicsTests(bool verbose = false);
+    void broadphaseTests(bool verbose = false);
+    void deletionLogTests(bool verbose = false);
     void runAllTests(bool verbose = false);
 }
 
@@ -19,9 +19,11 @@
 #include <EntityTree.h>
 #include <EntityTreeElement.h>
 #include <Octree.h>
+#include <OctreeElementBag.h>
 #include <OctreeConstants.h>
 #include <PropertyFlags.h>
 #include <SharedUtil.h>
+#include <ViewFrustum.h>
 
 #include "OctreeTests.h"
 
@@ -50,6 +52,14 @@ enum ExamplePropertyList {
 
 typedef PropertyFlags<ExamplePropertyList> ExamplePropertyFlags;
 
+// an enum without PropertyFlagsTraits, so its flags stay in a QBitArray to check the inline ones against
+enum FuzzPropertyList {
+    FUZZ_PROP_FIRST = 0,
+    FUZZ_PROP_LAST = 63,
+};
+
+typedef PropertyFlags<FuzzPropertyList> FuzzPropertyFlags;
+
 
 void OctreeTests::propertyFlagsTests(bool verbose) {
     int testsTaken = 0;
@@ -883,6 +893,633 @@ void OctreeTests::propertyFlagsTests(bool verbose) {
     }
 }
 
+// applies the same random operation to the flags kept inline and to the ones kept in a QBitArray
+static void applyRandomPropertyFlagsOperation(EntityPropertyFlags& flags, EntityPropertyFlags& otherFlags,
+                                              FuzzPropertyFlags& fuzzFlags, FuzzPropertyFlags& otherFuzzFlags) {
+    const int FLAG_COUNT = PROP_LAST_ITEM + 1;
+    int flag = randIntInRange(0, FLAG_COUNT - 1);
+    bool value = randomBoolean();
+    switch (randIntInRange(0, 13)) {
+        case 0:
+            flags.setHasProperty((EntityPropertyList)flag, value);
+            fuzzFlags.setHasProperty((FuzzPropertyList)flag, value);
+            break;
+        case 1:
+            otherFlags.setHasProperty((EntityPropertyList)flag, value);
+            otherFuzzFlags.setHasProperty((FuzzPropertyList)flag, value);
+            break;
+        case 2:
+            flags |= otherFlags;
+            fuzzFlags |= otherFuzzFlags;
+            break;
+        case 3:
+            flags &= otherFlags;
+            fuzzFlags &= otherFuzzFlags;
+            break;
+        case 4:
+            flags ^= otherFlags;
+            fuzzFlags ^= otherFuzzFlags;
+            break;
+        case 5:
+            flags += otherFlags;
+            fuzzFlags += otherFuzzFlags;
+            break;
+        case 6:
+            flags -= otherFlags;
+            fuzzFlags -= otherFuzzFlags;
+            break;
+        case 7:
+            flags = flags | (EntityPropertyList)flag;
+            fuzzFlags = fuzzFlags | (FuzzPropertyList)flag;
+            break;
+        case 8:
+            flags = flags & (EntityPropertyList)flag;
+            fuzzFlags = fuzzFlags & (FuzzPropertyList)flag;
+            break;
+        case 9:
+            flags = flags ^ (EntityPropertyList)flag;
+            fuzzFlags = fuzzFlags ^ (FuzzPropertyList)flag;
+            break;
+        case 10:
+            otherFlags = ~flags;
+            otherFuzzFlags = ~fuzzFlags;
+            break;
+        case 11:
+            flags = otherFlags;
+            fuzzFlags = otherFuzzFlags;
+            break;
+        case 12:
+            otherFlags.clear();
+            otherFuzzFlags.clear();
+            break;
+        case 13:
+            flags.decode(otherFlags.encode());
+            fuzzFlags.decode(otherFuzzFlags.encode());
+            break;
+    }
+}
+
+// PropertyFlags::encode() and decode() as they were before the flags could be kept inline, so that the wire format is
+// checked against the original code rather than against itself
+static QByteArray referencePropertyFlagsEncode(const QBitArray& flags, int minFlag, int maxFlag) {
+    QByteArray output;
+    
+    if (maxFlag < minFlag) {
+        output.fill(0, 1);
+        return output; // no flags... nothing to encode
+    }
+
+    // we should size the array to the correct size.
+    int lengthInBytes = (maxFlag / (BITS_PER_BYTE - 1)) + 1;
+
+    output.fill(0, lengthInBytes);
+
+    // next pack the number of header bits in, the first N-1 to be set to 1, the last to be set to 0
+    for(int i = 0; i < lengthInBytes; i++) {
+        int outputIndex = i;
+        int bitValue = (i < (lengthInBytes - 1)  ? 1 : 0);
+        char original = output.at(outputIndex / BITS_PER_BYTE);
+        int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
+        char thisBit = ( bitValue << shiftBy);
+        output[i / BITS_PER_BYTE] = (original | thisBit);
+    }
+
+    // finally pack the the actual bits from the bit array
+    for(int i = lengthInBytes; i < (lengthInBytes + maxFlag + 1); i++) {
+        int flagIndex = i - lengthInBytes;
+        int outputIndex = i;
+        int bitValue = ( flags[flagIndex]  ? 1 : 0);
+        char original = output.at(outputIndex / BITS_PER_BYTE);
+        int shiftBy = BITS_PER_BYTE - ((outputIndex % BITS_PER_BYTE) + 1);
+        char thisBit = ( bitValue << shiftBy);
+        output[i / BITS_PER_BYTE] = (original | thisBit);
+    }
+    
+    return output;
+}
+
+static QBitArray referencePropertyFlagsDecode(const QByteArray& fromEncodedBytes, int& encodedLength) {
+    QBitArray flags;
+
+    // first convert the ByteArray into a BitArray...
+    QBitArray encodedBits;
+    int bitCount = BITS_PER_BYTE * fromEncodedBytes.count();
+    encodedBits.resize(bitCount);
+    
+    for(int byte = 0; byte < fromEncodedBytes.count(); byte++) {
+        char originalByte = fromEncodedBytes.at(byte);
+        for(int bit = 0; bit < BITS_PER_BYTE; bit++) {
+            int shiftBy = BITS_PER_BYTE - (bit + 1);
+            char maskBit = ( 1 << shiftBy);
+            bool bitValue = originalByte & maskBit;
+            encodedBits.setBit(byte * BITS_PER_BYTE + bit, bitValue);
+        }
+    }
+    
+    // next, read the leading bits to determine the correct number of bytes to decode (may not match the QByteArray)
+    int encodedByteCount = 0;
+    int leadBits = 1;
+    int bitAt;
+    for (bitAt = 0; bitAt < bitCount; bitAt++) {
+        if (encodedBits.at(bitAt)) {
+            encodedByteCount++;
+            leadBits++;
+        } else {
+            break;
+        }
+    }
+    encodedByteCount++; // always at least one byte
+    encodedLength = encodedByteCount;
+
+    int expectedBitCount = encodedByteCount * BITS_PER_BYTE;
+    
+    // Now, keep reading...
+    if (expectedBitCount <= (encodedBits.size() - leadBits)) {
+        int flagsStartAt = bitAt + 1; 
+        for (bitAt = flagsStartAt; bitAt < expectedBitCount; bitAt++) {
+            if (encodedBits.at(bitAt)) {
+                int flag = bitAt - flagsStartAt;
+                if (flag >= flags.size()) {
+                    flags.resize(flag + 1);
+                }
+                flags.setBit(flag);
+            }
+        }
+    }
+    return flags;
+}
+
+template<typename Enum> static bool propertyFlagsEncodeLikeReference(PropertyFlags<Enum>& flags) {
+    QBitArray bits;
+    if (flags.lastFlag() >= flags.firstFlag()) {
+        bits.resize((int)flags.lastFlag() + 1);
+        for (int flag = 0; flag <= (int)flags.lastFlag(); flag++) {
+            bits.setBit(flag, flags.getHasProperty((Enum)flag));
+        }
+    }
+    return flags.encode() == referencePropertyFlagsEncode(bits, (int)flags.firstFlag(), (int)flags.lastFlag());
+}
+
+static bool propertyFlagsMatch(EntityPropertyFlags& flags, FuzzPropertyFlags& fuzzFlags) {
+    if (!propertyFlagsEncodeLikeReference(flags) || !propertyFlagsEncodeLikeReference(fuzzFlags)) {
+        return false;
+    }
+    if (flags.encode() != fuzzFlags.encode() || flags.getEncodedLength() != fuzzFlags.getEncodedLength() ||
+            !flags != !fuzzFlags || (int)flags.firstFlag() != (int)fuzzFlags.firstFlag() ||
+            (int)flags.lastFlag() != (int)fuzzFlags.lastFlag()) {
+        return false;
+    }
+    for (int flag = FUZZ_PROP_FIRST; flag <= FUZZ_PROP_LAST; flag++) {
+        if (flags.getHasProperty((EntityPropertyList)flag) != fuzzFlags.getHasProperty((FuzzPropertyList)flag)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void OctreeTests::propertyFlagsFuzzTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "OctreeTests::propertyFlagsFuzzTests()";
+
+    {
+        testsTaken++;
+        const int OPERATIONS = 100000;
+        QString testName = "EntityPropertyFlags match QBitArray flags and the original encoder through "
+            + QString::number(OPERATIONS) + " random operations";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        EntityPropertyFlags flags, otherFlags;
+        FuzzPropertyFlags fuzzFlags, otherFuzzFlags;
+        bool passed = true;
+        for (int i = 0; passed && i < OPERATIONS; i++) {
+            applyRandomPropertyFlagsOperation(flags, otherFlags, fuzzFlags, otherFuzzFlags);
+            passed = propertyFlagsMatch(flags, fuzzFlags) && propertyFlagsMatch(otherFlags, otherFuzzFlags) &&
+                (flags == otherFlags) == (fuzzFlags == otherFuzzFlags);
+            if (!passed && verbose) {
+                qDebug() << "    operation" << i << "left them different";
+                flags.debugDumpBits();
+                fuzzFlags.debugDumpBits();
+            }
+        }
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        const int BUFFERS = 100000;
+        const int MAX_BUFFER_LENGTH = 12;
+        QString testName = "EntityPropertyFlags decode " + QString::number(BUFFERS)
+            + " random buffers like the original decoder";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        bool passed = true;
+        for (int i = 0; passed && i < BUFFERS; i++) {
+            // mostly leading ones, so the lengths run past the end of the buffer as well as short of it
+            unsigned char buffer[MAX_BUFFER_LENGTH];
+            int length = randIntInRange(0, MAX_BUFFER_LENGTH);
+            for (int j = 0; j < length; j++) {
+                buffer[j] = randomBoolean() ? 0xFF : (unsigned char)randIntInRange(0, 255);
+            }
+            EntityPropertyFlags flags;
+            FuzzPropertyFlags fuzzFlags(QByteArray((const char*)buffer, length));
+            int referenceLength;
+            QBitArray referenceFlags = referencePropertyFlagsDecode(QByteArray((const char*)buffer, length),
+                                                                    referenceLength);
+            passed = flags.decode(buffer, length) == referenceLength && fuzzFlags.getEncodedLength() == referenceLength;
+
+            // the inline flags only hold as many as the enum could ever need
+            for (int flag = FUZZ_PROP_FIRST; passed && flag < referenceFlags.size(); flag++) {
+                bool referenceHasFlag = referenceFlags.testBit(flag);
+                passed = fuzzFlags.getHasProperty((FuzzPropertyList)flag) == referenceHasFlag &&
+                    (flag > FUZZ_PROP_LAST || flags.getHasProperty((EntityPropertyList)flag) == referenceHasFlag);
+            }
+            for (int flag = referenceFlags.size(); passed && flag <= FUZZ_PROP_LAST; flag++) {
+                passed = !flags.getHasProperty((EntityPropertyList)flag) && !fuzzFlags.getHasProperty((FuzzPropertyList)flag);
+            }
+            if (passed && (int)fuzzFlags.lastFlag() <= FUZZ_PROP_LAST) {
+                passed = flags.encode() == fuzzFlags.encode();
+            }
+        }
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        const int ITERATIONS = 1000000;
+        QString testName = "Performance - EntityPropertyFlags vs QBitArray flags copied, combined and encoded "
+            + QString::number(ITERATIONS) + " times";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        // what appendEntityData() does with them for each entity
+        EntityPropertyFlags requested;
+        FuzzPropertyFlags fuzzRequested;
+        for (int flag = PROP_VISIBLE; flag <= PROP_LAST_ITEM; flag += 2) {
+            requested.setHasProperty((EntityPropertyList)flag);
+            fuzzRequested.setHasProperty((FuzzPropertyList)flag);
+        }
+        unsigned char buffer[EntityPropertyFlags::MAX_ENCODED_LENGTH];
+        int totalLength = 0;
+
+        quint64 start = usecTimestampNow();
+        for (int i = 0; i < ITERATIONS; i++) {
+            EntityPropertyFlags flags(PROP_LAST_ITEM);
+            EntityPropertyFlags didntFit = requested;
+            flags -= PROP_LAST_ITEM;
+            flags |= requested;
+            didntFit -= flags;
+            totalLength += flags.encode(buffer, sizeof(buffer));
+        }
+        quint64 end = usecTimestampNow();
+
+        int fuzzTotalLength = 0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            FuzzPropertyFlags flags((FuzzPropertyList)PROP_LAST_ITEM);
+            FuzzPropertyFlags didntFit = fuzzRequested;
+            flags -= (FuzzPropertyList)PROP_LAST_ITEM;
+            flags |= fuzzRequested;
+            didntFit -= flags;
+            fuzzTotalLength += flags.encode().size();
+        }
+        quint64 fuzzEnd = usecTimestampNow();
+
+        if (totalLength == fuzzTotalLength) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken << ":" << qPrintable(testName)
+                        << "elapsed EntityPropertyFlags=" << (float)(end - start) / USECS_PER_MSECS << "msecs"
+                        << "QBitArray=" << (float)(fuzzEnd - end) / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
+
+// a frustum somewhere in the domain looking any which way, sometimes with a keyhole
+static void randomizeViewFrustum(ViewFrustum& viewFrustum) {
+    viewFrustum.setPosition(glm::vec3(randFloatInRange(0.0f, TREE_SCALE), randFloatInRange(0.0f, TREE_SCALE),
+                                      randFloatInRange(0.0f, TREE_SCALE)));
+    viewFrustum.setOrientation(glm::quat(glm::vec3(randFloatInRange(-PI, PI), randFloatInRange(-PI, PI),
+                                                   randFloatInRange(-PI, PI))));
+    viewFrustum.setFieldOfView(randFloatInRange(30.0f, 120.0f));
+    viewFrustum.setAspectRatio(randFloatInRange(0.5f, 2.0f));
+    viewFrustum.setNearClip(randFloatInRange(0.01f, 1.0f));
+    viewFrustum.setFarClip(randFloatInRange(100.0f, TREE_SCALE));
+    viewFrustum.setKeyholeRadius(randomBoolean() ? randFloatInRange(0.0f, 1000.0f) : -1.0f);
+    viewFrustum.calculate();
+}
+
+// a cube the size of an element at a random level, half of them around the camera where the planes and keyhole are
+static AACube randomElementCube(const ViewFrustum& viewFrustum) {
+    const int MAX_LEVEL = 14;
+    int level = randIntInRange(0, MAX_LEVEL);
+    float scale = 1.0f / (1 << level);
+    glm::vec3 corner;
+    if (randomBoolean()) {
+        glm::vec3 position = viewFrustum.getPosition() / (float)TREE_SCALE;
+        corner = glm::floor(position / scale) * scale;
+    } else {
+        int elements = (1 << level) - 1;
+        corner = glm::vec3(randIntInRange(0, elements), randIntInRange(0, elements), randIntInRange(0, elements)) * scale;
+    }
+    AACube cube(corner, scale);
+    cube.scale(TREE_SCALE);
+    return cube;
+}
+
+void OctreeTests::childrenInFrustumTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "OctreeTests::childrenInFrustumTests()";
+
+    {
+        testsTaken++;
+        const int FRUSTUMS = 1000;
+        const int CUBES_PER_FRUSTUM = 100;
+        QString testName = "childrenInFrustum() matches cubeInFrustum() for the children of "
+            + QString::number(FRUSTUMS * CUBES_PER_FRUSTUM) + " random cubes";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        bool passed = true;
+        for (int i = 0; passed && i < FRUSTUMS; i++) {
+            ViewFrustum viewFrustum;
+            randomizeViewFrustum(viewFrustum);
+            for (int j = 0; passed && j < CUBES_PER_FRUSTUM; j++) {
+                AACube cube = randomElementCube(viewFrustum);
+                unsigned char insideMask = 0;
+                unsigned char intersectMask = 0;
+                viewFrustum.childrenInFrustum(cube, insideMask, intersectMask);
+                float distances[NUMBER_OF_CHILDREN];
+                viewFrustum.childDistancesToCamera(cube, distances);
+
+                float childScale = cube.getScale() / 2.0f;
+                for (int child = 0; passed && child < NUMBER_OF_CHILDREN; child++) {
+                    glm::vec3 offset((child & 4) ? childScale : 0.0f, (child & 2) ? childScale : 0.0f,
+                                     (child & 1) ? childScale : 0.0f);
+                    AACube childCube(cube.getCorner() + offset, childScale);
+                    ViewFrustum::location expected = viewFrustum.cubeInFrustum(childCube);
+                    ViewFrustum::location location = (insideMask & (1 << child)) ? ViewFrustum::INSIDE :
+                        ((intersectMask & (1 << child)) ? ViewFrustum::INTERSECT : ViewFrustum::OUTSIDE);
+                    float expectedDistance = glm::distance(viewFrustum.getPosition(), childCube.calcCenter());
+                    const float DISTANCE_EPSILON = 0.0001f;
+                    passed = location == expected && !(insideMask & intersectMask & (1 << child)) &&
+                        fabsf(distances[child] - expectedDistance) <= DISTANCE_EPSILON * expectedDistance;
+                    if (!passed && verbose) {
+                        qDebug() << "    child" << child << "of" << cube << "was" << location << "expected" << expected
+                            << "distance" << distances[child] << "expected" << expectedDistance;
+                    }
+                }
+            }
+        }
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        const int FRUSTUMS = 100;
+        const int CUBES_PER_FRUSTUM = 10000;
+        QString testName = "Performance - childrenInFrustum() vs cubeInFrustum() for the children of "
+            + QString::number(FRUSTUMS * CUBES_PER_FRUSTUM) + " cubes";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        QVector<ViewFrustum> viewFrustums(FRUSTUMS);
+        QVector<AACube> cubes;
+        for (int i = 0; i < FRUSTUMS; i++) {
+            randomizeViewFrustum(viewFrustums[i]);
+            for (int j = 0; j < CUBES_PER_FRUSTUM; j++) {
+                cubes << randomElementCube(viewFrustums.at(i));
+            }
+        }
+
+        int inView = 0;
+        quint64 start = usecTimestampNow();
+        for (int i = 0; i < cubes.size(); i++) {
+            unsigned char insideMask = 0;
+            unsigned char intersectMask = 0;
+            viewFrustums.at(i / CUBES_PER_FRUSTUM).childrenInFrustum(cubes.at(i), insideMask, intersectMask);
+            for (int child = 0; child < NUMBER_OF_CHILDREN; child++) {
+                inView += ((insideMask | intersectMask) >> child) & 1;
+            }
+        }
+        quint64 end = usecTimestampNow();
+
+        int oneAtATimeInView = 0;
+        for (int i = 0; i < cubes.size(); i++) {
+            const AACube& cube = cubes.at(i);
+            float childScale = cube.getScale() / 2.0f;
+            for (int child = 0; child < NUMBER_OF_CHILDREN; child++) {
+                glm::vec3 offset((child & 4) ? childScale : 0.0f, (child & 2) ? childScale : 0.0f,
+                                 (child & 1) ? childScale : 0.0f);
+                AACube childCube(cube.getCorner() + offset, childScale);
+                if (viewFrustums.at(i / CUBES_PER_FRUSTUM).cubeInFrustum(childCube) != ViewFrustum::OUTSIDE) {
+                    oneAtATimeInView++;
+                }
+            }
+        }
+        quint64 oneAtATimeEnd = usecTimestampNow();
+
+        if (inView == oneAtATimeInView) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+        float USECS_PER_MSECS = 1000.0f;
+        qDebug() << "TIME - Test" << testsTaken << ":" << qPrintable(testName)
+                        << "elapsed childrenInFrustum=" << (float)(end - start) / USECS_PER_MSECS << "msecs"
+                        << "cubeInFrustum=" << (float)(oneAtATimeEnd - end) / USECS_PER_MSECS << "msecs";
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
+
+// true if the extracted elements are exactly the expected ones, once each, with the column in order among them
+static bool elementBagOrderMatches(const QVector<OctreeElement*>& extracted, const QSet<OctreeElement*>& expected,
+                                   const QVector<OctreeElement*>& column) {
+    if (extracted.size() != expected.size() || extracted.toList().toSet() != expected) {
+        return false;
+    }
+    int lastColumnIndex = -1;
+    foreach (OctreeElement* element, column) {
+        int index = extracted.indexOf(element);
+        if (index < lastColumnIndex) {
+            return false;
+        }
+        lastColumnIndex = index;
+    }
+    return extracted.first() == column.first();
+}
+
+void OctreeTests::elementBagTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+
+    qDebug() << "OctreeTests::elementBagTests()";
+
+    // a grid of elements, and the column of them along z at the x = 0, y = 0 edge
+    EntityTree tree;
+    const int ELEMENTS_PER_SIDE = 4;
+    const float ELEMENT_SCALE = 1.0f / ELEMENTS_PER_SIDE;
+    QVector<OctreeElement*> elements;
+    QVector<OctreeElement*> column;
+    for (int x = 0; x < ELEMENTS_PER_SIDE; x++) {
+        for (int y = 0; y < ELEMENTS_PER_SIDE; y++) {
+            for (int z = 0; z < ELEMENTS_PER_SIDE; z++) {
+                OctreeElement* element = tree.getOrCreateChildElementAt(x * ELEMENT_SCALE, y * ELEMENT_SCALE,
+                                                                        z * ELEMENT_SCALE, ELEMENT_SCALE);
+                elements << element;
+                if (x == 0 && y == 0) {
+                    column << element;
+                }
+            }
+        }
+    }
+
+    // looking down the column from its far end, and back up it from its near end
+    ViewFrustum fromFarEnd;
+    fromFarEnd.setPosition(glm::vec3(ELEMENT_SCALE / 2.0f, ELEMENT_SCALE / 2.0f, 1.0f) * (float)TREE_SCALE);
+    fromFarEnd.setOrientation(glm::quat()); // looking down -z
+    ViewFrustum fromNearEnd;
+    fromNearEnd.setPosition(glm::vec3(ELEMENT_SCALE / 2.0f, ELEMENT_SCALE / 2.0f, 0.0f) * (float)TREE_SCALE);
+    fromNearEnd.setOrientation(glm::quat(glm::vec3(0.0f, PI, 0.0f))); // looking down +z
+    QVector<OctreeElement*> reversedColumn;
+    for (int i = column.size() - 1; i >= 0; i--) {
+        reversedColumn << column.at(i);
+    }
+
+    {
+        testsTaken++;
+        QString testName = "bag gives out each element once, the one the camera is in first and then the nearest in front";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        OctreeElementBag bag;
+        bag.setPriorityView(fromFarEnd);
+        QSet<OctreeElement*> expected;
+        foreach (OctreeElement* element, elements) {
+            bag.insert(element);
+            bag.insert(element);
+            expected.insert(element);
+        }
+        OctreeElement* removed = elements.last();
+        bag.remove(removed);
+        expected.remove(removed);
+
+        bool passed = bag.count() == expected.size() && !bag.contains(removed);
+        QVector<OctreeElement*> extracted;
+        while (!bag.isEmpty()) {
+            extracted << bag.extract();
+        }
+        passed = passed && bag.extract() == NULL && elementBagOrderMatches(extracted, expected, column);
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "bag ranks what it holds again when the view changes";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken << ":" << qPrintable(testName);
+        }
+
+        OctreeElementBag bag;
+        bag.setPriorityView(fromFarEnd);
+        QSet<OctreeElement*> expected;
+        foreach (OctreeElement* element, elements) {
+            bag.insert(element);
+            expected.insert(element);
+        }
+
+        // take some out, turn around, then put them back
+        QVector<OctreeElement*> extracted;
+        const int TAKEN_BEFORE_TURNING = 10;
+        for (int i = 0; i < TAKEN_BEFORE_TURNING; i++) {
+            extracted << bag.extract();
+        }
+        bag.setPriorityView(fromNearEnd);
+        foreach (OctreeElement* element, extracted) {
+            bag.insert(element);
+        }
+        extracted.clear();
+        while (!bag.isEmpty()) {
+            extracted << bag.extract();
+        }
+        bool passed = elementBagOrderMatches(extracted, expected, reversedColumn);
+
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken << ":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (verbose) {
+        qDebug() << "******************************************************************************************";
+    }
+}
 
 typedef ByteCountCoded<unsigned int> ByteCountCodedUINT;
 typedef ByteCountCoded<quint64> ByteCountCodedQUINT64;
@@ -1440,6 +2077,9 @@ void OctreeTests::modelItemTests(bool verbose) {
 
 void OctreeTests::runAllTests(bool verbose) {
     propertyFlagsTests(verbose);
+    propertyFlagsFuzzTests(verbose);
+    childrenInFrustumTests(verbose);
+    elementBagTests(verbose);
     byteCountCodingTests(verbose);
     modelItemTests(verbose);
 }
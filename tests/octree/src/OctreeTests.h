@@ -15,6 +15,9 @@
 namespace OctreeTests {
 
     void propertyFlagsTests(bool verbose);
+    void propertyFlagsFuzzTests(bool verbose);
+    void childrenInFrustumTests(bool verbose);
+    void elementBagTests(bool verbose);
     void byteCountCodingTests(bool verbose);
     void modelItemTests(bool verbose);
 
@@ -18,6 +18,10 @@ int main(int argc, const char* argv[]) {
     bool verbose = cmdOptionExists(argc, argv, VERBOSE);
     qDebug() << "OctreeTests::runAllTests()";
     //OctreeTests::runAllTests(verbose);
+    OctreeTests::propertyFlagsTests(verbose);
+    OctreeTests::propertyFlagsFuzzTests(verbose);
+    OctreeTests::childrenInFrustumTests(verbose);
+    OctreeTests::elementBagTests(verbose);
     //AABoxCubeTests::runAllTests(verbose);
     EntityTests::runAllTests(verbose);
     return 0;
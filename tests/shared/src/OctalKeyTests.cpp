@@ -0,0 +1,86 @@
+//
+//  OctalKeyTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cassert>
+#include <cstdlib>
+
+#include "OctalKeyTests.h"
+
+void OctalKeyTests::runAllTests() {
+    roundTripTest();
+    ancestorTest();
+    tooDeepTest();
+}
+
+// builds the code one child at a time, the way elements get theirs
+static unsigned char* randomOctalCode(int sections, OctalKey& expectedKey) {
+    unsigned char* octalCode = new unsigned char[1];
+    *octalCode = 0;
+    expectedKey = ROOT_OCTAL_KEY;
+    for (int i = 0; i < sections; i++) {
+        int childNumber = rand() % 8;
+        unsigned char* childCode = childOctalCode(octalCode, childNumber);
+        delete[] octalCode;
+        octalCode = childCode;
+        expectedKey = childOctalKey(expectedKey, childNumber);
+    }
+    return octalCode;
+}
+
+void OctalKeyTests::roundTripTest() {
+    for (int sections = 0; sections <= MAX_OCTAL_KEY_SECTIONS; sections++) {
+        for (int i = 0; i < 100; i++) {
+            OctalKey expectedKey;
+            unsigned char* octalCode = randomOctalCode(sections, expectedKey);
+
+            OctalKey key = octalKeyForCode(octalCode);
+            assert(key == expectedKey);
+            assert(numberOfSectionsInOctalKey(key) == sections);
+
+            unsigned char* roundTripCode = octalCodeForKey(key);
+            assert(compareOctalCodes(octalCode, roundTripCode) == EXACT_MATCH);
+
+            delete[] roundTripCode;
+            delete[] octalCode;
+        }
+    }
+}
+
+void OctalKeyTests::ancestorTest() {
+    for (int i = 0; i < 1000; i++) {
+        OctalKey firstKey;
+        OctalKey secondKey;
+        unsigned char* firstCode = randomOctalCode(rand() % (MAX_OCTAL_KEY_SECTIONS + 1), firstKey);
+        unsigned char* secondCode = randomOctalCode(rand() % (MAX_OCTAL_KEY_SECTIONS + 1), secondKey);
+
+        // the keys agree with the codes, and every key is under the root and its own ancestors
+        assert(isAncestorOfKey(firstKey, secondKey) == isAncestorOf(firstCode, secondCode));
+        assert(isAncestorOfKey(secondKey, firstKey) == isAncestorOf(secondCode, firstCode));
+        assert(isAncestorOfKey(ROOT_OCTAL_KEY, firstKey));
+        int sections = numberOfSectionsInOctalKey(firstKey);
+        for (int up = 0; up <= sections; up++) {
+            assert(isAncestorOfKey(ancestorOctalKey(firstKey, up), firstKey));
+            assert(ancestorOctalKeyForCode(firstCode, sections - up) == ancestorOctalKey(firstKey, up));
+        }
+
+        delete[] firstCode;
+        delete[] secondCode;
+    }
+}
+
+void OctalKeyTests::tooDeepTest() {
+    OctalKey expectedKey;
+    unsigned char* octalCode = randomOctalCode(MAX_OCTAL_KEY_SECTIONS + 1, expectedKey);
+    assert(octalKeyForCode(octalCode) == INVALID_OCTAL_KEY);
+    assert(numberOfSectionsInOctalKey(ancestorOctalKeyForCode(octalCode, MAX_OCTAL_KEY_SECTIONS)) ==
+           MAX_OCTAL_KEY_SECTIONS);
+    assert(octalCodeForKey(INVALID_OCTAL_KEY) == NULL);
+    delete[] octalCode;
+}
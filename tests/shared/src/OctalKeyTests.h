@@ -0,0 +1,25 @@
+//
+//  OctalKeyTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctalKeyTests_h
+#define hifi_OctalKeyTests_h
+
+#include "OctalCode.h"
+
+namespace OctalKeyTests {
+
+    void runAllTests();
+
+    void roundTripTest();
+    void ancestorTest();
+    void tooDeepTest();
+};
+
+#endif // hifi_OctalKeyTests_h
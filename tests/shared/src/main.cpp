@@ -11,11 +11,13 @@
 #include "AngularConstraintTests.h"
 #include "MovingPercentileTests.h"
 #include "MovingMinMaxAvgTests.h"
+#include "OctalKeyTests.h"
 
 int main(int argc, char** argv) {
     MovingMinMaxAvgTests::runAllTests();
     MovingPercentileTests::runAllTests();
     AngularConstraintTests::runAllTests();
+    OctalKeyTests::runAllTests();
     printf("tests complete, press enter to exit\n");
     getchar();
     return 0;
@@ -0,0 +1,402 @@
+//
+//  PacketReplayer.cpp
+//  tools/packet-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtNetwork/QNetworkRequest>
+
+#include <HifiConfigVariantMap.h>
+#include <NetworkAccessManager.h>
+#include <NodeList.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "PacketReplayer.h"
+
+const QString CAPTURE_OPTION = "capture";
+const QString TARGET_OPTION = "target";
+const QString DOMAIN_OPTION = "domain";
+const QString SPEED_OPTION = "speed";
+const QString FAN_OUT_OPTION = "fanout";
+const QString LOOP_OPTION = "loop";
+const QString SENDER_OPTION = "sender";
+const QString REPORT_OPTION = "report";
+
+const QString DEFAULT_TARGET_NAME = "avatar-mixer";
+const int REPLAY_TICK_MSECS = 1;
+const int STATS_REPORT_INTERVAL_MSECS = 5 * 1000;
+const qint64 NSECS_PER_USEC = 1000;
+
+// packets that belong to the captured session itself (domain handshake, pings, STUN) can't be replayed as-is, our own
+// NodeList does that part of the conversation for us
+static bool isReplayablePacketType(PacketType packetType) {
+    switch (packetType) {
+        case PacketTypeUnknown:
+        case PacketTypeStunResponse:
+        case PacketTypeDomainList:
+        case PacketTypeDomainListRequest:
+        case PacketTypeDomainConnectRequest:
+        case PacketTypeDomainConnectionDenied:
+        case PacketTypeDomainServerRequireDTLS:
+        case PacketTypeCreateAssignment:
+        case PacketTypeRequestAssignment:
+        case PacketTypeNodeJsonStats:
+        case PacketTypePing:
+        case PacketTypePingReply:
+        case PacketTypeUnverifiedPing:
+        case PacketTypeUnverifiedPingReply:
+        case PacketTypeIceServerHeartbeat:
+        case PacketTypeIceServerHeartbeatResponse:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static NodeType_t nodeTypeForTargetName(const QString& targetName) {
+    const NodeType_t TARGET_NODE_TYPES[] = {
+        NodeType::AudioMixer, NodeType::AvatarMixer, NodeType::EntityServer, NodeType::MetavoxelServer
+    };
+
+    for (unsigned int i = 0; i < sizeof(TARGET_NODE_TYPES) / sizeof(NodeType_t); i++) {
+        // same naming as the domain-server uses for node stats
+        if (NodeType::getNodeTypeName(TARGET_NODE_TYPES[i]).toLower().replace(' ', '-') == targetName) {
+            return TARGET_NODE_TYPES[i];
+        }
+    }
+    return NodeType::Unassigned;
+}
+
+PacketReplayer::PacketReplayer(int& argc, char** argv) :
+    QCoreApplication(argc, argv),
+    _captureFilename(),
+    _reader(),
+    _replayedSenderUUID(),
+    _targetNodeType(NodeType::Unassigned),
+    _domainHostname(DEFAULT_ASSIGNMENT_SERVER_HOSTNAME),
+    _speedFactor(1.0f),
+    _shouldLoop(false),
+    _shouldReport(false),
+    _childProcesses(),
+    _nextDatagram(),
+    _hasNextDatagram(false),
+    _isReplaying(false),
+    _replayTimer(),
+    _replayTimerTick(NULL),
+    _firstDatagramUsecs(0),
+    _loopOffsetUsecs(0),
+    _datagramsSent(0),
+    _bytesSent(0),
+    _maxLagUsecs(0)
+{
+    NodeType::init();
+
+    const QVariantMap argumentVariantMap = HifiConfigVariantMap::mergeCLParametersWithJSONConfig(arguments());
+
+    _captureFilename = argumentVariantMap.value(CAPTURE_OPTION).toString();
+    _targetNodeType = nodeTypeForTargetName(argumentVariantMap.value(TARGET_OPTION, DEFAULT_TARGET_NAME).toString());
+
+    if (_captureFilename.isEmpty() || _targetNodeType == NodeType::Unassigned) {
+        qDebug() << "usage: packet-replay --capture <file> [--target audio-mixer|avatar-mixer|entity-server|"
+            "metavoxel-server] [--domain <hostname>] [--speed <factor>] [--fanout <copies>] [--loop]";
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+
+    if (argumentVariantMap.contains(DOMAIN_OPTION)) {
+        _domainHostname = argumentVariantMap.value(DOMAIN_OPTION).toString();
+    }
+
+    if (argumentVariantMap.contains(SPEED_OPTION)) {
+        _speedFactor = argumentVariantMap.value(SPEED_OPTION).toFloat();
+        if (_speedFactor <= 0.0f) {
+            _speedFactor = 1.0f;
+        }
+    }
+
+    _shouldLoop = argumentVariantMap.contains(LOOP_OPTION);
+    _shouldReport = argumentVariantMap.contains(REPORT_OPTION);
+
+    if (!_reader.open(_captureFilename)) {
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+
+    int fanOut = std::max(1, argumentVariantMap.value(FAN_OUT_OPTION, 1).toInt());
+
+    if (argumentVariantMap.contains(SENDER_OPTION)) {
+        _replayedSenderUUID = QUuid(argumentVariantMap.value(SENDER_OPTION).toString());
+    } else {
+        // find out who is in the capture, one process per sender so that the server sees each of them as its own node
+        QSet<QUuid> senders;
+        CapturedDatagram captured;
+        while (_reader.readNext(captured)) {
+            if (isReplayablePacketType(packetTypeForPacket(captured.datagram))) {
+                senders.insert(captured.senderUUID);
+            }
+        }
+        _reader.rewind();
+
+        qDebug() << "Capture" << _captureFilename << "has" << senders.size() << "senders";
+
+        if (senders.size() == 1 && fanOut == 1) {
+            _replayedSenderUUID = *senders.begin();
+            _shouldReport = true;
+        } else {
+            foreach(const QUuid& senderUUID, senders) {
+                _replayedSenderUUID = senderUUID;
+                spawnChildReplayers(fanOut);
+            }
+            return;
+        }
+    }
+
+    // we're replaying a single sender, connect to the domain as an agent interested in the target
+    NodeList* nodeList = NodeList::createInstance(NodeType::Agent);
+    nodeList->addNodeTypeToInterestSet(_targetNodeType);
+    nodeList->getDomainHandler().setHostnameAndPort(_domainHostname);
+
+    connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead, this, &PacketReplayer::processDatagrams);
+
+    QTimer* domainServerTimer = new QTimer(this);
+    connect(domainServerTimer, SIGNAL(timeout()), this, SLOT(checkInWithDomainServer()));
+    domainServerTimer->start(DOMAIN_SERVER_CHECK_IN_MSECS);
+
+    QTimer* silentNodeRemovalTimer = new QTimer(this);
+    connect(silentNodeRemovalTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
+    silentNodeRemovalTimer->start(NODE_SILENCE_THRESHOLD_MSECS);
+
+    if (_shouldReport) {
+        QTimer* statsTimer = new QTimer(this);
+        connect(statsTimer, SIGNAL(timeout()), this, SLOT(requestServerStats()));
+        statsTimer->start(STATS_REPORT_INTERVAL_MSECS);
+    }
+
+    _replayTimerTick = new QTimer(this);
+    _replayTimerTick->setTimerType(Qt::PreciseTimer);
+    connect(_replayTimerTick, SIGNAL(timeout()), this, SLOT(replayDueDatagrams()));
+
+    qDebug() << "Replaying sender" << uuidStringWithoutCurlyBraces(_replayedSenderUUID) << "against the"
+        << NodeType::getNodeTypeName(_targetNodeType) << "at" << _speedFactor << "x speed";
+}
+
+PacketReplayer::~PacketReplayer() {
+    QList<QPointer<QProcess> >::Iterator it = _childProcesses.begin();
+    while (it != _childProcesses.end()) {
+        if (!it->isNull()) {
+            disconnect(it->data(), 0, this, 0);
+            it->data()->terminate();
+            it->data()->waitForFinished();
+        }
+        it = _childProcesses.erase(it);
+    }
+}
+
+void PacketReplayer::spawnChildReplayers(int fanOut) {
+    QStringList childArguments = arguments();
+    childArguments.removeFirst();
+
+    // the children replay a single copy of a single sender
+    int fanOutIndex = childArguments.indexOf("--" + FAN_OUT_OPTION);
+    if (fanOutIndex != -1) {
+        childArguments.removeAt(fanOutIndex);
+        childArguments.removeAt(fanOutIndex);
+    }
+    childArguments << "--" + SENDER_OPTION << uuidStringWithoutCurlyBraces(_replayedSenderUUID);
+
+    for (int i = 0; i < fanOut; i++) {
+        QStringList arguments = childArguments;
+
+        // only one child asks the domain-server for the target's stats
+        if (_childProcesses.isEmpty()) {
+            arguments << "--" + REPORT_OPTION;
+        }
+
+        QProcess* childReplayer = new QProcess(this);
+        _childProcesses.append(QPointer<QProcess>(childReplayer));
+
+        childReplayer->setProcessChannelMode(QProcess::ForwardedChannels);
+        childReplayer->start(applicationFilePath(), arguments);
+
+        connect(childReplayer, SIGNAL(finished(int, QProcess::ExitStatus)), this,
+                SLOT(childProcessFinished(int, QProcess::ExitStatus)));
+    }
+
+    qDebug() << "Spawned" << fanOut << "replayers for sender" << uuidStringWithoutCurlyBraces(_replayedSenderUUID);
+}
+
+void PacketReplayer::childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    _childProcesses.removeOne(QPointer<QProcess>(qobject_cast<QProcess*>(sender())));
+
+    if (_childProcesses.isEmpty()) {
+        qDebug() << "All replayers have finished";
+        quit();
+    }
+}
+
+void PacketReplayer::processDatagrams() {
+    NodeList* nodeList = NodeList::getInstance();
+
+    static QByteArray incomingPacket;
+    HifiSockAddr senderSockAddr;
+
+    while (nodeList->getNodeSocket().hasPendingDatagrams()) {
+        incomingPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
+        nodeList->getNodeSocket().readDatagram(incomingPacket.data(), incomingPacket.size(),
+                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+
+        // whatever the server sends back to us is dropped, we only need the domain and ping handling
+        if (nodeList->packetVersionAndHashMatch(incomingPacket)) {
+            nodeList->processNodeData(senderSockAddr, incomingPacket);
+        }
+    }
+}
+
+void PacketReplayer::checkInWithDomainServer() {
+    NodeList* nodeList = NodeList::getInstance();
+    nodeList->sendDomainServerCheckIn();
+
+    if (!_isReplaying) {
+        SharedNodePointer targetNode = nodeList->soloNodeOfType(_targetNodeType);
+        if (targetNode && targetNode->getActiveSocket()) {
+            startReplay();
+        }
+    }
+}
+
+bool PacketReplayer::readNextReplayableDatagram() {
+    while (_reader.readNext(_nextDatagram)) {
+        if (_nextDatagram.senderUUID == _replayedSenderUUID
+            && _nextDatagram.datagram.size() >= numBytesForPacketHeader(_nextDatagram.datagram)
+            && isReplayablePacketType(packetTypeForPacket(_nextDatagram.datagram))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PacketReplayer::startReplay() {
+    _hasNextDatagram = readNextReplayableDatagram();
+    if (!_hasNextDatagram) {
+        qDebug() << "Nothing to replay for sender" << uuidStringWithoutCurlyBraces(_replayedSenderUUID);
+        quit();
+        return;
+    }
+
+    // start replaying from the sender's first datagram, not from when the capture was started
+    _firstDatagramUsecs = _nextDatagram.usecsSinceStart;
+    _loopOffsetUsecs = 0;
+    _isReplaying = true;
+    _replayTimer.start();
+    _replayTimerTick->start(REPLAY_TICK_MSECS);
+}
+
+void PacketReplayer::replayDueDatagrams() {
+    NodeList* nodeList = NodeList::getInstance();
+    SharedNodePointer targetNode = nodeList->soloNodeOfType(_targetNodeType);
+    if (!targetNode) {
+        return;
+    }
+
+    quint64 elapsedCaptureUsecs = (quint64)((_replayTimer.nsecsElapsed() / NSECS_PER_USEC) * _speedFactor);
+    QByteArray rfcSessionUUID = nodeList->getSessionUUID().toRfc4122();
+
+    while (_hasNextDatagram) {
+        quint64 dueUsecs = _loopOffsetUsecs + _nextDatagram.usecsSinceStart - _firstDatagramUsecs;
+        if (dueUsecs > elapsedCaptureUsecs) {
+            break;
+        }
+        _maxLagUsecs = std::max(_maxLagUsecs, elapsedCaptureUsecs - dueUsecs);
+
+        // swap in our session UUID, writeDatagram will re-hash the packet with our connection secret
+        QByteArray& packet = _nextDatagram.datagram;
+        int numTypeBytes = numBytesArithmeticCodingFromBuffer(packet.data());
+        memcpy(packet.data() + numTypeBytes + sizeof(PacketVersion), rfcSessionUUID.constData(), NUM_BYTES_RFC4122_UUID);
+
+        if (NON_VERIFIED_PACKETS.contains(packetTypeForPacket(packet))) {
+            nodeList->writeUnverifiedDatagram(packet, targetNode);
+        } else {
+            nodeList->writeDatagram(packet, targetNode);
+        }
+        _datagramsSent++;
+        _bytesSent += packet.size();
+
+        quint64 lastDatagramUsecs = _nextDatagram.usecsSinceStart;
+        _hasNextDatagram = readNextReplayableDatagram();
+
+        if (!_hasNextDatagram && _shouldLoop) {
+            _loopOffsetUsecs += lastDatagramUsecs - _firstDatagramUsecs;
+            _reader.rewind();
+            _hasNextDatagram = readNextReplayableDatagram();
+        }
+    }
+
+    if (!_hasNextDatagram) {
+        _replayTimerTick->stop();
+        printReplayStats();
+        qDebug() << "Replay of sender" << uuidStringWithoutCurlyBraces(_replayedSenderUUID) << "is complete";
+
+        // give the last stats request a chance to come back
+        QTimer::singleShot(STATS_REPORT_INTERVAL_MSECS, this, SLOT(quit()));
+    }
+}
+
+void PacketReplayer::printReplayStats() {
+    float elapsedSeconds = _replayTimer.elapsed() / (float)MSECS_PER_SECOND;
+    qDebug("Replay: %llu datagrams, %llu bytes in %.2fs (%.1f pps) - max lag behind capture %llu usecs",
+           _datagramsSent, _bytesSent, elapsedSeconds,
+           elapsedSeconds > 0.0f ? _datagramsSent / elapsedSeconds : 0.0f, _maxLagUsecs);
+}
+
+void PacketReplayer::requestServerStats() {
+    if (_isReplaying) {
+        printReplayStats();
+    }
+
+    SharedNodePointer targetNode = NodeList::getInstance()->soloNodeOfType(_targetNodeType);
+    if (!targetNode) {
+        return;
+    }
+
+    // the assignment-client sends its stats to the domain-server which serves them up as JSON
+    QUrl statsURL;
+    statsURL.setScheme("http");
+    statsURL.setHost(_domainHostname);
+    statsURL.setPort(DOMAIN_SERVER_HTTP_PORT);
+    statsURL.setPath(QString("/nodes/%1.json").arg(uuidStringWithoutCurlyBraces(targetNode->getUUID())));
+
+    QNetworkReply* reply = NetworkAccessManager::getInstance().get(QNetworkRequest(statsURL));
+    connect(reply, SIGNAL(finished()), this, SLOT(serverStatsReceived()));
+}
+
+void PacketReplayer::serverStatsReceived() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qDebug() << "Could not get server stats -" << reply->errorString();
+        return;
+    }
+
+    QJsonObject statsObject = QJsonDocument::fromJson(reply->readAll()).object();
+
+    QString statsString = QString("Server stats for %1:\n").arg(statsObject.value("node_type").toString());
+    foreach(const QString& key, statsObject.keys()) {
+        if (statsObject.value(key).isDouble()) {
+            statsString += QString("    %1: %2\n").arg(key, 50).arg(statsObject.value(key).toDouble());
+        }
+    }
+    qDebug() << qPrintable(statsString);
+}
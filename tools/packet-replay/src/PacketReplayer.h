@@ -0,0 +1,71 @@
+//
+//  PacketReplayer.h
+//  tools/packet-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketReplayer_h
+#define hifi_PacketReplayer_h
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtCore/QProcess>
+#include <QtCore/QTimer>
+#include <QtNetwork/QNetworkReply>
+
+#include <DatagramCapture.h>
+#include <Node.h>
+
+/// Replays a datagram capture written by an assignment-client started with --capture against a locally running
+/// assignment-client. Each captured sender is replayed by its own process which connects to the domain as an agent,
+/// so the server sees real nodes with their own session UUIDs and connection secrets.
+class PacketReplayer : public QCoreApplication {
+    Q_OBJECT
+public:
+    PacketReplayer(int& argc, char** argv);
+    ~PacketReplayer();
+
+private slots:
+    void processDatagrams();
+    void checkInWithDomainServer();
+    void replayDueDatagrams();
+    void requestServerStats();
+    void serverStatsReceived();
+    void childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+    void spawnChildReplayers(int fanOut);
+    void startReplay();
+    bool readNextReplayableDatagram();
+    void printReplayStats();
+
+    QString _captureFilename;
+    DatagramCaptureReader _reader;
+    QUuid _replayedSenderUUID;
+    NodeType_t _targetNodeType;
+    QString _domainHostname;
+    float _speedFactor;
+    bool _shouldLoop;
+    bool _shouldReport;
+
+    QList<QPointer<QProcess> > _childProcesses;
+
+    CapturedDatagram _nextDatagram;
+    bool _hasNextDatagram;
+    bool _isReplaying;
+    QElapsedTimer _replayTimer;
+    QTimer* _replayTimerTick;
+    quint64 _firstDatagramUsecs;
+    quint64 _loopOffsetUsecs;
+
+    quint64 _datagramsSent;
+    quint64 _bytesSent;
+    quint64 _maxLagUsecs;
+};
+
+#endif // hifi_PacketReplayer_h
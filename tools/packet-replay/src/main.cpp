@@ -0,0 +1,24 @@
+//
+//  main.cpp
+//  tools/packet-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <LogHandler.h>
+
+#include "PacketReplayer.h"
+
+int main(int argc, char* argv[]) {
+#ifndef WIN32
+    setvbuf(stdout, NULL, _IOLBF, 0);
+#endif
+    
+    qInstallMessageHandler(LogHandler::verboseMessageHandler);
+    
+    PacketReplayer replayer(argc, argv);
+    return replayer.exec();
+}
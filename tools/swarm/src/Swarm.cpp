@@ -0,0 +1,368 @@
+//
+//  Swarm.cpp
+//  tools/swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QTextStream>
+
+#include <AudioConstants.h>
+#include <DomainHandler.h>
+#include <HifiConfigVariantMap.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "Swarm.h"
+
+const QString BOTS_OPTION = "bots";
+const QString SOCKETS_OPTION = "sockets";
+const QString DOMAIN_OPTION = "domain";
+const QString SPREAD_OPTION = "spread";
+const QString RAMP_OPTION = "ramp";
+const QString STATS_FILE_OPTION = "stats-file";
+
+const int DEFAULT_BOT_COUNT = 100;
+const int DEFAULT_BOTS_PER_SOCKET = 16;
+const float DEFAULT_SPREAD_METERS = 50.0f;
+const float DEFAULT_RAMP_BOTS_PER_SECOND = 20.0f;
+
+const int TICK_INTERVAL_MSECS = 1;
+const int STATS_INTERVAL_MSECS = 5 * 1000;
+
+const quint64 AVATAR_DATA_INTERVAL_USECS = USECS_PER_SECOND / 60;
+const quint64 ENTITY_QUERY_INTERVAL_USECS = USECS_PER_SECOND;
+const quint64 CHECK_IN_INTERVAL_USECS = USECS_PER_SECOND;
+
+const NodeType_t REPORTED_NODE_TYPES[] = {
+    NodeType::AudioMixer, NodeType::AvatarMixer, NodeType::EntityServer
+};
+const int NUM_REPORTED_NODE_TYPES = sizeof(REPORTED_NODE_TYPES) / sizeof(NodeType_t);
+
+ScheduledBot::ScheduledBot(SwarmBot* bot, quint64 nowUsecs) :
+    bot(bot),
+    // spread each bot's sends across their intervals so the swarm doesn't fire in lock step
+    nextAvatarDataUsecs(nowUsecs + rand() % AVATAR_DATA_INTERVAL_USECS),
+    nextAudioFrameUsecs(nowUsecs + rand() % AudioConstants::NETWORK_FRAME_USECS),
+    nextEntityQueryUsecs(nowUsecs + rand() % ENTITY_QUERY_INTERVAL_USECS),
+    nextCheckInUsecs(nowUsecs + CHECK_IN_INTERVAL_USECS)
+{
+}
+
+Swarm::Swarm(int& argc, char** argv) :
+    QCoreApplication(argc, argv),
+    _targetBotCount(DEFAULT_BOT_COUNT),
+    _spread(DEFAULT_SPREAD_METERS),
+    _rampRate(DEFAULT_RAMP_BOTS_PER_SECOND),
+    _nodeTypesOfInterest(),
+    _domainSockAddr(),
+    _localAddress(getLocalAddress()),
+    _sockets(),
+    _bots(),
+    _botsBySessionUUID(),
+    _botsBySocket(),
+    _botsWaitingToConnect(),
+    _connectingBots(),
+    _tickTimer(NULL),
+    _statsTimer(NULL),
+    _elapsedTimer(),
+    _statsFile(),
+    _datagramsReceived(0),
+    _unmatchedDatagrams(0),
+    _lastStatsUsecs(0),
+    _lastBytesReceivedByNodeType()
+{
+    NodeType::init();
+
+    const QVariantMap argumentVariantMap = HifiConfigVariantMap::mergeCLParametersWithJSONConfig(arguments());
+
+    _targetBotCount = std::max(1, argumentVariantMap.value(BOTS_OPTION, DEFAULT_BOT_COUNT).toInt());
+    _spread = std::max(0.0f, argumentVariantMap.value(SPREAD_OPTION, DEFAULT_SPREAD_METERS).toFloat());
+    _rampRate = argumentVariantMap.value(RAMP_OPTION, DEFAULT_RAMP_BOTS_PER_SECOND).toFloat();
+    if (_rampRate <= 0.0f) {
+        _rampRate = DEFAULT_RAMP_BOTS_PER_SECOND;
+    }
+
+    int defaultSocketCount = (_targetBotCount + DEFAULT_BOTS_PER_SOCKET - 1) / DEFAULT_BOTS_PER_SOCKET;
+    int numSockets = std::max(1, argumentVariantMap.value(SOCKETS_OPTION, defaultSocketCount).toInt());
+
+    QString domainHostname = argumentVariantMap.value(DOMAIN_OPTION, DEFAULT_ASSIGNMENT_SERVER_HOSTNAME).toString();
+    _domainSockAddr = HifiSockAddr(domainHostname, DEFAULT_DOMAIN_SERVER_PORT, true);
+
+    if (_domainSockAddr.getAddress().isNull()) {
+        qDebug() << "Could not resolve domain-server hostname" << domainHostname;
+        qDebug() << "usage: swarm [--bots <count>] [--sockets <count>] [--domain <hostname>] [--spread <meters>]"
+            " [--ramp <bots per second>] [--stats-file <csv file>]";
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+
+    if (argumentVariantMap.contains(STATS_FILE_OPTION)) {
+        _statsFile.setFileName(argumentVariantMap.value(STATS_FILE_OPTION).toString());
+        if (_statsFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            QTextStream(&_statsFile) << "elapsed_secs,bot,session_uuid,node_type,ping_msecs,packets_received,"
+                "bytes_received\n";
+        } else {
+            qDebug() << "Could not open" << _statsFile.fileName() << "for per-bot stats";
+        }
+    }
+
+    _nodeTypesOfInterest << NodeType::AudioMixer << NodeType::AvatarMixer << NodeType::EntityServer;
+
+    for (int i = 0; i < numSockets; i++) {
+        QUdpSocket* socket = new QUdpSocket(this);
+        if (!socket->bind(QHostAddress::AnyIPv4, 0)) {
+            qDebug() << "Could not bind swarm socket" << i << "-" << socket->errorString();
+            delete socket;
+            break;
+        }
+
+        connect(socket, &QUdpSocket::readyRead, this, &Swarm::processDatagrams);
+        _sockets.append(socket);
+    }
+
+    if (_sockets.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+
+    qDebug() << "Starting a swarm of" << _targetBotCount << "bots on" << _sockets.size() << "sockets against"
+        << _domainSockAddr << "at" << _rampRate << "bots per second";
+
+    _elapsedTimer.start();
+
+    _tickTimer = new QTimer(this);
+    _tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(_tickTimer, &QTimer::timeout, this, &Swarm::tick);
+    _tickTimer->start(TICK_INTERVAL_MSECS);
+
+    _statsTimer = new QTimer(this);
+    connect(_statsTimer, &QTimer::timeout, this, &Swarm::printStats);
+    _statsTimer->start(STATS_INTERVAL_MSECS);
+}
+
+Swarm::~Swarm() {
+    foreach(const ScheduledBot& scheduledBot, _bots) {
+        delete scheduledBot.bot;
+    }
+}
+
+void Swarm::addBot() {
+    int index = _bots.size();
+    QUdpSocket* socket = _sockets[index % _sockets.size()];
+
+    // scatter the bots over a square of the requested size around the origin
+    glm::vec3 homePosition(randFloatInRange(-_spread / 2.0f, _spread / 2.0f), 0.0f,
+                           randFloatInRange(-_spread / 2.0f, _spread / 2.0f));
+
+    SwarmBot* bot = new SwarmBot(index, socket, homePosition);
+    _bots.append(ScheduledBot(bot, _elapsedTimer.nsecsElapsed() / 1000));
+    _botsBySocket[socket].append(bot);
+    _botsWaitingToConnect[socket].enqueue(bot);
+
+    if (!_connectingBots.contains(socket)) {
+        connectNextBot(socket);
+    }
+}
+
+void Swarm::connectNextBot(QUdpSocket* socket) {
+    QQueue<SwarmBot*>& waitingBots = _botsWaitingToConnect[socket];
+    if (waitingBots.isEmpty()) {
+        _connectingBots.remove(socket);
+        return;
+    }
+
+    SwarmBot* bot = waitingBots.dequeue();
+    _connectingBots.insert(socket, bot);
+
+    QByteArray connectPacket = bot->createCheckInPacket(_nodeTypesOfInterest,
+                                                        HifiSockAddr(_localAddress, socket->localPort()));
+    socket->writeDatagram(connectPacket, _domainSockAddr.getAddress(), _domainSockAddr.getPort());
+}
+
+void Swarm::processDatagrams() {
+    QUdpSocket* socket = qobject_cast<QUdpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+
+    static QByteArray incomingPacket;
+    HifiSockAddr senderSockAddr;
+
+    while (socket->hasPendingDatagrams()) {
+        incomingPacket.resize(socket->pendingDatagramSize());
+        socket->readDatagram(incomingPacket.data(), incomingPacket.size(),
+                             senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        _datagramsReceived++;
+
+        if (packetTypeForPacket(incomingPacket) == PacketTypeDomainList) {
+            processDomainList(socket, incomingPacket);
+            continue;
+        }
+
+        // everything else comes from the mixers and servers - the header hash says which of this socket's bots it's for
+        bool wasMatched = false;
+        foreach(SwarmBot* bot, _botsBySocket.value(socket)) {
+            SwarmNode* sendingNode = bot->nodeForPacket(incomingPacket);
+            if (sendingNode) {
+                bot->processNodePacket(*sendingNode, incomingPacket, senderSockAddr);
+                wasMatched = true;
+                break;
+            }
+        }
+
+        if (!wasMatched) {
+            _unmatchedDatagrams++;
+        }
+    }
+}
+
+void Swarm::processDomainList(QUdpSocket* socket, const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QUuid ownerUUID;
+    packetStream >> ownerUUID;
+
+    SwarmBot* bot = _botsBySessionUUID.value(ownerUUID);
+    if (!bot) {
+        // this should be the answer to the connect request currently outstanding on this socket
+        bot = _connectingBots.value(socket);
+        if (!bot) {
+            _unmatchedDatagrams++;
+            return;
+        }
+
+        bot->processDomainList(packet, _domainSockAddr.getAddress());
+        _botsBySessionUUID.insert(bot->getSessionUUID(), bot);
+
+        connectNextBot(socket);
+        return;
+    }
+
+    bot->processDomainList(packet, _domainSockAddr.getAddress());
+}
+
+void Swarm::tick() {
+    quint64 nowUsecs = _elapsedTimer.nsecsElapsed() / 1000;
+
+    // ramp up gradually, the domain-server and the mixers shouldn't see thousands of new nodes in the same instant
+    int botsDue = std::min(_targetBotCount, 1 + (int)(_rampRate * nowUsecs / USECS_PER_SECOND));
+    while (_bots.size() < botsDue) {
+        addBot();
+    }
+
+    for (int i = 0; i < _bots.size(); i++) {
+        ScheduledBot& scheduledBot = _bots[i];
+        SwarmBot* bot = scheduledBot.bot;
+
+        if (nowUsecs >= scheduledBot.nextCheckInUsecs) {
+            if (bot->isConnected()) {
+                QByteArray checkInPacket = bot->createCheckInPacket(_nodeTypesOfInterest,
+                    HifiSockAddr(_localAddress, bot->getSocket()->localPort()));
+                bot->getSocket()->writeDatagram(checkInPacket, _domainSockAddr.getAddress(), _domainSockAddr.getPort());
+                bot->pingNodes();
+            } else if (_connectingBots.value(bot->getSocket()) == bot) {
+                // our connect request or its answer was lost, ask again
+                _botsWaitingToConnect[bot->getSocket()].prepend(bot);
+                connectNextBot(bot->getSocket());
+            }
+            scheduledBot.nextCheckInUsecs += CHECK_IN_INTERVAL_USECS;
+        }
+
+        if (!bot->isConnected()) {
+            continue;
+        }
+
+        if (nowUsecs >= scheduledBot.nextAvatarDataUsecs) {
+            bot->simulate((float)AVATAR_DATA_INTERVAL_USECS / USECS_PER_SECOND);
+            bot->sendAvatarData();
+            scheduledBot.nextAvatarDataUsecs += AVATAR_DATA_INTERVAL_USECS;
+        }
+
+        if (nowUsecs >= scheduledBot.nextAudioFrameUsecs) {
+            bot->sendAudioFrame();
+            scheduledBot.nextAudioFrameUsecs += AudioConstants::NETWORK_FRAME_USECS;
+        }
+
+        if (nowUsecs >= scheduledBot.nextEntityQueryUsecs) {
+            bot->sendEntityQuery();
+            scheduledBot.nextEntityQueryUsecs += ENTITY_QUERY_INTERVAL_USECS;
+        }
+    }
+}
+
+void Swarm::printStats() {
+    quint64 nowUsecs = _elapsedTimer.nsecsElapsed() / 1000;
+    float intervalSeconds = (float)(nowUsecs - _lastStatsUsecs) / USECS_PER_SECOND;
+    _lastStatsUsecs = nowUsecs;
+
+    qDebug() << "Swarm -" << _botsBySessionUUID.size() << "of" << _bots.size() << "bots connected,"
+        << _datagramsReceived << "datagrams received," << _unmatchedDatagrams << "unmatched";
+
+    for (int i = 0; i < NUM_REPORTED_NODE_TYPES; i++) {
+        NodeType_t nodeType = REPORTED_NODE_TYPES[i];
+
+        int numLinked = 0;
+        int numActive = 0;
+        float totalPingMsecs = 0.0f;
+        float maxPingMsecs = 0.0f;
+        quint64 totalBytesReceived = 0;
+
+        foreach(const ScheduledBot& scheduledBot, _bots) {
+            foreach(const SwarmNode& node, scheduledBot.bot->getNodes()) {
+                if (node.type != nodeType) {
+                    continue;
+                }
+
+                numLinked++;
+                totalBytesReceived += node.bytesReceived;
+
+                if (!node.activeSocket.isNull() && node.pingRTT.getSampleCount() > 0) {
+                    float pingMsecs = node.pingRTT.getAverage() / USECS_PER_MSEC;
+                    numActive++;
+                    totalPingMsecs += pingMsecs;
+                    maxPingMsecs = std::max(maxPingMsecs, pingMsecs);
+                }
+            }
+        }
+
+        quint64 bytesThisInterval = totalBytesReceived - _lastBytesReceivedByNodeType.value(nodeType);
+        _lastBytesReceivedByNodeType[nodeType] = totalBytesReceived;
+
+        qDebug("    %-14s %5d linked, %5d active, ping avg %7.2f ms max %7.2f ms, receiving %9.1f kbps",
+               qPrintable(NodeType::getNodeTypeName(nodeType)), numLinked, numActive,
+               numActive > 0 ? totalPingMsecs / numActive : 0.0f, maxPingMsecs,
+               intervalSeconds > 0.0f ? (bytesThisInterval * 8.0f / 1000.0f) / intervalSeconds : 0.0f);
+    }
+
+    if (_statsFile.isOpen()) {
+        writeStatsFile(nowUsecs);
+    }
+}
+
+void Swarm::writeStatsFile(quint64 elapsedUsecs) {
+    QTextStream statsStream(&_statsFile);
+    float elapsedSeconds = (float)elapsedUsecs / USECS_PER_SECOND;
+
+    foreach(const ScheduledBot& scheduledBot, _bots) {
+        const SwarmBot* bot = scheduledBot.bot;
+        QString sessionUUID = uuidStringWithoutCurlyBraces(bot->getSessionUUID());
+
+        foreach(const SwarmNode& node, bot->getNodes()) {
+            statsStream << elapsedSeconds << ',' << bot->getIndex() << ',' << sessionUUID << ','
+                << NodeType::getNodeTypeName(node.type) << ','
+                << (node.pingRTT.getSampleCount() > 0 ? node.pingRTT.getAverage() / USECS_PER_MSEC : -1.0f) << ','
+                << node.packetsReceived << ',' << node.bytesReceived << '\n';
+        }
+    }
+
+    statsStream.flush();
+}
@@ -0,0 +1,86 @@
+//
+//  Swarm.h
+//  tools/swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_Swarm_h
+#define hifi_Swarm_h
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QQueue>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#include <HifiSockAddr.h>
+
+#include "SwarmBot.h"
+
+/// Per-bot send schedule, in usecs since the swarm started
+class ScheduledBot {
+public:
+    ScheduledBot(SwarmBot* bot, quint64 nowUsecs);
+
+    SwarmBot* bot;
+    quint64 nextAvatarDataUsecs;
+    quint64 nextAudioFrameUsecs;
+    quint64 nextEntityQueryUsecs;
+    quint64 nextCheckInUsecs;
+};
+
+/// Hosts a swarm of headless virtual clients in one process to put a domain and its mixers under load.
+class Swarm : public QCoreApplication {
+    Q_OBJECT
+public:
+    Swarm(int& argc, char** argv);
+    ~Swarm();
+
+private slots:
+    void processDatagrams();
+    void tick();
+    void printStats();
+
+private:
+    void addBot();
+    void connectNextBot(QUdpSocket* socket);
+    void processDomainList(QUdpSocket* socket, const QByteArray& packet);
+    void writeStatsFile(quint64 elapsedUsecs);
+
+    int _targetBotCount;
+    float _spread;
+    float _rampRate;
+    QSet<NodeType_t> _nodeTypesOfInterest;
+
+    HifiSockAddr _domainSockAddr;
+    QHostAddress _localAddress;
+
+    QVector<QUdpSocket*> _sockets;
+    QVector<ScheduledBot> _bots;
+    QHash<QUuid, SwarmBot*> _botsBySessionUUID;
+    QHash<QUdpSocket*, QList<SwarmBot*> > _botsBySocket;
+
+    // the domain-server answers a connect request to the address it came from, so only one bot per socket may be
+    // waiting for its first domain list at a time
+    QHash<QUdpSocket*, QQueue<SwarmBot*> > _botsWaitingToConnect;
+    QHash<QUdpSocket*, SwarmBot*> _connectingBots;
+
+    QTimer* _tickTimer;
+    QTimer* _statsTimer;
+    QElapsedTimer _elapsedTimer;
+    QFile _statsFile;
+
+    quint64 _datagramsReceived;
+    quint64 _unmatchedDatagrams;
+    quint64 _lastStatsUsecs;
+    QHash<NodeType_t, quint64> _lastBytesReceivedByNodeType;
+};
+
+#endif // hifi_Swarm_h
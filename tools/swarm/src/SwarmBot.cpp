@@ -0,0 +1,302 @@
+//
+//  SwarmBot.cpp
+//  tools/swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDataStream>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AudioConstants.h>
+#include <LimitedNodeList.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <ViewFrustum.h>
+
+#include "SwarmBot.h"
+
+const float WANDER_RADIUS = 2.0f;
+const float WANDER_ANGULAR_SPEED = 0.25f; // radians per second
+const float TONE_AMPLITUDE = 4000.0f;
+const float MIN_TONE_FREQUENCY = 200.0f;
+const float TONE_FREQUENCY_STEP = 10.0f;
+const int NUM_TONE_FREQUENCIES = 64;
+
+SwarmNode::SwarmNode() :
+    uuid(),
+    type(NodeType::Unassigned),
+    publicSocket(),
+    localSocket(),
+    activeSocket(),
+    connectionSecret(),
+    outgoingAudioSequence(0),
+    pingRTT(),
+    packetsReceived(0),
+    bytesReceived(0)
+{
+}
+
+SwarmBot::SwarmBot(int index, QUdpSocket* socket, const glm::vec3& homePosition) :
+    _index(index),
+    _socket(socket),
+    _sessionUUID(),
+    _nodes(),
+    _homePosition(homePosition),
+    _wanderAngle(randFloatInRange(0.0f, TWO_PI)),
+    _tonePhase(0.0f),
+    _toneFrequency(MIN_TONE_FREQUENCY + (index % NUM_TONE_FREQUENCIES) * TONE_FREQUENCY_STEP),
+    _avatarData(),
+    _entityQuery()
+{
+    _avatarData.setDisplayName(QString("swarm-bot-%1").arg(index));
+    _avatarData.setPosition(homePosition);
+
+    _entityQuery.setCameraFov(DEFAULT_FIELD_OF_VIEW_DEGREES);
+    _entityQuery.setCameraAspectRatio(DEFAULT_ASPECT_RATIO);
+    _entityQuery.setCameraNearClip(DEFAULT_NEAR_CLIP);
+    _entityQuery.setCameraFarClip(DEFAULT_FAR_CLIP);
+}
+
+QByteArray SwarmBot::createCheckInPacket(const QSet<NodeType_t>& nodeTypesOfInterest,
+                                         const HifiSockAddr& localSockAddr) const {
+    PacketType packetType = isConnected() ? PacketTypeDomainListRequest : PacketTypeDomainConnectRequest;
+
+    // we never send a null UUID, that would make populatePacketHeader go looking for a NodeList
+    QUuid packetUUID = isConnected() ? _sessionUUID : QUuid::createUuid();
+
+    QByteArray checkInPacket = byteArrayWithPopulatedHeader(packetType, packetUUID);
+    QDataStream packetStream(&checkInPacket, QIODevice::Append);
+
+    // a null public socket asks the domain-server to act as our STUN server
+    NodeType_t ownerType = NodeType::Agent;
+    packetStream << ownerType << HifiSockAddr() << localSockAddr << nodeTypesOfInterest.toList();
+
+    if (!isConnected()) {
+        // anonymous user, no username signature
+        packetStream << QString();
+    }
+
+    return checkInPacket;
+}
+
+void SwarmBot::processDomainList(const QByteArray& packet, const QHostAddress& domainAddress) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    packetStream >> _sessionUUID;
+    _avatarData.setSessionUUID(_sessionUUID);
+
+    QSet<QUuid> listedNodes;
+
+    while (packetStream.device()->pos() < packet.size()) {
+        qint8 nodeType;
+        QUuid nodeUUID, connectionSecret;
+        HifiSockAddr nodePublicSocket, nodeLocalSocket;
+
+        packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket >> connectionSecret;
+
+        // if the public socket address is 0 then it's reachable at the same IP as the domain server
+        if (nodePublicSocket.getAddress().isNull()) {
+            nodePublicSocket.setAddress(domainAddress);
+        }
+
+        SwarmNode& node = _nodes[nodeUUID];
+        if (node.uuid.isNull() || node.publicSocket != nodePublicSocket || node.localSocket != nodeLocalSocket) {
+            // this is a new node, or one that moved - we'll need to ping punch it again
+            node.activeSocket = HifiSockAddr();
+        }
+
+        node.uuid = nodeUUID;
+        node.type = nodeType;
+        node.publicSocket = nodePublicSocket;
+        node.localSocket = nodeLocalSocket;
+        node.connectionSecret = connectionSecret;
+
+        listedNodes.insert(nodeUUID);
+    }
+
+    // forget about any node the domain-server has stopped telling us about
+    QHash<QUuid, SwarmNode>::iterator it = _nodes.begin();
+    while (it != _nodes.end()) {
+        if (!listedNodes.contains(it.key())) {
+            it = _nodes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+SwarmNode* SwarmBot::nodeForPacket(const QByteArray& packet) {
+    QHash<QUuid, SwarmNode>::iterator matchingNode = _nodes.find(uuidFromPacketHeader(packet));
+    if (matchingNode == _nodes.end()) {
+        return NULL;
+    }
+
+    // several bots can share a socket and a server, the hash tells us which of them it was meant for
+    if (!NON_VERIFIED_PACKETS.contains(packetTypeForPacket(packet))
+        && hashFromPacketHeader(packet) != hashForPacketAndConnectionUUID(packet, matchingNode->connectionSecret)) {
+        return NULL;
+    }
+
+    return &matchingNode.value();
+}
+
+void SwarmBot::processNodePacket(SwarmNode& sendingNode, const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    sendingNode.packetsReceived++;
+    sendingNode.bytesReceived += packet.size();
+
+    PacketType packetType = packetTypeForPacket(packet);
+
+    if (packetType == PacketTypePing) {
+        QDataStream pingStream(packet);
+        pingStream.skipRawData(numBytesForPacketHeader(packet));
+
+        PingType_t pingType;
+        quint64 pingTime;
+        pingStream >> pingType >> pingTime;
+
+        QByteArray replyPacket = byteArrayWithPopulatedHeader(PacketTypePingReply, _sessionUUID);
+        QDataStream replyStream(&replyPacket, QIODevice::Append);
+        replyStream << pingType << pingTime << usecTimestampNow();
+
+        writeDatagram(replyPacket, sendingNode, senderSockAddr);
+
+    } else if (packetType == PacketTypePingReply) {
+        QDataStream replyStream(packet);
+        replyStream.skipRawData(numBytesForPacketHeader(packet));
+
+        PingType_t pingType;
+        quint64 ourOriginalTime;
+        replyStream >> pingType >> ourOriginalTime;
+
+        if (pingType == PingType::Local && sendingNode.activeSocket != sendingNode.localSocket) {
+            sendingNode.activeSocket = sendingNode.localSocket;
+        } else if (pingType == PingType::Public && sendingNode.activeSocket.isNull()) {
+            sendingNode.activeSocket = sendingNode.publicSocket;
+        }
+
+        sendingNode.pingRTT.updateAverage((float)(usecTimestampNow() - ourOriginalTime));
+    }
+}
+
+void SwarmBot::simulate(float deltaTime) {
+    // walk slowly around a small circle so the mixers and the entity server see us move
+    _wanderAngle += WANDER_ANGULAR_SPEED * deltaTime;
+    if (_wanderAngle > TWO_PI) {
+        _wanderAngle -= TWO_PI;
+    }
+
+    glm::vec3 position = _homePosition + WANDER_RADIUS * glm::vec3(cosf(_wanderAngle), 0.0f, sinf(_wanderAngle));
+    glm::quat orientation = glm::angleAxis(-_wanderAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    _avatarData.setPosition(position);
+    _avatarData.setOrientation(orientation);
+
+    _entityQuery.setCameraPosition(position);
+    _entityQuery.setCameraOrientation(orientation);
+}
+
+void SwarmBot::sendAvatarData() {
+    QByteArray avatarPacket;
+
+    foreach(const SwarmNode& node, _nodes) {
+        if (node.type == NodeType::AvatarMixer && !node.activeSocket.isNull()) {
+            if (avatarPacket.isEmpty()) {
+                avatarPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarData, _sessionUUID);
+                avatarPacket.append(_avatarData.toByteArray());
+            }
+            writeDatagram(avatarPacket, node, node.activeSocket);
+        }
+    }
+}
+
+void SwarmBot::sendAudioFrame() {
+    // a tone per bot, so the mix is something you can actually listen to
+    const int NUM_SAMPLES = AudioConstants::NETWORK_FRAME_SAMPLES_PER_CHANNEL;
+    int16_t samples[NUM_SAMPLES];
+
+    float phaseStep = TWO_PI * _toneFrequency / AudioConstants::SAMPLE_RATE;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        samples[i] = (int16_t)(TONE_AMPLITUDE * sinf(_tonePhase));
+        _tonePhase += phaseStep;
+    }
+    _tonePhase = fmodf(_tonePhase, TWO_PI);
+
+    glm::vec3 position = _avatarData.getPosition();
+    glm::quat orientation = _avatarData.getOrientation();
+
+    for (QHash<QUuid, SwarmNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
+        SwarmNode& node = it.value();
+        if (node.type == NodeType::AudioMixer && !node.activeSocket.isNull()) {
+            QByteArray audioPacket = byteArrayWithPopulatedHeader(PacketTypeMicrophoneAudioNoEcho, _sessionUUID);
+            QDataStream packetStream(&audioPacket, QIODevice::Append);
+
+            // mono, same layout the script engine uses for agent audio; the mixer reads the sequence number in native
+            // byte order, so it can't go through the stream's big-endian operator<<
+            quint16 sequence = node.outgoingAudioSequence++;
+            packetStream.writeRawData(reinterpret_cast<const char*>(&sequence), sizeof(quint16));
+            packetStream << (quint8)0;
+            packetStream.writeRawData(reinterpret_cast<const char*>(&position), sizeof(glm::vec3));
+            packetStream.writeRawData(reinterpret_cast<const char*>(&orientation), sizeof(glm::quat));
+            packetStream.writeRawData(reinterpret_cast<const char*>(samples), sizeof(samples));
+
+            writeDatagram(audioPacket, node, node.activeSocket);
+        }
+    }
+}
+
+void SwarmBot::sendEntityQuery() {
+    static unsigned char queryPacket[MAX_PACKET_SIZE];
+
+    foreach(const SwarmNode& node, _nodes) {
+        if (node.type == NodeType::EntityServer && !node.activeSocket.isNull()) {
+            unsigned char* endOfQueryPacket = queryPacket;
+            endOfQueryPacket += populatePacketHeader(reinterpret_cast<char*>(endOfQueryPacket), PacketTypeEntityQuery,
+                                                     _sessionUUID);
+            endOfQueryPacket += _entityQuery.getBroadcastData(endOfQueryPacket);
+
+            // entity queries are not verified
+            _socket->writeDatagram(reinterpret_cast<const char*>(queryPacket), endOfQueryPacket - queryPacket,
+                                   node.activeSocket.getAddress(), node.activeSocket.getPort());
+        }
+    }
+}
+
+void SwarmBot::pingNodes() {
+    foreach(const SwarmNode& node, _nodes) {
+        if (node.activeSocket.isNull()) {
+            // we don't have an active link to this node yet, ping punch both of its sockets
+            QByteArray localPingPacket = createPingPacket(PingType::Local);
+            writeDatagram(localPingPacket, node, node.localSocket);
+
+            QByteArray publicPingPacket = createPingPacket(PingType::Public);
+            writeDatagram(publicPingPacket, node, node.publicSocket);
+        } else if (node.type != NodeType::DomainServer) {
+            // this one is only for the round trip time
+            QByteArray pingPacket = createPingPacket(PingType::Agnostic);
+            writeDatagram(pingPacket, node, node.activeSocket);
+        }
+    }
+}
+
+QByteArray SwarmBot::createPingPacket(PingType_t pingType) const {
+    QByteArray pingPacket = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+    QDataStream packetStream(&pingPacket, QIODevice::Append);
+
+    packetStream << pingType << usecTimestampNow();
+
+    return pingPacket;
+}
+
+qint64 SwarmBot::writeDatagram(QByteArray& packet, const SwarmNode& destinationNode,
+                               const HifiSockAddr& destinationSockAddr) {
+    if (!destinationNode.connectionSecret.isNull()) {
+        replaceHashInPacketGivenConnectionUUID(packet, destinationNode.connectionSecret);
+    }
+    return _socket->writeDatagram(packet, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+}
@@ -0,0 +1,94 @@
+//
+//  SwarmBot.h
+//  tools/swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SwarmBot_h
+#define hifi_SwarmBot_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QUuid>
+#include <QtNetwork/QUdpSocket>
+
+#include <AvatarData.h>
+#include <HifiSockAddr.h>
+#include <LimitedNodeList.h>
+#include <Node.h>
+#include <OctreeQuery.h>
+#include <SimpleMovingAverage.h>
+
+/// A server one of the bots has been told about by the domain-server
+class SwarmNode {
+public:
+    SwarmNode();
+
+    QUuid uuid;
+    NodeType_t type;
+    HifiSockAddr publicSocket;
+    HifiSockAddr localSocket;
+    HifiSockAddr activeSocket;      // null until one of our pings has been answered
+    QUuid connectionSecret;
+
+    quint16 outgoingAudioSequence;
+
+    SimpleMovingAverage pingRTT;
+    quint64 packetsReceived;
+    quint64 bytesReceived;
+};
+
+/// A lightweight virtual client. It speaks just enough of the protocol to look like an interface to the domain-server
+/// and the mixers - domain check-ins, ping punching, avatar data, microphone audio and entity queries - without a
+/// NodeList of its own, so thousands of them can share one process and a small pool of sockets.
+class SwarmBot {
+public:
+    SwarmBot(int index, QUdpSocket* socket, const glm::vec3& homePosition);
+
+    int getIndex() const { return _index; }
+    QUdpSocket* getSocket() const { return _socket; }
+
+    const QUuid& getSessionUUID() const { return _sessionUUID; }
+    bool isConnected() const { return !_sessionUUID.isNull(); }
+
+    QByteArray createCheckInPacket(const QSet<NodeType_t>& nodeTypesOfInterest, const HifiSockAddr& localSockAddr) const;
+    void processDomainList(const QByteArray& packet, const QHostAddress& domainAddress);
+
+    /// returns the node this packet is from if it was sent to this bot, checking the hash when the header is verified
+    SwarmNode* nodeForPacket(const QByteArray& packet);
+    void processNodePacket(SwarmNode& sendingNode, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+
+    void simulate(float deltaTime);
+
+    void sendAvatarData();
+    void sendAudioFrame();
+    void sendEntityQuery();
+    void pingNodes();
+
+    const QHash<QUuid, SwarmNode>& getNodes() const { return _nodes; }
+
+private:
+    QByteArray createPingPacket(PingType_t pingType) const;
+    qint64 writeDatagram(QByteArray& packet, const SwarmNode& destinationNode, const HifiSockAddr& destinationSockAddr);
+
+    int _index;
+    QUdpSocket* _socket;
+    QUuid _sessionUUID;
+    QHash<QUuid, SwarmNode> _nodes;
+
+    glm::vec3 _homePosition;
+    float _wanderAngle;
+    float _tonePhase;
+    float _toneFrequency;
+
+    AvatarData _avatarData;
+    OctreeQuery _entityQuery;
+};
+
+#endif // hifi_SwarmBot_h